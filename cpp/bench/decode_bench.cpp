@@ -0,0 +1,399 @@
+// Microbenchmarks for the libdelila read side
+//
+// Inputs are bench_<profile>.delila files from the Rust bench_data tool,
+// which encodes events from the emulator's generator and frames them the
+// way the recorder does:
+//   cargo run --release --bin bench_data -- /tmp/delila_bench
+//   DELILA_BENCH_DATA=/tmp/delila_bench cpp/build/bench/delila_bench
+// Without DELILA_BENCH_DATA the files are generated once under /tmp with
+// the test writer (the same MessagePack encodings and pulse shapes,
+// DELILA_BENCH_MB per profile, default 64).
+//
+// Every benchmark runs on each profile (scalar, short, long, mixed) and
+// reports items/s as events/s and bytes/s as MB/s of data blocks read;
+// OpenFile counts files. Compare runs with Google Benchmark's compare.py.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "delila/columns.hpp"
+#include "delila/filter.hpp"
+#include "delila/histogram.hpp"
+#include "delila/pulse.hpp"
+#include "delila/reader.hpp"
+#include "delila/simd.hpp"
+#include "test_writer.hpp"
+
+#ifdef DELILA_BENCH_ROOT
+#include <TTree.h>
+#endif
+
+namespace {
+
+// Mirrors the profiles of src/bin/bench_data.rs
+struct Profile {
+    const char* name;
+    size_t events_per_batch;
+    uint64_t waveform_every;  // 0: no waveforms
+    size_t samples;
+    bool digital;             // Digital probes as well as analog
+};
+
+const Profile PROFILES[] = {
+    {"scalar", 50000, 0, 0, false},
+    {"short", 1000, 1, 256, false},
+    {"long", 16, 1, 16384, true},
+    {"mixed", 5000, 10, 1024, false},
+};
+
+// Pulse of data_source_emulator::generate_waveform: baseline, linear rise,
+// exponential decay; digital probes one bit per sample
+delila::Waveform pulse(std::mt19937_64& rng, uint16_t energy, size_t n, bool digital) {
+    delila::Waveform wf;
+    int16_t baseline = static_cast<int16_t>(std::uniform_int_distribution<int>(-50, 49)(rng));
+    double amplitude = static_cast<int16_t>(energy / 65535.0 * 8000.0);
+    size_t start = std::uniform_int_distribution<size_t>(n / 4, n / 2 - 1)(rng);
+    const size_t rise = 5;
+    const double tau = 50.0;
+    wf.analog_probe1.resize(n);
+    wf.analog_probe2.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        double p1 = 0;
+        double p2 = 0;
+        if (i >= start && i < start + rise) {
+            p1 = amplitude * static_cast<double>(i - start) / rise;
+            p2 = amplitude / 4;
+        } else if (i >= start + rise) {
+            double decay = std::exp(-static_cast<double>(i - start - rise) / tau);
+            p1 = amplitude * decay;
+            if (i < start + rise + 100) p2 = -(amplitude / 4) * decay;
+        }
+        wf.analog_probe1[i] = static_cast<int16_t>(baseline + static_cast<int16_t>(p1));
+        wf.analog_probe2[i] = static_cast<int16_t>(p2);
+    }
+    if (digital) {
+        std::vector<uint8_t>* probes[] = {&wf.digital_probe1, &wf.digital_probe2,
+                                          &wf.digital_probe3, &wf.digital_probe4};
+        const size_t widths[] = {50, 100, 30, 0};
+        for (int p = 0; p < 4; p++) {
+            probes[p]->assign((n + 7) / 8, 0);
+            for (size_t i = start; i < std::min(start + widths[p], n); i++) {
+                (*probes[p])[i / 8] |= static_cast<uint8_t>(1u << (i % 8));
+            }
+        }
+    }
+    wf.trigger_threshold = 100;
+    return wf;
+}
+
+// Events of data_source_emulator::generate_event (module 0, 16 channels)
+std::vector<uint8_t> generate_file(const Profile& profile, uint64_t target_bytes) {
+    std::mt19937_64 rng(1);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<delila_test::TestBatch> batches;
+    double ts = 0;
+    uint64_t n = 0;
+    uint64_t bytes = 0;
+    while (bytes < target_bytes) {
+        delila_test::TestBatch b;
+        for (size_t i = 0; i < profile.events_per_batch; i++, n++) {
+            delila::Event ev;
+            ev.channel = static_cast<uint8_t>(rng() % 16);
+            double e = unit(rng) < 0.3
+                           ? static_cast<double>(rng() % 4096)
+                           : std::normal_distribution<double>(ev.channel * 50.0 + 500.0, 50.0)(rng);
+            ev.energy = static_cast<uint16_t>(std::min(std::max(e, 0.0), 65535.0));
+            ev.energy_short = static_cast<uint16_t>(ev.energy * (0.7 + 0.1 * unit(rng)));
+            ts += 10.0 + 990.0 * unit(rng);
+            ev.timestamp_ns = ts;
+            ev.flags = rng() % 100 == 0 ? 0x01 : 0;
+            if (profile.waveform_every > 0 && n % profile.waveform_every == 0) {
+                ev.has_waveform = true;
+                ev.waveform = pulse(rng, ev.energy, profile.samples, profile.digital);
+                bytes += profile.samples * 4 + (profile.digital ? profile.samples / 2 : 0);
+            }
+            bytes += 22;
+            b.events.push_back(std::move(ev));
+        }
+        batches.push_back(std::move(b));
+    }
+    return delila_test::build_file(batches);
+}
+
+bool exists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+// Path of the profile's file, generating it if there is no bench_data output
+std::string input_file(const Profile& profile) {
+    const char* dir = std::getenv("DELILA_BENCH_DATA");
+    std::string name = std::string("bench_") + profile.name + ".delila";
+    if (dir) return std::string(dir) + "/" + name;
+
+    std::string path = "/tmp/delila_" + name;
+    if (!exists(path)) {
+        const char* mb = std::getenv("DELILA_BENCH_MB");
+        uint64_t target = (mb ? std::strtoull(mb, nullptr, 10) : 64) * 1000000ULL;
+        std::fprintf(stderr, "Generating %s ...\n", path.c_str());
+        std::vector<uint8_t> image = generate_file(profile, target);
+        std::ofstream f(path, std::ios::binary);
+        f.write(reinterpret_cast<const char*>(image.data()),
+                static_cast<std::streamsize>(image.size()));
+    }
+    return path;
+}
+
+// Open `path` or fail the benchmark
+bool open_or_skip(benchmark::State& state, delila::FileReader& reader, const std::string& path,
+                  delila::ReadMode mode = delila::ReadMode::Mmap) {
+    if (!reader.open(path, mode)) {
+        state.SkipWithError(reader.error().c_str());
+        return false;
+    }
+    return true;
+}
+
+// Events and data bytes of one pass over the file
+void set_processed(benchmark::State& state, const delila::FileReader& reader) {
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * reader.footer().total_events));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * reader.footer().data_bytes));
+}
+
+void OpenFile(benchmark::State& state, const std::string& path) {
+    for (auto _ : state) {
+        delila::FileReader reader;
+        if (!open_or_skip(state, reader, path)) return;
+        benchmark::DoNotOptimize(reader.footer().total_events);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// Read-ahead stall counters per pass: decoder_waits high means I/O-bound,
+// io_waits high means decode-bound
+void set_read_ahead_counters(benchmark::State& state, const delila::FileReader& reader) {
+    if (reader.mode() != delila::ReadMode::ReadAhead) return;
+    delila::ReadAheadStats stats = reader.read_ahead_stats();
+    auto per_pass = benchmark::Counter::kAvgIterations;
+    state.counters["decoder_waits"] = benchmark::Counter(static_cast<double>(stats.decoder_waits), per_pass);
+    state.counters["io_waits"] = benchmark::Counter(static_cast<double>(stats.io_waits), per_pass);
+    state.counters["decoder_wait_s"] = benchmark::Counter(stats.decoder_wait_seconds, per_pass);
+    state.counters["io_wait_s"] = benchmark::Counter(stats.io_wait_seconds, per_pass);
+}
+
+void IterateBlocks(benchmark::State& state, const std::string& path, delila::ReadMode mode) {
+    delila::FileReader reader;
+    if (!open_or_skip(state, reader, path, mode)) return;
+    delila::BlockView block;
+    for (auto _ : state) {
+        reader.rewind();
+        while (reader.next_block(block)) {
+            // One byte per cache line: mmap hands out pointers only, so the
+            // bytes/s would otherwise count data that was never read
+            uint8_t sum = 0;
+            for (size_t i = 0; i < block.size; i += 64) sum ^= block.data[i];
+            benchmark::DoNotOptimize(sum);
+        }
+    }
+    set_processed(state, reader);
+    set_read_ahead_counters(state, reader);
+}
+
+void DecodeColumns(benchmark::State& state, const std::string& path, bool waveforms,
+                   delila::ReadMode mode) {
+    delila::FileReader reader;
+    if (!open_or_skip(state, reader, path, mode)) return;
+    delila::BatchHeader header;
+    delila::EventColumns cols;
+    for (auto _ : state) {
+        reader.rewind();
+        while (reader.next_columns(header, cols, waveforms)) benchmark::DoNotOptimize(cols.size());
+    }
+    set_processed(state, reader);
+    set_read_ahead_counters(state, reader);
+}
+
+// Channel-selective extraction: one of the 16 channels, waveforms decoded
+// for the accepted events only
+void DecodeFiltered(benchmark::State& state, const std::string& path) {
+    delila::FileReader reader;
+    if (!open_or_skip(state, reader, path)) return;
+    delila::EventFilter filter;
+    filter.select(0, 3);
+    delila::BatchHeader header;
+    delila::EventColumns cols;
+    for (auto _ : state) {
+        reader.rewind();
+        while (reader.next_columns(header, cols, filter)) benchmark::DoNotOptimize(cols.size());
+    }
+    set_processed(state, reader);
+}
+
+void DecodeEvents(benchmark::State& state, const std::string& path) {
+    delila::FileReader reader;
+    if (!open_or_skip(state, reader, path)) return;
+    delila::BatchHeader header;
+    std::vector<delila::Event> events;
+    for (auto _ : state) {
+        reader.rewind();
+        while (reader.next_batch(header, events)) benchmark::DoNotOptimize(events.data());
+    }
+    set_processed(state, reader);
+}
+
+void VerifyChecksum(benchmark::State& state, const std::string& path) {
+    delila::FileReader reader;
+    if (!open_or_skip(state, reader, path)) return;
+    for (auto _ : state) {
+        if (reader.verify_checksum(static_cast<unsigned>(state.range(0))) !=
+            delila::ChecksumStatus::Match) {
+            state.SkipWithError("checksum does not match");
+            return;
+        }
+    }
+    set_processed(state, reader);
+}
+
+// Overview, PSD and per-channel spectra of the file on range(0) threads
+// (0: all cores), as histogram_delila() in read_delila.C
+void FillHistograms(benchmark::State& state, const std::string& path) {
+    delila::FileReader reader;
+    if (!open_or_skip(state, reader, path)) return;
+    delila::HistogramOptions opt;
+    opt.psd = true;
+    opt.per_channel = true;
+    for (auto _ : state) {
+        delila::HistogramSet h =
+            delila::fill_histograms({path}, opt, static_cast<unsigned>(state.range(0)));
+        benchmark::DoNotOptimize(h.events());
+    }
+    set_processed(state, reader);
+}
+
+// Baseline, gate charges and CFD time of every waveform on one thread, with
+// the SIMD level range(0) (a SimdLevel), as macros/reprocess_pulses.C
+void ReprocessPulses(benchmark::State& state, const std::string& path) {
+    delila::FileReader reader;
+    if (!open_or_skip(state, reader, path)) return;
+    delila::SimdLevel saved = delila::simd_level();
+    if (!delila::set_simd_level(static_cast<delila::SimdLevel>(state.range(0)))) {
+        state.SkipWithError("SIMD level not supported");
+        return;
+    }
+    state.SetLabel(delila::simd_level_name(delila::simd_level()));
+    delila::PsdParameters par;
+    par.polarity = "Positive";
+    for (auto _ : state) {
+        double sum = 0;
+        delila::reprocess_pulses({path}, par, [&](const delila::PulseBlock& b) {
+            if (b.pulses.size() > 0) sum += b.pulses.q_long[0];
+        }, 1);
+        benchmark::DoNotOptimize(sum);
+    }
+    delila::set_simd_level(saved);
+    set_processed(state, reader);
+}
+
+#ifdef DELILA_BENCH_ROOT
+// Decode + fill the scalar branches and analog_probe1 of an in-memory tree
+// (what convert_to_tree.C does per event, without the file I/O)
+void TreeFill(benchmark::State& state, const std::string& path) {
+    delila::FileReader reader;
+    if (!open_or_skip(state, reader, path)) return;
+    delila::BatchHeader header;
+    delila::EventColumns cols;
+    for (auto _ : state) {
+        TTree tree("bench", "bench");
+        tree.SetDirectory(nullptr);
+        UChar_t module, channel;
+        UShort_t energy, energy_short;
+        Double_t timestamp_ns;
+        ULong64_t flags;
+        std::vector<int16_t> probe1;
+        tree.Branch("module", &module, "module/b");
+        tree.Branch("channel", &channel, "channel/b");
+        tree.Branch("energy", &energy, "energy/s");
+        tree.Branch("energy_short", &energy_short, "energy_short/s");
+        tree.Branch("timestamp_ns", &timestamp_ns, "timestamp_ns/D");
+        tree.Branch("flags", &flags, "flags/l");
+        tree.Branch("analog_probe1", &probe1);
+
+        reader.rewind();
+        while (reader.next_columns(header, cols)) {
+            for (size_t i = 0; i < cols.size(); i++) {
+                module = cols.module[i];
+                channel = cols.channel[i];
+                energy = cols.energy[i];
+                energy_short = cols.energy_short[i];
+                timestamp_ns = cols.timestamp_ns[i];
+                flags = cols.flags[i];
+                probe1.clear();
+                if (cols.has_waveform(i)) {
+                    size_t w = static_cast<size_t>(cols.waveform_index[i]);
+                    const int16_t* p = cols.analog_probe1.data(w);
+                    probe1.assign(p, p + cols.analog_probe1.size(w));
+                }
+                tree.Fill();
+            }
+        }
+    }
+    set_processed(state, reader);
+}
+#endif
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+    for (const Profile& profile : PROFILES) {
+        std::string path = input_file(profile);
+        std::string p = profile.name;
+        benchmark::RegisterBenchmark(("OpenFile/" + p).c_str(), OpenFile, path);
+        benchmark::RegisterBenchmark(("IterateBlocks/mmap/" + p).c_str(), IterateBlocks, path,
+                                     delila::ReadMode::Mmap);
+        benchmark::RegisterBenchmark(("IterateBlocks/stream/" + p).c_str(), IterateBlocks, path,
+                                     delila::ReadMode::Stream);
+        // Real time: the work is split with the I/O thread
+        benchmark::RegisterBenchmark(("IterateBlocks/readahead/" + p).c_str(), IterateBlocks, path,
+                                     delila::ReadMode::ReadAhead)
+            ->UseRealTime();
+        benchmark::RegisterBenchmark(("DecodeScalar/" + p).c_str(), DecodeColumns, path, false,
+                                     delila::ReadMode::Mmap);
+        benchmark::RegisterBenchmark(("DecodeWaveforms/" + p).c_str(), DecodeColumns, path, true,
+                                     delila::ReadMode::Mmap);
+        benchmark::RegisterBenchmark(("DecodeWaveforms/stream/" + p).c_str(), DecodeColumns, path,
+                                     true, delila::ReadMode::Stream);
+        benchmark::RegisterBenchmark(("DecodeWaveforms/readahead/" + p).c_str(), DecodeColumns,
+                                     path, true, delila::ReadMode::ReadAhead)
+            ->UseRealTime();
+        benchmark::RegisterBenchmark(("DecodeFiltered/channel/" + p).c_str(), DecodeFiltered, path);
+        benchmark::RegisterBenchmark(("DecodeEvents/" + p).c_str(), DecodeEvents, path);
+        benchmark::RegisterBenchmark(("VerifyChecksum/" + p).c_str(), VerifyChecksum, path)
+            ->Arg(1)
+            ->Arg(0);
+        benchmark::RegisterBenchmark(("FillHistograms/" + p).c_str(), FillHistograms, path)
+            ->Arg(1)
+            ->Arg(0)
+            ->UseRealTime();
+        benchmark::RegisterBenchmark(("ReprocessPulses/" + p).c_str(), ReprocessPulses, path)
+            ->Arg(static_cast<int>(delila::SimdLevel::Scalar))
+            ->Arg(static_cast<int>(delila::SimdLevel::AVX2));
+#ifdef DELILA_BENCH_ROOT
+        benchmark::RegisterBenchmark(("TreeFill/" + p).c_str(), TreeFill, path);
+#endif
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
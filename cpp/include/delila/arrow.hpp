@@ -0,0 +1,96 @@
+// Apache Arrow / Parquet export (libdelila_arrow, needs Arrow and Parquet)
+//
+// One row per event, one Arrow RecordBatch per decoded block:
+//   module, channel (uint8), energy, energy_short (uint16), timestamp_ns
+//   (float64), flags (uint64), and with waveforms time_resolution (uint8),
+//   trigger_threshold (uint16), analog_probe1..2 (list<int16>) and
+//   digital_probe1..4 (list<uint8>), null for events without a waveform.
+//
+// Parquet output has one row group per block (so a query's row-group
+// statistics prune like the block index does), zstd pages, dictionary
+// encoding for module and channel and BYTE_STREAM_SPLIT for timestamp_ns
+// (Parquet's delta encodings are for integers only). IPC stream output
+// ("-" for stdout) lets other tools read the batches from a pipe:
+//
+//   delila::ArrowWriter out;
+//   delila::ArrowOptions opt;
+//   opt.format = delila::ArrowFormat::Parquet;
+//   out.open("run0010.parquet", opt);
+//   while (reader.next_columns(batch, cols)) out.write(cols);
+//   out.close();
+//
+// or, for whole runs, export_arrow(chain.files(), "run0010.parquet", opt);
+// From the shell: delila-arrow --ipc - data/run0010_*.delila | duckdb ...
+
+#pragma once
+
+#include <arrow/api.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "delila/columns.hpp"
+#include "delila/filter.hpp"
+#include "delila/metrics.hpp"
+
+namespace delila {
+
+enum class ArrowFormat {
+    Parquet,    // One row group per block
+    IpcStream,  // Arrow IPC streaming format, one message per block
+};
+
+struct ArrowOptions {
+    ArrowFormat format = ArrowFormat::Parquet;
+    bool waveforms = true;     // Waveform columns (and decoding them)
+    int compression_level = 3; // Parquet zstd level
+};
+
+// Columns of ArrowOptions::waveforms
+std::shared_ptr<arrow::Schema> arrow_schema(bool waveforms = true);
+
+// One decoded block as a RecordBatch of arrow_schema(waveforms). The scalar
+// columns and probe samples refer to `cols`' buffers (no copy), so keep
+// `cols` unchanged while the batch is in use.
+arrow::Result<std::shared_ptr<arrow::RecordBatch>> to_record_batch(const EventColumns& cols,
+                                                                   bool waveforms = true);
+
+class ArrowWriter {
+public:
+    ArrowWriter();
+    ~ArrowWriter();  // Closes
+
+    // Create `path` ("-": stdout, IPC stream only). False (see error()) on failure.
+    bool open(const std::string& path, const ArrowOptions& options = ArrowOptions());
+    // One block: a record batch, or a Parquet row group (empty blocks are skipped)
+    bool write(const EventColumns& cols);
+    // Finish the file (Parquet footer, IPC end-of-stream)
+    bool close();
+
+    const std::string& error() const { return error_; }
+    uint64_t rows() const { return rows_; }
+    size_t batches() const { return batches_; }
+
+private:
+    struct Impl;
+    bool fail(const arrow::Status& status);
+
+    std::unique_ptr<Impl> impl_;
+    ArrowOptions options_;
+    std::string error_;
+    uint64_t rows_ = 0;
+    size_t batches_ = 0;
+};
+
+// Every event of `paths`, in file and block order, to `output`. Files that
+// cannot be read, and damaged blocks, are reported in `errors` and skipped;
+// false (and `errors`) if the output cannot be written. Stage times and
+// counters go to `metrics` if given (see metrics.hpp).
+bool export_arrow(const std::vector<std::string>& paths, const std::string& output,
+                  const ArrowOptions& options = ArrowOptions(), const EventFilter* filter = nullptr,
+                  std::vector<std::string>* errors = nullptr, Metrics* metrics = nullptr);
+
+}  // namespace delila
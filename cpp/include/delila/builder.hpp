@@ -0,0 +1,103 @@
+// Coincidence event building over the time-ordered stream
+//
+// EventBuilder pulls hits from a TimeMerger in timestamp_ns order and
+// groups them in one pass: a window opens at a trigger hit (or at any hit
+// when no trigger channels are given) and collects every hit up to
+// window_ns after it, and pre_window_ns before it. Each hit goes into at
+// most one built event; hits never inside a window are dropped. Only the
+// hits of the open window are held, so the cost is O(n) in the number of
+// hits and memory is that of the merger plus one window.
+//
+//   delila::TimeMerger merger;
+//   merger.add_input().add_run("data", 42);
+//   delila::BuilderOptions options;
+//   options.window_ns = 500;
+//   options.triggers = {{0, 3}};              // module 0, channel 3
+//   options.min_multiplicity = 2;
+//   delila::EventBuilder builder(merger, options);
+//   delila::BuiltEvent ev;
+//   while (builder.next(ev)) { ... ev.hits, ev.trigger_ts ... }
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "delila/event.hpp"
+#include "delila/merge.hpp"
+
+namespace delila {
+
+// A (module, channel) that opens windows; -1 matches any
+struct TriggerChannel {
+    int module = -1;
+    int channel = -1;
+
+    bool matches(const Event& ev) const {
+        return (module < 0 || module == ev.module) && (channel < 0 || channel == ev.channel);
+    }
+};
+
+struct BuilderOptions {
+    double window_ns = 1000.0;      // After the opening hit
+    double pre_window_ns = 0.0;     // Before the trigger (trigger mode only)
+    bool extend_window = false;     // Window closes window_ns after the last hit
+                                    // joined instead of after the opening hit
+    std::vector<TriggerChannel> triggers;  // Empty: any hit opens a window
+    size_t min_multiplicity = 1;    // Hits per built event, trigger included
+    size_t max_multiplicity = 0;    // 0: no limit
+};
+
+struct BuiltEvent {
+    double trigger_ts = 0.0;        // Timestamp of the opening hit
+    size_t trigger = 0;             // Its position in hits
+    std::vector<Event> hits;        // In timestamp_ns order
+    std::vector<uint32_t> source_ids;
+
+    size_t multiplicity() const { return hits.size(); }
+};
+
+struct BuilderStats {
+    uint64_t hits = 0;              // Read from the merger
+    uint64_t hits_used = 0;         // In built events that passed the cuts
+    uint64_t events = 0;
+    uint64_t rejected = 0;          // Windows failing the multiplicity cuts
+};
+
+class EventBuilder {
+public:
+    EventBuilder(TimeMerger& source, BuilderOptions options = BuilderOptions())
+        : source_(source), options_(std::move(options)) {}
+
+    // Next built event passing the cuts. `event` is overwritten. False at
+    // the end of the stream.
+    bool next(BuiltEvent& event);
+
+    const BuilderStats& stats() const { return stats_; }
+    const BuilderOptions& options() const { return options_; }
+
+private:
+    struct Hit {
+        Event event;
+        uint32_t source_id = 0;
+    };
+
+    // Append the next hit of the merger to pending_. False at the end.
+    bool pull();
+    bool opens_window(const Event& ev) const;
+
+    // Position of the next opening hit in pending_ (older hits that no
+    // window can reach are dropped). False at the end of the stream.
+    bool find_opener(size_t& open);
+
+    TimeMerger& source_;
+    BuilderOptions options_;
+    std::deque<Hit> pending_;
+    Event next_;
+    BuilderStats stats_;
+};
+
+}  // namespace delila
@@ -0,0 +1,97 @@
+// Several .delila files read as one stream
+//
+// The recorder splits a run into run{RUN}_{SEQ}_{exp}.delila files. A
+// FileChain opens them one at a time in (run, sequence) order, so memory
+// use is that of a single FileReader however long the run is.
+//
+//   delila::FileChain chain;
+//   chain.add_run("data", 42);              // or add_glob("data/run0042_*.delila")
+//   delila::EventColumns cols;
+//   delila::BatchHeader batch;
+//   while (chain.next_columns(batch, cols)) { ... }
+//   for (const auto& e : chain.errors()) { ... damaged or unreadable file ... }
+//
+// Live runs: with set_follow(true) the chain waits at the end of the last
+// file while it has no footer. refresh() then picks up appended blocks and
+// files the recorder created meanwhile (added globs / runs are re-scanned).
+//   chain.set_follow(true);
+//   for (;;) {
+//       while (chain.next_columns(batch, cols)) { ... }
+//       sleep(1);
+//       chain.refresh();
+//   }
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "delila/columns.hpp"
+#include "delila/event.hpp"
+#include "delila/reader.hpp"
+
+namespace delila {
+
+class FileChain {
+public:
+    // Add files matching a glob pattern (only *.delila, sidecars are skipped).
+    // Returns false if nothing matched.
+    bool add_glob(const std::string& pattern);
+
+    // Add every file of a run: <directory>/run{run_number:04}_*.delila
+    bool add_run(const std::string& directory, uint32_t run_number);
+
+    void add_file(const std::string& path);
+
+    // Files in read order: (run, sequence) parsed from the name, then name
+    const std::vector<std::string>& files() const { return files_; }
+
+    // Read and decode the next block of the chain, opening files as needed.
+    // A file that cannot be opened or stops on a damaged block is recorded in
+    // errors() and reading continues with the next file.
+    bool next_batch(BatchHeader& header, std::vector<Event>& events);
+    bool next_columns(BatchHeader& header, EventColumns& cols, bool decode_waveforms = true);
+    bool next_columns(BatchHeader& header, EventColumns& cols, const EventFilter& filter,
+                      bool decode_waveforms = true);
+
+    // Follow mode (see above); set before reading
+    void set_follow(bool on);
+    bool follow() const { return follow_; }
+
+    // Re-scan the glob patterns for new files and pick up data appended to
+    // the current file. Returns true if there is anything new to read.
+    bool refresh();
+
+    // Restart at the first file
+    void rewind();
+
+    // Reader of the current file (valid while next_* returns true)
+    const FileReader& reader() const { return reader_; }
+    size_t file_index() const { return file_index_; }
+
+    const std::vector<std::string>& errors() const { return errors_; }
+    size_t blocks_read() const { return blocks_read_ + (opened_ ? reader_.blocks_read() : 0); }
+    uint64_t bytes_read() const { return bytes_read_ + (opened_ ? reader_.bytes_read() : 0); }
+
+private:
+    void sort_files();
+
+    // Apply `read` to the current reader, moving through files until it
+    // yields a block. False at end of chain.
+    template <typename Read>
+    bool next(Read read);
+
+    std::vector<std::string> files_;
+    std::vector<std::string> patterns_;  // For refresh()
+    bool follow_ = false;
+    size_t file_index_ = 0;
+    bool opened_ = false;  // reader_ holds files_[file_index_]
+    FileReader reader_;
+    std::vector<std::string> errors_;
+    size_t blocks_read_ = 0;    // Files already finished
+    uint64_t bytes_read_ = 0;
+};
+
+}  // namespace delila
@@ -0,0 +1,73 @@
+// Data checksum of .delila files (footer.data_checksum)
+//
+// The recorder's ChecksumCalculator (src/recorder/format.rs) hashes every
+// length prefix and every block payload on its own with xxh64(seed 0) and
+// folds the hashes as state = rotl(state, 5) ^ hash, then xors in the byte
+// count. Piece k of M therefore ends up rotated by 5 * (M - 1 - k), so the
+// fold can be computed in any order once each piece knows its position:
+// BlockChecksum lets worker threads hash disjoint blocks and merge.
+//
+//   delila::BlockChecksum sum;
+//   sum.add(block.index, block.data, block.size);   // any thread, own instance
+//   total.merge(sum);
+//   bool ok = total.finalize() == reader.footer().data_checksum;
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace delila {
+
+// XXH64 of `len` bytes
+uint64_t xxh64(const void* data, size_t len, uint64_t seed = 0);
+
+// Sequential port of the Rust ChecksumCalculator
+class ChecksumCalculator {
+public:
+    void update(const void* data, size_t len);
+    uint64_t finalize() const { return state_ ^ bytes_processed_; }
+    uint64_t bytes_processed() const { return bytes_processed_; }
+    void reset() { state_ = bytes_processed_ = 0; }
+
+private:
+    uint64_t state_ = 0;
+    uint64_t bytes_processed_ = 0;
+};
+
+// Same checksum, accumulated block by block in any order
+class BlockChecksum {
+public:
+    // Block `index` (0-based position in the file) with its payload; the
+    // length prefix is rebuilt from `size`. Each block must be added once.
+    void add(uint64_t index, const uint8_t* payload, uint32_t size);
+
+    // Fold in blocks hashed elsewhere (disjoint indices)
+    void merge(const BlockChecksum& other);
+
+    // Checksum over blocks [0, blocks()) - equal to the footer's once all
+    // blocks of the file were added
+    uint64_t finalize() const;
+
+    uint64_t blocks() const { return blocks_; }
+    uint64_t bytes() const { return bytes_; }         // Length prefixes included
+    void reset() { acc_ = blocks_ = bytes_ = 0; }
+
+    // Partial sum as (state(), blocks(), bytes()), to be merged in another
+    // process (partition.hpp writes it to the partition result)
+    uint64_t state() const { return acc_; }
+    static BlockChecksum from_state(uint64_t state, uint64_t blocks, uint64_t bytes) {
+        BlockChecksum sum;
+        sum.acc_ = state;
+        sum.blocks_ = blocks;
+        sum.bytes_ = bytes;
+        return sum;
+    }
+
+private:
+    uint64_t acc_ = 0;     // XOR of rotr(hash_k, 5k)
+    uint64_t blocks_ = 0;
+    uint64_t bytes_ = 0;
+};
+
+}  // namespace delila
@@ -0,0 +1,93 @@
+// Columnar (struct-of-arrays) event layout
+//
+// One contiguous array per scalar field, so histogram fill loops walk
+// dense memory and vectorize. Waveform probes live in one flat sample
+// buffer per probe, addressed CSR-style by per-waveform offsets; events
+// without a waveform cost nothing there.
+//
+//   EventColumns cols;
+//   while (reader.next_columns(batch, cols)) {
+//       for (size_t i = 0; i < cols.size(); i++) h->Fill(cols.energy[i]);
+//       int32_t w = cols.waveform_index[0];
+//       if (w != NO_WAVEFORM) {
+//           const int16_t* s = cols.analog_probe1.data(w);
+//           size_t n = cols.analog_probe1.size(w);
+//       }
+//   }
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace delila {
+
+constexpr int32_t NO_WAVEFORM = -1;
+
+// Scalar columns, for decoding only some of them (see
+// FileReader::decode_block): the others are left empty. waveform_index,
+// and so size(), is always filled.
+constexpr uint32_t FIELD_MODULE = 1u << 0;
+constexpr uint32_t FIELD_CHANNEL = 1u << 1;
+constexpr uint32_t FIELD_ENERGY = 1u << 2;
+constexpr uint32_t FIELD_ENERGY_SHORT = 1u << 3;
+constexpr uint32_t FIELD_TIMESTAMP_NS = 1u << 4;
+constexpr uint32_t FIELD_FLAGS = 1u << 5;
+constexpr uint32_t ALL_FIELDS = 0x3f;
+
+// Samples of one probe for every waveform in a batch
+template <typename T>
+struct ProbeColumn {
+    std::vector<T> samples;               // All waveforms back to back
+    std::vector<uint32_t> offsets{0};     // Waveform w: [offsets[w], offsets[w + 1])
+
+    const T* data(size_t w) const { return samples.data() + offsets[w]; }
+    size_t size(size_t w) const { return offsets[w + 1] - offsets[w]; }
+
+    // Close the waveform whose samples were just appended
+    void end_waveform() { offsets.push_back(static_cast<uint32_t>(samples.size())); }
+
+    void clear() {
+        samples.clear();
+        offsets.assign(1, 0);
+    }
+};
+
+struct EventColumns {
+    // Per event
+    std::vector<uint8_t> module;
+    std::vector<uint8_t> channel;
+    std::vector<uint16_t> energy;
+    std::vector<uint16_t> energy_short;
+    std::vector<double> timestamp_ns;
+    std::vector<uint64_t> flags;
+    std::vector<int32_t> waveform_index;  // Waveform number, or NO_WAVEFORM
+
+    // Per waveform
+    std::vector<uint8_t> time_resolution;
+    std::vector<uint16_t> trigger_threshold;
+    ProbeColumn<int16_t> analog_probe1;
+    ProbeColumn<int16_t> analog_probe2;
+    ProbeColumn<uint8_t> digital_probe1;
+    ProbeColumn<uint8_t> digital_probe2;
+    ProbeColumn<uint8_t> digital_probe3;
+    ProbeColumn<uint8_t> digital_probe4;
+
+    size_t size() const { return waveform_index.size(); }
+    bool empty() const { return waveform_index.empty(); }
+    size_t num_waveforms() const { return time_resolution.size(); }
+    bool has_waveform(size_t i) const { return waveform_index[i] != NO_WAVEFORM; }
+
+    // Keeps capacity so a reused EventColumns does not reallocate
+    void clear();
+
+    // Grow the per-event columns in `fields` (and waveform_index) to n
+    // events; new entries are zeroed
+    void resize_events(size_t n, uint32_t fields = ALL_FIELDS);
+
+    // Append events [first, first + count) of `src`, waveforms included
+    void append(const EventColumns& src, size_t first, size_t count);
+};
+
+}  // namespace delila
@@ -0,0 +1,65 @@
+// Per-block compression of v3 (.delila "DELILA03") files
+//
+// Mirrors encode_block() / decode_block() in src/recorder/format.rs. In a v3
+// file every length prefix is followed by an 8-byte block header
+//   u8 compression (Compression), 3 bytes zero, u32_le MessagePack size
+// and the MessagePack batch, stored as is, as an LZ4 block or as a zstd
+// frame. The length prefix counts header + stored bytes, so framing, the
+// index and the footer checksum are the same as in v2.
+//
+// FileReader::decode_block() decompresses on the thread that calls it, into
+// a per-thread buffer: decoding views on worker threads (view_block(),
+// RDataFrame, for_each_parallel()) spreads decompression over the workers.
+//
+//   size_t size;
+//   std::vector<uint8_t> scratch;
+//   const uint8_t* msgpack = delila::block_payload(block.data, block.size, scratch, size, &err);
+//
+// The codecs are compiled in when liblz4 / libzstd are found at build time
+// (compression_available()); without them such blocks fail to decode with
+// an error naming the missing codec.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace delila {
+
+enum class Compression : uint8_t {
+    None = 0,
+    Lz4 = 1,   // LZ4 block format
+    Zstd = 2,  // zstd frame
+};
+
+constexpr size_t BLOCK_HEADER_SIZE = 8;
+
+struct BlockHeader {
+    Compression compression = Compression::None;
+    uint32_t raw_size = 0;  // MessagePack bytes once decompressed
+};
+
+const char* compression_name(Compression compression);
+
+// Whether this build can decode (and encode) `compression`
+bool compression_available(Compression compression);
+
+// Parse the block header at the start of a v3 block. False if `size` is too
+// small or the codec id is unknown.
+bool parse_block_header(const uint8_t* data, size_t size, BlockHeader& header);
+
+// MessagePack payload of the v3 block `data` (the bytes after the length
+// prefix): a pointer into `data` for stored blocks, into `scratch` for
+// compressed ones (resized, capacity kept). nullptr on error.
+const uint8_t* block_payload(const uint8_t* data, size_t size, std::vector<uint8_t>& scratch,
+                             size_t& payload_size, std::string* error = nullptr);
+
+// Frame `size` bytes of MessagePack as a v3 block (block header + payload)
+// into `out`. `level` is the zstd level. Stored uncompressed when
+// compression does not make the block smaller, as the recorder does.
+bool encode_block(const uint8_t* data, size_t size, Compression compression, int level,
+                  std::vector<uint8_t>& out, std::string* error = nullptr);
+
+}  // namespace delila
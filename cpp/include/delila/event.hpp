@@ -0,0 +1,58 @@
+// Event data structures (match Rust EventData / Waveform in src/common/mod.rs)
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace delila {
+
+// Waveform data structure
+struct Waveform {
+    std::vector<int16_t> analog_probe1;
+    std::vector<int16_t> analog_probe2;
+    std::vector<uint8_t> digital_probe1;
+    std::vector<uint8_t> digital_probe2;
+    std::vector<uint8_t> digital_probe3;
+    std::vector<uint8_t> digital_probe4;
+    uint8_t time_resolution = 0;
+    uint16_t trigger_threshold = 0;
+
+    // Keeps vector capacity so a reused Waveform does not reallocate
+    void clear() {
+        analog_probe1.clear();
+        analog_probe2.clear();
+        digital_probe1.clear();
+        digital_probe2.clear();
+        digital_probe3.clear();
+        digital_probe4.clear();
+        time_resolution = 0;
+        trigger_threshold = 0;
+    }
+
+    bool has_data() const {
+        return !analog_probe1.empty() || !analog_probe2.empty();
+    }
+};
+
+// Event data structure (matches Rust EventData)
+struct Event {
+    uint8_t module = 0;
+    uint8_t channel = 0;
+    uint16_t energy = 0;
+    uint16_t energy_short = 0;
+    double timestamp_ns = 0.0;
+    uint64_t flags = 0;
+    bool has_waveform = false;
+    Waveform waveform;
+};
+
+// Batch envelope (matches Rust EventDataBatch, minus the events)
+struct BatchHeader {
+    uint32_t source_id = 0;
+    uint64_t sequence_number = 0;
+    uint64_t timestamp = 0;
+    size_t num_events = 0;
+};
+
+}  // namespace delila
@@ -0,0 +1,124 @@
+// Event selection applied while decoding (predicate pushdown)
+//
+// EventFilter holds cuts on the scalar fields of an event. Handed to
+// FileReader::next_columns() it is tested right after each event's six
+// scalars are read; a rejected event's waveform is stepped over using the
+// MessagePack lengths (bin blobs in one jump, int arrays one run per SIMD
+// call) instead of being decoded, and the event never reaches the columns.
+// With a time window and a loaded index, whole blocks outside it are not
+// even read, and with zone maps in the index (index.hpp) so are blocks
+// whose energy range or channels cannot match.
+//
+//   delila::EventFilter filter;
+//   filter.select(0, 3).select(1);            // module 0 ch 3, all of module 1
+//   filter.energy(100, 4000).time(t0, t1).flags(0, delila::FLAG_PILEUP);
+//   reader.load_index();                      // Optional: block skipping
+//   while (reader.next_columns(batch, cols, filter)) { ... cols may be empty ... }
+//
+// Every cut is optional; a default-constructed filter accepts everything.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "delila/event.hpp"
+#include "delila/index.hpp"
+
+namespace delila {
+
+// Event flag bits (Rust common::flags)
+constexpr uint64_t FLAG_PILEUP = 0x01;
+constexpr uint64_t FLAG_TRIGGER_LOST = 0x02;
+constexpr uint64_t FLAG_OVER_RANGE = 0x04;
+constexpr uint64_t FLAG_1024_TRIGGER = 0x08;
+constexpr uint64_t FLAG_N_LOST_TRIGGER = 0x10;
+
+class EventFilter {
+public:
+    // Accept (module, channel); -1 matches any. Without any select() call
+    // every channel passes; after one, only the selected ones do.
+    EventFilter& select(int module, int channel = -1);
+
+    // Inclusive ranges
+    EventFilter& energy(uint16_t min, uint16_t max) {
+        energy_min_ = min;
+        energy_max_ = max;
+        return *this;
+    }
+    EventFilter& energy_short(uint16_t min, uint16_t max) {
+        energy_short_min_ = min;
+        energy_short_max_ = max;
+        return *this;
+    }
+
+    // Every bit of `set` present and every bit of `clear` absent
+    EventFilter& flags(uint64_t set, uint64_t clear = 0) {
+        flags_set_ = set;
+        flags_clear_ = clear;
+        return *this;
+    }
+
+    // timestamp_ns in [min, max)
+    EventFilter& time(double min, double max) {
+        time_min_ = min;
+        time_max_ = max;
+        return *this;
+    }
+
+    // Drop every cut
+    void clear();
+
+    bool accepts_all() const;
+    bool has_time_window() const {
+        return time_min_ > -std::numeric_limits<double>::infinity() ||
+               time_max_ < std::numeric_limits<double>::infinity();
+    }
+
+    // False if no event in [first_ns, last_ns] can pass the time window
+    bool overlaps(double first_ns, double last_ns) const {
+        return last_ns >= time_min_ && first_ns < time_max_;
+    }
+
+    // False if no event of the block can pass: its time range misses the
+    // window, or its zone map rules out the energy range or every selected
+    // channel
+    bool may_match(const BlockIndexEntry& block) const;
+
+    bool matches(uint8_t module, uint8_t channel, uint16_t energy, uint16_t energy_short,
+                 double timestamp_ns, uint64_t flags) const {
+        // & rather than &&: one data-dependent branch per event, not six
+        return (channels_.empty() || channel_selected(module, channel)) &
+               (energy >= energy_min_) & (energy <= energy_max_) &
+               (energy_short >= energy_short_min_) & (energy_short <= energy_short_max_) &
+               ((flags & flags_set_) == flags_set_) & ((flags & flags_clear_) == 0) &
+               (timestamp_ns >= time_min_) & (timestamp_ns < time_max_);
+    }
+
+    bool matches(const Event& ev) const {
+        return matches(ev.module, ev.channel, ev.energy, ev.energy_short, ev.timestamp_ns,
+                       ev.flags);
+    }
+
+private:
+    bool channel_selected(uint8_t module, uint8_t channel) const {
+        size_t bit = (static_cast<size_t>(module) << 8) | channel;
+        return (channels_[bit >> 6] >> (bit & 63)) & 1;
+    }
+
+    std::vector<uint64_t> channels_;  // 256 x 256 bits by (module, channel); empty: all
+    std::array<uint64_t, 16> zone_channels_{};  // Selection folded like BlockIndexEntry::channels
+    uint16_t energy_min_ = 0;
+    uint16_t energy_max_ = 0xffff;
+    uint16_t energy_short_min_ = 0;
+    uint16_t energy_short_max_ = 0xffff;
+    uint64_t flags_set_ = 0;
+    uint64_t flags_clear_ = 0;
+    double time_min_ = -std::numeric_limits<double>::infinity();
+    double time_max_ = std::numeric_limits<double>::infinity();
+};
+
+}  // namespace delila
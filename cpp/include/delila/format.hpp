@@ -0,0 +1,85 @@
+// DELILA file format definitions (C++ side)
+//
+// Mirrors src/recorder/format.rs. Keep the two in sync.
+//
+// File structure (v2):
+//   Header:      "DELILA02" + u32_le(len) + msgpack(FileHeader)
+//   Data blocks: [u32_le(len) + msgpack(EventDataBatch)]...
+//   Footer:      "DLEND002" + 56 bytes metadata (64 bytes total)
+// v3 ("DELILA03") puts a block header after each length prefix and may
+// compress the MessagePack (compression.hpp).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace delila {
+
+// File format constants
+constexpr const char* FILE_MAGIC = "DELILA02";
+constexpr const char* FILE_MAGIC_V3 = "DELILA03";
+constexpr const char* FOOTER_MAGIC = "DLEND002";
+constexpr size_t MAGIC_SIZE = 8;
+constexpr size_t FOOTER_SIZE = 64;
+
+// Sanity limit on a single block (same as DataFileReader in Rust)
+constexpr uint32_t MAX_BLOCK_SIZE = 100000000;
+
+// Little-endian loads (file framing is LE, MessagePack payload is BE)
+inline uint32_t load_u32_le(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) |
+           (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline uint64_t load_u64_le(const uint8_t* p) {
+    return static_cast<uint64_t>(load_u32_le(p)) |
+           (static_cast<uint64_t>(load_u32_le(p + 4)) << 32);
+}
+
+inline double load_f64_le(const uint8_t* p) {
+    uint64_t bits = load_u64_le(p);
+    double result;
+    std::memcpy(&result, &bits, sizeof(double));
+    return result;
+}
+
+// File header metadata (matches Rust FileHeader field order)
+struct FileHeader {
+    uint32_t version = 0;
+    uint32_t run_number = 0;
+    std::string exp_name;
+    uint32_t file_sequence = 0;
+    uint64_t file_start_time_ns = 0;
+    std::string comment;
+    double sort_margin_ratio = 0.0;
+    bool is_sorted = false;
+    std::vector<uint32_t> source_ids;
+};
+
+// Footer structure (fixed 64 bytes)
+struct Footer {
+    char magic[8] = {0};
+    uint64_t data_checksum = 0;
+    uint64_t total_events = 0;
+    uint64_t data_bytes = 0;
+    double first_event_time_ns = 0.0;
+    double last_event_time_ns = 0.0;
+    uint64_t file_end_time_ns = 0;
+    uint8_t write_complete = 0;
+
+    bool is_complete() const { return write_complete == 1; }
+};
+
+// Parse a 64-byte footer. Returns false if the magic does not match.
+bool parse_footer(const uint8_t* buf, Footer& footer);
+
+// Parse the MessagePack header payload (after magic + length prefix).
+bool parse_file_header(const uint8_t* data, size_t size, FileHeader& header);
+
+}  // namespace delila
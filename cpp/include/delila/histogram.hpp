@@ -0,0 +1,250 @@
+// Histogramming on the decoder: integer bins, one pass, many threads
+//
+// Histogram1D bins exactly like the monitor's Histogram1D (src/monitor/mod.rs,
+// same HistogramConfig defaults and float arithmetic), so an offline spectrum
+// matches the online one bin for bin. Counts are u64: no precision loss above
+// 2^24 entries as with TH1F.
+//
+// HistogramSet fills every requested histogram from one pass over a block's
+// columns: energy, energy_short, channel and module, optionally the energy vs
+// energy_short PSD map and per (module, channel) energy spectra / PSD maps.
+// fill_histograms() decodes the blocks of a run on worker threads, each
+// filling its own HistogramSet, and adds them up at the end.
+//
+//   delila::HistogramOptions opt;
+//   opt.psd = true;
+//   opt.per_channel = true;
+//   std::vector<std::string> errors;
+//   delila::HistogramSet h = delila::fill_histograms(chain.files(), opt, 0, &errors);
+//   const delila::Histogram1D* e = h.channel_energy(0, 3);   // Like the monitor's
+//
+// Per-channel histograms are created on first use. With the monitor's
+// 65536-bin default a spectrum is 512 KiB, held once per worker thread.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "delila/columns.hpp"
+#include "delila/filter.hpp"
+#include "delila/metrics.hpp"
+
+namespace delila {
+
+// Mirrors HistogramConfig in src/monitor/mod.rs
+struct HistogramConfig {
+    uint32_t num_bins = 65536;
+    float min_value = 0.0f;
+    float max_value = 65536.0f;  // 1 bin per ADC channel (16-bit)
+};
+
+// Binning of one axis
+class HistogramAxis {
+public:
+    explicit HistogramAxis(HistogramConfig config = HistogramConfig())
+        : config_(config),
+          bin_width_((config.max_value - config.min_value) / static_cast<float>(config.num_bins)) {}
+
+    // Bin index of `value`: -1 below min_value, num_bins at or above
+    // max_value. Same float arithmetic as the monitor (value not NaN).
+    int64_t bin_of(float value) const {
+        if (value < config_.min_value) return -1;
+        if (value >= config_.max_value) return config_.num_bins;
+        auto bin = static_cast<int64_t>((value - config_.min_value) / bin_width_);
+        return bin < config_.num_bins ? bin : config_.num_bins;
+    }
+
+    const HistogramConfig& config() const { return config_; }
+    uint32_t num_bins() const { return config_.num_bins; }
+    double bin_low_edge(uint32_t bin) const { return config_.min_value + bin * bin_width_; }
+
+private:
+    HistogramConfig config_;
+    float bin_width_;  // (max - min) / num_bins, as the monitor computes it
+};
+
+class Histogram1D {
+public:
+    explicit Histogram1D(HistogramConfig config = HistogramConfig())
+        : axis_(config), bins_(config.num_bins, 0) {}
+
+    void fill(float value) {
+        total_counts_++;
+        count(value);
+    }
+
+    // Add the counts of a histogram with the same config
+    void add(const Histogram1D& other);
+    void clear();
+
+    const HistogramAxis& axis() const { return axis_; }
+    const HistogramConfig& config() const { return axis_.config(); }
+    const std::vector<uint64_t>& bins() const { return bins_; }
+    uint64_t total_counts() const { return total_counts_; }
+    uint64_t overflow() const { return overflow_; }
+    uint64_t underflow() const { return underflow_; }
+
+private:
+    friend class HistogramSet;
+
+    // fill() for a bin_of() result looked up in a table (UINT32_MAX:
+    // underflow), without total_counts_: HistogramSet adds a block's events
+    // at once
+    void count_bin(uint32_t bin) {
+        if (bin < bins_.size()) {
+            bins_[bin]++;
+        } else if (bin == UINT32_MAX) {
+            underflow_++;
+        } else {
+            overflow_++;
+        }
+    }
+
+    void count(float value) {
+        int64_t bin = axis_.bin_of(value);
+        count_bin(bin < 0 ? UINT32_MAX : static_cast<uint32_t>(bin));
+    }
+
+    HistogramAxis axis_;
+    std::vector<uint64_t> bins_;
+    uint64_t total_counts_ = 0;
+    uint64_t overflow_ = 0;
+    uint64_t underflow_ = 0;
+};
+
+// Two axes binned as Histogram1D, bins()[y * x.num_bins + x]. An entry
+// outside either axis only counts in outside().
+class Histogram2D {
+public:
+    Histogram2D(HistogramConfig x = HistogramConfig{0, 0.0f, 0.0f},
+                HistogramConfig y = HistogramConfig{0, 0.0f, 0.0f})
+        : x_(x), y_(y), bins_(static_cast<size_t>(x.num_bins) * y.num_bins, 0) {}
+
+    void fill(float x, float y) {
+        total_counts_++;
+        count(x, y);
+    }
+
+    void add(const Histogram2D& other);
+    void clear();
+
+    const HistogramAxis& x_axis() const { return x_; }
+    const HistogramAxis& y_axis() const { return y_; }
+    uint64_t at(uint32_t x, uint32_t y) const {
+        return bins_[static_cast<size_t>(y) * x_.num_bins() + x];
+    }
+    const std::vector<uint64_t>& bins() const { return bins_; }
+    uint64_t total_counts() const { return total_counts_; }
+    uint64_t outside() const { return outside_; }
+
+private:
+    friend class HistogramSet;
+
+    // As Histogram1D::count_bin(); UINT32_MAX is outside too
+    void count_bins(uint32_t bx, uint32_t by) {
+        if (bx < x_.num_bins() && by < y_.num_bins()) {
+            bins_[static_cast<size_t>(by) * x_.num_bins() + bx]++;
+        } else {
+            outside_++;
+        }
+    }
+
+    void count(float x, float y) {
+        int64_t bx = x_.bin_of(x);
+        int64_t by = y_.bin_of(y);
+        count_bins(bx < 0 ? UINT32_MAX : static_cast<uint32_t>(bx),
+                   by < 0 ? UINT32_MAX : static_cast<uint32_t>(by));
+    }
+
+    HistogramAxis x_;
+    HistogramAxis y_;
+    std::vector<uint64_t> bins_;
+    uint64_t total_counts_ = 0;
+    uint64_t outside_ = 0;
+};
+
+struct HistogramOptions {
+    HistogramConfig energy;                      // energy and energy_short spectra
+    HistogramConfig channel{64, 0.0f, 64.0f};
+    HistogramConfig module{32, 0.0f, 32.0f};
+    bool psd = false;                            // energy (x) vs energy_short (y)
+    HistogramConfig psd_energy{1024, 0.0f, 65536.0f};
+    HistogramConfig psd_short{1024, 0.0f, 65536.0f};
+    bool per_channel = false;                    // Energy spectrum per (module, channel)
+    bool psd_per_channel = false;                // PSD map per (module, channel)
+};
+
+// Histograms of one (module, channel)
+struct ChannelHistograms {
+    uint8_t module = 0;
+    uint8_t channel = 0;
+    Histogram1D energy{HistogramConfig{0, 0.0f, 0.0f}};  // Unless per_channel: no bins
+    Histogram2D psd;                             // Unless psd_per_channel: no bins
+};
+
+class HistogramSet {
+public:
+    explicit HistogramSet(const HistogramOptions& options = HistogramOptions());
+
+    // Fill every histogram from the first n events of cols, in one pass
+    void fill(const EventColumns& cols, size_t n);
+    void fill(const EventColumns& cols) { fill(cols, cols.size()); }
+
+    // Add a set built with the same options (per-channel histograms the
+    // other set has and this one lacks are copied)
+    void add(const HistogramSet& other);
+    void clear();
+
+    const HistogramOptions& options() const { return options_; }
+    uint64_t events() const { return events_; }
+    const Histogram1D& energy() const { return energy_; }
+    const Histogram1D& energy_short() const { return energy_short_; }
+    const Histogram1D& channel() const { return channel_; }
+    const Histogram1D& module() const { return module_; }
+    const Histogram2D& psd() const { return psd_; }
+
+    // Channels seen, in first-seen order (any order after fill_histograms())
+    const std::vector<ChannelHistograms>& channels() const { return channels_; }
+    // nullptr if the channel was not seen or per-channel histograms are off
+    const Histogram1D* channel_energy(uint8_t module, uint8_t channel) const;
+    const Histogram2D* channel_psd(uint8_t module, uint8_t channel) const;
+
+private:
+    using BinTable = std::vector<uint32_t>;  // Input value -> bin (bin_of())
+
+    ChannelHistograms& channel_slot(uint8_t module, uint8_t channel);
+
+    HistogramOptions options_;
+    // Every input is a u16 or u8, so its bin is looked up rather than
+    // computed; the tables are shared by the copies of a set
+    std::shared_ptr<const BinTable> energy_bins_;
+    std::shared_ptr<const BinTable> psd_x_bins_;
+    std::shared_ptr<const BinTable> psd_y_bins_;
+    std::shared_ptr<const BinTable> channel_bins_;
+    std::shared_ptr<const BinTable> module_bins_;
+    uint64_t events_ = 0;
+    Histogram1D energy_;
+    Histogram1D energy_short_;
+    Histogram1D channel_;
+    Histogram1D module_;
+    Histogram2D psd_;
+    std::vector<ChannelHistograms> channels_;
+    std::vector<uint32_t> slot_;  // (module << 8 | channel) -> index + 1 into channels_
+};
+
+// Histogram every event of `paths` (files in order, each mmapped and its
+// blocks decoded on up to n_workers threads, 0: all cores) into one set.
+// Waveforms are not decoded. With a filter, only passing events are
+// counted and blocks the index rules out are not read. Files that cannot
+// be read, and damaged blocks, are reported in `errors` and skipped.
+// Stage times and counters go to `metrics` if given (see metrics.hpp).
+HistogramSet fill_histograms(const std::vector<std::string>& paths,
+                             const HistogramOptions& options, unsigned n_workers = 0,
+                             std::vector<std::string>* errors = nullptr,
+                             const EventFilter* filter = nullptr, Metrics* metrics = nullptr);
+
+}  // namespace delila
@@ -0,0 +1,122 @@
+// Block index sidecar (<file>.delila.idx)
+//
+// Written by the recorder when a file is closed, or rebuilt for old files
+// with `delila-recover index`. Layout (all little-endian):
+//
+//   Header (32 bytes): magic "DLIDX001", entry_size u32, reserved u32,
+//                      num_entries u64, data_file_size u64
+//   Entry  (entry_size bytes, >= 40):
+//                      offset u64, length u32, source_id u32, num_events u32,
+//                      flags u32, first_timestamp_ns f64, last_timestamp_ns f64
+//     zone map (176-byte entries with INDEX_FLAG_ZONE_MAP):
+//                      min_energy u16, max_energy u16, waveform_events u32,
+//                      channels u64[16]
+//
+// The zone map lets a filtered read skip blocks without touching them: the
+// channel bitmap has bit (module % 16) * 64 + channel % 64 set for every
+// (module, channel) present, so a clear bit rules the pair out. Sidecars
+// from before zone maps have 40-byte entries and flags 0.
+//
+// Blocks from different sources interleave, so block time ranges overlap.
+// Time lookups use a prefix max of last_timestamp_ns and a suffix min of
+// first_timestamp_ns, which are monotone and can be binary searched.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace delila {
+
+constexpr const char* INDEX_MAGIC = "DLIDX001";
+constexpr size_t INDEX_HEADER_SIZE = 32;
+constexpr size_t INDEX_ENTRY_SIZE = 176;
+constexpr size_t INDEX_ENTRY_MIN_SIZE = 40;
+constexpr uint32_t INDEX_FLAG_ZONE_MAP = 0x01;
+constexpr const char* INDEX_SUFFIX = ".idx";
+
+struct BlockIndexEntry {
+    uint64_t offset = 0;  // File offset of the u32 length prefix
+    uint32_t length = 0;  // MessagePack payload length
+    uint32_t source_id = 0;
+    uint32_t num_events = 0;
+    double first_timestamp_ns = 0.0;  // Earliest event in the block
+    double last_timestamp_ns = 0.0;   // Latest event in the block
+
+    // Zone map (only if has_zone_map)
+    bool has_zone_map = false;
+    uint16_t min_energy = 0;
+    uint16_t max_energy = 0;
+    uint32_t waveform_events = 0;
+    std::array<uint64_t, 16> channels{};
+
+    static size_t channel_bit(uint8_t module, uint8_t channel) {
+        return static_cast<size_t>(module % 16) * 64 + channel % 64;
+    }
+
+    // Fold one event into the zone map; the first call starts it. (An empty
+    // block gets has_zone_map with zero range and no channels.)
+    void add_to_zone_map(uint8_t module, uint8_t channel, uint16_t energy, bool has_waveform) {
+        if (!has_zone_map) {
+            has_zone_map = true;
+            min_energy = energy;
+            max_energy = energy;
+        }
+        min_energy = std::min(min_energy, energy);
+        max_energy = std::max(max_energy, energy);
+        waveform_events += has_waveform;
+        size_t bit = channel_bit(module, channel);
+        channels[bit / 64] |= uint64_t{1} << (bit % 64);
+    }
+
+    // False only if the zone map rules out events of (module, channel)
+    bool may_contain(uint8_t module, uint8_t channel) const {
+        if (!has_zone_map) return true;
+        size_t bit = channel_bit(module, channel);
+        return (channels[bit / 64] >> (bit % 64)) & 1;
+    }
+};
+
+class BlockIndex {
+public:
+    static std::string sidecar_path(const std::string& data_path) { return data_path + INDEX_SUFFIX; }
+
+    // Parse a sidecar image. Returns false on bad magic or truncation.
+    bool parse(const uint8_t* data, size_t size);
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+    std::vector<uint8_t> to_bytes() const;
+
+    void clear();
+    void push(const BlockIndexEntry& entry);
+
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    const BlockIndexEntry& operator[](size_t i) const { return entries_[i]; }
+    const std::vector<BlockIndexEntry>& entries() const { return entries_; }
+
+    // Size of the data file the index was built for (detects stale sidecars)
+    uint64_t data_file_size() const { return data_file_size_; }
+    void set_data_file_size(uint64_t size) { data_file_size_ = size; }
+
+    uint64_t total_events() const;
+
+    // First block that may hold an event at or after t_ns (size() if none).
+    // Reading from this block onwards sees every event with timestamp >= t_ns.
+    size_t lower_bound(double t_ns) const;
+
+    // Blocks whose time range intersects [t0_ns, t1_ns), in file order
+    std::vector<size_t> blocks_overlapping(double t0_ns, double t1_ns) const;
+
+private:
+    uint64_t data_file_size_ = 0;
+    std::vector<BlockIndexEntry> entries_;
+    std::vector<double> max_last_;   // max_last_[i]  = max(last_timestamp_ns[0..i])
+    std::vector<double> min_first_;  // min_first_[i] = min(first_timestamp_ns[i..])
+};
+
+}  // namespace delila
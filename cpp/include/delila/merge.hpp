@@ -0,0 +1,119 @@
+// Time-ordered merge of .delila event streams
+//
+// The recorder writes batches as they arrive, so events are only in time
+// order within one source (and then only roughly: digitizer buffers flush
+// per channel). TimeMerger reads one or more inputs block by block, files
+// every batch into a lane per (input, source_id), and k-way merges the
+// lanes through a min-heap on their first timestamps.
+//
+// Like the recorder's old SortingBuffer (TODO/archive/phase2_infrastructure/
+// 09_timestamp_sorting_design.md), only the tail is uncertain: an event is
+// emitted once every unfinished input has read past its timestamp by
+// max_disorder_ns, i.e. no later block is expected to hold an older event.
+// Memory is then bounded by max_disorder_ns times the event rate
+// (max_buffered_events caps it in any case).
+//
+//   delila::TimeMerger merger;
+//   merger.add_input().add_run("data", 42);     // one FileChain per input
+//   delila::Event ev;
+//   while (merger.next(ev)) { ... ev in timestamp_ns order ... }
+//   if (merger.stats().late_events > 0) { ... raise max_disorder_ns ... }
+
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "delila/chain.hpp"
+#include "delila/event.hpp"
+
+namespace delila {
+
+struct MergeOptions {
+    // Largest expected lag of an event behind the newest block of its input
+    double max_disorder_ns = 1e9;
+
+    // Emit the oldest buffered event regardless once this many are held
+    size_t max_buffered_events = 4u << 20;
+};
+
+struct MergeStats {
+    uint64_t events = 0;         // Emitted
+    uint64_t late_events = 0;    // Emitted after a newer event (disorder > max_disorder_ns)
+    uint64_t forced = 0;         // Emitted early because of max_buffered_events
+    size_t blocks = 0;
+    size_t lanes = 0;            // (input, source_id) pairs seen
+    size_t peak_buffered = 0;
+};
+
+class TimeMerger {
+public:
+    explicit TimeMerger(MergeOptions options = MergeOptions()) : options_(options) {}
+
+    // New input, read in its own order (add files or a run to the chain
+    // before the first next()). Files that follow each other in time
+    // belong in one input; independent streams in separate inputs.
+    FileChain& add_input();
+
+    // Shorthand for an input of one file
+    void add_file(const std::string& path) { add_input().add_file(path); }
+
+    // Next event in timestamp_ns order (ties: lane order, then read order).
+    // False once every input is exhausted and the buffer is empty.
+    bool next(Event& event);
+
+    // Up to max_events events appended in order; returns the number added
+    size_t next_events(std::vector<Event>& events, size_t max_events);
+
+    // source_id of the batch the last event from next() came from
+    uint32_t source_id() const { return source_id_; }
+
+    size_t buffered() const { return buffered_; }
+    const MergeStats& stats() const { return stats_; }
+    const MergeOptions& options() const { return options_; }
+
+    // Errors of all inputs ("path: error", see FileChain::errors())
+    std::vector<std::string> errors() const;
+
+private:
+    struct Input {
+        std::unique_ptr<FileChain> chain;
+        double frontier = -DBL_MAX;  // Newest timestamp read
+        bool done = false;
+    };
+
+    struct Lane {
+        uint32_t source_id = 0;
+        std::deque<Event> events;  // Sorted by timestamp_ns
+    };
+
+    // Timestamp below which nothing more is expected from unfinished inputs
+    double watermark() const;
+
+    // Read the next block of the input furthest behind. False if all are done.
+    bool read_more();
+    void add_batch(size_t input, uint32_t source_id);
+
+    bool heap_less(size_t a, size_t b) const;  // std heap order: min ts on top
+    void emit(Event& event);
+
+    MergeOptions options_;
+    std::vector<Input> inputs_;
+    std::vector<Lane> lanes_;
+    std::map<std::pair<size_t, uint32_t>, size_t> lane_of_;
+    std::vector<size_t> heap_;     // Non-empty lanes
+    std::vector<Event> batch_;     // Reused decode buffer
+    size_t buffered_ = 0;
+    double last_ts_ = -DBL_MAX;
+    uint32_t source_id_ = 0;
+    MergeStats stats_;
+};
+
+}  // namespace delila
@@ -0,0 +1,49 @@
+// Pipeline Message frames as published over ZMQ
+//
+// The merger (and every stage before it) publishes the Rust `Message` enum,
+// which rmp_serde encodes as a map of one entry keyed by the variant name:
+//   {"Data": [source_id, sequence_number, timestamp, events]}
+//   {"EndOfStream": [source_id]}
+//   {"Heartbeat": [source_id, timestamp, counter]}
+// parse_message() reads the envelope only; a Data payload is left in place
+// for MsgPackParser (or FileReader::decode_block), which takes either
+// analog probe encoding.
+//
+//   delila::Message msg;
+//   if (delila::parse_message(frame, size, msg) && msg.kind == delila::MessageKind::Data) {
+//       delila::MsgPackParser p(msg.payload, msg.payload_size);
+//       ...
+//   }
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace delila {
+
+enum class MessageKind {
+    Data,
+    EndOfStream,
+    Heartbeat,
+};
+
+const char* message_kind_name(MessageKind kind);
+
+struct Message {
+    MessageKind kind = MessageKind::Data;
+    uint32_t source_id = 0;
+    uint64_t sequence_number = 0;   // Data
+    uint64_t timestamp = 0;         // Data: batch creation, Heartbeat: send time
+    uint64_t counter = 0;           // Heartbeat
+
+    // Data: the EventDataBatch bytes inside the frame (not copied)
+    const uint8_t* payload = nullptr;
+    size_t payload_size = 0;
+};
+
+// Decode the envelope of one frame. A bare EventDataBatch (no envelope) is
+// taken as Data. False for anything else.
+bool parse_message(const uint8_t* data, size_t size, Message& msg);
+
+}  // namespace delila
@@ -0,0 +1,193 @@
+// Per-stage timing and throughput counters for the offline tools
+//
+// Where does a slow conversion spend its time? A Metrics attached to the
+// reader (and fed by the tool for its own stages) keeps cumulative
+// counters and per-stage times:
+//
+//   delila::Metrics metrics;
+//   reader.set_metrics(&metrics);                        // read / decompress / parse / waveform
+//   delila::MetricsReporter report(metrics, 5.0);        // A rate line every 5 s
+//   while (reader.next_batch(batch, events)) {
+//       {
+//           delila::StageTimer t(&metrics, delila::Stage::Fill);
+//           for (const auto& ev : events) { ... tree->Fill(); }
+//       }
+//       metrics.add_events_processed(events.size());
+//       report.poll();
+//   }
+//   std::cout << metrics.snapshot().to_json("convert_to_tree") << std::endl;
+//
+// Counter names and meanings follow AtomicCounters / CounterSnapshot /
+// RateSnapshot of src/common/metrics.rs, and to_json() also carries the
+// ComponentMetrics fields (src/common/mod.rs) the dashboards show for the
+// online components, so online and offline throughput plot side by side:
+//   received / processed / dropped    blocks read / decoded / damaged
+//   events_received / events_processed  events decoded / handed on (filled)
+//   bytes                              block bytes read from the files
+//
+// Stage times are exclusive (parse excludes the waveform decode inside
+// it) and summed over threads, so with workers they can exceed the wall
+// time. In ReadMode::Mmap the read stage is only the lookup of the next
+// block: page faults land in parse. Stream or ReadAhead separate the I/O.
+//
+// Counters are relaxed atomics: workers of one tool can share a Metrics.
+// A null Metrics* (the default everywhere) costs one branch per block.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace delila {
+
+enum class Stage {
+    Read,        // Fetching block bytes (pread / ifstream / read-ahead wait)
+    Decompress,  // LZ4 / zstd of v3 blocks
+    Parse,       // MessagePack scalars and structure
+    Waveform,    // Waveform probe arrays
+    Fill,        // Handing events on (TTree::Fill, histograms, ...)
+    Write,       // Output (TTree::Write, merger flushes)
+};
+
+constexpr size_t NUM_STAGES = 6;
+
+// "read", "decompress", "parse", "waveform", "fill", "write"
+const char* stage_name(Stage stage);
+
+// Monotonic clock in nanoseconds
+inline uint64_t monotonic_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+// Rates between two snapshots (as RateSnapshot in metrics.rs)
+struct RateSnapshot {
+    double received_rate = 0;   // Blocks read per second
+    double processed_rate = 0;  // Blocks decoded per second
+    double events_rate = 0;     // Events processed per second
+    double bytes_rate = 0;      // Bytes per second
+
+    // "500 B/s", "1.50 KB/s", "1.50 MB/s", "1.50 GB/s"
+    std::string format_bytes_rate() const;
+    // "500 /s", "1.50 K/s", "1.50 M/s"
+    std::string format_events_rate() const;
+};
+
+struct MetricsSnapshot {
+    uint64_t received = 0;
+    uint64_t processed = 0;
+    uint64_t dropped = 0;
+    uint64_t events_received = 0;
+    uint64_t events_processed = 0;
+    uint64_t bytes = 0;
+    uint64_t waveform_samples = 0;  // analog_probe1 samples decoded
+    uint64_t stage_ns[NUM_STAGES] = {};
+    double elapsed_secs = 0;        // Since the Metrics was created or reset
+
+    uint64_t ns(Stage stage) const { return stage_ns[static_cast<size_t>(stage)]; }
+
+    // Rates since `prev` over elapsed_secs (zero if elapsed_secs <= 0)
+    RateSnapshot rate_from(const MetricsSnapshot& prev, double elapsed_secs) const;
+    // Average rates since the start
+    RateSnapshot rate() const { return rate_from(MetricsSnapshot(), elapsed_secs); }
+
+    // One-line JSON summary for `component`:
+    //   {"component": ..., "elapsed_secs": ...,
+    //    "metrics": {ComponentMetrics fields},
+    //    "counters": {CounterSnapshot fields, waveform_samples},
+    //    "rates": {RateSnapshot fields},
+    //    "stages": {"read_ns": ..., ..., "write_ns": ...}}
+    std::string to_json(const std::string& component) const;
+};
+
+class Metrics {
+public:
+    Metrics() : start_ns_(monotonic_ns()) {}
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    void add_received(uint64_t n = 1) { received_.fetch_add(n, std::memory_order_relaxed); }
+    void add_processed(uint64_t n = 1) { processed_.fetch_add(n, std::memory_order_relaxed); }
+    void inc_dropped() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+    void add_events_received(uint64_t n) {
+        events_received_.fetch_add(n, std::memory_order_relaxed);
+    }
+    void add_events_processed(uint64_t n) {
+        events_processed_.fetch_add(n, std::memory_order_relaxed);
+    }
+    void add_bytes(uint64_t n) { bytes_.fetch_add(n, std::memory_order_relaxed); }
+    void add_waveform_samples(uint64_t n) {
+        waveform_samples_.fetch_add(n, std::memory_order_relaxed);
+    }
+    void add_time(Stage stage, uint64_t ns) {
+        stage_ns_[static_cast<size_t>(stage)].fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    MetricsSnapshot snapshot() const;
+
+    // Zero every counter and restart the clock
+    void reset();
+
+private:
+    std::atomic<uint64_t> received_{0};
+    std::atomic<uint64_t> processed_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> events_received_{0};
+    std::atomic<uint64_t> events_processed_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> waveform_samples_{0};
+    std::atomic<uint64_t> stage_ns_[NUM_STAGES] = {};
+    std::atomic<uint64_t> start_ns_;
+};
+
+// Adds the time from construction to stop() (or destruction) to one stage.
+// No clock is read for a null Metrics.
+class StageTimer {
+public:
+    StageTimer(Metrics* metrics, Stage stage)
+        : metrics_(metrics), stage_(stage), start_(metrics ? monotonic_ns() : 0) {}
+    ~StageTimer() { stop(); }
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    void stop() {
+        if (metrics_) metrics_->add_time(stage_, monotonic_ns() - start_);
+        metrics_ = nullptr;
+    }
+
+private:
+    Metrics* metrics_;
+    Stage stage_;
+    uint64_t start_;
+};
+
+// Periodic rate report, replacing progress dots:
+//   [  5.0 s] 1.52 M/s, 98.40 MB/s (1200 blocks, 7600000 events) read 3% decompress 0%
+//             parse 41% waveform 30% fill 24% write 2%
+// (one line; stage shares of the time spent in this interval)
+class MetricsReporter {
+public:
+    // `out` defaults to std::cout; interval_secs <= 0 never reports
+    explicit MetricsReporter(const Metrics& metrics, double interval_secs = 5.0,
+                             std::ostream* out = nullptr);
+
+    // Print a line if interval_secs passed since the last one; cheap
+    // enough to call once per block. Returns true if it printed.
+    bool poll();
+    // Print a line now
+    void report();
+
+private:
+    const Metrics& metrics_;
+    double interval_secs_;
+    std::ostream* out_;
+    MetricsSnapshot last_;
+    uint64_t last_ns_;
+};
+
+}  // namespace delila
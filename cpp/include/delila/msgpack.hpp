@@ -0,0 +1,356 @@
+// MessagePack parser for EventDataBatch blocks
+//
+// MessagePack format (as emitted by rmp_serde):
+//   - Batch is array of 4 elements: [source_id, sequence_number, timestamp, events]
+//   - Event is array of 6 or 7 elements:
+//     Without waveform: [module, channel, energy, energy_short, timestamp_ns, flags]
+//     With waveform:    [module, channel, energy, energy_short, timestamp_ns, flags, waveform]
+//   - Waveform is array of 8 elements:
+//     [analog_probe1, analog_probe2, digital_probe1, digital_probe2,
+//      digital_probe3, digital_probe4, time_resolution, trigger_threshold]
+//
+// The parser works on a non-owning (pointer, length) view and never
+// copies the input. Primitive readers are inline so the event loop in
+// msgpack.cpp compiles down to straight-line code; waveform sample runs
+// are decoded by the kernels in simd.hpp.
+//
+// The batch loops (parse_events(), parse_events_columns()) are specialized
+// on the event layout rmp_serde writes, picked once per batch from the
+// first event: its array header (6 fields: no waveform, 7: waveform) and
+// whether it is "wide" (fixint module / channel / flags, uint16 energy /
+// energy_short: every field at a fixed offset, the common case). Each event
+// is tried as wide (in a wide loop), then with fixint module / channel,
+// fixint / uint8 / uint16 energies, a float64 timestamp_ns and any flags,
+// without per-field bounds checks or tag dispatch. An event that matches
+// neither (other header or tags, end of block) goes through the generic
+// readers, so every valid encoding still parses.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "delila/columns.hpp"
+#include "delila/event.hpp"
+#include "delila/filter.hpp"
+
+namespace delila {
+
+// Big-endian loads (MessagePack payload)
+inline uint16_t load_u16_be(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t load_u32_be(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) |
+           (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) |
+           static_cast<uint32_t>(p[3]);
+}
+
+inline uint64_t load_u64_be(const uint8_t* p) {
+    return (static_cast<uint64_t>(load_u32_be(p)) << 32) | load_u32_be(p + 4);
+}
+
+class MsgPackParser {
+public:
+    MsgPackParser(const uint8_t* data, size_t size)
+        : begin_(data), pos_(data), end_(data + size) {}
+
+    // Batch envelope: array header, source_id, sequence_number, timestamp
+    // and the events array header. Leaves the cursor at the first event.
+    bool parse_batch_header(BatchHeader& header);
+
+    // Parse one event. Reuses the waveform vectors of `ev`.
+    // With decode_waveform = false the waveform is skipped (has_waveform is
+    // still set, the probe vectors are left empty).
+    bool parse_event(Event& ev, bool decode_waveform = true);
+
+    // Parse a whole batch, appending to `events`
+    bool parse_batch(BatchHeader& header, std::vector<Event>& events);
+
+    // Parse the events after parse_batch_header() into `events` (resized
+    // to num_events, waveform vectors reused). On failure `events` keeps
+    // the events before the bad one.
+    bool parse_events(size_t num_events, std::vector<Event>& events, bool decode_waveforms = true) {
+        return parse_events_into(num_events, events, 0, decode_waveforms);
+    }
+
+    // Parse the events after parse_batch_header() into columns, appending.
+    // With decode_waveforms = false waveforms are skipped and every event
+    // gets NO_WAVEFORM. Scalar columns outside `fields` (FIELD_* of
+    // columns.hpp) are stepped over and not stored; keep them the same
+    // across the batches appended to one EventColumns.
+    bool parse_events_columns(size_t num_events, EventColumns& cols, bool decode_waveforms = true,
+                              uint32_t fields = ALL_FIELDS) {
+        return parse_columns(num_events, cols, nullptr, decode_waveforms, fields);
+    }
+
+    // As above, keeping only the events `filter` accepts. Scalars are tested
+    // first; a rejected event's waveform is skipped (skip_waveform), never
+    // decoded.
+    bool parse_events_columns(size_t num_events, EventColumns& cols, const EventFilter& filter,
+                              bool decode_waveforms = true, uint32_t fields = ALL_FIELDS) {
+        return parse_columns(num_events, cols, &filter, decode_waveforms, fields);
+    }
+
+    // --- Primitives -------------------------------------------------------
+
+    bool read_array_header(size_t& size) {
+        if (pos_ >= end_) return false;
+        uint8_t b = *pos_;
+
+        // fixarray (0x90 - 0x9f)
+        if ((b & 0xf0) == 0x90) {
+            pos_++;
+            size = b & 0x0f;
+            return true;
+        }
+        // array16 (0xdc)
+        if (b == 0xdc && end_ - pos_ >= 3) {
+            size = load_u16_be(pos_ + 1);
+            pos_ += 3;
+            return true;
+        }
+        // array32 (0xdd)
+        if (b == 0xdd && end_ - pos_ >= 5) {
+            size = load_u32_be(pos_ + 1);
+            pos_ += 5;
+            return true;
+        }
+        return false;
+    }
+
+    bool read_map_header(size_t& size) {
+        if (pos_ >= end_) return false;
+        uint8_t b = *pos_;
+
+        // fixmap (0x80 - 0x8f)
+        if ((b & 0xf0) == 0x80) {
+            pos_++;
+            size = b & 0x0f;
+            return true;
+        }
+        // map16 (0xde)
+        if (b == 0xde && end_ - pos_ >= 3) {
+            size = load_u16_be(pos_ + 1);
+            pos_ += 3;
+            return true;
+        }
+        // map32 (0xdf)
+        if (b == 0xdf && end_ - pos_ >= 5) {
+            size = load_u32_be(pos_ + 1);
+            pos_ += 5;
+            return true;
+        }
+        return false;
+    }
+
+    bool read_uint(uint64_t& val) {
+        if (pos_ >= end_) return false;
+        uint8_t b = *pos_;
+        ptrdiff_t avail = end_ - pos_;
+
+        // positive fixint (0x00 - 0x7f)
+        if (b <= 0x7f) {
+            pos_++;
+            val = b;
+            return true;
+        }
+        switch (b) {
+        case 0xcc:  // uint8
+            if (avail < 2) return false;
+            val = pos_[1];
+            pos_ += 2;
+            return true;
+        case 0xcd:  // uint16
+            if (avail < 3) return false;
+            val = load_u16_be(pos_ + 1);
+            pos_ += 3;
+            return true;
+        case 0xce:  // uint32
+            if (avail < 5) return false;
+            val = load_u32_be(pos_ + 1);
+            pos_ += 5;
+            return true;
+        case 0xcf:  // uint64
+            if (avail < 9) return false;
+            val = load_u64_be(pos_ + 1);
+            pos_ += 9;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool read_int(int64_t& val) {
+        if (pos_ >= end_) return false;
+        uint8_t b = *pos_;
+        ptrdiff_t avail = end_ - pos_;
+
+        // positive fixint (0x00 - 0x7f)
+        if (b <= 0x7f) {
+            pos_++;
+            val = b;
+            return true;
+        }
+        // negative fixint (0xe0 - 0xff)
+        if (b >= 0xe0) {
+            pos_++;
+            val = static_cast<int8_t>(b);
+            return true;
+        }
+        switch (b) {
+        case 0xd0:  // int8
+            if (avail < 2) return false;
+            val = static_cast<int8_t>(pos_[1]);
+            pos_ += 2;
+            return true;
+        case 0xd1:  // int16
+            if (avail < 3) return false;
+            val = static_cast<int16_t>(load_u16_be(pos_ + 1));
+            pos_ += 3;
+            return true;
+        case 0xd2:  // int32
+            if (avail < 5) return false;
+            val = static_cast<int32_t>(load_u32_be(pos_ + 1));
+            pos_ += 5;
+            return true;
+        case 0xd3:  // int64
+            if (avail < 9) return false;
+            val = static_cast<int64_t>(load_u64_be(pos_ + 1));
+            pos_ += 9;
+            return true;
+        default: {
+            // uint types (for positive values stored as unsigned)
+            uint64_t uval;
+            if (!read_uint(uval)) return false;
+            val = static_cast<int64_t>(uval);
+            return true;
+        }
+        }
+    }
+
+    bool read_float64(double& val) {
+        if (end_ - pos_ < 9) return false;
+        uint8_t b = *pos_;
+
+        // float64 (0xcb), big-endian IEEE 754
+        if (b == 0xcb) {
+            uint64_t bits = load_u64_be(pos_ + 1);
+            std::memcpy(&val, &bits, sizeof(double));
+            pos_ += 9;
+            return true;
+        }
+        return false;
+    }
+
+    bool read_bool(bool& val) {
+        if (pos_ >= end_) return false;
+        uint8_t b = *pos_;
+        if (b == 0xc2 || b == 0xc3) {
+            val = (b == 0xc3);
+            pos_++;
+            return true;
+        }
+        return false;
+    }
+
+    bool read_nil() {
+        if (pos_ >= end_ || *pos_ != 0xc0) return false;
+        pos_++;
+        return true;
+    }
+
+    bool read_str(std::string& val);
+
+    // Vec<i16> is a MessagePack array of ints, or a bin blob of
+    // little-endian samples (EventDataBatch::to_msgpack_with)
+    bool read_i16_array(std::vector<int16_t>& arr) {
+        arr.clear();
+        return append_i16_array(arr);
+    }
+
+    // Vec<u8> is an array of uints (default serde) or bin8/16/32
+    bool read_u8_array(std::vector<uint8_t>& arr) {
+        arr.clear();
+        return append_u8_array(arr);
+    }
+
+    // As above, appending to `arr` (flat column buffers)
+    bool append_i16_array(std::vector<int16_t>& arr);
+    bool append_u8_array(std::vector<uint8_t>& arr);
+
+    // Skip one object of any type (nested containers included)
+    bool skip();
+
+    // Skip a Waveform: bin probes in one jump, int arrays a run of
+    // same-width samples at a time. Much faster than skip() on the samples.
+    bool skip_waveform();
+
+    // Time waveform decoding (for Stage::Waveform of metrics.hpp): one
+    // clock read before and after each decoded waveform. Off by default.
+    void set_waveform_timing(bool on) { waveform_timing_ = on; }
+    uint64_t waveform_ns() const { return waveform_ns_; }
+
+    // --- Cursor -----------------------------------------------------------
+
+    size_t position() const { return static_cast<size_t>(pos_ - begin_); }
+    size_t remaining() const { return static_cast<size_t>(end_ - pos_); }
+    bool at_end() const { return pos_ >= end_; }
+    uint8_t peek() const { return pos_ < end_ ? *pos_ : 0xc1; }
+
+private:
+    // Scalar fields of one event, and its array size (7 with a waveform)
+    struct Scalars {
+        uint64_t module, channel, energy, energy_short, flags;
+        double timestamp_ns;
+        size_t size;
+    };
+
+    // Loops specialized on the first event of a batch: its array header
+    // (6 or 7 fields) and whether it is "wide" (uint16 energies, fixint
+    // module / channel / flags: every field at a fixed offset)
+    enum class EventLayout { Generic, Narrow6, Wide6, Narrow7, Wide7 };
+    EventLayout first_event_layout() const;
+
+    // Any valid encoding
+    bool read_scalars(Scalars& s);
+    // Tries the wide layout (Wide), then fixint / uint8 / uint16 energies
+    // with array header `Header` (0: neither), then read_scalars()
+    template <uint8_t Header, bool Wide>
+    bool read_scalars_as(Scalars& s);
+    // Events go to events[base, base + num_events)
+    bool parse_events_into(size_t num_events, std::vector<Event>& events, size_t base,
+                           bool decode_waveforms);
+    template <uint8_t Header, bool Wide>
+    bool parse_events_as(size_t num_events, std::vector<Event>& events, size_t base,
+                         bool decode_waveforms);
+    template <uint8_t Header, bool Wide>
+    bool parse_columns_as(size_t num_events, EventColumns& cols, const EventFilter* filter,
+                          bool decode_waveforms, uint32_t fields);
+    // Waveform slot of an event with Scalars::size 7 (nil: none)
+    bool parse_event_waveform(Event& ev, bool decode_waveform);
+
+    bool parse_waveform(Waveform& wf);
+    bool parse_waveform_columns(EventColumns& cols);
+    bool parse_columns(size_t num_events, EventColumns& cols, const EventFilter* filter,
+                       bool decode_waveforms, uint32_t fields);
+    bool skip_i16_array();
+    bool skip_u8_array();
+    bool append_bin(std::vector<uint8_t>& arr);
+    // bin8/16/32 header; leaves the cursor at the payload
+    bool read_bin_header(size_t& size);
+    bool skip_depth(int depth);
+
+    const uint8_t* begin_;
+    const uint8_t* pos_;
+    const uint8_t* end_;
+    bool waveform_timing_ = false;
+    uint64_t waveform_ns_ = 0;
+};
+
+}  // namespace delila
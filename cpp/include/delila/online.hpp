@@ -0,0 +1,185 @@
+// Online consumer: decode batches straight from the pipeline's ZMQ stream
+//
+// OnlineConsumer subscribes to a PUB endpoint (the merger by default) the
+// same way the recorder and the monitor do, and hands every decoded batch
+// to a handler on a pool of worker threads. The receive thread only reads
+// the Message envelope and queues the frame; when the workers fall behind
+// and the queue is full, new frames are dropped and counted rather than
+// stalling the socket (the publisher would drop them at its HWM anyway).
+//
+// Workers fill per-worker state (WorkerStates below); snapshot() merges it
+// for display while the workers keep running. Each batch is applied under
+// its worker's lock, so a snapshot holds whole batches only.
+//
+//   delila::OnlineConsumer consumer;             // tcp://localhost:5556
+//   delila::WorkerStates<MyHistos> states(consumer.n_workers());
+//   consumer.start([&](unsigned w, const delila::BatchHeader&, const delila::EventColumns& cols) {
+//       states.update(w, [&](MyHistos& h) { ... fill from cols ... });
+//   });
+//   for (;;) {
+//       sleep(1);
+//       states.snapshot([&](const MyHistos& h) { ... add into display ... });
+//   }
+//   consumer.stop();
+//
+// Built as libdelila_online, only when libzmq is found (WorkerStates is
+// header-only and needs nothing).
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "delila/columns.hpp"
+#include "delila/event.hpp"
+#include "delila/message.hpp"
+
+namespace delila {
+
+struct OnlineOptions {
+    std::string endpoint = "tcp://localhost:5556";  // Merger PUB
+    unsigned n_workers = 0;          // Decoding threads (0: all cores)
+    size_t queue_frames = 1024;      // Frames waiting for a worker; more are dropped
+    int receive_hwm = 10000;         // ZMQ_RCVHWM (same as the recorder)
+    bool decode_waveforms = true;
+    void* context = nullptr;         // ZMQ context to share (inproc://); null: own one
+};
+
+struct OnlineStats {
+    uint64_t frames = 0;             // Received
+    uint64_t dropped = 0;            // Queue full
+    uint64_t bad_frames = 0;         // Not a Message, or a batch that fails to decode
+    uint64_t missing_batches = 0;    // Gaps in a source's sequence_number
+    uint64_t batches = 0;            // Decoded and handled
+    uint64_t events = 0;
+    uint64_t end_of_stream = 0;
+    uint64_t heartbeats = 0;
+};
+
+class OnlineConsumer {
+public:
+    // Called on worker `worker` (in [0, n_workers())) for each decoded batch
+    using BatchHandler =
+        std::function<void(unsigned worker, const BatchHeader& header, const EventColumns& cols)>;
+    // Called on the receive thread for EndOfStream and Heartbeat; keep it short
+    using ControlHandler = std::function<void(const Message& msg)>;
+
+    explicit OnlineConsumer(OnlineOptions options = OnlineOptions());
+    ~OnlineConsumer();
+
+    OnlineConsumer(const OnlineConsumer&) = delete;
+    OnlineConsumer& operator=(const OnlineConsumer&) = delete;
+
+    void set_control_handler(ControlHandler handler) { control_ = std::move(handler); }
+
+    // Connect and start the threads. False (see error()) if the socket
+    // cannot be set up.
+    bool start(BatchHandler handler);
+
+    // Stop receiving, let the workers finish the queued frames and join
+    void stop();
+
+    bool running() const { return running_; }
+    unsigned n_workers() const { return n_workers_; }
+    const OnlineOptions& options() const { return options_; }
+    const std::string& error() const { return error_; }
+
+    // Counters so far (safe to call while running)
+    OnlineStats stats() const;
+
+private:
+    struct Frame {
+        std::vector<uint8_t> bytes;
+        size_t payload_offset = 0;   // EventDataBatch inside bytes
+        size_t payload_size = 0;
+        size_t index = 0;            // sequence_number, for error messages
+    };
+
+    void receive_loop();
+    void worker_loop(unsigned worker);
+    bool fail(const std::string& msg);
+
+    OnlineOptions options_;
+    unsigned n_workers_ = 1;
+    BatchHandler handler_;
+    ControlHandler control_;
+    std::string error_;
+
+    void* context_ = nullptr;        // zmq context / SUB socket
+    void* socket_ = nullptr;
+    bool own_context_ = false;       // Made in start(), terminated with the socket
+    bool running_ = false;
+    std::atomic<bool> stop_{false};
+    std::thread receiver_;
+    std::vector<std::thread> workers_;
+    std::map<uint32_t, uint64_t> next_sequence_;  // Receive thread only
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<Frame> queue_;
+    std::vector<std::vector<uint8_t>> spare_;     // Buffers for reuse
+    bool draining_ = false;
+
+    std::atomic<uint64_t> frames_{0}, dropped_{0}, bad_frames_{0}, missing_batches_{0};
+    std::atomic<uint64_t> batches_{0}, events_{0}, end_of_stream_{0}, heartbeats_{0};
+};
+
+// One State per worker, each behind its own lock. Workers only ever take
+// their own lock, so updates do not contend except with a snapshot that is
+// reading that one worker.
+template <typename State>
+class WorkerStates {
+public:
+    // States are default-constructed; set them up with take() if needed
+    explicit WorkerStates(unsigned n_workers) {
+        for (unsigned w = 0; w < std::max(n_workers, 1u); w++) slots_.emplace_back(new Slot());
+    }
+
+    unsigned size() const { return static_cast<unsigned>(slots_.size()); }
+
+    // fn(State&) on worker `worker`'s state
+    template <typename Fn>
+    void update(unsigned worker, Fn fn) {
+        Slot& s = *slots_[worker];
+        std::lock_guard<std::mutex> lock(s.mutex);
+        fn(s.state);
+    }
+
+    // fn(const State&) for each worker in turn, each held for the call only
+    template <typename Fn>
+    void snapshot(Fn fn) {
+        for (auto& s : slots_) {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            fn(static_cast<const State&>(s->state));
+        }
+    }
+
+    // fn(State&) for each worker in turn, e.g. to take and clear buffers
+    template <typename Fn>
+    void take(Fn fn) {
+        for (auto& s : slots_) {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            fn(s->state);
+        }
+    }
+
+private:
+    struct Slot {
+        std::mutex mutex;
+        State state;
+    };
+    std::vector<std::unique_ptr<Slot>> slots_;
+};
+
+}  // namespace delila
@@ -0,0 +1,180 @@
+// Partitioned conversion: deterministic block-range jobs over many files
+//
+// A campaign (many runs, tens of TB) is converted as an array job on a
+// cluster: plan once, run one worker per partition, merge and check.
+//
+//   Plan: every file's block index (sidecar, or one scan that is then saved
+//   as the sidecar) gives the block sizes; the blocks of all files, in
+//   order, are cut into partitions of about equal bytes. A partition is a
+//   list of block ranges and may span files or split one. The plan is a
+//   text manifest, so the same input always gives the same jobs:
+//
+//     delila::PlanOptions opt;
+//     opt.target_bytes = 4ull << 30;              // or opt.partitions = 200
+//     delila::PartitionPlan plan = delila::plan_partitions(chain.files(), opt, &errors);
+//     plan.save("plan.txt");
+//
+//   Work: job k (e.g. $SLURM_ARRAY_TASK_ID) reads its blocks in order and
+//   tallies them like FileSummary, data checksum included:
+//
+//     plan.load("plan.txt");
+//     delila::PartitionReader part;
+//     part.open(plan, k);
+//     while (part.next_batch(header, events)) { ... }
+//     part.result().save("part_00042.result");
+//
+//   Check: combine_partitions() adds up the results per file, from
+//   partial data checksums too, and each FileSummary::check_footer()
+//   compares them with the footer recorded in the plan. The merge node
+//   needs the results only, not the data files.
+//
+// macros/convert_to_tree.C builds on this: plan_partitions(),
+// convert_partition() and merge_partitions() (fast TTree concatenation in
+// partition order, no recompression).
+//
+// Manifest (one record per line, fields separated by single spaces, the
+// path last so it may contain spaces):
+//   delila-plan 1
+//   file <file_size> <blocks> <index_events> <has_footer> <total_events>
+//        <data_bytes> <first_ts> <last_ts> <data_checksum> <write_complete> <path>
+//   range <partition> <file> <first_block> <end_block> <events> <bytes>
+// Result:
+//   delila-partition-result 1
+//   partition <id>
+//   range <file> <first_block> <end_block> <blocks> <events> <waveforms>
+//         <data_bytes> <first_ts> <last_ts> <checksum_state>
+//   error <message>                                            (if any)
+
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "delila/checksum.hpp"
+#include "delila/format.hpp"
+#include "delila/reader.hpp"
+#include "delila/run.hpp"
+
+namespace delila {
+
+struct PlanOptions {
+    size_t partitions = 0;               // Number of jobs; 0: from target_bytes
+    uint64_t target_bytes = 4ull << 30;  // Bytes per job when partitions is 0
+    bool write_index = true;             // Save scanned indices as sidecars for the workers
+};
+
+// One input file as planned
+struct PlannedFile {
+    std::string path;
+    uint64_t file_size = 0;    // Workers refuse a file that changed size
+    size_t blocks = 0;
+    uint64_t events = 0;       // Sum of the index's num_events
+    bool has_footer = false;
+    Footer footer;             // total_events, data_bytes, time range, checksum
+};
+
+// Blocks [first_block, end_block) of plan.files[file]
+struct BlockRange {
+    size_t file = 0;
+    size_t first_block = 0;
+    size_t end_block = 0;
+    uint64_t events = 0;       // From the index
+    uint64_t bytes = 0;        // Length prefixes included
+};
+
+struct Partition {
+    std::vector<BlockRange> ranges;  // In file and block order
+
+    uint64_t events() const;
+    uint64_t bytes() const;
+};
+
+struct PartitionPlan {
+    std::vector<PlannedFile> files;
+    std::vector<Partition> partitions;
+
+    // False (and `error`) if the file cannot be written, or read / parsed
+    bool save(const std::string& path, std::string* error = nullptr) const;
+    bool load(const std::string& path, std::string* error = nullptr);
+};
+
+// Index every file (in the given order) and cut its blocks into balanced
+// partitions. Files that cannot be opened are reported in `errors` and
+// left out; a damaged block ends that file's blocks (and is reported).
+PartitionPlan plan_partitions(const std::vector<std::string>& paths,
+                              const PlanOptions& options = PlanOptions(),
+                              std::vector<std::string>* errors = nullptr);
+
+// What a worker read of one BlockRange, tallied as FileSummary does
+struct RangeResult {
+    size_t file = 0;
+    size_t first_block = 0;
+    size_t end_block = 0;
+    size_t blocks = 0;
+    uint64_t events = 0;
+    uint64_t waveforms = 0;
+    uint64_t data_bytes = 0;
+    double first_ts = DBL_MAX;
+    double last_ts = -DBL_MAX;
+    BlockChecksum checksum;    // Partial footer.data_checksum of the range
+};
+
+struct PartitionResult {
+    size_t partition = 0;
+    std::vector<RangeResult> ranges;
+    std::string error;         // Worker stopped early (open / read / decode)
+
+    bool save(const std::string& path, std::string* error = nullptr) const;
+    bool load(const std::string& path, std::string* error = nullptr);
+};
+
+// The blocks of one partition, opening its files in turn
+class PartitionReader {
+public:
+    // Check the partition exists; files are opened on first read (with
+    // their index, sidecar or scan). False (see error()) if it does not.
+    bool open(const PartitionPlan& plan, size_t partition, ReadMode mode = ReadMode::Mmap);
+
+    // Next block of the partition. False at its end or on error (error();
+    // also recorded in result().error).
+    bool next_batch(BatchHeader& header, std::vector<Event>& events);
+    bool next_columns(BatchHeader& header, EventColumns& cols, bool decode_waveforms = true);
+
+    // Blocks and bytes read and stage times (see metrics.hpp); not owned
+    void set_metrics(Metrics* metrics) { metrics_ = metrics; }
+
+    const std::string& error() const { return error_; }
+    // Ranges read so far (complete after next_*() returned false cleanly)
+    const PartitionResult& result() const { return result_; }
+    // File of the block returned last
+    const std::string& current_path() const;
+
+private:
+    bool next_block(BlockView& block);
+    bool fail(const std::string& msg);
+
+    const PartitionPlan* plan_ = nullptr;
+    const Partition* partition_ = nullptr;
+    ReadMode mode_ = ReadMode::Mmap;
+    size_t range_ = 0;           // Current range
+    size_t next_index_ = 0;      // Next block of the current range
+    std::unique_ptr<FileReader> reader_;
+    Metrics* metrics_ = nullptr;
+    std::string error_;
+    PartitionResult result_;
+};
+
+// Per-file tallies of all results, in plan order, for check_footer() and
+// RunSummary::of(). A missing, duplicate or failed partition, or one whose
+// ranges differ from the plan, goes to `problems`; its files then come up
+// short against their footers. Checksums are marked checked (Match /
+// Mismatch) only for files whose every block was read.
+std::vector<FileSummary> combine_partitions(const PartitionPlan& plan,
+                                            const std::vector<PartitionResult>& results,
+                                            std::vector<std::string>* problems = nullptr);
+
+}  // namespace delila
@@ -0,0 +1,143 @@
+// Offline pulse-shape reprocessing of stored waveforms
+//
+// Recomputes, from analog_probe1 of every event with a waveform, what the
+// DPP-PSD firmware computed online: baseline, long / short gate charges,
+// PSD = (long - short) / long and the CFD zero-crossing time, so new gate
+// settings can be tried without taking new data.
+//
+// PsdParameters carries the channel parameters of the digitizer config
+// (ChannelConfig in src/config/digitizer.rs, same names and units), and
+// set() takes them by name, so a channel's firmware settings are replayed
+// as written:
+//
+//   delila::PsdParameters par;
+//   par.set("polarity", "Negative");
+//   par.set("gate_long_ns", "400");
+//   par.set("gate_short_ns", "60");
+//   delila::PulseProcessor proc(par);
+//   delila::PulseColumns pulses;
+//   while (reader.next_columns(header, cols)) {
+//       proc.process(cols, pulses);   // pulses.q_long[i] ... for event i
+//   }
+//
+// or over whole files, blocks processed on all cores and handed back in
+// file order (what macros/reprocess_pulses.C writes as branches):
+//
+//   delila::reprocess_pulses(chain.files(), par, [&](const delila::PulseBlock& b) { ... });
+//
+// Per waveform: the samples are prefix-summed once (integer, exact), so the
+// baseline and both gates are differences of two sums; the baseline-
+// subtracted, polarity-corrected signal and the CFD signal are computed
+// with the SIMD level of simd.hpp (AVX2, SSE4.1, NEON or plain C++; the
+// results are identical at every level).
+//
+// Charges are sums of baseline-subtracted samples (ADC x samples), not
+// scaled by the firmware's charge sensitivity, so they compare to energy /
+// energy_short up to a per-channel gain.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "delila/columns.hpp"
+#include "delila/event.hpp"
+#include "delila/metrics.hpp"
+
+namespace delila {
+
+// Channel parameters of ChannelConfig (src/config/digitizer.rs) that shape
+// the PSD, plus the offline-only settings below them
+struct PsdParameters {
+    std::string polarity = "Negative";  // "Positive" / "Negative" / "POLARITY_*"
+    uint32_t trigger_threshold = 0;     // ADC counts arming the CFD (0: half the peak)
+    uint32_t gate_long_ns = 400;
+    uint32_t gate_short_ns = 100;
+    uint32_t gate_pre_ns = 40;          // Gates open this long before the trigger
+    uint32_t cfd_delay_ns = 8;
+
+    // Not in the digitizer config
+    double cfd_fraction = 0.25;         // CFD attenuation
+    uint32_t pre_trigger_ns = 200;      // Trigger position in the waveform
+    uint32_t baseline_samples = 16;     // Averaged just before the gates
+    double sample_ns = 2.0;             // Sample period at time_resolution 0 (x2^time_resolution)
+
+    bool negative() const;
+
+    // Set a field by name from its config text ("gate_long_ns", "400").
+    // False (and `error`, if given) for an unknown name or a bad value.
+    bool set(const std::string& name, const std::string& value, std::string* error = nullptr);
+};
+
+// Reprocessed quantities of one waveform
+struct PulseResult {
+    float baseline = 0.0f;    // Mean ADC value of the baseline window
+    float amplitude = 0.0f;   // Peak of the baseline-subtracted, polarity-corrected signal
+    float q_long = 0.0f;      // Signal summed over the long / short gate
+    float q_short = 0.0f;
+    float psd = 0.0f;         // (q_long - q_short) / q_long, NaN unless q_long > 0
+    double cfd_time_ns = 0.0; // CFD zero crossing after the first sample, NaN if none
+};
+
+// PulseResult per event of a block (NaN everywhere for events without a
+// waveform)
+struct PulseColumns {
+    std::vector<float> baseline;
+    std::vector<float> amplitude;
+    std::vector<float> q_long;
+    std::vector<float> q_short;
+    std::vector<float> psd;
+    std::vector<double> cfd_time_ns;
+
+    size_t size() const { return q_long.size(); }
+    void resize(size_t n);
+    void set(size_t i, const PulseResult& r);
+};
+
+// Not thread-safe (scratch buffers are reused): one per thread
+class PulseProcessor {
+public:
+    explicit PulseProcessor(const PsdParameters& params = PsdParameters());
+
+    // One waveform; time_resolution as stored (0-3) scales the sample period
+    PulseResult process(const int16_t* samples, size_t n, uint8_t time_resolution = 0);
+
+    // Every event of cols (decoded with waveforms); `out` is overwritten
+    void process(const EventColumns& cols, PulseColumns& out);
+
+    const PsdParameters& params() const { return params_; }
+
+private:
+    PsdParameters params_;
+    float sign_;                    // -1 for negative pulses
+    std::vector<uint32_t> prefix_;  // prefix_[i]: sum of samples [0, i), mod 2^32
+    std::vector<float> signal_;
+    std::vector<float> cfd_;
+};
+
+// One decoded block and its reprocessed pulses
+struct PulseBlock {
+    const std::string* path = nullptr;  // File it came from
+    BatchHeader header;
+    EventColumns cols;
+    PulseColumns pulses;
+};
+
+// Called with every block of every file, in file and block order, on the
+// calling thread
+using PulseSink = std::function<void(const PulseBlock& block)>;
+
+// Decode (mmapped, with waveforms) and reprocess every block of `paths` on
+// up to n_workers threads (0: all cores), handing the blocks to `sink` in
+// order. Files that cannot be read, and damaged blocks, are reported in
+// `errors` and skipped. Returns the number of events handed to `sink`.
+// Stage times and counters go to `metrics` if given (see metrics.hpp; the
+// pulse analysis and the sink count as Stage::Fill).
+uint64_t reprocess_pulses(const std::vector<std::string>& paths, const PsdParameters& params,
+                          const PulseSink& sink, unsigned n_workers = 0,
+                          std::vector<std::string>* errors = nullptr, Metrics* metrics = nullptr);
+
+}  // namespace delila
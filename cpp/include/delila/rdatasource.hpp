@@ -0,0 +1,87 @@
+// RDataFrame data source for .delila files (libdelila_rdf, needs ROOT)
+//
+// Exposes one row per event without converting to a TTree:
+//   module, channel, energy, energy_short, timestamp_ns, flags, has_waveform,
+//   analog_probe1, analog_probe2, digital_probe1..4, time_resolution,
+//   trigger_threshold
+//
+// Entry ranges are whole-block ranges taken from the block index, so
+// ROOT::EnableImplicitMT() spreads blocks across slots. Blocks are decoded
+// into EventColumns (the struct-of-arrays decoder); waveforms only when a
+// query reads a waveform column, and then only the probes it reads are
+// handed to RDF. A query that reads no column (Count()) decodes nothing.
+// Likewise only the scalar columns a query reads are stored (MessagePack
+// has no field offsets, so the others are still stepped over).
+//
+// Usage:
+//   ROOT::EnableImplicitMT();
+//   auto df = delila::MakeDelilaDataFrame("data/run0010_0000_data.delila");
+//   auto h = df.Filter("channel == 3").Histo1D({"e", "energy", 4096, 0, 65536}, "energy");
+
+#pragma once
+
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/RDataSource.hxx>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "delila/columns.hpp"
+#include "delila/event.hpp"
+#include "delila/reader.hpp"
+
+namespace delila {
+
+class RDelilaDS final : public ROOT::RDF::RDataSource {
+public:
+    // Opens the file (Mmap mode) and loads or builds its block index.
+    // Throws std::runtime_error if the file cannot be read.
+    explicit RDelilaDS(std::string_view path);
+
+    void SetNSlots(unsigned int n_slots) override;
+    const std::vector<std::string>& GetColumnNames() const override;
+    bool HasColumn(std::string_view name) const override;
+    std::string GetTypeName(std::string_view name) const override;
+    std::vector<std::pair<ULong64_t, ULong64_t>> GetEntryRanges() override;
+    bool SetEntry(unsigned int slot, ULong64_t entry) override;
+    void Initialize() override;
+    std::string GetLabel() override { return "Delila"; }
+
+    uint64_t num_entries() const { return block_first_entry_.back(); }
+
+protected:
+    Record_t GetColumnReadersImpl(std::string_view name, const std::type_info& type) override;
+
+private:
+    struct Slot {
+        size_t block = SIZE_MAX;  // Block currently decoded into `events`
+        ULong64_t first_entry = 0;
+        ULong64_t end_entry = 0;
+        BatchHeader header;
+        EventColumns cols;
+        std::vector<Event> events;       // has_waveform without waveform columns
+        bool events_layout = false;      // Block decoded into `events`, not `cols`
+        Waveform waveform;               // Probes of the current event that are read
+        ULong64_t flags = 0;             // Copy: uint64_t is not ULong64_t on LP64
+        bool has_waveform = false;
+        std::vector<const void*> values;  // Per column: address of the current value
+    };
+
+    int column_index(std::string_view name) const;
+    void load_block(Slot& slot, size_t block);
+    void set_waveform(Slot& slot, size_t i);
+
+    FileReader reader_;
+    std::vector<ULong64_t> block_first_entry_;  // Prefix sum of num_events (size = blocks + 1)
+    std::vector<Slot> slots_;
+    uint32_t used_columns_ = 0;  // Bit per column with readers
+    bool decode_waveforms_ = false;
+    bool ranges_done_ = false;
+};
+
+// RDataFrame over a .delila file
+ROOT::RDataFrame MakeDelilaDataFrame(std::string_view path);
+
+}  // namespace delila
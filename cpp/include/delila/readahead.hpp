@@ -0,0 +1,115 @@
+// Read-ahead: a background I/O thread reading a file ahead of the decoder
+//
+// For files where mmap does not help (NFS / HDD archives), the plain Stream
+// mode stalls the decoder on every read and leaves the disk idle while it
+// parses. ReadAhead keeps a ring of `depth` preallocated buffers of
+// `read_size` bytes: the I/O thread fills free buffers with consecutive
+// pread()s from the current position while the decoder consumes filled
+// ones, and each buffer goes back to the ring once the decoder has moved
+// past it. Steady state allocates nothing.
+//
+// Used by FileReader in ReadMode::ReadAhead:
+//   delila::FileReader reader;
+//   reader.set_read_ahead({8, 4 << 20});                 // depth, read_size
+//   reader.open(path, delila::ReadMode::ReadAhead);
+//   while (reader.next_columns(batch, cols)) { ... }
+//   delila::ReadAheadStats s = reader.read_ahead_stats();
+//   // s.decoder_waits >> s.io_waits: I/O-bound; the other way: CPU-bound
+//
+// fetch() is for one consumer thread, reading mostly forwards. A fetch
+// outside the data read so far (a seek) discards the read-ahead and
+// restarts the I/O thread there.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace delila {
+
+struct ReadAheadOptions {
+    size_t depth = 4;               // Buffers in the ring
+    size_t read_size = 4 << 20;     // Bytes per read (and per buffer)
+};
+
+struct ReadAheadStats {
+    uint64_t reads = 0;             // Buffers filled by the I/O thread
+    uint64_t bytes = 0;
+    uint64_t restarts = 0;          // Seeks that discarded read-ahead
+    uint64_t decoder_waits = 0;     // fetch() found no data ready: I/O-bound
+    uint64_t io_waits = 0;          // Ring full, I/O thread idle: CPU-bound
+    double decoder_wait_seconds = 0;
+    double io_wait_seconds = 0;
+};
+
+class ReadAhead {
+public:
+    explicit ReadAhead(ReadAheadOptions options = ReadAheadOptions());
+    ~ReadAhead() { close(); }
+    ReadAhead(const ReadAhead&) = delete;
+    ReadAhead& operator=(const ReadAhead&) = delete;
+
+    // Open `path` and start reading at `begin`, up to `end`. False (see
+    // error()) if the file cannot be opened.
+    bool open(const std::string& path, uint64_t begin, uint64_t end);
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+
+    // Move the end of the readable range (a file that grew)
+    void set_end(uint64_t end);
+
+    // `len` bytes at `offset` in [begin, end): a pointer into a ring buffer,
+    // or into an internal buffer when the range spans two reads. Valid until
+    // the next fetch(). nullptr on a read error or past the end.
+    const uint8_t* fetch(uint64_t offset, size_t len);
+
+    const ReadAheadOptions& options() const { return options_; }
+    ReadAheadStats stats() const;
+    const std::string& error() const { return error_; }
+
+private:
+    struct Chunk {
+        size_t buffer = 0;          // Index into buffers_
+        uint64_t offset = 0;        // File offset of the first byte
+        size_t size = 0;
+        uint64_t end() const { return offset + size; }
+    };
+
+    void io_loop();
+    // Drop the read-ahead and continue reading at `offset` (lock held)
+    void restart(uint64_t offset);
+    // Wait until filled_ is not empty (lock held). False on a read error,
+    // or once everything up to end_ has been handed out.
+    bool wait_for_data(std::unique_lock<std::mutex>& lock);
+    // Hand the first filled buffer back to the I/O thread (lock held)
+    void release_front();
+
+    ReadAheadOptions options_;
+    int fd_ = -1;
+    std::string error_;
+    std::thread io_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable filled_cv_;   // Decoder waits for data
+    std::condition_variable free_cv_;     // I/O thread waits for a buffer / work
+    std::vector<std::vector<uint8_t>> buffers_;
+    std::vector<size_t> free_;
+    std::deque<Chunk> filled_;          // Consecutive, in file order
+    uint64_t ahead_begin_ = 0;          // First byte still filled or in flight
+    uint64_t read_pos_ = 0;             // Next offset the I/O thread reads
+    bool in_flight_ = false;            // I/O thread is in pread()
+    uint64_t end_ = 0;
+    uint64_t generation_ = 0;           // Bumped by restart(); stale reads are dropped
+    bool stop_ = false;
+    bool io_error_ = false;
+    std::vector<uint8_t> joined_;       // Ranges spanning two reads
+    ReadAheadStats stats_;
+};
+
+}  // namespace delila
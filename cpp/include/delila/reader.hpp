@@ -0,0 +1,350 @@
+// Sequential block reader for .delila files
+//
+// Two read modes:
+//   ReadMode::Mmap   - map the whole file (madvise sequential) and hand out
+//                      views straight into the mapping; no copy, no allocation.
+//                      Views stay valid until close(). Falls back to Stream
+//                      if the file cannot be mapped.
+//   ReadMode::Stream - std::ifstream into one reused buffer. Views stay valid
+//                      until the next read.
+//   ReadMode::ReadAhead - an I/O thread reads data blocks ahead into a ring
+//                      of buffers (readahead.hpp, set_read_ahead()) while
+//                      blocks are decoded; for NFS / HDD. Views as for Stream.
+//
+// Usage:
+//   delila::FileReader reader;
+//   if (!reader.open("data/run0010_0000_data.delila")) { ... reader.error() ... }
+//   delila::BatchHeader batch;
+//   std::vector<delila::Event> events;
+//   while (reader.next_batch(batch, events)) {
+//       for (const auto& ev : events) { ... }
+//   }
+//   if (!reader.error().empty()) { ... stopped on a damaged block ... }
+//
+// Random access (uses the <file>.idx sidecar, or scans the file once):
+//   reader.seek_to_time(t0);   // next_batch() continues from the first block
+//                              // that can hold an event at or after t0
+//   reader.read_block(i, block);
+//
+// Checksum (footer.data_checksum) while reading, no second pass:
+//   reader.set_verify_checksum(true);
+//   while (reader.next_batch(batch, events)) { ... }
+//   if (reader.check_checksum() == delila::ChecksumStatus::Mismatch) { ... }
+// or without decoding, on all cores (Mmap):  reader.verify_checksum()
+//
+// Per-stage times and throughput counters (see metrics.hpp):
+//   delila::Metrics metrics;
+//   reader.set_metrics(&metrics);
+//   while (reader.next_batch(batch, events)) { ... }
+//   std::cout << metrics.snapshot().to_json("my_tool") << std::endl;
+//
+// Damaged files (a crash, a bad disk): with resync on, a block with a bad
+// length, a truncated block or one that does not decode is stepped over.
+// The reader scans ahead for the next plausible block and goes on there:
+//   reader.set_resync(true);
+//   while (reader.next_batch(batch, events)) { ... }
+//   for (const auto& d : reader.damaged()) { ... d.offset, d.length, d.reason ... }
+//
+// Following a file the recorder is still writing (no footer yet):
+//   reader.set_follow(true);
+//   for (;;) {
+//       while (reader.next_batch(batch, events)) { ... }
+//       if (reader.has_footer()) break;     // File closed by the recorder
+//       sleep(1);
+//       reader.refresh();                   // Picks up appended blocks
+//   }
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "delila/checksum.hpp"
+#include "delila/columns.hpp"
+#include "delila/event.hpp"
+#include "delila/filter.hpp"
+#include "delila/format.hpp"
+#include "delila/index.hpp"
+#include "delila/metrics.hpp"
+#include "delila/readahead.hpp"
+
+namespace delila {
+
+// Non-owning view of one data block
+struct BlockView {
+    const uint8_t* data = nullptr;  // Block as stored (length prefix excluded): the
+    size_t size = 0;                // MessagePack, or in v3 block header + payload
+    uint64_t offset = 0;            // File offset of the u32 length prefix
+    size_t index = 0;               // Block number within the file
+    bool has_block_header = false;  // v3 block (see compression.hpp)
+};
+
+enum class ReadMode {
+    Mmap,
+    Stream,
+    ReadAhead,
+};
+
+enum class ChecksumStatus {
+    NoFooter,    // Nothing to compare against
+    Incomplete,  // Not every data block was hashed (stopped early, or seeks)
+    Match,
+    Mismatch,
+};
+
+const char* checksum_status_name(ChecksumStatus status);
+
+// Bytes stepped over by resync (set_resync())
+struct DamagedRange {
+    uint64_t offset = 0;   // Length prefix of the bad block
+    uint64_t length = 0;   // Up to the next plausible block (or the data end)
+    std::string reason;    // What was wrong with the block
+};
+
+// A block that failed to decode outside the reader (decode_block() on a
+// worker) and was stepped over, as a damaged range: length prefix included
+DamagedRange skipped_block(const BlockView& block, const std::string& reason);
+
+// Ranges of both lists in file order, e.g. reader.damaged() and the
+// skipped_block()s of the workers
+std::vector<DamagedRange> merge_damaged(std::vector<DamagedRange> a,
+                                        const std::vector<DamagedRange>& b);
+
+class FileReader {
+public:
+    FileReader() = default;
+    ~FileReader() { close(); }
+    FileReader(const FileReader&) = delete;
+    FileReader& operator=(const FileReader&) = delete;
+
+    // Open a file and read header and footer. Returns false on error.
+    bool open(const std::string& path, ReadMode mode = ReadMode::Mmap);
+    void close();
+    bool is_open() const { return is_open_; }
+
+    const std::string& path() const { return path_; }
+
+    // Mode actually in use (Stream if mapping failed)
+    ReadMode mode() const { return mode_; }
+
+    // Ring depth and read size for ReadMode::ReadAhead; set before open()
+    void set_read_ahead(const ReadAheadOptions& options) { read_ahead_options_ = options; }
+    // I/O and decoder stall counters of the current file (ReadAhead mode)
+    ReadAheadStats read_ahead_stats() const {
+        return read_ahead_ ? read_ahead_->stats() : ReadAheadStats();
+    }
+
+    // Last error message (empty if the reader stopped cleanly)
+    const std::string& error() const { return error_; }
+
+    uint64_t file_size() const { return file_size_; }
+    uint32_t header_length() const { return header_length_; }
+    const FileHeader& header() const { return header_; }
+    bool has_header_metadata() const { return header_valid_; }
+
+    // v3 file: blocks carry a block header and may be compressed
+    bool has_block_headers() const { return block_headers_; }
+
+    // Footer is only valid if has_footer() (missing for crashed/open files)
+    bool has_footer() const { return has_footer_; }
+    const Footer& footer() const { return footer_; }
+
+    // Data region [data_begin, data_end)
+    uint64_t data_begin() const { return data_begin_; }
+    uint64_t data_end() const { return data_end_; }
+
+    // Restart block iteration at the first data block
+    void rewind();
+
+    // Read the next block (see ReadMode for view lifetime).
+    // Returns false at end of data or on error (check error()).
+    bool next_block(BlockView& block);
+
+    // Read and decode the next block. `events` is overwritten.
+    bool next_batch(BatchHeader& header, std::vector<Event>& events);
+
+    // Read and decode the next block into columns (see columns.hpp).
+    // `cols` is overwritten.
+    bool next_columns(BatchHeader& header, EventColumns& cols, bool decode_waveforms = true);
+
+    // As above, keeping only the events `filter` accepts (see filter.hpp);
+    // `cols` may come back empty. With a loaded index, blocks the filter
+    // rules out by time range or zone map are stepped over unread
+    // (blocks_skipped(); this stops the running checksum, like a seek).
+    bool next_columns(BatchHeader& header, EventColumns& cols, const EventFilter& filter,
+                      bool decode_waveforms = true);
+
+    // Decode a block obtained from next_block()/read_block(). Stateless and
+    // thread-safe: in Mmap mode, views collected on one thread can be decoded
+    // on many, and compressed v3 blocks are decompressed there too. On
+    // failure `error` (if given) says which event was bad.
+    // decode_waveforms = false skips the probe arrays (see parse_event).
+    // With `metrics`, decompress / parse / waveform times and the processed
+    // (or dropped) block and its events are added to it. Into columns, only
+    // the scalar `fields` (FIELD_* of columns.hpp) are stored.
+    static bool decode_block(const BlockView& block, BatchHeader& header,
+                             std::vector<Event>& events, std::string* error = nullptr,
+                             bool decode_waveforms = true, Metrics* metrics = nullptr);
+    static bool decode_block(const BlockView& block, BatchHeader& header, EventColumns& cols,
+                             std::string* error = nullptr, bool decode_waveforms = true,
+                             Metrics* metrics = nullptr, uint32_t fields = ALL_FIELDS);
+    static bool decode_block(const BlockView& block, BatchHeader& header, EventColumns& cols,
+                             const EventFilter& filter, std::string* error = nullptr,
+                             bool decode_waveforms = true, Metrics* metrics = nullptr,
+                             uint32_t fields = ALL_FIELDS);
+
+    // View of block i straight from the mapping, without touching the
+    // iteration state. Thread-safe once load_index() has been called;
+    // Mmap mode only (returns false in Stream mode).
+    bool view_block(size_t i, BlockView& block) const;
+
+    // Count blocks and bytes read, and time every stage of next_block(),
+    // next_batch() and next_columns(), into `metrics` (null: off, the
+    // default). Not owned; may be shared with other readers.
+    void set_metrics(Metrics* metrics) { metrics_ = metrics; }
+    Metrics* metrics() const { return metrics_; }
+
+    size_t blocks_read() const { return blocks_read_; }
+    uint64_t bytes_read() const { return bytes_read_; }
+    size_t blocks_skipped() const { return blocks_skipped_; }  // Pruned by a filter
+
+    // Load the block index sidecar. A missing or stale sidecar (built for a
+    // different file size) is replaced by an in-memory index from one scan,
+    // or with scan = false left out (false, no index). Rewinds the reader.
+    // Returns false if the scan hit a damaged block; the index then covers
+    // the blocks before it.
+    bool load_index(bool scan = true);
+    bool has_index() const { return has_index_; }
+    bool index_from_sidecar() const { return index_from_sidecar_; }
+    const BlockIndex& index() const { return index_; }
+
+    // Read block i (loads the index on first use). Iteration continues with
+    // block i + 1.
+    bool read_block(size_t i, BlockView& block);
+
+    // Position iteration at the first block that may contain an event at or
+    // after t_ns. Blocks from different sources overlap in time, so callers
+    // filtering a window still check each event's timestamp. Returns false
+    // if no block reaches t_ns.
+    bool seek_to_time(double t_ns);
+
+    // Follow mode: in a file without footer, a block that runs past the end
+    // is still being written. Iteration stops before it without an error
+    // and resumes there after refresh(). Off by default (a truncated tail
+    // is then an error).
+    void set_follow(bool on) { follow_ = on; }
+    bool follow() const { return follow_; }
+
+    // Bytes after the last complete block (the partial block in follow mode)
+    uint64_t pending_bytes() const { return data_end_ > pos_ ? data_end_ - pos_ : 0; }
+
+    // Pick up data appended since open() or the last refresh(): re-reads the
+    // file size, remaps the file in Mmap mode (views of earlier blocks are
+    // invalidated) and looks for a footer written meanwhile. Iteration
+    // position and counters are kept; the index is dropped. Returns true if
+    // the file grew.
+    bool refresh();
+
+    // Resync on damage: instead of stopping at a block with a bad length, a
+    // truncated block or (next_batch() / next_columns()) one that does not
+    // decode, scan ahead for the next plausible block and continue there;
+    // load_index() then indexes every block it can find. A plausible block
+    // has a sane u32 length and starts like a batch: a 4-element array whose
+    // source_id fits a u32 (and is in the header's source_ids, if listed), or
+    // in v3 a valid block header. The block after it must check out too.
+    // If the damaged block's length still points at a plausible block, that
+    // is where reading goes on, without a scan.
+    // The scan looks for that array tag (v3: the block header's zero bytes)
+    // with memchr / memmem, which glibc vectorizes. Block numbers then count
+    // the blocks read, not their place in the file. Off by default.
+    void set_resync(bool on) { resync_ = on; }
+    bool resync() const { return resync_; }
+    // Stretches stepped over, in file order (cleared by rewind())
+    const std::vector<DamagedRange>& damaged() const { return damaged_; }
+
+    // Offset of the first plausible block whose length prefix is at or after
+    // `from` (see set_resync()); data_end() if there is none
+    uint64_t find_next_block(uint64_t from);
+
+    // Hash blocks into checksum() as next_block()/read_block() hand them
+    // out. Only an unbroken run from block 0 counts; seeks stop the sum
+    // until the next rewind(). Off by default.
+    void set_verify_checksum(bool on) { verify_checksum_ = on; }
+    bool verify_checksum_enabled() const { return verify_checksum_; }
+    const BlockChecksum& checksum() const { return checksum_; }
+
+    // Compare a checksum over this file's blocks with the footer. Workers
+    // decoding view_block() views each hash their own blocks and merge.
+    ChecksumStatus check_checksum(const BlockChecksum& sum) const;
+    ChecksumStatus check_checksum() const { return check_checksum(checksum_); }
+
+    // Verify-only pass: hash every block without decoding. In Mmap mode the
+    // blocks, from the sidecar index or else the length prefixes alone (no
+    // index scan), are split over n_threads (0: all cores); in Stream mode,
+    // or if the framing is damaged, one sequential pass. Rewinds the reader.
+    ChecksumStatus verify_checksum(unsigned n_threads = 0);
+
+private:
+    bool fail(const std::string& msg);
+    bool map_file();
+    void unmap_file();
+
+    // Pointer to `len` bytes at `offset` (into the mapping, or read into buffer_)
+    const uint8_t* fetch(uint64_t offset, size_t len);
+
+    // Read the block whose length prefix is at `offset` and advance past it
+    bool read_block_at(uint64_t offset, size_t index, BlockView& block);
+    bool build_index();
+
+    // `avail` bytes at the length prefix `offset` look like a block ending
+    // at `end` (past data_end() only if `truncated_ok` and there is no footer)
+    bool plausible_block(const uint8_t* p, size_t avail, uint64_t offset, uint64_t& end,
+                         bool truncated_ok = false) const;
+    // A plausible block at `offset` followed by another one (or the data end)
+    bool plausible_at(uint64_t offset, bool check_next = true);
+    // Record the damaged block at `offset` and move to the next plausible
+    // one. False if none is left.
+    bool resync_from(uint64_t offset, const std::string& reason);
+
+    bool is_open_ = false;
+    ReadMode mode_ = ReadMode::Mmap;
+    std::ifstream f_;
+    uint64_t stream_pos_ = 0;       // Current ifstream position (avoids redundant seeks)
+    const uint8_t* map_ = nullptr;  // Whole-file mapping in Mmap mode
+    std::string path_;
+    std::string error_;
+    uint64_t file_size_ = 0;
+    uint32_t header_length_ = 0;
+    FileHeader header_;
+    bool header_valid_ = false;
+    bool block_headers_ = false;    // DELILA03
+    Footer footer_;
+    bool has_footer_ = false;
+    uint64_t data_begin_ = 0;
+    uint64_t data_end_ = 0;
+
+    uint64_t pos_ = 0;
+    size_t blocks_read_ = 0;
+    uint64_t bytes_read_ = 0;
+    size_t blocks_skipped_ = 0;
+    std::vector<uint8_t> buffer_;  // Reused across blocks (Stream mode)
+    ReadAheadOptions read_ahead_options_;
+    std::unique_ptr<ReadAhead> read_ahead_;  // Data blocks in ReadAhead mode
+
+    BlockIndex index_;
+    bool has_index_ = false;
+    bool index_from_sidecar_ = false;
+
+    bool verify_checksum_ = false;
+    BlockChecksum checksum_;
+    bool follow_ = false;
+    bool resync_ = false;
+    std::vector<DamagedRange> damaged_;
+    Metrics* metrics_ = nullptr;
+};
+
+}  // namespace delila
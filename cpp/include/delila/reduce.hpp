@@ -0,0 +1,107 @@
+// Waveform reduction at conversion time
+//
+// Most stored samples are baseline before the trigger. ReduceOptions
+// shrinks each waveform before it is written:
+//
+//   crop        keep [trigger - pre, trigger + post) around the trigger,
+//               found as the first set sample of a digital probe (the
+//               firmware's trigger marker, digital_probe1 by default);
+//               waveforms without the marker are kept whole
+//   decimate    one sample per N: the mean of the N analog samples (or the
+//               first, with pick) and any set digital sample of the N, so
+//               short digital pulses survive
+//   digital     keep, drop (constant probes stored as one level bit, no
+//               samples) or rle (every probe as its level at the first
+//               kept sample plus the positions where it toggles)
+//   features    no samples at all: baseline, its RMS, peak, peak position
+//               and the baseline-subtracted integral of analog_probe1
+//
+//   delila::ReduceOptions opt;
+//   opt.set("crop", "32:160");
+//   opt.set("decimate", "2");
+//   opt.set("digital", "rle");
+//   delila::ReducedWaveform red;
+//   for (const auto& ev : events) {
+//       if (ev.has_waveform) delila::reduce_waveform(ev.waveform, opt, red);
+//       // red.wf: kept samples; red.first_sample, red.decimation map them back:
+//       //   sample k was original sample first_sample + k * decimation
+//   }
+//
+// macros/convert_to_tree.C takes the same names in its output profile
+// ("crop=32:160,decimate=2,digital=rle").
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "delila/event.hpp"
+
+namespace delila {
+
+enum class DigitalMode {
+    Keep,          // Samples as they are (cropped and decimated)
+    DropConstant,  // Probes constant over the kept window: level bit only
+    RunLength,     // Every probe as level + toggle positions
+};
+
+struct ReduceOptions {
+    bool crop = false;
+    uint32_t pre_samples = 64;     // Kept before the trigger
+    uint32_t post_samples = 256;   // Kept from the trigger on
+    int trigger_probe = 1;         // Digital probe (1-4) marking the trigger
+
+    uint32_t decimate = 1;         // Keep one sample per `decimate`
+    bool pick = false;             // First sample of each group instead of the mean
+
+    DigitalMode digital = DigitalMode::Keep;
+
+    bool features = false;         // Features only, no samples
+    uint32_t baseline_samples = 16; // Averaged from the first sample for the baseline
+
+    // Anything to do at all
+    bool active() const {
+        return crop || decimate > 1 || digital != DigitalMode::Keep || features;
+    }
+
+    // Set an option by name: "crop" ("PRE:POST"), "trigger" (1-4),
+    // "decimate" (N >= 1), "pick", "digital" ("keep" / "drop" / "rle"),
+    // "features", "baseline" (samples). False (and `error`, if given) for
+    // an unknown name or a bad value.
+    bool set(const std::string& name, const std::string& value, std::string* error = nullptr);
+};
+
+// Features of analog_probe1 (features mode)
+struct WaveformFeatures {
+    float baseline = 0.0f;      // Mean of the first baseline_samples samples
+    float baseline_rms = 0.0f;  // Their RMS about the mean
+    float peak = 0.0f;          // Largest deviation from the baseline, signed
+    int32_t peak_sample = -1;   // Where it is; -1 without samples
+    float integral = 0.0f;      // Baseline-subtracted sum over the kept window
+};
+
+// One reduced waveform; reused between calls without reallocating
+struct ReducedWaveform {
+    Waveform wf;                 // Kept samples (empty in features mode)
+    uint32_t n_samples = 0;      // Length of the original (longest probe)
+    int32_t trigger_sample = -1; // Trigger marker in the original; -1: none
+    uint32_t first_sample = 0;   // Original index of kept sample 0
+    uint32_t decimation = 1;
+    // Bit k: level of digital_probe(k+1); DropConstant: of the dropped
+    // probes, RunLength: at first_sample
+    uint8_t digital_levels = 0;
+    // RunLength: where digital_probe(k+1) toggles, in original samples
+    // counted from first_sample (not decimated)
+    std::vector<uint32_t> digital_edges[4];
+    WaveformFeatures features;
+};
+
+// Reduce `in` according to `opt` into `out`
+void reduce_waveform(const Waveform& in, const ReduceOptions& opt, ReducedWaveform& out);
+
+// First set sample of digital_probe`probe` (1-4), -1 if none
+int32_t find_trigger(const Waveform& wf, int probe = 1);
+
+}  // namespace delila
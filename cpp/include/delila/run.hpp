@@ -0,0 +1,120 @@
+// Multi-file run processing
+//
+// A run is split into many files (1 GB / 10 min each by default). These
+// helpers process the files of a run side by side, one worker per file,
+// and check what was read against each file's footer.
+//
+//   delila::FileChain chain;
+//   chain.add_run("data", 42);
+//   std::vector<delila::FileSummary> files(chain.files().size());
+//   delila::for_each_parallel(files.size(), 8, [&](size_t i) {
+//       delila::FileReader reader;
+//       ... reader.open(chain.files()[i]), files[i].add_block(...) ...
+//   });
+//   delila::RunSummary run = delila::RunSummary::of(files);
+//
+// summarize_files() does the reading part when only the tallies are needed,
+// read_columns() when all events are wanted in memory as one set of columns.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "delila/columns.hpp"
+#include "delila/event.hpp"
+#include "delila/filter.hpp"
+#include "delila/format.hpp"
+#include "delila/reader.hpp"
+
+namespace delila {
+
+// Call fn(i) for i in [0, n) on up to n_workers threads (0: all cores).
+// Items are handed out one at a time, so long and short files balance.
+template <typename Fn>
+void for_each_parallel(size_t n, unsigned n_workers, Fn fn) {
+    if (n_workers == 0) n_workers = std::max(1u, std::thread::hardware_concurrency());
+    n_workers = static_cast<unsigned>(std::min<size_t>(n_workers, n));
+
+    std::atomic<size_t> next{0};
+    auto work = [&] {
+        for (size_t i = next++; i < n; i = next++) fn(i);
+    };
+    if (n_workers <= 1) {
+        work();
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < n_workers; t++) workers.emplace_back(work);
+    for (auto& w : workers) w.join();
+}
+
+// What was read from one file, tallied the way the recorder fills its
+// footer: per block, the first and last event widen [first_ts, last_ts]
+struct FileSummary {
+    std::string path;
+    uint64_t events = 0;
+    uint64_t waveforms = 0;
+    size_t blocks = 0;                     // blocks and data_bytes (length
+    uint64_t data_bytes = 0;               // prefixes included) set by finish()
+    double first_ts = DBL_MAX;
+    double last_ts = -DBL_MAX;
+    bool has_footer = false;
+    Footer footer;
+    bool checksum_checked = false;         // Reader hashed the blocks
+    ChecksumStatus checksum = ChecksumStatus::NoFooter;
+    std::string error;                     // Open or read error
+
+    void add_block(const std::vector<Event>& events);
+    void add_block(const EventColumns& cols);  // Counts decoded waveforms only
+
+    // Take block counts, footer, checksum (if the reader verified it) and
+    // error from the reader after the last block
+    void finish(const FileReader& reader);
+
+    // Mismatches against the footer, one message each (empty: consistent).
+    // A file without a valid footer cannot be checked and reports that.
+    std::vector<std::string> check_footer() const;
+};
+
+// Totals over the files of a run
+struct RunSummary {
+    size_t files = 0;
+    size_t files_with_errors = 0;
+    size_t files_failing_footer = 0;
+    uint64_t events = 0;
+    uint64_t waveforms = 0;
+    size_t blocks = 0;
+    uint64_t data_bytes = 0;
+    double first_ts = DBL_MAX;
+    double last_ts = -DBL_MAX;
+
+    void add(const FileSummary& file);
+    static RunSummary of(const std::vector<FileSummary>& files);
+};
+
+// Read every file on up to n_workers threads and tally it (waveforms are
+// counted but not decoded), checking footer.data_checksum in the same pass
+// unless verify_checksum is false. Results are in the order of `paths`.
+std::vector<FileSummary> summarize_files(const std::vector<std::string>& paths, unsigned n_workers,
+                                         ReadMode mode = ReadMode::Mmap,
+                                         bool verify_checksum = true);
+
+// Every event of `paths`, in file and block order, in one EventColumns (the
+// Python module's delila.read()). Blocks are decoded on up to n_workers
+// threads (0: all cores), a window of blocks at a time, and appended in
+// order. With a filter only accepted events are kept, and a sidecar index
+// prunes blocks. Files that cannot be read, damaged blocks and waveforms
+// past the 2^32 samples ProbeColumn offsets can address are reported in
+// `errors` and skipped.
+EventColumns read_columns(const std::vector<std::string>& paths, unsigned n_workers = 0,
+                          const EventFilter* filter = nullptr, bool decode_waveforms = true,
+                          std::vector<std::string>* errors = nullptr, Metrics* metrics = nullptr);
+
+}  // namespace delila
@@ -0,0 +1,41 @@
+// SIMD kernels for waveform sample arrays
+//
+// rmp_serde writes a Vec<i16> as one MessagePack int per sample: a 1-byte
+// fixint for -32..127, else a 3-byte int16 / uint16 record. Waveforms are
+// long runs of one or the other, so these kernels decode a whole run per
+// call instead of branching on the type byte of every sample.
+//
+// The instruction set (AVX2, SSE4.1, NEON or plain C++) is picked once at
+// runtime from what the CPU supports.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace delila {
+
+enum class SimdLevel { Scalar, SSE41, AVX2, NEON };
+
+// Level in use, and whether this build / CPU can run a given one
+SimdLevel simd_level();
+bool simd_supported(SimdLevel level);
+const char* simd_level_name(SimdLevel level);
+
+// Force a level (benchmarks and tests). Returns false if unsupported.
+// Not meant to be called while other threads decode.
+bool set_simd_level(SimdLevel level);
+
+// Decode the leading run of fixints of `in` (at most n, n bytes readable)
+// into `out` (n slots). Returns the run length; out past it is unspecified.
+size_t decode_fixint_run(const uint8_t* in, size_t n, int16_t* out);
+
+// Same for 3-byte int16 (0xd1) / uint16 (0xcd) records; 3 * n bytes readable.
+// uint16 values above 32767 wrap, as static_cast<int16_t> does.
+size_t decode_int16_run(const uint8_t* in, size_t n, int16_t* out);
+
+// Run lengths only, for waveforms that are skipped rather than decoded
+size_t skip_fixint_run(const uint8_t* in, size_t n);
+size_t skip_int16_run(const uint8_t* in, size_t n);
+
+}  // namespace delila
@@ -0,0 +1,130 @@
+// TTree branch layout of converted .delila files (libdelila_rdf, needs ROOT)
+//
+// OutputTrees creates "events" (plus "waveforms" for the friend layout) in
+// a directory per OutputProfile (tree_profile.hpp), and its EventBranches
+// holds one set of branch buffers: one OutputTrees per filling thread.
+//
+//   delila::OutputProfile profile;
+//   profile.parse("friend,zstd");
+//   std::string err;
+//   auto file = delila::create_tree_file("out.root", profile, &err);
+//   if (!file) { ... err ... }
+//   delila::OutputTrees trees;
+//   trees.create(file.get(), profile);
+//   for (const auto& ev : events) {
+//       trees.br->set(ev);
+//       trees.br->fill();
+//   }
+//   trees.write();
+//
+// Waveform branches are variable-length arrays truncated at
+// MAX_BRANCH_SAMPLES. With waveform reduction (reduce.hpp) they hold the
+// kept samples, and wf_n_samples / trigger_sample / wf_first_sample /
+// wf_decimation (or the features) map them back to the stored waveform.
+// macros/convert_to_tree.C lists every branch.
+
+#pragma once
+
+#include <ROOT/TBufferMerger.hxx>
+#include <RtypesCore.h>
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TTree.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "delila/event.hpp"
+#include "delila/reduce.hpp"
+#include "delila/tree_profile.hpp"
+
+namespace delila {
+
+// Samples per probe in a waveform branch; longer probes are truncated
+constexpr int MAX_BRANCH_SAMPLES = 16384;
+
+// Branch buffers for the "events" tree (one set per filling thread)
+struct EventBranches {
+    UChar_t module;
+    UChar_t channel;
+    UShort_t energy;
+    UShort_t energy_short;
+    Double_t timestamp_ns;
+    ULong64_t flags;
+    Bool_t has_waveform;
+
+    Int_t n_analog1;
+    Int_t n_analog2;
+    Int_t n_digital1;
+    Int_t n_digital2;
+    Int_t n_digital3;
+    Int_t n_digital4;
+    // Sized to MAX_BRANCH_SAMPLES only when waveform branches are attached
+    std::vector<Short_t> analog1;
+    std::vector<Short_t> analog2;
+    std::vector<UChar_t> digital1;
+    std::vector<UChar_t> digital2;
+    std::vector<UChar_t> digital3;
+    std::vector<UChar_t> digital4;
+    UChar_t time_resolution;
+    UShort_t trigger_threshold;
+
+    // Waveform reduction (see delila/reduce.hpp), only with reduce.active()
+    UInt_t wf_n_samples;       // Samples before reduction
+    Int_t trigger_sample;      // Trigger marker, -1: none
+    UInt_t wf_first_sample;    // Kept sample k is sample wf_first_sample + k * wf_decimation
+    UInt_t wf_decimation;
+    UChar_t digital_levels;    // digital=drop / rle: bit k is digital(k+1)'s level
+    Int_t n_edges[4];          // digital=rle: toggles of digital(k+1) from wf_first_sample
+    std::vector<UInt_t> edges[4];
+    Float_t wf_baseline;       // features
+    Float_t wf_baseline_rms;
+    Float_t wf_peak;
+    Int_t wf_peak_sample;
+    Float_t wf_integral;
+
+    TTree* scalars_ = nullptr;
+    TTree* waveforms_ = nullptr;  // == scalars_ inline, nullptr without waveforms
+    const ReduceOptions* reduce_ = nullptr;  // nullptr: samples as stored
+    ReducedWaveform reduced_;
+
+    // Scalar branches on `scalars`, waveform branches on `waveforms` (may
+    // be the same tree; nullptr for none). `reduce` must outlive the branches.
+    void attach(TTree* scalars, TTree* waveforms, Int_t basket_size, const ReduceOptions& reduce);
+
+    // Buffers from one event (reduced first, if attached with reduction)
+    void set(const Event& ev);
+
+    void fill() {
+        scalars_->Fill();
+        if (waveforms_ != nullptr && waveforms_ != scalars_) waveforms_->Fill();
+    }
+};
+
+// Trees of one output directory: "events", plus "waveforms" for the friend layout
+struct OutputTrees {
+    TTree* events = nullptr;
+    TTree* waveforms = nullptr;  // Only for WaveformLayout::Friend
+    std::unique_ptr<EventBranches> br;
+
+    // The trees belong to `dir` (written and deleted with it); `profile`
+    // must outlive them
+    void create(TDirectory* dir, const OutputProfile& profile);
+
+    void write() {
+        events->Write();
+        if (waveforms) waveforms->Write();
+    }
+};
+
+// New file at `path` with the profile's compression; null (and `error`,
+// if given) if it cannot be created
+std::unique_ptr<TFile> create_tree_file(const std::string& path, const OutputProfile& profile,
+                                        std::string* error = nullptr);
+
+// TBufferMerger into `path` with the profile's compression
+std::unique_ptr<ROOT::TBufferMerger> create_tree_merger(const std::string& path,
+                                                        const OutputProfile& profile);
+
+}  // namespace delila
@@ -0,0 +1,54 @@
+// Output profile of a TTree conversion (macros/convert_to_tree.C)
+//
+// A comma-separated spec sets the waveform layout, ROOT compression,
+// basket / flush sizes and the waveform reduction (reduce.hpp):
+//
+//   full | scalar | friend          waveforms in "events", none, or in a
+//                                   friend tree "waveforms"
+//   lz4[:level] | zstd[:level] | zlib[:level] | lzma[:level] | none
+//   flush=N                         TTree::SetAutoFlush(N)
+//   basket=BYTES                    branch basket size
+//   crop=PRE:POST, trigger=K, decimate=N, pick, digital=drop|rle,
+//   features, baseline=N            ReduceOptions::set()
+//
+//   delila::OutputProfile profile;
+//   std::string err;
+//   if (!profile.parse("friend,zstd,crop=32:160", &err)) { ... err ... }
+//
+// Plain settings, no ROOT: the branches that use them are in
+// tree_output.hpp (libdelila_rdf).
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "delila/reduce.hpp"
+
+namespace delila {
+
+enum class WaveformLayout {
+    Inline,  // Waveform branches in "events"
+    None,    // Scalar branches only
+    Friend,  // Waveform branches in "waveforms", one entry per event
+};
+
+// "full", "scalar" or "friend", as in the spec
+const char* waveform_layout_name(WaveformLayout layout);
+
+struct OutputProfile {
+    WaveformLayout waveforms = WaveformLayout::Inline;
+    int compression = -1;        // ROOT algorithm * 100 + level, -1: ROOT default
+    int64_t auto_flush = 0;      // TTree::SetAutoFlush argument, 0: ROOT default
+    int32_t basket_size = 32000;
+    ReduceOptions reduce;        // Waveform reduction (crop, decimate, digital, features)
+
+    // Apply a spec (see above) on top of the current settings. False (and
+    // `error`, if given) for an unknown option or a bad value.
+    bool parse(const std::string& spec, std::string* error = nullptr);
+
+    // "Profile: ..." line, and a "Waveforms: ..." line when reduction applies
+    std::string describe() const;
+};
+
+}  // namespace delila
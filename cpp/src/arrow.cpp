@@ -0,0 +1,278 @@
+// Apache Arrow / Parquet export of decoded blocks
+
+#include "delila/arrow.hpp"
+
+#include <arrow/io/file.h>
+#include <arrow/io/stdio.h>
+#include <arrow/ipc/writer.h>
+#include <arrow/util/bit_util.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/properties.h>
+
+#include <limits>
+
+#include "delila/reader.hpp"
+
+namespace delila {
+
+namespace {
+
+// Scalar column over `v` (no copy)
+template <typename ArrayType, typename T>
+std::shared_ptr<arrow::Array> wrap(const std::vector<T>& v) {
+    return std::make_shared<ArrayType>(static_cast<int64_t>(v.size()), arrow::Buffer::Wrap(v));
+}
+
+// A per-waveform value for each event (0 and null without a waveform)
+template <typename ArrayType, typename T>
+arrow::Result<std::shared_ptr<arrow::Array>> per_event(const EventColumns& cols,
+                                                       const std::vector<T>& values,
+                                                       const std::shared_ptr<arrow::Buffer>& validity,
+                                                       int64_t null_count) {
+    const size_t n = cols.size();
+    ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> data,
+                          arrow::AllocateBuffer(static_cast<int64_t>(n * sizeof(T))));
+    T* out = reinterpret_cast<T*>(data->mutable_data());
+    for (size_t i = 0; i < n; i++) {
+        int32_t w = cols.waveform_index[i];
+        out[i] = w == NO_WAVEFORM ? T(0) : values[static_cast<size_t>(w)];
+    }
+    return std::make_shared<ArrayType>(static_cast<int64_t>(n), data, validity, null_count);
+}
+
+// One probe as list<T> per event. Waveforms are stored in event order, so
+// the samples are the list values as they are; only the per-event list
+// offsets are built.
+template <typename ArrayType, typename T>
+arrow::Result<std::shared_ptr<arrow::Array>> probe_list(
+    const EventColumns& cols, const ProbeColumn<T>& probe,
+    const std::shared_ptr<arrow::DataType>& type, const std::shared_ptr<arrow::Buffer>& validity,
+    int64_t null_count) {
+    const size_t n = cols.size();
+    if (probe.samples.size() > static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+        return arrow::Status::CapacityError("more than 2^31 samples in one block");
+    }
+    ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> offsets,
+                          arrow::AllocateBuffer(static_cast<int64_t>((n + 1) * sizeof(int32_t))));
+    int32_t* off = reinterpret_cast<int32_t*>(offsets->mutable_data());
+    int32_t pos = 0;
+    for (size_t i = 0; i < n; i++) {
+        off[i] = pos;
+        int32_t w = cols.waveform_index[i];
+        if (w != NO_WAVEFORM) pos += static_cast<int32_t>(probe.size(static_cast<size_t>(w)));
+    }
+    off[n] = pos;
+    return std::make_shared<arrow::ListArray>(type, static_cast<int64_t>(n), offsets,
+                                              wrap<ArrayType>(probe.samples), validity, null_count);
+}
+
+}  // namespace
+
+std::shared_ptr<arrow::Schema> arrow_schema(bool waveforms) {
+    arrow::FieldVector fields = {
+        arrow::field("module", arrow::uint8(), false),
+        arrow::field("channel", arrow::uint8(), false),
+        arrow::field("energy", arrow::uint16(), false),
+        arrow::field("energy_short", arrow::uint16(), false),
+        arrow::field("timestamp_ns", arrow::float64(), false),
+        arrow::field("flags", arrow::uint64(), false),
+    };
+    if (waveforms) {
+        fields.push_back(arrow::field("time_resolution", arrow::uint8()));
+        fields.push_back(arrow::field("trigger_threshold", arrow::uint16()));
+        fields.push_back(arrow::field("analog_probe1", arrow::list(arrow::int16())));
+        fields.push_back(arrow::field("analog_probe2", arrow::list(arrow::int16())));
+        fields.push_back(arrow::field("digital_probe1", arrow::list(arrow::uint8())));
+        fields.push_back(arrow::field("digital_probe2", arrow::list(arrow::uint8())));
+        fields.push_back(arrow::field("digital_probe3", arrow::list(arrow::uint8())));
+        fields.push_back(arrow::field("digital_probe4", arrow::list(arrow::uint8())));
+    }
+    return arrow::schema(fields);
+}
+
+arrow::Result<std::shared_ptr<arrow::RecordBatch>> to_record_batch(const EventColumns& cols,
+                                                                   bool waveforms) {
+    std::shared_ptr<arrow::Schema> schema = arrow_schema(waveforms);
+    const int64_t n = static_cast<int64_t>(cols.size());
+    if (n == 0) return arrow::RecordBatch::MakeEmpty(schema);
+
+    arrow::ArrayVector columns = {
+        wrap<arrow::UInt8Array>(cols.module),
+        wrap<arrow::UInt8Array>(cols.channel),
+        wrap<arrow::UInt16Array>(cols.energy),
+        wrap<arrow::UInt16Array>(cols.energy_short),
+        wrap<arrow::DoubleArray>(cols.timestamp_ns),
+        wrap<arrow::UInt64Array>(cols.flags),
+    };
+    if (waveforms) {
+        // One validity bitmap for every waveform column
+        ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> validity,
+                              arrow::AllocateEmptyBitmap(n));
+        int64_t nulls = 0;
+        for (int64_t i = 0; i < n; i++) {
+            if (cols.has_waveform(static_cast<size_t>(i))) {
+                arrow::bit_util::SetBit(validity->mutable_data(), i);
+            } else {
+                nulls++;
+            }
+        }
+        if (nulls == 0) validity = nullptr;
+
+        ARROW_ASSIGN_OR_RAISE(auto time_resolution,
+                              per_event<arrow::UInt8Array>(cols, cols.time_resolution, validity, nulls));
+        ARROW_ASSIGN_OR_RAISE(auto threshold, per_event<arrow::UInt16Array>(
+                                                  cols, cols.trigger_threshold, validity, nulls));
+        columns.push_back(time_resolution);
+        columns.push_back(threshold);
+
+        const int first = static_cast<int>(columns.size());
+        auto type = [&](int k) { return schema->field(first + k)->type(); };
+        ARROW_ASSIGN_OR_RAISE(auto a1, probe_list<arrow::Int16Array>(cols, cols.analog_probe1,
+                                                                     type(0), validity, nulls));
+        ARROW_ASSIGN_OR_RAISE(auto a2, probe_list<arrow::Int16Array>(cols, cols.analog_probe2,
+                                                                     type(1), validity, nulls));
+        ARROW_ASSIGN_OR_RAISE(auto d1, probe_list<arrow::UInt8Array>(cols, cols.digital_probe1,
+                                                                     type(2), validity, nulls));
+        ARROW_ASSIGN_OR_RAISE(auto d2, probe_list<arrow::UInt8Array>(cols, cols.digital_probe2,
+                                                                     type(3), validity, nulls));
+        ARROW_ASSIGN_OR_RAISE(auto d3, probe_list<arrow::UInt8Array>(cols, cols.digital_probe3,
+                                                                     type(4), validity, nulls));
+        ARROW_ASSIGN_OR_RAISE(auto d4, probe_list<arrow::UInt8Array>(cols, cols.digital_probe4,
+                                                                     type(5), validity, nulls));
+        columns.insert(columns.end(), {a1, a2, d1, d2, d3, d4});
+    }
+    return arrow::RecordBatch::Make(schema, n, std::move(columns));
+}
+
+struct ArrowWriter::Impl {
+    std::shared_ptr<arrow::Schema> schema;
+    std::shared_ptr<arrow::io::OutputStream> sink;
+    std::unique_ptr<parquet::arrow::FileWriter> parquet;      // ArrowFormat::Parquet
+    std::shared_ptr<arrow::ipc::RecordBatchWriter> ipc;       // ArrowFormat::IpcStream
+};
+
+ArrowWriter::ArrowWriter() = default;
+
+ArrowWriter::~ArrowWriter() {
+    close();
+}
+
+bool ArrowWriter::fail(const arrow::Status& status) {
+    error_ = status.ToString();
+    return false;
+}
+
+bool ArrowWriter::open(const std::string& path, const ArrowOptions& options) {
+    close();
+    error_.clear();
+    rows_ = 0;
+    batches_ = 0;
+    options_ = options;
+    auto impl = std::make_unique<Impl>();
+    impl->schema = arrow_schema(options.waveforms);
+
+    if (path == "-") {
+        if (options.format != ArrowFormat::IpcStream) {
+            return fail(arrow::Status::Invalid("stdout takes the IPC stream format only"));
+        }
+        impl->sink = std::make_shared<arrow::io::StdoutStream>();
+    } else {
+        auto file = arrow::io::FileOutputStream::Open(path);
+        if (!file.ok()) return fail(file.status());
+        impl->sink = *file;
+    }
+
+    if (options.format == ArrowFormat::Parquet) {
+        // Dictionaries only where values repeat; timestamps split by byte
+        // plane, which zstd compresses well for slowly rising doubles
+        parquet::WriterProperties::Builder builder;
+        builder.compression(arrow::Compression::ZSTD)
+            ->compression_level(options.compression_level)
+            ->disable_dictionary()
+            ->enable_dictionary("module")
+            ->enable_dictionary("channel")
+            ->encoding("timestamp_ns", parquet::Encoding::BYTE_STREAM_SPLIT);
+        auto writer = parquet::arrow::FileWriter::Open(*impl->schema, arrow::default_memory_pool(),
+                                                       impl->sink, builder.build(),
+                                                       parquet::default_arrow_writer_properties());
+        if (!writer.ok()) return fail(writer.status());
+        impl->parquet = std::move(*writer);
+    } else {
+        auto writer = arrow::ipc::MakeStreamWriter(impl->sink, impl->schema);
+        if (!writer.ok()) return fail(writer.status());
+        impl->ipc = *writer;
+    }
+    impl_ = std::move(impl);
+    return true;
+}
+
+bool ArrowWriter::write(const EventColumns& cols) {
+    if (!impl_) return fail(arrow::Status::Invalid("writer is not open"));
+    if (cols.empty()) return true;
+    auto batch = to_record_batch(cols, options_.waveforms);
+    if (!batch.ok()) return fail(batch.status());
+
+    arrow::Status status;
+    if (impl_->parquet) {
+        // Row group = block
+        auto table = arrow::Table::FromRecordBatches(impl_->schema, {*batch});
+        if (!table.ok()) return fail(table.status());
+        status = impl_->parquet->WriteTable(**table, (*batch)->num_rows());
+    } else {
+        status = impl_->ipc->WriteRecordBatch(**batch);
+    }
+    if (!status.ok()) return fail(status);
+    rows_ += cols.size();
+    batches_++;
+    return true;
+}
+
+bool ArrowWriter::close() {
+    if (!impl_) return error_.empty();
+    arrow::Status status = impl_->parquet ? impl_->parquet->Close() : impl_->ipc->Close();
+    if (status.ok()) status = impl_->sink->Close();
+    impl_.reset();
+    return status.ok() || fail(status);
+}
+
+bool export_arrow(const std::vector<std::string>& paths, const std::string& output,
+                  const ArrowOptions& options, const EventFilter* filter,
+                  std::vector<std::string>* errors, Metrics* metrics) {
+    auto report = [&](const std::string& path, const std::string& msg) {
+        if (errors) errors->push_back(path + ": " + msg);
+    };
+    ArrowWriter out;
+    if (!out.open(output, options)) {
+        report(output, out.error());
+        return false;
+    }
+
+    BatchHeader header;
+    EventColumns cols;
+    for (const std::string& path : paths) {
+        FileReader reader;
+        if (!reader.open(path)) {
+            report(path, reader.error());
+            continue;
+        }
+        reader.set_metrics(metrics);
+        if (filter) reader.load_index(false);  // Sidecar only: prunes blocks
+        while (filter ? reader.next_columns(header, cols, *filter, options.waveforms)
+                      : reader.next_columns(header, cols, options.waveforms)) {
+            StageTimer timer(metrics, Stage::Write);
+            if (!out.write(cols)) {
+                report(output, out.error());
+                return false;
+            }
+            if (metrics) metrics->add_events_processed(cols.size());
+        }
+        if (!reader.error().empty()) report(path, reader.error());
+    }
+    if (!out.close()) {
+        report(output, out.error());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace delila
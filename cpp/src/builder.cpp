@@ -0,0 +1,80 @@
+// Coincidence event building over the time-ordered stream
+
+#include "delila/builder.hpp"
+
+namespace delila {
+
+bool EventBuilder::pull() {
+    if (!source_.next(next_)) return false;
+    pending_.push_back(Hit{std::move(next_), source_.source_id()});
+    stats_.hits++;
+    return true;
+}
+
+bool EventBuilder::opens_window(const Event& ev) const {
+    if (options_.triggers.empty()) return true;
+    for (const auto& t : options_.triggers) {
+        if (t.matches(ev)) return true;
+    }
+    return false;
+}
+
+bool EventBuilder::find_opener(size_t& open) {
+    for (size_t i = 0;; i++) {
+        if (i == pending_.size() && !pull()) {
+            pending_.clear();
+            return false;
+        }
+        // A trigger at or after hit i cannot reach back past this
+        double reach = pending_[i].event.timestamp_ns - options_.pre_window_ns;
+        while (pending_.front().event.timestamp_ns < reach) {
+            pending_.pop_front();
+            i--;
+        }
+        if (opens_window(pending_[i].event)) {
+            open = i;
+            return true;
+        }
+    }
+}
+
+bool EventBuilder::next(BuiltEvent& event) {
+    for (;;) {
+        size_t open;
+        if (!find_opener(open)) return false;
+
+        // Collect up to the end of the window
+        double t0 = pending_[open].event.timestamp_ns;
+        double end = t0 + options_.window_ns;
+        size_t n = open + 1;
+        for (;; n++) {
+            if (n == pending_.size() && !pull()) break;
+            double ts = pending_[n].event.timestamp_ns;
+            if (ts > end) break;
+            if (options_.extend_window) end = ts + options_.window_ns;
+        }
+
+        bool pass = n >= options_.min_multiplicity &&
+                    (options_.max_multiplicity == 0 || n <= options_.max_multiplicity);
+        if (!pass) {
+            stats_.rejected++;
+            pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(n));
+            continue;
+        }
+
+        event.trigger_ts = t0;
+        event.trigger = open;
+        event.hits.resize(n);
+        event.source_ids.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            event.hits[i] = std::move(pending_[i].event);
+            event.source_ids[i] = pending_[i].source_id;
+        }
+        pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(n));
+        stats_.events++;
+        stats_.hits_used += n;
+        return true;
+    }
+}
+
+}  // namespace delila
@@ -0,0 +1,146 @@
+// Several .delila files read as one stream
+
+#include "delila/chain.hpp"
+
+#include <glob.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <tuple>
+
+namespace delila {
+
+namespace {
+
+bool ends_with(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// (run, sequence) from run{RUN}_{SEQ}_..., or (UINT32_MAX, UINT32_MAX) for other names
+std::pair<uint32_t, uint32_t> run_and_sequence(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    unsigned run = 0, seq = 0;
+    if (std::sscanf(name.c_str(), "run%u_%u_", &run, &seq) == 2) {
+        return {run, seq};
+    }
+    return {UINT32_MAX, UINT32_MAX};
+}
+
+}  // namespace
+
+bool FileChain::add_glob(const std::string& pattern) {
+    if (std::find(patterns_.begin(), patterns_.end(), pattern) == patterns_.end()) {
+        patterns_.push_back(pattern);
+    }
+    glob_t g;
+    size_t before = files_.size();
+    if (::glob(pattern.c_str(), 0, nullptr, &g) == 0) {
+        for (size_t i = 0; i < g.gl_pathc; i++) {
+            std::string path = g.gl_pathv[i];
+            if (ends_with(path, ".delila")) files_.push_back(path);
+        }
+    }
+    ::globfree(&g);
+    sort_files();
+    return files_.size() > before;
+}
+
+bool FileChain::add_run(const std::string& directory, uint32_t run_number) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "run%04u_*.delila", run_number);
+    std::string dir = directory.empty() ? "." : directory;
+    return add_glob(dir + "/" + name);
+}
+
+void FileChain::add_file(const std::string& path) {
+    files_.push_back(path);
+    sort_files();
+}
+
+void FileChain::sort_files() {
+    std::stable_sort(files_.begin(), files_.end(), [](const std::string& a, const std::string& b) {
+        return std::make_tuple(run_and_sequence(a), a) < std::make_tuple(run_and_sequence(b), b);
+    });
+    files_.erase(std::unique(files_.begin(), files_.end()), files_.end());
+}
+
+void FileChain::set_follow(bool on) {
+    follow_ = on;
+    reader_.set_follow(on);
+}
+
+bool FileChain::refresh() {
+    size_t before = files_.size();
+    std::string current = file_index_ < files_.size() ? files_[file_index_] : std::string();
+    for (const auto& pattern : std::vector<std::string>(patterns_)) add_glob(pattern);
+    // New names sort after the current one in a live run; keep its position regardless
+    if (!current.empty()) {
+        file_index_ = static_cast<size_t>(
+            std::find(files_.begin(), files_.end(), current) - files_.begin());
+    }
+    bool grew = opened_ ? reader_.refresh() : file_index_ < files_.size();
+    return grew || files_.size() > before;
+}
+
+void FileChain::rewind() {
+    file_index_ = 0;
+    opened_ = false;
+    reader_.close();
+    errors_.clear();
+    blocks_read_ = 0;
+    bytes_read_ = 0;
+}
+
+template <typename Read>
+bool FileChain::next(Read read) {
+    while (file_index_ < files_.size()) {
+        bool last = file_index_ + 1 == files_.size();
+        if (!opened_) {
+            if (!reader_.open(files_[file_index_])) {
+                // Just created, header not flushed yet: retry after refresh()
+                if (follow_ && last) return false;
+                errors_.push_back(files_[file_index_] + ": " + reader_.error());
+                file_index_++;
+                continue;
+            }
+            opened_ = true;
+        }
+
+        if (read(reader_)) return true;
+
+        // Still being written: wait here for refresh(). A file without
+        // footer followed by a newer one was abandoned (recorder crash).
+        if (follow_ && last && reader_.error().empty() && !reader_.has_footer()) return false;
+
+        // End of this file (cleanly or at a damaged block)
+        if (!reader_.error().empty()) {
+            errors_.push_back(files_[file_index_] + ": " + reader_.error());
+        }
+        blocks_read_ += reader_.blocks_read();
+        bytes_read_ += reader_.bytes_read();
+        opened_ = false;
+        file_index_++;
+    }
+    return false;
+}
+
+bool FileChain::next_batch(BatchHeader& header, std::vector<Event>& events) {
+    return next([&](FileReader& r) { return r.next_batch(header, events); });
+}
+
+bool FileChain::next_columns(BatchHeader& header, EventColumns& cols, bool decode_waveforms) {
+    return next([&](FileReader& r) { return r.next_columns(header, cols, decode_waveforms); });
+}
+
+bool FileChain::next_columns(BatchHeader& header, EventColumns& cols, const EventFilter& filter,
+                             bool decode_waveforms) {
+    // Sidecar zone maps let each file prune blocks; files without one are
+    // read in full rather than scanned first
+    return next([&](FileReader& r) {
+        if (!filter.accepts_all() && !r.has_index() && r.blocks_read() == 0) r.load_index(false);
+        return r.next_columns(header, cols, filter, decode_waveforms);
+    });
+}
+
+}  // namespace delila
@@ -0,0 +1,147 @@
+// Data checksum of .delila files (footer.data_checksum)
+
+#include "delila/checksum.hpp"
+
+#include <cstring>
+
+namespace delila {
+
+namespace {
+
+constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t PRIME_5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, unsigned r) {
+    r &= 63;
+    return r == 0 ? x : (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t rotr(uint64_t x, unsigned r) {
+    r &= 63;
+    return r == 0 ? x : (x >> r) | (x << (64 - r));
+}
+
+// Little-endian loads (xxHash reads its input little-endian)
+inline uint64_t load_u64_le(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+inline uint32_t load_u32_le(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME_2;
+    acc = rotl(acc, 31);
+    return acc * PRIME_1;
+}
+
+inline uint64_t merge_round(uint64_t acc, uint64_t val) {
+    acc ^= round(0, val);
+    return acc * PRIME_1 + PRIME_4;
+}
+
+inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME_2;
+    h ^= h >> 29;
+    h *= PRIME_3;
+    h ^= h >> 32;
+    return h;
+}
+
+// ChecksumCalculator fold step, rotation of the running state
+constexpr unsigned FOLD_ROTATION = 5;
+
+}  // namespace
+
+uint64_t xxh64(const void* data, size_t len, uint64_t seed) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = seed + PRIME_1 + PRIME_2;
+        uint64_t v2 = seed + PRIME_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME_1;
+        do {
+            v1 = round(v1, load_u64_le(p));
+            v2 = round(v2, load_u64_le(p + 8));
+            v3 = round(v3, load_u64_le(p + 16));
+            v4 = round(v4, load_u64_le(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge_round(h, v1);
+        h = merge_round(h, v2);
+        h = merge_round(h, v3);
+        h = merge_round(h, v4);
+    } else {
+        h = seed + PRIME_5;
+    }
+    h += static_cast<uint64_t>(len);
+
+    while (end - p >= 8) {
+        h ^= round(0, load_u64_le(p));
+        h = rotl(h, 27) * PRIME_1 + PRIME_4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        h ^= static_cast<uint64_t>(load_u32_le(p)) * PRIME_1;
+        h = rotl(h, 23) * PRIME_2 + PRIME_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= static_cast<uint64_t>(*p) * PRIME_5;
+        h = rotl(h, 11) * PRIME_1;
+        p++;
+    }
+    return avalanche(h);
+}
+
+void ChecksumCalculator::update(const void* data, size_t len) {
+    if (len == 0) return;
+    state_ = rotl(state_, FOLD_ROTATION) ^ xxh64(data, len, 0);
+    bytes_processed_ += len;
+}
+
+void BlockChecksum::add(uint64_t index, const uint8_t* payload, uint32_t size) {
+    uint8_t prefix[4];
+    for (int i = 0; i < 4; i++) prefix[i] = static_cast<uint8_t>(size >> (8 * i));
+
+    // Pieces 2 * index (length prefix) and 2 * index + 1 (payload)
+    uint64_t piece = 2 * index;
+    acc_ ^= rotr(xxh64(prefix, 4, 0), static_cast<unsigned>(FOLD_ROTATION * piece % 64));
+    acc_ ^= rotr(xxh64(payload, size, 0), static_cast<unsigned>(FOLD_ROTATION * (piece + 1) % 64));
+    blocks_++;
+    bytes_ += 4 + static_cast<uint64_t>(size);
+}
+
+void BlockChecksum::merge(const BlockChecksum& other) {
+    acc_ ^= other.acc_;
+    blocks_ += other.blocks_;
+    bytes_ += other.bytes_;
+}
+
+uint64_t BlockChecksum::finalize() const {
+    if (blocks_ == 0) return 0;
+    uint64_t pieces = 2 * blocks_;
+    return rotl(acc_, static_cast<unsigned>(FOLD_ROTATION * (pieces - 1) % 64)) ^ bytes_;
+}
+
+}  // namespace delila
@@ -0,0 +1,79 @@
+// Columnar (struct-of-arrays) event layout
+
+#include "delila/columns.hpp"
+
+namespace delila {
+
+namespace {
+
+template <typename T>
+void append_waveform(ProbeColumn<T>& dst, const ProbeColumn<T>& src, size_t w) {
+    const T* begin = src.data(w);
+    dst.samples.insert(dst.samples.end(), begin, begin + src.size(w));
+    dst.end_waveform();
+}
+
+template <typename T>
+void append_range(std::vector<T>& dst, const std::vector<T>& src, size_t first, size_t count) {
+    if (src.empty()) return;  // A column left out of the decode
+    dst.insert(dst.end(), src.begin() + first, src.begin() + first + count);
+}
+
+}  // namespace
+
+void EventColumns::clear() {
+    module.clear();
+    channel.clear();
+    energy.clear();
+    energy_short.clear();
+    timestamp_ns.clear();
+    flags.clear();
+    waveform_index.clear();
+    time_resolution.clear();
+    trigger_threshold.clear();
+    analog_probe1.clear();
+    analog_probe2.clear();
+    digital_probe1.clear();
+    digital_probe2.clear();
+    digital_probe3.clear();
+    digital_probe4.clear();
+}
+
+void EventColumns::resize_events(size_t n, uint32_t fields) {
+    if (fields & FIELD_MODULE) module.resize(n);
+    if (fields & FIELD_CHANNEL) channel.resize(n);
+    if (fields & FIELD_ENERGY) energy.resize(n);
+    if (fields & FIELD_ENERGY_SHORT) energy_short.resize(n);
+    if (fields & FIELD_TIMESTAMP_NS) timestamp_ns.resize(n);
+    if (fields & FIELD_FLAGS) flags.resize(n);
+    waveform_index.resize(n, NO_WAVEFORM);
+}
+
+void EventColumns::append(const EventColumns& src, size_t first, size_t count) {
+    append_range(module, src.module, first, count);
+    append_range(channel, src.channel, first, count);
+    append_range(energy, src.energy, first, count);
+    append_range(energy_short, src.energy_short, first, count);
+    append_range(timestamp_ns, src.timestamp_ns, first, count);
+    append_range(flags, src.flags, first, count);
+
+    // Waveform numbers are per batch: renumber into this one
+    for (size_t i = first; i < first + count; i++) {
+        int32_t w = src.waveform_index[i];
+        if (w == NO_WAVEFORM) {
+            waveform_index.push_back(NO_WAVEFORM);
+            continue;
+        }
+        waveform_index.push_back(static_cast<int32_t>(num_waveforms()));
+        time_resolution.push_back(src.time_resolution[w]);
+        trigger_threshold.push_back(src.trigger_threshold[w]);
+        append_waveform(analog_probe1, src.analog_probe1, w);
+        append_waveform(analog_probe2, src.analog_probe2, w);
+        append_waveform(digital_probe1, src.digital_probe1, w);
+        append_waveform(digital_probe2, src.digital_probe2, w);
+        append_waveform(digital_probe3, src.digital_probe3, w);
+        append_waveform(digital_probe4, src.digital_probe4, w);
+    }
+}
+
+}  // namespace delila
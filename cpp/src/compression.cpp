@@ -0,0 +1,176 @@
+// Per-block compression of v3 files
+
+#include "delila/compression.hpp"
+
+#include <cstring>
+
+#include "delila/format.hpp"
+
+#ifdef DELILA_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef DELILA_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace delila {
+
+namespace {
+
+bool set_error(std::string* error, const std::string& msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+bool decompress(Compression compression, const uint8_t* in, size_t in_size, uint8_t* out,
+                size_t out_size, std::string* error) {
+    (void)in, (void)in_size, (void)out, (void)out_size;  // Unused without codecs
+    switch (compression) {
+        case Compression::None:
+            break;
+        case Compression::Lz4:
+#ifdef DELILA_HAVE_LZ4
+        {
+            int n = LZ4_decompress_safe(reinterpret_cast<const char*>(in),
+                                        reinterpret_cast<char*>(out), static_cast<int>(in_size),
+                                        static_cast<int>(out_size));
+            if (n < 0) return set_error(error, "LZ4 block is corrupt");
+            if (static_cast<size_t>(n) != out_size) {
+                return set_error(error, "LZ4 block decompressed to " + std::to_string(n) +
+                                            " bytes, header says " + std::to_string(out_size));
+            }
+            return true;
+        }
+#else
+            break;
+#endif
+        case Compression::Zstd:
+#ifdef DELILA_HAVE_ZSTD
+        {
+            size_t n = ZSTD_decompress(out, out_size, in, in_size);
+            if (ZSTD_isError(n)) return set_error(error, std::string("zstd: ") + ZSTD_getErrorName(n));
+            if (n != out_size) {
+                return set_error(error, "zstd frame decompressed to " + std::to_string(n) +
+                                            " bytes, header says " + std::to_string(out_size));
+            }
+            return true;
+        }
+#else
+            break;
+#endif
+    }
+    return set_error(error, std::string(compression_name(compression)) +
+                                " compression not supported by this build of libdelila");
+}
+
+}  // namespace
+
+const char* compression_name(Compression compression) {
+    switch (compression) {
+        case Compression::None: return "none";
+        case Compression::Lz4: return "lz4";
+        case Compression::Zstd: return "zstd";
+    }
+    return "unknown";
+}
+
+bool compression_available(Compression compression) {
+    switch (compression) {
+        case Compression::None: return true;
+#ifdef DELILA_HAVE_LZ4
+        case Compression::Lz4: return true;
+#endif
+#ifdef DELILA_HAVE_ZSTD
+        case Compression::Zstd: return true;
+#endif
+        default: return false;
+    }
+}
+
+bool parse_block_header(const uint8_t* data, size_t size, BlockHeader& header) {
+    if (size < BLOCK_HEADER_SIZE || data[0] > static_cast<uint8_t>(Compression::Zstd)) {
+        return false;
+    }
+    header.compression = static_cast<Compression>(data[0]);
+    header.raw_size = load_u32_le(data + 4);
+    return true;
+}
+
+const uint8_t* block_payload(const uint8_t* data, size_t size, std::vector<uint8_t>& scratch,
+                             size_t& payload_size, std::string* error) {
+    BlockHeader header;
+    if (!parse_block_header(data, size, header)) {
+        set_error(error, size < BLOCK_HEADER_SIZE ? "Block shorter than its block header"
+                                                  : "Unknown block compression " +
+                                                        std::to_string(data[0]));
+        return nullptr;
+    }
+    const uint8_t* stored = data + BLOCK_HEADER_SIZE;
+    size_t stored_size = size - BLOCK_HEADER_SIZE;
+    if (header.compression == Compression::None) {
+        payload_size = stored_size;
+        return stored;
+    }
+    if (header.raw_size > MAX_BLOCK_SIZE) {
+        set_error(error, "Uncompressed block size " + std::to_string(header.raw_size));
+        return nullptr;
+    }
+
+    scratch.resize(header.raw_size);
+    if (!decompress(header.compression, stored, stored_size, scratch.data(), scratch.size(),
+                    error)) {
+        return nullptr;
+    }
+    payload_size = scratch.size();
+    return scratch.data();
+}
+
+bool encode_block(const uint8_t* data, size_t size, Compression compression, int level,
+                  std::vector<uint8_t>& out, std::string* error) {
+    if (size > MAX_BLOCK_SIZE) return set_error(error, "Block too large");
+    if (!compression_available(compression)) {
+        return set_error(error, std::string(compression_name(compression)) +
+                                    " compression not supported by this build of libdelila");
+    }
+
+    size_t bound = size;
+#ifdef DELILA_HAVE_LZ4
+    if (compression == Compression::Lz4) bound = LZ4_compressBound(static_cast<int>(size));
+#endif
+#ifdef DELILA_HAVE_ZSTD
+    if (compression == Compression::Zstd) bound = ZSTD_compressBound(size);
+#endif
+    out.resize(BLOCK_HEADER_SIZE + bound);
+    [[maybe_unused]] uint8_t* payload = out.data() + BLOCK_HEADER_SIZE;
+
+    size_t n = 0;  // Compressed size; 0: store
+#ifdef DELILA_HAVE_LZ4
+    if (compression == Compression::Lz4) {
+        int r = LZ4_compress_default(reinterpret_cast<const char*>(data),
+                                     reinterpret_cast<char*>(payload), static_cast<int>(size),
+                                     static_cast<int>(bound));
+        n = r > 0 ? static_cast<size_t>(r) : 0;
+    }
+#endif
+#ifdef DELILA_HAVE_ZSTD
+    if (compression == Compression::Zstd) {
+        size_t r = ZSTD_compress(payload, bound, data, size, level);
+        n = ZSTD_isError(r) ? 0 : r;
+    }
+#endif
+    (void)level;
+    if (n == 0 || n >= size) {
+        compression = Compression::None;
+        n = size;
+        out.resize(BLOCK_HEADER_SIZE + size);
+        if (size > 0) std::memcpy(out.data() + BLOCK_HEADER_SIZE, data, size);
+    }
+    out.resize(BLOCK_HEADER_SIZE + n);
+
+    out[0] = static_cast<uint8_t>(compression);
+    out[1] = out[2] = out[3] = 0;
+    for (int i = 0; i < 4; i++) out[4 + i] = static_cast<uint8_t>(size >> (8 * i));
+    return true;
+}
+
+}  // namespace delila
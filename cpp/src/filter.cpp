@@ -0,0 +1,53 @@
+// Event selection applied while decoding
+
+#include "delila/filter.hpp"
+
+namespace delila {
+
+namespace {
+
+constexpr size_t CHANNEL_WORDS = 256 * 256 / 64;
+
+}  // namespace
+
+EventFilter& EventFilter::select(int module, int channel) {
+    channels_.resize(CHANNEL_WORDS, 0);
+    int m0 = module < 0 ? 0 : module;
+    int m1 = module < 0 ? 255 : module;
+    int c0 = channel < 0 ? 0 : channel;
+    int c1 = channel < 0 ? 255 : channel;
+    for (int m = m0; m <= m1 && m < 256; m++) {
+        for (int c = c0; c <= c1 && c < 256; c++) {
+            size_t bit = (static_cast<size_t>(m) << 8) | static_cast<size_t>(c);
+            channels_[bit >> 6] |= uint64_t{1} << (bit & 63);
+            size_t zone_bit = BlockIndexEntry::channel_bit(static_cast<uint8_t>(m),
+                                                           static_cast<uint8_t>(c));
+            zone_channels_[zone_bit / 64] |= uint64_t{1} << (zone_bit % 64);
+        }
+    }
+    return *this;
+}
+
+void EventFilter::clear() {
+    *this = EventFilter();
+}
+
+bool EventFilter::may_match(const BlockIndexEntry& block) const {
+    if (!overlaps(block.first_timestamp_ns, block.last_timestamp_ns)) return false;
+    if (!block.has_zone_map) return true;
+    if (block.num_events == 0) return false;
+    if (block.max_energy < energy_min_ || block.min_energy > energy_max_) return false;
+    if (channels_.empty()) return true;
+    for (size_t w = 0; w < zone_channels_.size(); w++) {
+        if (block.channels[w] & zone_channels_[w]) return true;
+    }
+    return false;
+}
+
+bool EventFilter::accepts_all() const {
+    return channels_.empty() && energy_min_ == 0 && energy_max_ == 0xffff &&
+           energy_short_min_ == 0 && energy_short_max_ == 0xffff && flags_set_ == 0 &&
+           flags_clear_ == 0 && !has_time_window();
+}
+
+}  // namespace delila
@@ -0,0 +1,61 @@
+// DELILA file format helpers
+
+#include "delila/format.hpp"
+
+#include "delila/msgpack.hpp"
+
+namespace delila {
+
+bool parse_footer(const uint8_t* buf, Footer& footer) {
+    if (std::memcmp(buf, FOOTER_MAGIC, MAGIC_SIZE) != 0) {
+        return false;
+    }
+
+    std::memcpy(footer.magic, buf, MAGIC_SIZE);
+    footer.data_checksum = load_u64_le(buf + 8);
+    footer.total_events = load_u64_le(buf + 16);
+    footer.data_bytes = load_u64_le(buf + 24);
+    footer.first_event_time_ns = load_f64_le(buf + 32);
+    footer.last_event_time_ns = load_f64_le(buf + 40);
+    footer.file_end_time_ns = load_u64_le(buf + 48);
+    footer.write_complete = buf[56];
+    return true;
+}
+
+bool parse_file_header(const uint8_t* data, size_t size, FileHeader& header) {
+    // FileHeader is serialized as an array (rmp_serde compact form):
+    //   [version, run_number, exp_name, file_sequence, file_start_time_ns,
+    //    comment, sort_margin_ratio, is_sorted, source_ids, metadata]
+    MsgPackParser p(data, size);
+    size_t n_fields;
+    if (!p.read_array_header(n_fields) || n_fields < 9) return false;
+
+    uint64_t tmp;
+    if (!p.read_uint(tmp)) return false;
+    header.version = static_cast<uint32_t>(tmp);
+    if (!p.read_uint(tmp)) return false;
+    header.run_number = static_cast<uint32_t>(tmp);
+    if (!p.read_str(header.exp_name)) return false;
+    if (!p.read_uint(tmp)) return false;
+    header.file_sequence = static_cast<uint32_t>(tmp);
+    if (!p.read_uint(header.file_start_time_ns)) return false;
+    if (!p.read_str(header.comment)) return false;
+    if (!p.read_float64(header.sort_margin_ratio)) return false;
+    if (!p.read_bool(header.is_sorted)) return false;
+
+    size_t n_sources;
+    if (!p.read_array_header(n_sources)) return false;
+    header.source_ids.resize(n_sources);
+    for (size_t i = 0; i < n_sources; i++) {
+        if (!p.read_uint(tmp)) return false;
+        header.source_ids[i] = static_cast<uint32_t>(tmp);
+    }
+
+    // metadata map and any fields added by later format versions are skipped
+    for (size_t i = 9; i < n_fields; i++) {
+        if (!p.skip()) return false;
+    }
+    return true;
+}
+
+}  // namespace delila
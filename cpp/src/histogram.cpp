@@ -0,0 +1,240 @@
+// Histogramming on the decoder
+
+#include "delila/histogram.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "delila/reader.hpp"
+
+namespace delila {
+
+namespace {
+
+void add_bins(std::vector<uint64_t>& to, const std::vector<uint64_t>& from) {
+    size_t n = std::min(to.size(), from.size());
+    for (size_t i = 0; i < n; i++) to[i] += from[i];
+}
+
+// bin_of() of every value in [0, n_values), UINT32_MAX for underflow
+std::shared_ptr<const std::vector<uint32_t>> bin_table(const HistogramConfig& config,
+                                                       size_t n_values) {
+    HistogramAxis axis(config);
+    auto table = std::make_shared<std::vector<uint32_t>>(n_values);
+    for (size_t v = 0; v < n_values; v++) {
+        int64_t bin = axis.bin_of(static_cast<float>(v));
+        (*table)[v] = bin < 0 ? UINT32_MAX : static_cast<uint32_t>(bin);
+    }
+    return table;
+}
+
+}  // namespace
+
+void Histogram1D::add(const Histogram1D& other) {
+    add_bins(bins_, other.bins_);
+    total_counts_ += other.total_counts_;
+    overflow_ += other.overflow_;
+    underflow_ += other.underflow_;
+}
+
+void Histogram1D::clear() {
+    std::fill(bins_.begin(), bins_.end(), 0);
+    total_counts_ = 0;
+    overflow_ = 0;
+    underflow_ = 0;
+}
+
+void Histogram2D::add(const Histogram2D& other) {
+    add_bins(bins_, other.bins_);
+    total_counts_ += other.total_counts_;
+    outside_ += other.outside_;
+}
+
+void Histogram2D::clear() {
+    std::fill(bins_.begin(), bins_.end(), 0);
+    total_counts_ = 0;
+    outside_ = 0;
+}
+
+HistogramSet::HistogramSet(const HistogramOptions& options)
+    : options_(options),
+      energy_bins_(bin_table(options.energy, 65536)),
+      channel_bins_(bin_table(options.channel, 256)),
+      module_bins_(bin_table(options.module, 256)),
+      energy_(options.energy),
+      energy_short_(options.energy),
+      channel_(options.channel),
+      module_(options.module),
+      psd_(options.psd ? Histogram2D(options.psd_energy, options.psd_short) : Histogram2D()) {
+    if (options.psd || options.psd_per_channel) {
+        psd_x_bins_ = bin_table(options.psd_energy, 65536);
+        psd_y_bins_ = bin_table(options.psd_short, 65536);
+    }
+}
+
+ChannelHistograms& HistogramSet::channel_slot(uint8_t module, uint8_t channel) {
+    if (slot_.empty()) slot_.assign(256 * 256, 0);
+    uint32_t& slot = slot_[(static_cast<size_t>(module) << 8) | channel];
+    if (slot == 0) {
+        ChannelHistograms ch;
+        ch.module = module;
+        ch.channel = channel;
+        if (options_.per_channel) ch.energy = Histogram1D(options_.energy);
+        if (options_.psd_per_channel) ch.psd = Histogram2D(options_.psd_energy, options_.psd_short);
+        channels_.push_back(std::move(ch));
+        slot = static_cast<uint32_t>(channels_.size());
+    }
+    return channels_[slot - 1];
+}
+
+void HistogramSet::fill(const EventColumns& cols, size_t n) {
+    n = std::min(n, cols.size());
+    const bool psd = options_.psd;
+    const bool channel_energy = options_.per_channel;
+    const bool channel_psd = options_.psd_per_channel;
+    const uint32_t* energy_bin = energy_bins_->data();
+    const uint32_t* channel_bin = channel_bins_->data();
+    const uint32_t* module_bin = module_bins_->data();
+    const uint32_t* psd_x = psd_x_bins_ ? psd_x_bins_->data() : nullptr;
+    const uint32_t* psd_y = psd_y_bins_ ? psd_y_bins_->data() : nullptr;
+    for (size_t i = 0; i < n; i++) {
+        uint16_t e = cols.energy[i];
+        uint16_t es = cols.energy_short[i];
+        energy_.count_bin(energy_bin[e]);
+        energy_short_.count_bin(energy_bin[es]);
+        channel_.count_bin(channel_bin[cols.channel[i]]);
+        module_.count_bin(module_bin[cols.module[i]]);
+        if (psd) psd_.count_bins(psd_x[e], psd_y[es]);
+        if (channel_energy | channel_psd) {
+            ChannelHistograms& ch = channel_slot(cols.module[i], cols.channel[i]);
+            if (channel_energy) {
+                ch.energy.count_bin(energy_bin[e]);
+                ch.energy.total_counts_++;
+            }
+            if (channel_psd) {
+                ch.psd.count_bins(psd_x[e], psd_y[es]);
+                ch.psd.total_counts_++;
+            }
+        }
+    }
+    events_ += n;
+    energy_.total_counts_ += n;
+    energy_short_.total_counts_ += n;
+    channel_.total_counts_ += n;
+    module_.total_counts_ += n;
+    if (psd) psd_.total_counts_ += n;
+}
+
+void HistogramSet::add(const HistogramSet& other) {
+    events_ += other.events_;
+    energy_.add(other.energy_);
+    energy_short_.add(other.energy_short_);
+    channel_.add(other.channel_);
+    module_.add(other.module_);
+    psd_.add(other.psd_);
+    for (const ChannelHistograms& theirs : other.channels_) {
+        ChannelHistograms& mine = channel_slot(theirs.module, theirs.channel);
+        mine.energy.add(theirs.energy);
+        mine.psd.add(theirs.psd);
+    }
+}
+
+void HistogramSet::clear() {
+    events_ = 0;
+    energy_.clear();
+    energy_short_.clear();
+    channel_.clear();
+    module_.clear();
+    psd_.clear();
+    channels_.clear();
+    slot_.clear();
+}
+
+const Histogram1D* HistogramSet::channel_energy(uint8_t module, uint8_t channel) const {
+    if (!options_.per_channel || slot_.empty()) return nullptr;
+    uint32_t slot = slot_[(static_cast<size_t>(module) << 8) | channel];
+    return slot ? &channels_[slot - 1].energy : nullptr;
+}
+
+const Histogram2D* HistogramSet::channel_psd(uint8_t module, uint8_t channel) const {
+    if (!options_.psd_per_channel || slot_.empty()) return nullptr;
+    uint32_t slot = slot_[(static_cast<size_t>(module) << 8) | channel];
+    return slot ? &channels_[slot - 1].psd : nullptr;
+}
+
+HistogramSet fill_histograms(const std::vector<std::string>& paths,
+                             const HistogramOptions& options, unsigned n_workers,
+                             std::vector<std::string>* errors, const EventFilter* filter,
+                             Metrics* metrics) {
+    if (n_workers == 0) n_workers = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<HistogramSet> sets(n_workers, HistogramSet(options));  // One per worker
+    std::mutex error_mutex;
+    auto report = [&](const std::string& path, const std::string& msg) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (errors) errors->push_back(path + ": " + msg);
+    };
+
+    for (const std::string& path : paths) {
+        FileReader reader;
+        if (!reader.open(path, ReadMode::Mmap)) {
+            report(path, reader.error());
+            continue;
+        }
+        reader.set_metrics(metrics);
+        // Views into the mapping, decoded on the workers. The index (sidecar
+        // only: a scan would decode everything twice) just prunes for a filter.
+        std::vector<BlockView> blocks;
+        BlockView block;
+        if (filter && reader.load_index(false)) {
+            const BlockIndex& index = reader.index();
+            for (size_t i = 0; i < index.size(); i++) {
+                if (filter->may_match(index[i]) && reader.view_block(i, block)) {
+                    blocks.push_back(block);
+                    if (metrics) {
+                        metrics->add_received();
+                        metrics->add_bytes(4 + static_cast<uint64_t>(block.size));
+                    }
+                }
+            }
+        } else {
+            while (reader.next_block(block)) blocks.push_back(block);
+            if (!reader.error().empty()) report(path, reader.error());  // Blocks before the damage
+        }
+
+        std::atomic<size_t> next{0};
+        auto work = [&](unsigned w) {
+            BatchHeader header;
+            EventColumns cols;
+            std::string err;
+            for (size_t i = next++; i < blocks.size(); i = next++) {
+                err.clear();
+                bool ok = filter ? FileReader::decode_block(blocks[i], header, cols, *filter, &err,
+                                                            false, metrics)
+                                 : FileReader::decode_block(blocks[i], header, cols, &err, false,
+                                                            metrics);
+                if (!ok) {
+                    report(path, err);
+                    continue;
+                }
+                StageTimer timer(metrics, Stage::Fill);
+                sets[w].fill(cols);
+                if (metrics) metrics->add_events_processed(cols.size());
+            }
+        };
+        unsigned n_threads = static_cast<unsigned>(std::min<size_t>(n_workers, blocks.size()));
+        if (n_threads <= 1) {
+            work(0);
+            continue;
+        }
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < n_threads; t++) threads.emplace_back(work, t);
+        for (auto& t : threads) t.join();
+    }
+
+    for (size_t w = 1; w < sets.size(); w++) sets[0].add(sets[w]);
+    return std::move(sets[0]);
+}
+
+}  // namespace delila
@@ -0,0 +1,145 @@
+// Block index sidecar
+
+#include "delila/index.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "delila/format.hpp"
+
+namespace delila {
+
+namespace {
+
+void store_le(std::vector<uint8_t>& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+}  // namespace
+
+bool BlockIndex::parse(const uint8_t* data, size_t size) {
+    clear();
+    if (size < INDEX_HEADER_SIZE || std::memcmp(data, INDEX_MAGIC, MAGIC_SIZE) != 0) {
+        return false;
+    }
+
+    // Larger entries are accepted so fields can be appended later
+    const size_t entry_size = load_u32_le(data + 8);
+    const uint64_t num_entries = load_u64_le(data + 16);
+    if (entry_size < INDEX_ENTRY_MIN_SIZE ||
+        num_entries > (size - INDEX_HEADER_SIZE) / entry_size) {
+        return false;
+    }
+    data_file_size_ = load_u64_le(data + 24);
+
+    entries_.reserve(num_entries);
+    const uint8_t* p = data + INDEX_HEADER_SIZE;
+    for (uint64_t i = 0; i < num_entries; i++, p += entry_size) {
+        BlockIndexEntry e;
+        e.offset = load_u64_le(p);
+        e.length = load_u32_le(p + 8);
+        e.source_id = load_u32_le(p + 12);
+        e.num_events = load_u32_le(p + 16);
+        e.first_timestamp_ns = load_f64_le(p + 24);
+        e.last_timestamp_ns = load_f64_le(p + 32);
+        if ((load_u32_le(p + 20) & INDEX_FLAG_ZONE_MAP) && entry_size >= INDEX_ENTRY_SIZE) {
+            e.has_zone_map = true;
+            e.min_energy = static_cast<uint16_t>(p[40] | (p[41] << 8));
+            e.max_energy = static_cast<uint16_t>(p[42] | (p[43] << 8));
+            e.waveform_events = load_u32_le(p + 44);
+            for (size_t w = 0; w < e.channels.size(); w++) e.channels[w] = load_u64_le(p + 48 + 8 * w);
+        }
+        push(e);
+    }
+    return true;
+}
+
+bool BlockIndex::load(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) return false;
+
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    return parse(bytes.data(), bytes.size());
+}
+
+std::vector<uint8_t> BlockIndex::to_bytes() const {
+    std::vector<uint8_t> out(INDEX_MAGIC, INDEX_MAGIC + MAGIC_SIZE);
+    out.reserve(INDEX_HEADER_SIZE + entries_.size() * INDEX_ENTRY_SIZE);
+    store_le(out, INDEX_ENTRY_SIZE, 4);
+    store_le(out, 0, 4);
+    store_le(out, entries_.size(), 8);
+    store_le(out, data_file_size_, 8);
+
+    for (const auto& e : entries_) {
+        uint64_t first, last;
+        std::memcpy(&first, &e.first_timestamp_ns, 8);
+        std::memcpy(&last, &e.last_timestamp_ns, 8);
+        store_le(out, e.offset, 8);
+        store_le(out, e.length, 4);
+        store_le(out, e.source_id, 4);
+        store_le(out, e.num_events, 4);
+        store_le(out, e.has_zone_map ? INDEX_FLAG_ZONE_MAP : 0, 4);
+        store_le(out, first, 8);
+        store_le(out, last, 8);
+        store_le(out, e.has_zone_map ? e.min_energy : 0, 2);
+        store_le(out, e.has_zone_map ? e.max_energy : 0, 2);
+        store_le(out, e.has_zone_map ? e.waveform_events : 0, 4);
+        for (uint64_t w : e.channels) store_le(out, e.has_zone_map ? w : 0, 8);
+    }
+    return out;
+}
+
+bool BlockIndex::save(const std::string& path) const {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f.is_open()) return false;
+    auto bytes = to_bytes();
+    f.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(f);
+}
+
+void BlockIndex::clear() {
+    data_file_size_ = 0;
+    entries_.clear();
+    max_last_.clear();
+    min_first_.clear();
+}
+
+void BlockIndex::push(const BlockIndexEntry& entry) {
+    entries_.push_back(entry);
+    max_last_.push_back(max_last_.empty() ? entry.last_timestamp_ns
+                                          : std::max(max_last_.back(), entry.last_timestamp_ns));
+
+    // Suffix min: only the tail that is larger than the new block changes.
+    // With (mostly) increasing timestamps this stops immediately.
+    min_first_.push_back(entry.first_timestamp_ns);
+    for (size_t j = min_first_.size() - 1; j-- > 0 && min_first_[j] > entry.first_timestamp_ns;) {
+        min_first_[j] = entry.first_timestamp_ns;
+    }
+}
+
+uint64_t BlockIndex::total_events() const {
+    uint64_t total = 0;
+    for (const auto& e : entries_) total += e.num_events;
+    return total;
+}
+
+size_t BlockIndex::lower_bound(double t_ns) const {
+    return static_cast<size_t>(std::lower_bound(max_last_.begin(), max_last_.end(), t_ns) -
+                               max_last_.begin());
+}
+
+std::vector<size_t> BlockIndex::blocks_overlapping(double t0_ns, double t1_ns) const {
+    std::vector<size_t> result;
+    // No block at or after `end` starts before t1
+    const size_t end = static_cast<size_t>(
+        std::lower_bound(min_first_.begin(), min_first_.end(), t1_ns) - min_first_.begin());
+    for (size_t i = lower_bound(t0_ns); i < end; i++) {
+        if (entries_[i].last_timestamp_ns >= t0_ns && entries_[i].first_timestamp_ns < t1_ns) {
+            result.push_back(i);
+        }
+    }
+    return result;
+}
+
+}  // namespace delila
@@ -0,0 +1,165 @@
+// Time-ordered merge of .delila event streams
+
+#include "delila/merge.hpp"
+
+#include <algorithm>
+
+namespace delila {
+
+namespace {
+
+bool earlier(const Event& a, const Event& b) { return a.timestamp_ns < b.timestamp_ns; }
+
+}  // namespace
+
+FileChain& TimeMerger::add_input() {
+    inputs_.emplace_back();
+    inputs_.back().chain = std::make_unique<FileChain>();
+    return *inputs_.back().chain;
+}
+
+std::vector<std::string> TimeMerger::errors() const {
+    std::vector<std::string> out;
+    for (const auto& in : inputs_) {
+        out.insert(out.end(), in.chain->errors().begin(), in.chain->errors().end());
+    }
+    return out;
+}
+
+double TimeMerger::watermark() const {
+    double w = DBL_MAX;
+    for (const auto& in : inputs_) {
+        if (!in.done) w = std::min(w, in.frontier - options_.max_disorder_ns);
+    }
+    return w;
+}
+
+bool TimeMerger::heap_less(size_t a, size_t b) const {
+    // std heaps keep the largest on top; invert for the earliest lane head
+    double ta = lanes_[a].events.front().timestamp_ns;
+    double tb = lanes_[b].events.front().timestamp_ns;
+    if (ta != tb) return ta > tb;
+    return a > b;
+}
+
+bool TimeMerger::read_more() {
+    // The input furthest behind holds the watermark down
+    Input* lagging = nullptr;
+    size_t index = 0;
+    for (size_t i = 0; i < inputs_.size(); i++) {
+        Input& in = inputs_[i];
+        if (!in.done && (lagging == nullptr || in.frontier < lagging->frontier)) {
+            lagging = &in;
+            index = i;
+        }
+    }
+    if (lagging == nullptr) return false;
+
+    BatchHeader header;
+    if (!lagging->chain->next_batch(header, batch_)) {
+        lagging->done = true;
+        return true;
+    }
+    stats_.blocks++;
+    add_batch(index, header.source_id);
+    return true;
+}
+
+void TimeMerger::add_batch(size_t input, uint32_t source_id) {
+    if (batch_.empty()) return;
+
+    auto key = std::make_pair(input, source_id);
+    auto it = lane_of_.find(key);
+    if (it == lane_of_.end()) {
+        it = lane_of_.emplace(key, lanes_.size()).first;
+        lanes_.emplace_back();
+        lanes_.back().source_id = source_id;
+        stats_.lanes = lanes_.size();
+    }
+    size_t lane_id = it->second;
+    Lane& lane = lanes_[lane_id];
+
+    if (!std::is_sorted(batch_.begin(), batch_.end(), earlier)) {
+        std::stable_sort(batch_.begin(), batch_.end(), earlier);
+    }
+    Input& in = inputs_[input];
+    in.frontier = std::max(in.frontier, batch_.back().timestamp_ns);
+
+    bool was_empty = lane.events.empty();
+    bool new_head = false;
+    for (auto& ev : batch_) {
+        if (lane.events.empty() || !earlier(ev, lane.events.back())) {
+            lane.events.push_back(std::move(ev));
+            continue;
+        }
+        // Older than the lane tail: disorder within the source
+        auto pos = std::upper_bound(lane.events.begin(), lane.events.end(), ev, earlier);
+        new_head |= pos == lane.events.begin();
+        lane.events.insert(pos, std::move(ev));
+    }
+    buffered_ += batch_.size();
+    stats_.peak_buffered = std::max(stats_.peak_buffered, buffered_);
+
+    auto less = [this](size_t a, size_t b) { return heap_less(a, b); };
+    if (was_empty) {
+        heap_.push_back(lane_id);
+        std::push_heap(heap_.begin(), heap_.end(), less);
+    } else if (new_head) {
+        std::make_heap(heap_.begin(), heap_.end(), less);
+    }
+}
+
+void TimeMerger::emit(Event& event) {
+    auto less = [this](size_t a, size_t b) { return heap_less(a, b); };
+    std::pop_heap(heap_.begin(), heap_.end(), less);
+    size_t lane_id = heap_.back();
+    Lane& lane = lanes_[lane_id];
+
+    event = std::move(lane.events.front());
+    lane.events.pop_front();
+    buffered_--;
+    if (lane.events.empty()) {
+        heap_.pop_back();
+    } else {
+        std::push_heap(heap_.begin(), heap_.end(), less);
+    }
+
+    source_id_ = lane.source_id;
+    stats_.events++;
+    if (event.timestamp_ns < last_ts_) stats_.late_events++;
+    last_ts_ = std::max(last_ts_, event.timestamp_ns);
+}
+
+bool TimeMerger::next(Event& event) {
+    for (;;) {
+        if (!heap_.empty()) {
+            double head = lanes_[heap_.front()].events.front().timestamp_ns;
+            if (head <= watermark()) {
+                emit(event);
+                return true;
+            }
+            if (buffered_ >= options_.max_buffered_events) {
+                stats_.forced++;
+                emit(event);
+                return true;
+            }
+        }
+        if (!read_more()) {
+            if (heap_.empty()) return false;
+            emit(event);
+            return true;
+        }
+    }
+}
+
+size_t TimeMerger::next_events(std::vector<Event>& events, size_t max_events) {
+    size_t n = 0;
+    Event ev;
+    while (n < max_events && next(ev)) {
+        events.push_back(std::move(ev));
+        n++;
+    }
+    return n;
+}
+
+}  // namespace delila
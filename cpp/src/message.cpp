@@ -0,0 +1,95 @@
+// Pipeline Message frames as published over ZMQ
+
+#include "delila/message.hpp"
+
+#include <string>
+
+#include "delila/msgpack.hpp"
+
+namespace delila {
+
+namespace {
+
+// Batch header fields; the payload runs to the end of the frame
+bool parse_data(const uint8_t* data, size_t size, Message& msg) {
+    MsgPackParser p(data, size);
+    BatchHeader header;
+    if (!p.parse_batch_header(header)) return false;
+    msg.kind = MessageKind::Data;
+    msg.source_id = header.source_id;
+    msg.sequence_number = header.sequence_number;
+    msg.timestamp = header.timestamp;
+    msg.payload = data;
+    msg.payload_size = size;
+    return true;
+}
+
+// Struct fields, encoded as an array (rmp_serde default) or a map by name
+bool read_fields(MsgPackParser& p, const char* const* names, uint64_t* const* values, size_t n) {
+    size_t size;
+    if (p.read_array_header(size)) {
+        if (size != n) return false;
+        for (size_t i = 0; i < n; i++) {
+            if (!p.read_uint(*values[i])) return false;
+        }
+        return true;
+    }
+    if (!p.read_map_header(size)) return false;
+    size_t found = 0;
+    std::string key;
+    for (size_t i = 0; i < size; i++) {
+        if (!p.read_str(key)) return false;
+        size_t f = 0;
+        while (f < n && key != names[f]) f++;
+        if (f == n) {
+            if (!p.skip()) return false;
+            continue;
+        }
+        if (!p.read_uint(*values[f])) return false;
+        found++;
+    }
+    return found == n;
+}
+
+}  // namespace
+
+const char* message_kind_name(MessageKind kind) {
+    switch (kind) {
+        case MessageKind::Data: return "Data";
+        case MessageKind::EndOfStream: return "EndOfStream";
+        case MessageKind::Heartbeat: return "Heartbeat";
+    }
+    return "?";
+}
+
+bool parse_message(const uint8_t* data, size_t size, Message& msg) {
+    msg = Message();
+    MsgPackParser p(data, size);
+    size_t entries;
+    if (!p.read_map_header(entries)) return parse_data(data, size, msg);
+    std::string variant;
+    if (entries != 1 || !p.read_str(variant)) return false;
+
+    const uint8_t* value = data + p.position();
+    size_t value_size = p.remaining();
+    if (variant == "Data") return parse_data(value, value_size, msg);
+
+    uint64_t source_id = 0;
+    if (variant == "EndOfStream") {
+        static const char* const names[] = {"source_id"};
+        uint64_t* const values[] = {&source_id};
+        if (!read_fields(p, names, values, 1)) return false;
+        msg.kind = MessageKind::EndOfStream;
+    } else if (variant == "Heartbeat") {
+        static const char* const names[] = {"source_id", "timestamp", "counter"};
+        uint64_t* const values[] = {&source_id, &msg.timestamp, &msg.counter};
+        if (!read_fields(p, names, values, 3)) return false;
+        msg.kind = MessageKind::Heartbeat;
+    } else {
+        return false;
+    }
+    msg.source_id = static_cast<uint32_t>(source_id);
+    return true;
+}
+
+}  // namespace delila
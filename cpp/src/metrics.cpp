@@ -0,0 +1,178 @@
+// Per-stage timing and throughput counters for the offline tools
+
+#include "delila/metrics.hpp"
+
+#include <cstdio>
+#include <iostream>
+
+namespace delila {
+
+namespace {
+
+std::string format_double(double v, const char* fmt) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), fmt, v);
+    return buf;
+}
+
+std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+// Finite JSON number (NaN / inf are not JSON)
+std::string json_number(double v) {
+    if (!(v == v) || v > 1.7e308 || v < -1.7e308) return "0";
+    return format_double(v, "%.6g");
+}
+
+uint64_t since(uint64_t now, uint64_t prev) { return now > prev ? now - prev : 0; }
+
+}  // namespace
+
+const char* stage_name(Stage stage) {
+    switch (stage) {
+    case Stage::Read: return "read";
+    case Stage::Decompress: return "decompress";
+    case Stage::Parse: return "parse";
+    case Stage::Waveform: return "waveform";
+    case Stage::Fill: return "fill";
+    case Stage::Write: return "write";
+    }
+    return "unknown";
+}
+
+std::string RateSnapshot::format_bytes_rate() const {
+    if (bytes_rate >= 1e9) return format_double(bytes_rate / 1e9, "%.2f GB/s");
+    if (bytes_rate >= 1e6) return format_double(bytes_rate / 1e6, "%.2f MB/s");
+    if (bytes_rate >= 1e3) return format_double(bytes_rate / 1e3, "%.2f KB/s");
+    return format_double(bytes_rate, "%.0f B/s");
+}
+
+std::string RateSnapshot::format_events_rate() const {
+    if (events_rate >= 1e6) return format_double(events_rate / 1e6, "%.2f M/s");
+    if (events_rate >= 1e3) return format_double(events_rate / 1e3, "%.2f K/s");
+    return format_double(events_rate, "%.0f /s");
+}
+
+RateSnapshot MetricsSnapshot::rate_from(const MetricsSnapshot& prev, double elapsed) const {
+    RateSnapshot r;
+    if (elapsed <= 0) return r;
+    r.received_rate = static_cast<double>(since(received, prev.received)) / elapsed;
+    r.processed_rate = static_cast<double>(since(processed, prev.processed)) / elapsed;
+    r.events_rate = static_cast<double>(since(events_processed, prev.events_processed)) / elapsed;
+    r.bytes_rate = static_cast<double>(since(bytes, prev.bytes)) / elapsed;
+    return r;
+}
+
+std::string MetricsSnapshot::to_json(const std::string& component) const {
+    RateSnapshot r = rate();
+    std::string s = "{\"component\": " + json_string(component) +
+                    ", \"elapsed_secs\": " + json_number(elapsed_secs);
+    // ComponentMetrics (src/common/mod.rs)
+    s += ", \"metrics\": {\"events_processed\": " + std::to_string(events_processed) +
+         ", \"bytes_transferred\": " + std::to_string(bytes) +
+         ", \"queue_size\": 0, \"queue_max\": 0, \"event_rate\": " + json_number(r.events_rate) +
+         ", \"data_rate\": " + json_number(r.bytes_rate) + "}";
+    // CounterSnapshot / RateSnapshot (src/common/metrics.rs)
+    s += ", \"counters\": {\"received\": " + std::to_string(received) +
+         ", \"processed\": " + std::to_string(processed) +
+         ", \"dropped\": " + std::to_string(dropped) +
+         ", \"events_received\": " + std::to_string(events_received) +
+         ", \"events_processed\": " + std::to_string(events_processed) +
+         ", \"bytes\": " + std::to_string(bytes) +
+         ", \"waveform_samples\": " + std::to_string(waveform_samples) + "}";
+    s += ", \"rates\": {\"received_rate\": " + json_number(r.received_rate) +
+         ", \"processed_rate\": " + json_number(r.processed_rate) +
+         ", \"events_rate\": " + json_number(r.events_rate) +
+         ", \"bytes_rate\": " + json_number(r.bytes_rate) + "}";
+    s += ", \"stages\": {";
+    for (size_t i = 0; i < NUM_STAGES; i++) {
+        if (i > 0) s += ", ";
+        s += "\"" + std::string(stage_name(static_cast<Stage>(i))) + "_ns\": " +
+             std::to_string(stage_ns[i]);
+    }
+    return s + "}}";
+}
+
+MetricsSnapshot Metrics::snapshot() const {
+    MetricsSnapshot s;
+    s.received = received_.load(std::memory_order_relaxed);
+    s.processed = processed_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.events_received = events_received_.load(std::memory_order_relaxed);
+    s.events_processed = events_processed_.load(std::memory_order_relaxed);
+    s.bytes = bytes_.load(std::memory_order_relaxed);
+    s.waveform_samples = waveform_samples_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < NUM_STAGES; i++) {
+        s.stage_ns[i] = stage_ns_[i].load(std::memory_order_relaxed);
+    }
+    s.elapsed_secs =
+        static_cast<double>(since(monotonic_ns(), start_ns_.load(std::memory_order_relaxed))) *
+        1e-9;
+    return s;
+}
+
+void Metrics::reset() {
+    received_.store(0, std::memory_order_relaxed);
+    processed_.store(0, std::memory_order_relaxed);
+    dropped_.store(0, std::memory_order_relaxed);
+    events_received_.store(0, std::memory_order_relaxed);
+    events_processed_.store(0, std::memory_order_relaxed);
+    bytes_.store(0, std::memory_order_relaxed);
+    waveform_samples_.store(0, std::memory_order_relaxed);
+    for (auto& ns : stage_ns_) ns.store(0, std::memory_order_relaxed);
+    start_ns_.store(monotonic_ns(), std::memory_order_relaxed);
+}
+
+MetricsReporter::MetricsReporter(const Metrics& metrics, double interval_secs, std::ostream* out)
+    : metrics_(metrics),
+      interval_secs_(interval_secs),
+      out_(out ? out : &std::cout),
+      last_(metrics.snapshot()),
+      last_ns_(monotonic_ns()) {}
+
+bool MetricsReporter::poll() {
+    if (interval_secs_ <= 0) return false;
+    if (static_cast<double>(since(monotonic_ns(), last_ns_)) * 1e-9 < interval_secs_) return false;
+    report();
+    return true;
+}
+
+void MetricsReporter::report() {
+    uint64_t now = monotonic_ns();
+    MetricsSnapshot s = metrics_.snapshot();
+    RateSnapshot r = s.rate_from(last_, static_cast<double>(since(now, last_ns_)) * 1e-9);
+
+    uint64_t total_ns = 0;
+    for (size_t i = 0; i < NUM_STAGES; i++) total_ns += since(s.stage_ns[i], last_.stage_ns[i]);
+
+    std::ostream& out = *out_;
+    out << format_double(s.elapsed_secs, "[%5.1f s] ") << r.format_events_rate() << ", "
+        << r.format_bytes_rate() << " (" << s.processed << " blocks, " << s.events_processed
+        << " events)";
+    if (total_ns > 0) {
+        for (size_t i = 0; i < NUM_STAGES; i++) {
+            double share = 100.0 * static_cast<double>(since(s.stage_ns[i], last_.stage_ns[i])) /
+                           static_cast<double>(total_ns);
+            out << " " << stage_name(static_cast<Stage>(i)) << format_double(share, " %.0f%%");
+        }
+    }
+    out << std::endl;
+    last_ = s;
+    last_ns_ = now;
+}
+
+}  // namespace delila
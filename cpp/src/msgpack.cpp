@@ -0,0 +1,668 @@
+// MessagePack parser for EventDataBatch blocks
+
+#include "delila/msgpack.hpp"
+
+#include <algorithm>
+
+#include "delila/metrics.hpp"
+#include "delila/simd.hpp"
+
+namespace delila {
+
+namespace {
+
+// Nesting limit for skip(); EventDataBatch is at most 4 levels deep
+constexpr int MAX_SKIP_DEPTH = 32;
+
+// Event array headers of the specialized loops
+constexpr uint8_t EVENT_6 = 0x96;  // No waveform
+constexpr uint8_t EVENT_7 = 0x97;  // Waveform (or nil)
+
+// Widest scalar prefix the specialized decode reads: array header,
+// module, channel, 2 x uint16, float64, uint64
+constexpr size_t MAX_SCALAR_BYTES = 1 + 1 + 1 + 3 + 3 + 9 + 9;
+
+// The common event in full: fixint module / channel, uint16 energy and
+// energy_short, fixint flags. Every field is at a fixed offset.
+constexpr size_t WIDE_BYTES = 1 + 1 + 1 + 3 + 3 + 9 + 1;
+
+inline bool is_wide_event(const uint8_t* p, uint8_t header) {
+    return (p[0] == header) & (p[1] <= 0x7f) & (p[2] <= 0x7f) & (p[3] == 0xcd) &
+           (p[6] == 0xcd) & (p[9] == 0xcb) & (p[18] <= 0x7f);
+}
+
+// Fixint, uint8 or uint16 at p (3 bytes readable): value and width.
+// Another tag clears `ok` (the width is still at most 3).
+inline size_t fixed_u16(const uint8_t* p, uint64_t& val, bool& ok) {
+    uint8_t tag = p[0];
+    bool fix = tag <= 0x7f;
+    bool u8 = tag == 0xcc;
+    ok &= fix | u8 | (tag == 0xcd);
+    val = fix ? tag : static_cast<uint64_t>(load_u16_be(p + 1) >> (u8 ? 8 : 0));
+    return fix ? 1 : u8 ? 2 : 3;
+}
+
+// Fixint or uint8 / 16 / 32 / 64 at p (9 bytes readable)
+inline size_t fixed_u64(const uint8_t* p, uint64_t& val, bool& ok) {
+    uint8_t tag = p[0];
+    if (tag <= 0x7f) {
+        val = tag;
+        return 1;
+    }
+    unsigned k = static_cast<unsigned>(tag) - 0xcc;  // 0-3: uint8 - uint64
+    ok &= k < 4;
+    unsigned bytes = 1u << (k & 3);
+    val = load_u64_be(p + 1) >> (64 - 8 * bytes);
+    return 1 + bytes;
+}
+
+}  // namespace
+
+bool MsgPackParser::parse_batch_header(BatchHeader& header) {
+    // Batch is array of 4 elements
+    size_t batch_size;
+    if (!read_array_header(batch_size) || batch_size != 4) {
+        return false;
+    }
+
+    // source_id (u32)
+    uint64_t src;
+    if (!read_uint(src)) return false;
+    header.source_id = static_cast<uint32_t>(src);
+
+    // sequence_number (u64)
+    if (!read_uint(header.sequence_number)) return false;
+
+    // timestamp (u64)
+    if (!read_uint(header.timestamp)) return false;
+
+    // events array header (each event takes well over one byte, which
+    // bounds the count before callers size their buffers from it)
+    if (!read_array_header(header.num_events)) return false;
+    return header.num_events <= remaining();
+}
+
+bool MsgPackParser::read_scalars(Scalars& s) {
+    // Event is array of 6 or 7 elements (7 if has waveform):
+    // module (u8), channel (u8), energy (u16), energy_short (u16),
+    // timestamp_ns (f64), flags (u64)
+    if (!read_array_header(s.size) || (s.size != 6 && s.size != 7)) return false;
+    return read_uint(s.module) && read_uint(s.channel) && read_uint(s.energy) &&
+           read_uint(s.energy_short) && read_float64(s.timestamp_ns) && read_uint(s.flags);
+}
+
+template <uint8_t Header, bool Wide>
+inline bool MsgPackParser::read_scalars_as(Scalars& s) {
+    if (Header != 0 && remaining() >= MAX_SCALAR_BYTES) {
+        const uint8_t* p = pos_;
+        if (Wide && is_wide_event(p, Header)) {
+            // Constant offsets: no load waits for another field's tag
+            s.module = p[1];
+            s.channel = p[2];
+            s.energy = load_u16_be(p + 4);
+            s.energy_short = load_u16_be(p + 7);
+            uint64_t bits = load_u64_be(p + 10);
+            std::memcpy(&s.timestamp_ns, &bits, sizeof(double));
+            s.flags = p[18];
+            s.size = Header & 0x0f;
+            pos_ += WIDE_BYTES;
+            return true;
+        }
+        // Straight-line: every tag is checked into `ok`, once
+        bool ok = (p[0] == Header) & (p[1] <= 0x7f) & (p[2] <= 0x7f);
+        s.module = p[1];
+        s.channel = p[2];
+        size_t at = 3;
+        at += fixed_u16(p + at, s.energy, ok);
+        at += fixed_u16(p + at, s.energy_short, ok);
+        ok &= p[at] == 0xcb;
+        uint64_t bits = load_u64_be(p + at + 1);
+        std::memcpy(&s.timestamp_ns, &bits, sizeof(double));
+        at += 9;
+        at += fixed_u64(p + at, s.flags, ok);
+        if (ok) {
+            s.size = Header & 0x0f;
+            pos_ += at;
+            return true;
+        }
+    }
+    return read_scalars(s);
+}
+
+MsgPackParser::EventLayout MsgPackParser::first_event_layout() const {
+    uint8_t header = peek();
+    if (header != EVENT_6 && header != EVENT_7) return EventLayout::Generic;
+    bool wide = remaining() >= MAX_SCALAR_BYTES && is_wide_event(pos_, header);
+    if (header == EVENT_6) return wide ? EventLayout::Wide6 : EventLayout::Narrow6;
+    return wide ? EventLayout::Wide7 : EventLayout::Narrow7;
+}
+
+bool MsgPackParser::parse_event_waveform(Event& ev, bool decode_waveform) {
+    // Tolerate an explicit nil as "no waveform"
+    if (read_nil()) return true;
+    if (!decode_waveform) {
+        if (!skip_waveform()) return false;
+    } else if (waveform_timing_) {
+        uint64_t t0 = monotonic_ns();
+        bool ok = parse_waveform(ev.waveform);
+        waveform_ns_ += monotonic_ns() - t0;
+        if (!ok) return false;
+    } else if (!parse_waveform(ev.waveform)) {
+        return false;
+    }
+    ev.has_waveform = true;
+    return true;
+}
+
+bool MsgPackParser::parse_event(Event& ev, bool decode_waveform) {
+    Scalars s;
+    if (!read_scalars(s)) return false;
+    ev.module = static_cast<uint8_t>(s.module);
+    ev.channel = static_cast<uint8_t>(s.channel);
+    ev.energy = static_cast<uint16_t>(s.energy);
+    ev.energy_short = static_cast<uint16_t>(s.energy_short);
+    ev.timestamp_ns = s.timestamp_ns;
+    ev.flags = s.flags;
+    ev.has_waveform = false;
+    ev.waveform.clear();
+    return s.size != 7 || parse_event_waveform(ev, decode_waveform);
+}
+
+template <uint8_t Header, bool Wide>
+bool MsgPackParser::parse_events_as(size_t num_events, std::vector<Event>& events, size_t base,
+                                    bool decode_waveforms) {
+    Scalars s;
+    for (size_t i = 0; i < num_events; i++) {
+        Event& ev = events[base + i];
+        if (!read_scalars_as<Header, Wide>(s)) {
+            events.resize(base + i);
+            return false;
+        }
+        ev.module = static_cast<uint8_t>(s.module);
+        ev.channel = static_cast<uint8_t>(s.channel);
+        ev.energy = static_cast<uint16_t>(s.energy);
+        ev.energy_short = static_cast<uint16_t>(s.energy_short);
+        ev.timestamp_ns = s.timestamp_ns;
+        ev.flags = s.flags;
+        ev.has_waveform = false;
+        ev.waveform.clear();
+        if (s.size == 7 && !parse_event_waveform(ev, decode_waveforms)) {
+            events.resize(base + i);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MsgPackParser::parse_events_into(size_t num_events, std::vector<Event>& events, size_t base,
+                                      bool decode_waveforms) {
+    // Resize once, then fill in place (reuses capacity across batches)
+    events.resize(base + num_events);
+    switch (first_event_layout()) {
+    case EventLayout::Wide6:
+        return parse_events_as<EVENT_6, true>(num_events, events, base, decode_waveforms);
+    case EventLayout::Narrow6:
+        return parse_events_as<EVENT_6, false>(num_events, events, base, decode_waveforms);
+    case EventLayout::Wide7:
+        return parse_events_as<EVENT_7, true>(num_events, events, base, decode_waveforms);
+    case EventLayout::Narrow7:
+        return parse_events_as<EVENT_7, false>(num_events, events, base, decode_waveforms);
+    default:
+        return parse_events_as<0, false>(num_events, events, base, decode_waveforms);
+    }
+}
+
+bool MsgPackParser::parse_batch(BatchHeader& header, std::vector<Event>& events) {
+    return parse_batch_header(header) &&
+           parse_events_into(header.num_events, events, events.size(), true);
+}
+
+bool MsgPackParser::parse_columns(size_t num_events, EventColumns& cols,
+                                  const EventFilter* filter, bool decode_waveforms,
+                                  uint32_t fields) {
+    switch (first_event_layout()) {
+    case EventLayout::Wide6:
+        return parse_columns_as<EVENT_6, true>(num_events, cols, filter, decode_waveforms, fields);
+    case EventLayout::Narrow6:
+        return parse_columns_as<EVENT_6, false>(num_events, cols, filter, decode_waveforms, fields);
+    case EventLayout::Wide7:
+        return parse_columns_as<EVENT_7, true>(num_events, cols, filter, decode_waveforms, fields);
+    case EventLayout::Narrow7:
+        return parse_columns_as<EVENT_7, false>(num_events, cols, filter, decode_waveforms, fields);
+    default:
+        return parse_columns_as<0, false>(num_events, cols, filter, decode_waveforms, fields);
+    }
+}
+
+template <uint8_t Header, bool Wide>
+bool MsgPackParser::parse_columns_as(size_t num_events, EventColumns& cols,
+                                     const EventFilter* filter, bool decode_waveforms,
+                                     uint32_t fields) {
+    // Resize once and write through raw pointers: the loop stays free of
+    // push_back capacity checks. Columns outside `fields` get no pointer
+    // and are never written.
+    const size_t base = cols.size();
+    cols.resize_events(base + num_events, fields);
+    auto column = [&](auto& v, uint32_t field) { return fields & field ? v.data() + base : nullptr; };
+    uint8_t* module = column(cols.module, FIELD_MODULE);
+    uint8_t* channel = column(cols.channel, FIELD_CHANNEL);
+    uint16_t* energy = column(cols.energy, FIELD_ENERGY);
+    uint16_t* energy_short = column(cols.energy_short, FIELD_ENERGY_SHORT);
+    double* timestamp_ns = column(cols.timestamp_ns, FIELD_TIMESTAMP_NS);
+    uint64_t* flags = column(cols.flags, FIELD_FLAGS);
+    int32_t* waveform_index = cols.waveform_index.data() + base;
+
+    // On error keep the events before the bad one and drop partial samples
+    auto truncate = [&](size_t n) {
+        cols.resize_events(base + n, fields);
+        for (auto* p : {&cols.analog_probe1, &cols.analog_probe2}) p->samples.resize(p->offsets.back());
+        for (auto* p : {&cols.digital_probe1, &cols.digital_probe2, &cols.digital_probe3,
+                        &cols.digital_probe4}) {
+            p->samples.resize(p->offsets.back());
+        }
+        return false;
+    };
+
+    // Event i is written to slot k; a rejected one is overwritten by the
+    // next. The test reads the scalars from locals, not back from the columns.
+    Scalars s;
+    size_t k = 0;
+    for (size_t i = 0; i < num_events; i++) {
+        if (!read_scalars_as<Header, Wide>(s)) return truncate(k);
+        if (module) module[k] = static_cast<uint8_t>(s.module);
+        if (channel) channel[k] = static_cast<uint8_t>(s.channel);
+        if (energy) energy[k] = static_cast<uint16_t>(s.energy);
+        if (energy_short) energy_short[k] = static_cast<uint16_t>(s.energy_short);
+        if (timestamp_ns) timestamp_ns[k] = s.timestamp_ns;
+        if (flags) flags[k] = s.flags;
+
+        bool keep = !filter || filter->matches(static_cast<uint8_t>(s.module),
+                                               static_cast<uint8_t>(s.channel),
+                                               static_cast<uint16_t>(s.energy),
+                                               static_cast<uint16_t>(s.energy_short),
+                                               s.timestamp_ns, s.flags);
+        waveform_index[k] = NO_WAVEFORM;
+        if (s.size == 7 && !read_nil()) {
+            if (!keep || !decode_waveforms) {
+                if (!skip_waveform()) return truncate(k);
+            } else {
+                uint64_t t0 = waveform_timing_ ? monotonic_ns() : 0;
+                bool ok = parse_waveform_columns(cols);
+                if (waveform_timing_) waveform_ns_ += monotonic_ns() - t0;
+                if (!ok) return truncate(k);
+                waveform_index[k] = static_cast<int32_t>(cols.num_waveforms() - 1);
+            }
+        }
+        if (keep) k++;
+    }
+    if (k < num_events) cols.resize_events(base + k, fields);
+    return true;
+}
+
+bool MsgPackParser::parse_waveform_columns(EventColumns& cols) {
+    size_t wf_size;
+    if (!read_array_header(wf_size) || wf_size != 8) {
+        return false;
+    }
+
+    if (!append_i16_array(cols.analog_probe1.samples)) return false;
+    if (!append_i16_array(cols.analog_probe2.samples)) return false;
+    if (!append_u8_array(cols.digital_probe1.samples)) return false;
+    if (!append_u8_array(cols.digital_probe2.samples)) return false;
+    if (!append_u8_array(cols.digital_probe3.samples)) return false;
+    if (!append_u8_array(cols.digital_probe4.samples)) return false;
+
+    uint64_t time_resolution, trigger_threshold;
+    if (!read_uint(time_resolution) || !read_uint(trigger_threshold)) return false;
+
+    // Commit the waveform only once all of it parsed
+    cols.analog_probe1.end_waveform();
+    cols.analog_probe2.end_waveform();
+    cols.digital_probe1.end_waveform();
+    cols.digital_probe2.end_waveform();
+    cols.digital_probe3.end_waveform();
+    cols.digital_probe4.end_waveform();
+    cols.time_resolution.push_back(static_cast<uint8_t>(time_resolution));
+    cols.trigger_threshold.push_back(static_cast<uint16_t>(trigger_threshold));
+    return true;
+}
+
+bool MsgPackParser::parse_waveform(Waveform& wf) {
+    // Waveform is array of 8 elements
+    size_t wf_size;
+    if (!read_array_header(wf_size) || wf_size != 8) {
+        return false;
+    }
+
+    if (!read_i16_array(wf.analog_probe1)) return false;
+    if (!read_i16_array(wf.analog_probe2)) return false;
+    if (!read_u8_array(wf.digital_probe1)) return false;
+    if (!read_u8_array(wf.digital_probe2)) return false;
+    if (!read_u8_array(wf.digital_probe3)) return false;
+    if (!read_u8_array(wf.digital_probe4)) return false;
+
+    uint64_t tmp;
+    // time_resolution (u8)
+    if (!read_uint(tmp)) return false;
+    wf.time_resolution = static_cast<uint8_t>(tmp);
+
+    // trigger_threshold (u16)
+    if (!read_uint(tmp)) return false;
+    wf.trigger_threshold = static_cast<uint16_t>(tmp);
+
+    return true;
+}
+
+bool MsgPackParser::append_i16_array(std::vector<int16_t>& arr) {
+    if (pos_ >= end_) return false;
+
+    // Little-endian bin blob (recorder option analog_probes_as_bin)
+    uint8_t tag = *pos_;
+    if (tag == 0xc4 || tag == 0xc5 || tag == 0xc6) {
+        size_t bytes;
+        if (!read_bin_header(bytes) || bytes % 2 != 0) return false;
+        size_t base = arr.size();
+        arr.resize(base + bytes / 2);
+        int16_t* out = arr.data() + base;
+        std::memcpy(out, pos_, bytes);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        for (size_t i = 0; i < bytes / 2; i++) {
+            out[i] = static_cast<int16_t>(__builtin_bswap16(static_cast<uint16_t>(out[i])));
+        }
+#endif
+        pos_ += bytes;
+        return true;
+    }
+
+    size_t size;
+    if (!read_array_header(size)) return false;
+    // Every element takes at least one byte
+    if (size > remaining()) return false;
+
+    size_t base = arr.size();
+    arr.resize(base + size);
+    int16_t* out = arr.data() + base;
+    size_t i = 0;
+    while (i < size) {
+        if (pos_ >= end_) return false;
+        uint8_t b = *pos_;
+
+        // Runs of same-width samples go to the SIMD kernels
+        size_t n = 0;
+        if (b <= 0x7f || b >= 0xe0) {
+            n = decode_fixint_run(pos_, std::min(size - i, remaining()), out + i);
+            pos_ += n;
+        } else if (b == 0xd1 || b == 0xcd) {
+            n = decode_int16_run(pos_, std::min(size - i, remaining() / 3), out + i);
+            pos_ += 3 * n;
+        }
+        if (n == 0) {
+            int64_t val;
+            if (!read_int(val)) return false;
+            out[i] = static_cast<int16_t>(val);
+            n = 1;
+        }
+        i += n;
+    }
+    return true;
+}
+
+bool MsgPackParser::append_u8_array(std::vector<uint8_t>& arr) {
+    if (pos_ >= end_) return false;
+    uint8_t b = *pos_;
+
+    // Check for binary format first
+    if (b == 0xc4 || b == 0xc5 || b == 0xc6) {
+        return append_bin(arr);
+    }
+
+    // Otherwise, it's an array
+    size_t size;
+    if (!read_array_header(size)) return false;
+    if (size > remaining()) return false;
+
+    size_t base = arr.size();
+    arr.resize(base + size);
+    uint8_t* out = arr.data() + base;
+    for (size_t i = 0; i < size; i++) {
+        if (pos_ >= end_) return false;
+        uint8_t v = *pos_;
+        if (v <= 0x7f) {
+            out[i] = v;
+            pos_++;
+            continue;
+        }
+        uint64_t val;
+        if (!read_uint(val)) return false;
+        out[i] = static_cast<uint8_t>(val);
+    }
+    return true;
+}
+
+bool MsgPackParser::skip_waveform() {
+    size_t wf_size;
+    if (!read_array_header(wf_size) || wf_size != 8) {
+        return false;
+    }
+    if (!skip_i16_array() || !skip_i16_array()) return false;
+    for (int p = 0; p < 4; p++) {
+        if (!skip_u8_array()) return false;
+    }
+    uint64_t time_resolution, trigger_threshold;
+    return read_uint(time_resolution) && read_uint(trigger_threshold);
+}
+
+bool MsgPackParser::skip_i16_array() {
+    if (pos_ >= end_) return false;
+
+    uint8_t tag = *pos_;
+    if (tag == 0xc4 || tag == 0xc5 || tag == 0xc6) {
+        size_t bytes;
+        if (!read_bin_header(bytes) || bytes % 2 != 0) return false;
+        pos_ += bytes;
+        return true;
+    }
+
+    // Same run structure as append_i16_array, counting instead of storing
+    size_t size;
+    if (!read_array_header(size)) return false;
+    if (size > remaining()) return false;
+    size_t i = 0;
+    while (i < size) {
+        if (pos_ >= end_) return false;
+        uint8_t b = *pos_;
+
+        size_t n = 0;
+        if (b <= 0x7f || b >= 0xe0) {
+            n = skip_fixint_run(pos_, std::min(size - i, remaining()));
+            pos_ += n;
+        } else if (b == 0xd1 || b == 0xcd) {
+            n = skip_int16_run(pos_, std::min(size - i, remaining() / 3));
+            pos_ += 3 * n;
+        }
+        if (n == 0) {
+            int64_t val;
+            if (!read_int(val)) return false;
+            n = 1;
+        }
+        i += n;
+    }
+    return true;
+}
+
+bool MsgPackParser::skip_u8_array() {
+    if (pos_ >= end_) return false;
+    uint8_t b = *pos_;
+
+    if (b == 0xc4 || b == 0xc5 || b == 0xc6) {
+        size_t size;
+        if (!read_bin_header(size)) return false;
+        pos_ += size;
+        return true;
+    }
+
+    size_t size;
+    if (!read_array_header(size)) return false;
+    if (size > remaining()) return false;
+    for (size_t i = 0; i < size; i++) {
+        if (pos_ >= end_) return false;
+        if (*pos_ <= 0x7f) {
+            pos_++;
+            continue;
+        }
+        uint64_t val;
+        if (!read_uint(val)) return false;
+    }
+    return true;
+}
+
+bool MsgPackParser::read_bin_header(size_t& size) {
+    if (pos_ >= end_) return false;
+    uint8_t b = *pos_;
+    ptrdiff_t avail = end_ - pos_;
+
+    if (b == 0xc4 && avail >= 2) {
+        size = pos_[1];
+        pos_ += 2;
+    } else if (b == 0xc5 && avail >= 3) {
+        size = load_u16_be(pos_ + 1);
+        pos_ += 3;
+    } else if (b == 0xc6 && avail >= 5) {
+        size = load_u32_be(pos_ + 1);
+        pos_ += 5;
+    } else {
+        return false;
+    }
+    return size <= remaining();
+}
+
+bool MsgPackParser::append_bin(std::vector<uint8_t>& arr) {
+    size_t size;
+    if (!read_bin_header(size)) return false;
+    arr.insert(arr.end(), pos_, pos_ + size);
+    pos_ += size;
+    return true;
+}
+
+bool MsgPackParser::read_str(std::string& val) {
+    if (pos_ >= end_) return false;
+    uint8_t b = *pos_;
+    ptrdiff_t avail = end_ - pos_;
+    size_t size = 0;
+
+    if ((b & 0xe0) == 0xa0) {
+        // fixstr (0xa0 - 0xbf)
+        size = b & 0x1f;
+        pos_ += 1;
+    } else if (b == 0xd9 && avail >= 2) {
+        size = pos_[1];
+        pos_ += 2;
+    } else if (b == 0xda && avail >= 3) {
+        size = load_u16_be(pos_ + 1);
+        pos_ += 3;
+    } else if (b == 0xdb && avail >= 5) {
+        size = load_u32_be(pos_ + 1);
+        pos_ += 5;
+    } else {
+        return false;
+    }
+
+    if (size > remaining()) return false;
+    val.assign(reinterpret_cast<const char*>(pos_), size);
+    pos_ += size;
+    return true;
+}
+
+bool MsgPackParser::skip() {
+    return skip_depth(0);
+}
+
+bool MsgPackParser::skip_depth(int depth) {
+    if (pos_ >= end_ || depth > MAX_SKIP_DEPTH) return false;
+    uint8_t b = *pos_;
+    ptrdiff_t avail = end_ - pos_;
+
+    // Width of the payload / element count following the type byte
+    size_t skip_bytes = 0;
+    size_t count = 0;
+    bool is_map = false;
+    bool is_container = false;
+
+    if (b <= 0x7f || b >= 0xe0 || b == 0xc0 || b == 0xc2 || b == 0xc3) {
+        pos_++;
+        return true;
+    }
+    if ((b & 0xe0) == 0xa0) {
+        skip_bytes = 1 + (b & 0x1f);
+    } else if ((b & 0xf0) == 0x90) {
+        pos_++;
+        count = b & 0x0f;
+        is_container = true;
+    } else if ((b & 0xf0) == 0x80) {
+        pos_++;
+        count = b & 0x0f;
+        is_map = true;
+        is_container = true;
+    } else {
+        switch (b) {
+        case 0xcc: case 0xd0: skip_bytes = 2; break;
+        case 0xcd: case 0xd1: skip_bytes = 3; break;
+        case 0xce: case 0xd2: case 0xca: skip_bytes = 5; break;
+        case 0xcf: case 0xd3: case 0xcb: skip_bytes = 9; break;
+        case 0xd4: skip_bytes = 3; break;   // fixext1
+        case 0xd5: skip_bytes = 4; break;   // fixext2
+        case 0xd6: skip_bytes = 6; break;   // fixext4
+        case 0xd7: skip_bytes = 10; break;  // fixext8
+        case 0xd8: skip_bytes = 18; break;  // fixext16
+        case 0xc4: case 0xd9:
+            if (avail < 2) return false;
+            skip_bytes = 2 + pos_[1];
+            break;
+        case 0xc5: case 0xda:
+            if (avail < 3) return false;
+            skip_bytes = 3 + load_u16_be(pos_ + 1);
+            break;
+        case 0xc6: case 0xdb:
+            if (avail < 5) return false;
+            skip_bytes = 5 + static_cast<size_t>(load_u32_be(pos_ + 1));
+            break;
+        case 0xc7:  // ext8
+            if (avail < 2) return false;
+            skip_bytes = 3 + pos_[1];
+            break;
+        case 0xc8:  // ext16
+            if (avail < 3) return false;
+            skip_bytes = 4 + load_u16_be(pos_ + 1);
+            break;
+        case 0xc9:  // ext32
+            if (avail < 5) return false;
+            skip_bytes = 6 + static_cast<size_t>(load_u32_be(pos_ + 1));
+            break;
+        case 0xdc: case 0xdd:
+            if (!read_array_header(count)) return false;
+            is_container = true;
+            break;
+        case 0xde: case 0xdf:
+            if (!read_map_header(count)) return false;
+            is_map = true;
+            is_container = true;
+            break;
+        default:
+            return false;
+        }
+    }
+
+    if (!is_container) {
+        if (skip_bytes > static_cast<size_t>(avail)) return false;
+        pos_ += skip_bytes;
+        return true;
+    }
+
+    size_t items = is_map ? count * 2 : count;
+    for (size_t i = 0; i < items; i++) {
+        if (!skip_depth(depth + 1)) return false;
+    }
+    return true;
+}
+
+}  // namespace delila
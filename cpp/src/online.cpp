@@ -0,0 +1,189 @@
+// Online consumer: decode batches straight from the pipeline's ZMQ stream
+
+#include "delila/online.hpp"
+
+#include <zmq.h>
+
+#include <cerrno>
+
+#include "delila/reader.hpp"
+
+namespace delila {
+
+namespace {
+
+// Receive timeout, so the thread notices stop() while the stream is idle
+constexpr int RECEIVE_TIMEOUT_MS = 100;
+
+}  // namespace
+
+OnlineConsumer::OnlineConsumer(OnlineOptions options) : options_(std::move(options)) {
+    n_workers_ = options_.n_workers;
+    if (n_workers_ == 0) n_workers_ = std::max(1u, std::thread::hardware_concurrency());
+    options_.queue_frames = std::max<size_t>(options_.queue_frames, 1);
+}
+
+OnlineConsumer::~OnlineConsumer() {
+    stop();
+}
+
+bool OnlineConsumer::fail(const std::string& msg) {
+    error_ = msg + ": " + zmq_strerror(zmq_errno());
+    if (socket_) zmq_close(socket_);
+    if (context_ && own_context_) zmq_ctx_term(context_);
+    socket_ = nullptr;
+    context_ = nullptr;
+    return false;
+}
+
+bool OnlineConsumer::start(BatchHandler handler) {
+    if (running_) return true;
+    error_.clear();
+    handler_ = std::move(handler);
+
+    own_context_ = !options_.context;
+    context_ = own_context_ ? zmq_ctx_new() : options_.context;
+    if (!context_) return fail("Cannot create ZMQ context");
+    socket_ = zmq_socket(context_, ZMQ_SUB);
+    if (!socket_) return fail("Cannot create SUB socket");
+
+    int hwm = options_.receive_hwm;
+    int timeout = RECEIVE_TIMEOUT_MS;
+    int linger = 0;
+    if (zmq_setsockopt(socket_, ZMQ_RCVHWM, &hwm, sizeof(hwm)) != 0 ||
+        zmq_setsockopt(socket_, ZMQ_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+        zmq_setsockopt(socket_, ZMQ_LINGER, &linger, sizeof(linger)) != 0 ||
+        zmq_setsockopt(socket_, ZMQ_SUBSCRIBE, "", 0) != 0) {
+        return fail("Cannot configure SUB socket");
+    }
+    if (zmq_connect(socket_, options_.endpoint.c_str()) != 0) {
+        return fail("Cannot connect to " + options_.endpoint);
+    }
+
+    stop_ = false;
+    draining_ = false;
+    next_sequence_.clear();
+    for (unsigned w = 0; w < n_workers_; w++) workers_.emplace_back([this, w] { worker_loop(w); });
+    // The socket moves to the receive thread (thread start is a full barrier)
+    receiver_ = std::thread([this] { receive_loop(); });
+    running_ = true;
+    return true;
+}
+
+void OnlineConsumer::stop() {
+    if (!running_) return;
+    stop_ = true;
+    receiver_.join();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        draining_ = true;
+    }
+    ready_.notify_all();
+    for (auto& w : workers_) w.join();
+    workers_.clear();
+
+    zmq_close(socket_);
+    if (own_context_) zmq_ctx_term(context_);
+    socket_ = nullptr;
+    context_ = nullptr;
+    running_ = false;
+}
+
+OnlineStats OnlineConsumer::stats() const {
+    OnlineStats s;
+    s.frames = frames_;
+    s.dropped = dropped_;
+    s.bad_frames = bad_frames_;
+    s.missing_batches = missing_batches_;
+    s.batches = batches_;
+    s.events = events_;
+    s.end_of_stream = end_of_stream_;
+    s.heartbeats = heartbeats_;
+    return s;
+}
+
+void OnlineConsumer::receive_loop() {
+    zmq_msg_t msg;
+    zmq_msg_init(&msg);
+    while (!stop_) {
+        if (zmq_msg_recv(&msg, socket_, 0) < 0) {
+            if (zmq_errno() == EAGAIN || zmq_errno() == EINTR) continue;
+            break;  // Context terminated
+        }
+        frames_++;
+        const uint8_t* data = static_cast<const uint8_t*>(zmq_msg_data(&msg));
+        size_t size = zmq_msg_size(&msg);
+
+        Message m;
+        if (!parse_message(data, size, m)) {
+            bad_frames_++;
+            continue;
+        }
+        if (m.kind != MessageKind::Data) {
+            (m.kind == MessageKind::EndOfStream ? end_of_stream_ : heartbeats_)++;
+            if (control_) control_(m);
+            continue;
+        }
+
+        // Sequence numbers count up per source; a jump is data lost
+        // upstream (or at our HWM), counted even if we drop the frame too
+        auto seq = next_sequence_.find(m.source_id);
+        if (seq != next_sequence_.end() && m.sequence_number > seq->second) {
+            missing_batches_ += m.sequence_number - seq->second;
+        }
+        next_sequence_[m.source_id] = m.sequence_number + 1;
+
+        // Never wait for the workers here
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.size() >= options_.queue_frames) {
+                dropped_++;
+                continue;
+            }
+            Frame f;
+            if (!spare_.empty()) {
+                f.bytes = std::move(spare_.back());
+                spare_.pop_back();
+            }
+            f.bytes.assign(data, data + size);
+            f.payload_offset = static_cast<size_t>(m.payload - data);
+            f.payload_size = m.payload_size;
+            f.index = static_cast<size_t>(m.sequence_number);
+            queue_.push_back(std::move(f));
+        }
+        ready_.notify_one();
+    }
+    zmq_msg_close(&msg);
+}
+
+void OnlineConsumer::worker_loop(unsigned worker) {
+    Frame f;
+    BatchHeader header;
+    EventColumns cols;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!f.bytes.empty() && spare_.size() < options_.queue_frames) {
+                spare_.push_back(std::move(f.bytes));
+            }
+            ready_.wait(lock, [this] { return !queue_.empty() || draining_; });
+            if (queue_.empty()) return;
+            f = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        BlockView block;
+        block.data = f.bytes.data() + f.payload_offset;
+        block.size = f.payload_size;
+        block.index = f.index;
+        if (!FileReader::decode_block(block, header, cols, nullptr, options_.decode_waveforms)) {
+            bad_frames_++;
+            continue;
+        }
+        handler_(worker, header, cols);
+        batches_++;
+        events_ += cols.size();
+    }
+}
+
+}  // namespace delila
@@ -0,0 +1,511 @@
+// Partitioned conversion: deterministic block-range jobs over many files
+
+#include "delila/partition.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace delila {
+
+namespace {
+
+constexpr const char* PLAN_MAGIC = "delila-plan";
+constexpr const char* RESULT_MAGIC = "delila-partition-result";
+constexpr int FORMAT_VERSION = 1;
+
+bool set_error(std::string* error, const std::string& msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+// Round-trips through parse_double()
+std::string format_double(double v) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.17g", v);
+    return buf;
+}
+
+std::string format_hex(uint64_t v) {
+    char buf[20];
+    std::snprintf(buf, sizeof(buf), "%016" PRIx64, v);
+    return buf;
+}
+
+bool parse_u64(const std::string& token, uint64_t& v, int base = 10) {
+    if (token.empty()) return false;
+    char* end = nullptr;
+    v = std::strtoull(token.c_str(), &end, base);
+    return *end == '\0';
+}
+
+bool parse_size(const std::string& token, size_t& v) {
+    uint64_t u;
+    if (!parse_u64(token, u)) return false;
+    v = static_cast<size_t>(u);
+    return true;
+}
+
+bool parse_double(const std::string& token, double& v) {
+    if (token.empty()) return false;
+    char* end = nullptr;
+    v = std::strtod(token.c_str(), &end);
+    return *end == '\0';
+}
+
+// First line "<magic> <version>"
+bool check_magic(std::istream& in, const char* magic, const std::string& path, std::string* error) {
+    std::string word;
+    int version = 0;
+    if (!(in >> word >> version) || word != magic) {
+        return set_error(error, path + ": not a " + magic + " file");
+    }
+    if (version != FORMAT_VERSION) {
+        return set_error(error, path + ": unsupported " + magic + " version " +
+                                    std::to_string(version));
+    }
+    return true;
+}
+
+// Remainder of the line after the fields already read (one separator dropped)
+std::string rest_of_line(std::istringstream& line) {
+    std::string rest;
+    std::getline(line, rest);
+    if (!rest.empty() && rest[0] == ' ') rest.erase(0, 1);
+    return rest;
+}
+
+// One decoded block folded into a range, as FileSummary::add_block() does
+void tally(RangeResult& r, size_t events, size_t waveforms, double front_ts, double back_ts) {
+    if (events == 0) return;
+    r.events += events;
+    r.waveforms += waveforms;
+    r.first_ts = std::min(r.first_ts, front_ts);
+    r.last_ts = std::max(r.last_ts, back_ts);
+}
+
+}  // namespace
+
+uint64_t Partition::events() const {
+    uint64_t n = 0;
+    for (const auto& r : ranges) n += r.events;
+    return n;
+}
+
+uint64_t Partition::bytes() const {
+    uint64_t n = 0;
+    for (const auto& r : ranges) n += r.bytes;
+    return n;
+}
+
+bool PartitionPlan::save(const std::string& path, std::string* error) const {
+    std::ofstream out(path);
+    if (!out) return set_error(error, "cannot create " + path);
+    out << PLAN_MAGIC << " " << FORMAT_VERSION << "\n";
+    for (const auto& f : files) {
+        const Footer& ft = f.footer;
+        out << "file " << f.file_size << " " << f.blocks << " " << f.events << " "
+            << (f.has_footer ? 1 : 0) << " " << ft.total_events << " " << ft.data_bytes << " "
+            << format_double(ft.first_event_time_ns) << " " << format_double(ft.last_event_time_ns)
+            << " " << format_hex(ft.data_checksum) << " " << static_cast<int>(ft.write_complete)
+            << " " << f.path << "\n";
+    }
+    for (size_t p = 0; p < partitions.size(); p++) {
+        for (const auto& r : partitions[p].ranges) {
+            out << "range " << p << " " << r.file << " " << r.first_block << " " << r.end_block
+                << " " << r.events << " " << r.bytes << "\n";
+        }
+    }
+    out.flush();
+    if (!out) return set_error(error, "write error on " + path);
+    return true;
+}
+
+bool PartitionPlan::load(const std::string& path, std::string* error) {
+    files.clear();
+    partitions.clear();
+    std::ifstream in(path);
+    if (!in) return set_error(error, "cannot open " + path);
+    if (!check_magic(in, PLAN_MAGIC, path, error)) return false;
+
+    std::string text;
+    size_t line_no = 1;
+    std::getline(in, text);
+    while (std::getline(in, text)) {
+        line_no++;
+        if (text.empty()) continue;
+        std::istringstream line(text);
+        std::string kind;
+        line >> kind;
+        bool ok = false;
+        if (kind == "file") {
+            PlannedFile f;
+            std::string t[10];
+            for (auto& token : t) line >> token;
+            uint64_t has_footer = 0, complete = 0;
+            ok = parse_u64(t[0], f.file_size) && parse_size(t[1], f.blocks) &&
+                 parse_u64(t[2], f.events) && parse_u64(t[3], has_footer) &&
+                 parse_u64(t[4], f.footer.total_events) && parse_u64(t[5], f.footer.data_bytes) &&
+                 parse_double(t[6], f.footer.first_event_time_ns) &&
+                 parse_double(t[7], f.footer.last_event_time_ns) &&
+                 parse_u64(t[8], f.footer.data_checksum, 16) && parse_u64(t[9], complete);
+            f.has_footer = has_footer != 0;
+            f.footer.write_complete = static_cast<uint8_t>(complete);
+            f.path = rest_of_line(line);
+            ok = ok && !f.path.empty();
+            if (ok) files.push_back(f);
+        } else if (kind == "range") {
+            BlockRange r;
+            std::string t[6];
+            for (auto& token : t) line >> token;
+            size_t p = 0;
+            ok = parse_size(t[0], p) && parse_size(t[1], r.file) && parse_size(t[2], r.first_block) &&
+                 parse_size(t[3], r.end_block) && parse_u64(t[4], r.events) &&
+                 parse_u64(t[5], r.bytes) && r.file < files.size() &&
+                 r.first_block < r.end_block && r.end_block <= files[r.file].blocks &&
+                 (p == partitions.size() || p + 1 == partitions.size());  // Grouped, in order
+            if (ok) {
+                if (p == partitions.size()) partitions.emplace_back();
+                partitions[p].ranges.push_back(r);
+            }
+        }
+        if (!ok) return set_error(error, path + ":" + std::to_string(line_no) + ": bad line");
+    }
+    return true;
+}
+
+PartitionPlan plan_partitions(const std::vector<std::string>& paths, const PlanOptions& options,
+                              std::vector<std::string>* errors) {
+    auto report = [&](const std::string& msg) {
+        if (errors) errors->push_back(msg);
+    };
+
+    PartitionPlan plan;
+    std::vector<std::vector<BlockIndexEntry>> blocks;  // Per planned file
+    uint64_t total_bytes = 0;
+    size_t total_blocks = 0;
+    for (const std::string& path : paths) {
+        FileReader reader;
+        if (!reader.open(path)) {
+            report(path + ": " + reader.error());
+            continue;
+        }
+        if (!reader.load_index()) {
+            report(path + ": " + reader.error() + " (planned the blocks before it)");
+        } else if (options.write_index && !reader.index_from_sidecar()) {
+            std::string sidecar = BlockIndex::sidecar_path(path);
+            if (!reader.index().save(sidecar)) report(sidecar + ": cannot write index sidecar");
+        }
+
+        PlannedFile f;
+        f.path = path;
+        f.file_size = reader.file_size();
+        f.blocks = reader.index().size();
+        f.events = reader.index().total_events();
+        f.has_footer = reader.has_footer();
+        if (f.has_footer) f.footer = reader.footer();
+        plan.files.push_back(f);
+        blocks.push_back(reader.index().entries());
+        for (const auto& e : blocks.back()) total_bytes += 4 + static_cast<uint64_t>(e.length);
+        total_blocks += f.blocks;
+    }
+    if (total_blocks == 0) return plan;
+
+    size_t n = options.partitions;
+    if (n == 0) {
+        uint64_t target = std::max<uint64_t>(options.target_bytes, 1);
+        n = static_cast<size_t>((total_bytes + target - 1) / target);
+    }
+    n = std::max<size_t>(1, std::min(n, total_blocks));
+
+    // Cut after the block that reaches the next 1/n of the bytes; blocks
+    // stay in file order, so a partition is a few contiguous ranges. Cut
+    // early when only one block per remaining partition is left, so all n
+    // partitions get blocks.
+    const double share = static_cast<double>(total_bytes) / static_cast<double>(n);
+    Partition current;
+    uint64_t done = 0;
+    size_t left = total_blocks;
+    for (size_t f = 0; f < plan.files.size(); f++) {
+        for (size_t b = 0; b < blocks[f].size(); b++) {
+            if (current.ranges.empty() || current.ranges.back().file != f) {
+                BlockRange r;
+                r.file = f;
+                r.first_block = b;
+                r.end_block = b;
+                current.ranges.push_back(r);
+            }
+            BlockRange& r = current.ranges.back();
+            uint64_t bytes = 4 + static_cast<uint64_t>(blocks[f][b].length);
+            r.end_block = b + 1;
+            r.events += blocks[f][b].num_events;
+            r.bytes += bytes;
+            done += bytes;
+            left--;
+            size_t k = plan.partitions.size();
+            if (k + 1 < n && (static_cast<double>(done) >= share * static_cast<double>(k + 1) ||
+                              left == n - (k + 1))) {
+                plan.partitions.push_back(std::move(current));
+                current = Partition();
+            }
+        }
+    }
+    if (!current.ranges.empty()) plan.partitions.push_back(std::move(current));
+    return plan;
+}
+
+bool PartitionResult::save(const std::string& path, std::string* error) const {
+    std::ofstream out(path);
+    if (!out) return set_error(error, "cannot create " + path);
+    out << RESULT_MAGIC << " " << FORMAT_VERSION << "\n";
+    out << "partition " << partition << "\n";
+    for (const auto& r : ranges) {
+        out << "range " << r.file << " " << r.first_block << " " << r.end_block << " " << r.blocks
+            << " " << r.events << " " << r.waveforms << " " << r.data_bytes << " "
+            << format_double(r.first_ts) << " " << format_double(r.last_ts) << " "
+            << format_hex(r.checksum.state()) << "\n";
+    }
+    if (!this->error.empty()) out << "error " << this->error << "\n";
+    out.flush();
+    if (!out) return set_error(error, "write error on " + path);
+    return true;
+}
+
+bool PartitionResult::load(const std::string& path, std::string* error) {
+    *this = PartitionResult();
+    std::ifstream in(path);
+    if (!in) return set_error(error, "cannot open " + path);
+    if (!check_magic(in, RESULT_MAGIC, path, error)) return false;
+
+    std::string text;
+    size_t line_no = 1;
+    std::getline(in, text);
+    while (std::getline(in, text)) {
+        line_no++;
+        if (text.empty()) continue;
+        std::istringstream line(text);
+        std::string kind;
+        line >> kind;
+        bool ok = false;
+        if (kind == "partition") {
+            std::string t;
+            line >> t;
+            ok = parse_size(t, partition);
+        } else if (kind == "range") {
+            RangeResult r;
+            std::string t[10];
+            for (auto& token : t) line >> token;
+            uint64_t state = 0;
+            ok = parse_size(t[0], r.file) && parse_size(t[1], r.first_block) &&
+                 parse_size(t[2], r.end_block) && parse_size(t[3], r.blocks) &&
+                 parse_u64(t[4], r.events) && parse_u64(t[5], r.waveforms) &&
+                 parse_u64(t[6], r.data_bytes) && parse_double(t[7], r.first_ts) &&
+                 parse_double(t[8], r.last_ts) && parse_u64(t[9], state, 16);
+            r.checksum = BlockChecksum::from_state(state, r.blocks, r.data_bytes);
+            if (ok) ranges.push_back(r);
+        } else if (kind == "error") {
+            this->error = rest_of_line(line);
+            ok = true;
+        }
+        if (!ok) return set_error(error, path + ":" + std::to_string(line_no) + ": bad line");
+    }
+    return true;
+}
+
+bool PartitionReader::open(const PartitionPlan& plan, size_t partition, ReadMode mode) {
+    plan_ = &plan;
+    partition_ = nullptr;
+    mode_ = mode;
+    range_ = 0;
+    reader_.reset();
+    error_.clear();
+    result_ = PartitionResult();
+    result_.partition = partition;
+    if (partition >= plan.partitions.size()) {
+        return fail("no partition " + std::to_string(partition) + " in the plan (" +
+                    std::to_string(plan.partitions.size()) + " partitions)");
+    }
+    partition_ = &plan.partitions[partition];
+    next_index_ = partition_->ranges.empty() ? 0 : partition_->ranges[0].first_block;
+    return true;
+}
+
+bool PartitionReader::fail(const std::string& msg) {
+    error_ = msg;
+    result_.error = msg;
+    return false;
+}
+
+const std::string& PartitionReader::current_path() const {
+    static const std::string none;
+    if (!partition_ || partition_->ranges.empty()) return none;
+    size_t r = std::min(range_, partition_->ranges.size() - 1);
+    return plan_->files[partition_->ranges[r].file].path;
+}
+
+bool PartitionReader::next_block(BlockView& block) {
+    if (!partition_ || !error_.empty()) return false;
+    const std::vector<BlockRange>& ranges = partition_->ranges;
+    while (range_ < ranges.size() && next_index_ >= ranges[range_].end_block) {
+        // Range done: on to the next file (or the next range of this one)
+        range_++;
+        reader_.reset();
+        if (range_ < ranges.size()) next_index_ = ranges[range_].first_block;
+    }
+    if (range_ >= ranges.size()) return false;
+
+    const BlockRange& r = ranges[range_];
+    const PlannedFile& f = plan_->files[r.file];
+    bool ok;
+    if (!reader_) {
+        reader_.reset(new FileReader());
+        if (!reader_->open(f.path, mode_)) return fail(f.path + ": " + reader_->error());
+        if (reader_->file_size() != f.file_size) {
+            return fail(f.path + ": " + std::to_string(reader_->file_size()) + " bytes, planned " +
+                        std::to_string(f.file_size) + " (changed since planning)");
+        }
+        // A file damaged at planning time still has its planned blocks
+        bool indexed = reader_->load_index();
+        if (reader_->index().size() < r.end_block) {
+            return fail(f.path + ": " +
+                        (indexed ? std::to_string(reader_->index().size()) + " blocks, planned " +
+                                       std::to_string(f.blocks)
+                                 : reader_->error()));
+        }
+        reader_->set_metrics(metrics_);
+        RangeResult result;
+        result.file = r.file;
+        result.first_block = r.first_block;
+        result.end_block = r.end_block;
+        result_.ranges.push_back(result);
+        ok = reader_->read_block(r.first_block, block);
+    } else {
+        ok = reader_->next_block(block);
+    }
+    if (!ok) {
+        std::string err = reader_->error().empty() ? "unexpected end of data" : reader_->error();
+        return fail(f.path + ": " + err);
+    }
+    next_index_++;
+
+    RangeResult& result = result_.ranges.back();
+    result.blocks++;
+    result.data_bytes += 4 + static_cast<uint64_t>(block.size);
+    result.checksum.add(block.index, block.data, static_cast<uint32_t>(block.size));
+    return true;
+}
+
+bool PartitionReader::next_batch(BatchHeader& header, std::vector<Event>& events) {
+    BlockView block;
+    if (!next_block(block)) return false;
+    std::string err;
+    if (!FileReader::decode_block(block, header, events, &err, true, metrics_)) {
+        return fail(current_path() + ": " + err);
+    }
+    size_t waveforms = 0;
+    for (const auto& ev : events) waveforms += ev.has_waveform;
+    if (!events.empty()) {
+        tally(result_.ranges.back(), events.size(), waveforms, events.front().timestamp_ns,
+              events.back().timestamp_ns);
+    }
+    return true;
+}
+
+bool PartitionReader::next_columns(BatchHeader& header, EventColumns& cols,
+                                   bool decode_waveforms) {
+    BlockView block;
+    if (!next_block(block)) return false;
+    std::string err;
+    if (!FileReader::decode_block(block, header, cols, &err, decode_waveforms, metrics_)) {
+        return fail(current_path() + ": " + err);
+    }
+    if (!cols.empty()) {
+        tally(result_.ranges.back(), cols.size(), cols.num_waveforms(), cols.timestamp_ns.front(),
+              cols.timestamp_ns.back());
+    }
+    return true;
+}
+
+std::vector<FileSummary> combine_partitions(const PartitionPlan& plan,
+                                            const std::vector<PartitionResult>& results,
+                                            std::vector<std::string>* problems) {
+    auto report = [&](const std::string& msg) {
+        if (problems) problems->push_back(msg);
+    };
+
+    std::vector<FileSummary> files(plan.files.size());
+    std::vector<BlockChecksum> sums(plan.files.size());
+    for (size_t f = 0; f < files.size(); f++) {
+        files[f].path = plan.files[f].path;
+        files[f].has_footer = plan.files[f].has_footer;
+        files[f].footer = plan.files[f].footer;
+    }
+
+    std::vector<const PartitionResult*> by_id(plan.partitions.size(), nullptr);
+    for (const auto& r : results) {
+        if (r.partition >= by_id.size()) {
+            report("result for partition " + std::to_string(r.partition) + " not in the plan");
+        } else if (by_id[r.partition]) {
+            report("partition " + std::to_string(r.partition) + ": more than one result");
+        } else {
+            by_id[r.partition] = &r;
+        }
+    }
+
+    for (size_t p = 0; p < plan.partitions.size(); p++) {
+        const std::vector<BlockRange>& planned = plan.partitions[p].ranges;
+        const PartitionResult* result = by_id[p];
+        std::string name = "partition " + std::to_string(p);
+        if (!result) {
+            report(name + ": no result");
+            continue;
+        }
+        if (!result->error.empty()) {
+            report(name + ": " + result->error);
+            for (const auto& r : planned) {
+                if (files[r.file].error.empty()) files[r.file].error = result->error;
+            }
+        }
+        // A failed worker may stop inside its last range: count what it read
+        bool matches = result->ranges.size() <= planned.size() &&
+                       (!result->error.empty() || result->ranges.size() == planned.size());
+        for (size_t i = 0; matches && i < result->ranges.size(); i++) {
+            const RangeResult& got = result->ranges[i];
+            matches = got.file == planned[i].file && got.first_block == planned[i].first_block &&
+                      got.end_block == planned[i].end_block;
+        }
+        if (!matches) {
+            report(name + ": ranges differ from the plan");
+            continue;
+        }
+        for (const RangeResult& r : result->ranges) {
+            FileSummary& s = files[r.file];
+            s.events += r.events;
+            s.waveforms += r.waveforms;
+            s.blocks += r.blocks;
+            s.data_bytes += r.data_bytes;
+            s.first_ts = std::min(s.first_ts, r.first_ts);
+            s.last_ts = std::max(s.last_ts, r.last_ts);
+            sums[r.file].merge(r.checksum);
+        }
+    }
+
+    for (size_t f = 0; f < files.size(); f++) {
+        FileSummary& s = files[f];
+        s.checksum_checked = sums[f].blocks() == plan.files[f].blocks;
+        if (!s.has_footer) {
+            s.checksum = ChecksumStatus::NoFooter;
+        } else if (!s.checksum_checked) {
+            s.checksum = ChecksumStatus::Incomplete;
+        } else {
+            s.checksum = sums[f].finalize() == s.footer.data_checksum ? ChecksumStatus::Match
+                                                                       : ChecksumStatus::Mismatch;
+        }
+    }
+    return files;
+}
+
+}  // namespace delila
@@ -0,0 +1,526 @@
+// Offline pulse-shape reprocessing of stored waveforms
+
+#include "delila/pulse.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#include "delila/reader.hpp"
+#include "delila/simd.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DELILA_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define DELILA_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace delila {
+
+namespace {
+
+constexpr float NaN = std::numeric_limits<float>::quiet_NaN();
+
+bool set_error(std::string* error, const std::string& msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+std::string lower(std::string s) {
+    for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+bool parse_u32(const std::string& s, uint32_t& out) {
+    if (s.empty() || s[0] == '-') return false;
+    errno = 0;
+    char* end = nullptr;
+    unsigned long v = std::strtoul(s.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || v > UINT32_MAX) return false;
+    out = static_cast<uint32_t>(v);
+    return true;
+}
+
+bool parse_double(const std::string& s, double& out) {
+    if (s.empty()) return false;
+    errno = 0;
+    char* end = nullptr;
+    double v = std::strtod(s.c_str(), &end);
+    if (errno != 0 || *end != '\0' || !std::isfinite(v)) return false;
+    out = v;
+    return true;
+}
+
+// --- Kernels ---------------------------------------------------------------
+//
+// prefix:  out[0] = 0, out[i + 1] = out[i] + x[i] (mod 2^32), n + 1 slots
+// signal:  out[i] = sign * (x[i] - baseline)
+// cfd:     out[i] = fraction * s[i] - s[i - delay], s before the first sample 0
+// peak:    max of s (n > 0)
+// Every level does the same float operations in the same order, so the
+// results do not depend on the level.
+
+void prefix_scalar(const int16_t* x, size_t n, uint32_t* out) {
+    uint32_t sum = 0;
+    out[0] = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += static_cast<uint32_t>(static_cast<int32_t>(x[i]));
+        out[i + 1] = sum;
+    }
+}
+
+void signal_scalar(const int16_t* x, size_t n, float baseline, float sign, float* out) {
+    for (size_t i = 0; i < n; i++) out[i] = sign * (static_cast<float>(x[i]) - baseline);
+}
+
+void cfd_scalar(const float* s, size_t n, size_t delay, float fraction, float* out) {
+    size_t i = 0;
+    for (; i < std::min(delay, n); i++) out[i] = fraction * s[i];
+    for (; i < n; i++) out[i] = fraction * s[i] - s[i - delay];
+}
+
+float peak_scalar(const float* s, size_t n) {
+    float peak = s[0];
+    for (size_t i = 1; i < n; i++) peak = std::max(peak, s[i]);
+    return peak;
+}
+
+#if DELILA_SIMD_X86
+
+__attribute__((target("sse4.1")))
+void prefix_sse41(const int16_t* x, size_t n, uint32_t* out) {
+    __m128i carry = _mm_setzero_si128();  // Running sum in every lane
+    out[0] = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(x + i)));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, carry);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 1), v);
+        carry = _mm_shuffle_epi32(v, 0xff);
+    }
+    uint32_t sum = out[i];
+    for (; i < n; i++) {
+        sum += static_cast<uint32_t>(static_cast<int32_t>(x[i]));
+        out[i + 1] = sum;
+    }
+}
+
+__attribute__((target("sse4.1")))
+void signal_sse41(const int16_t* x, size_t n, float baseline, float sign, float* out) {
+    const __m128 b = _mm_set1_ps(baseline);
+    const __m128 s = _mm_set1_ps(sign);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(x + i)));
+        _mm_storeu_ps(out + i, _mm_mul_ps(s, _mm_sub_ps(_mm_cvtepi32_ps(v), b)));
+    }
+    signal_scalar(x + i, n - i, baseline, sign, out + i);
+}
+
+__attribute__((target("sse4.1")))
+void cfd_sse41(const float* s, size_t n, size_t delay, float fraction, float* out) {
+    const __m128 f = _mm_set1_ps(fraction);
+    size_t i = 0;
+    for (; i < std::min(delay, n); i++) out[i] = fraction * s[i];
+    for (; i + 4 <= n; i += 4) {
+        __m128 now = _mm_mul_ps(f, _mm_loadu_ps(s + i));
+        _mm_storeu_ps(out + i, _mm_sub_ps(now, _mm_loadu_ps(s + i - delay)));
+    }
+    for (; i < n; i++) out[i] = fraction * s[i] - s[i - delay];
+}
+
+__attribute__((target("sse4.1")))
+float peak_sse41(const float* s, size_t n) {
+    if (n < 4) return peak_scalar(s, n);
+    __m128 m = _mm_loadu_ps(s);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) m = _mm_max_ps(m, _mm_loadu_ps(s + i));
+    m = _mm_max_ps(m, _mm_loadu_ps(s + n - 4));  // Tail, overlapping
+    m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(m);
+}
+
+__attribute__((target("avx2")))
+void prefix_avx2(const int16_t* x, size_t n, uint32_t* out) {
+    const __m256i last = _mm256_set1_epi32(7);
+    __m256i carry = _mm256_setzero_si256();
+    out[0] = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)));
+        // Scan within each 128-bit lane, then carry the low lane into the high one
+        v = _mm256_add_epi32(v, _mm256_slli_si256(v, 4));
+        v = _mm256_add_epi32(v, _mm256_slli_si256(v, 8));
+        __m256i low_total = _mm256_shuffle_epi32(v, 0xff);
+        v = _mm256_add_epi32(v, _mm256_permute2x128_si256(low_total, low_total, 0x08));
+        v = _mm256_add_epi32(v, carry);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 1), v);
+        carry = _mm256_permutevar8x32_epi32(v, last);
+    }
+    uint32_t sum = out[i];
+    for (; i < n; i++) {
+        sum += static_cast<uint32_t>(static_cast<int32_t>(x[i]));
+        out[i + 1] = sum;
+    }
+}
+
+__attribute__((target("avx2")))
+void signal_avx2(const int16_t* x, size_t n, float baseline, float sign, float* out) {
+    const __m256 b = _mm256_set1_ps(baseline);
+    const __m256 s = _mm256_set1_ps(sign);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(s, _mm256_sub_ps(_mm256_cvtepi32_ps(v), b)));
+    }
+    signal_scalar(x + i, n - i, baseline, sign, out + i);
+}
+
+__attribute__((target("avx2")))
+void cfd_avx2(const float* s, size_t n, size_t delay, float fraction, float* out) {
+    const __m256 f = _mm256_set1_ps(fraction);
+    size_t i = 0;
+    for (; i < std::min(delay, n); i++) out[i] = fraction * s[i];
+    for (; i + 8 <= n; i += 8) {
+        __m256 now = _mm256_mul_ps(f, _mm256_loadu_ps(s + i));
+        _mm256_storeu_ps(out + i, _mm256_sub_ps(now, _mm256_loadu_ps(s + i - delay)));
+    }
+    for (; i < n; i++) out[i] = fraction * s[i] - s[i - delay];
+}
+
+__attribute__((target("avx2")))
+float peak_avx2(const float* s, size_t n) {
+    if (n < 8) return peak_scalar(s, n);
+    __m256 m = _mm256_loadu_ps(s);
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) m = _mm256_max_ps(m, _mm256_loadu_ps(s + i));
+    m = _mm256_max_ps(m, _mm256_loadu_ps(s + n - 8));
+    __m128 h = _mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1));
+    h = _mm_max_ps(h, _mm_shuffle_ps(h, h, _MM_SHUFFLE(1, 0, 3, 2)));
+    h = _mm_max_ps(h, _mm_shuffle_ps(h, h, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(h);
+}
+
+#endif  // DELILA_SIMD_X86
+
+#if DELILA_SIMD_NEON
+
+void prefix_neon(const int16_t* x, size_t n, uint32_t* out) {
+    const int32x4_t zero = vdupq_n_s32(0);
+    int32x4_t carry = zero;
+    out[0] = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32x4_t v = vmovl_s16(vld1_s16(x + i));
+        v = vaddq_s32(v, vextq_s32(zero, v, 3));
+        v = vaddq_s32(v, vextq_s32(zero, v, 2));
+        v = vaddq_s32(v, carry);
+        vst1q_u32(out + i + 1, vreinterpretq_u32_s32(v));
+        carry = vdupq_laneq_s32(v, 3);
+    }
+    uint32_t sum = out[i];
+    for (; i < n; i++) {
+        sum += static_cast<uint32_t>(static_cast<int32_t>(x[i]));
+        out[i + 1] = sum;
+    }
+}
+
+void signal_neon(const int16_t* x, size_t n, float baseline, float sign, float* out) {
+    const float32x4_t b = vdupq_n_f32(baseline);
+    const float32x4_t s = vdupq_n_f32(sign);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t v = vcvtq_f32_s32(vmovl_s16(vld1_s16(x + i)));
+        vst1q_f32(out + i, vmulq_f32(s, vsubq_f32(v, b)));
+    }
+    signal_scalar(x + i, n - i, baseline, sign, out + i);
+}
+
+void cfd_neon(const float* s, size_t n, size_t delay, float fraction, float* out) {
+    const float32x4_t f = vdupq_n_f32(fraction);
+    size_t i = 0;
+    for (; i < std::min(delay, n); i++) out[i] = fraction * s[i];
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t now = vmulq_f32(f, vld1q_f32(s + i));
+        vst1q_f32(out + i, vsubq_f32(now, vld1q_f32(s + i - delay)));
+    }
+    for (; i < n; i++) out[i] = fraction * s[i] - s[i - delay];
+}
+
+float peak_neon(const float* s, size_t n) {
+    if (n < 4) return peak_scalar(s, n);
+    float32x4_t m = vld1q_f32(s);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) m = vmaxq_f32(m, vld1q_f32(s + i));
+    m = vmaxq_f32(m, vld1q_f32(s + n - 4));
+    return vmaxvq_f32(m);
+}
+
+#endif  // DELILA_SIMD_NEON
+
+struct PulseKernels {
+    void (*prefix)(const int16_t*, size_t, uint32_t*);
+    void (*signal)(const int16_t*, size_t, float, float, float*);
+    void (*cfd)(const float*, size_t, size_t, float, float*);
+    float (*peak)(const float*, size_t);
+};
+
+constexpr PulseKernels SCALAR_KERNELS{prefix_scalar, signal_scalar, cfd_scalar, peak_scalar};
+#if DELILA_SIMD_X86
+constexpr PulseKernels SSE41_KERNELS{prefix_sse41, signal_sse41, cfd_sse41, peak_sse41};
+constexpr PulseKernels AVX2_KERNELS{prefix_avx2, signal_avx2, cfd_avx2, peak_avx2};
+#endif
+#if DELILA_SIMD_NEON
+constexpr PulseKernels NEON_KERNELS{prefix_neon, signal_neon, cfd_neon, peak_neon};
+#endif
+
+// Kernels of the level simd.hpp has picked (or a test / benchmark forced)
+const PulseKernels& kernels() {
+    switch (simd_level()) {
+#if DELILA_SIMD_X86
+        case SimdLevel::AVX2:
+            return AVX2_KERNELS;
+        case SimdLevel::SSE41:
+            return SSE41_KERNELS;
+#endif
+#if DELILA_SIMD_NEON
+        case SimdLevel::NEON:
+            return NEON_KERNELS;
+#endif
+        default:
+            return SCALAR_KERNELS;
+    }
+}
+
+// ns -> samples, rounded to nearest
+size_t to_samples(double ns, double sample_ns) {
+    return static_cast<size_t>(std::llround(std::max(ns, 0.0) / sample_ns));
+}
+
+// Sum of samples [begin, end) from the prefix sums; exact while the window
+// is under 65536 samples
+int64_t window_sum(const uint32_t* prefix, size_t begin, size_t end) {
+    return static_cast<int32_t>(prefix[end] - prefix[begin]);
+}
+
+}  // namespace
+
+bool PsdParameters::negative() const {
+    return lower(polarity).find("neg") != std::string::npos;
+}
+
+bool PsdParameters::set(const std::string& name, const std::string& value, std::string* error) {
+    if (name == "polarity") {
+        std::string p = lower(value);
+        if (p != "positive" && p != "negative" && p != "polarity_positive" &&
+            p != "polarity_negative") {
+            return set_error(error, "Bad polarity: " + value);
+        }
+        polarity = value;
+        return true;
+    }
+    uint32_t* u32 = name == "trigger_threshold" ? &trigger_threshold
+                    : name == "gate_long_ns"     ? &gate_long_ns
+                    : name == "gate_short_ns"    ? &gate_short_ns
+                    : name == "gate_pre_ns"      ? &gate_pre_ns
+                    : name == "cfd_delay_ns"     ? &cfd_delay_ns
+                    : name == "pre_trigger_ns"   ? &pre_trigger_ns
+                    : name == "baseline_samples" ? &baseline_samples
+                                                 : nullptr;
+    if (u32) {
+        if (!parse_u32(value, *u32)) return set_error(error, "Bad " + name + ": " + value);
+        return true;
+    }
+    double* f64 = name == "cfd_fraction" ? &cfd_fraction : name == "sample_ns" ? &sample_ns : nullptr;
+    if (f64) {
+        double v;
+        if (!parse_double(value, v) || v <= 0.0) return set_error(error, "Bad " + name + ": " + value);
+        *f64 = v;
+        return true;
+    }
+    return set_error(error, "Unknown PSD parameter: " + name);
+}
+
+void PulseColumns::resize(size_t n) {
+    baseline.resize(n);
+    amplitude.resize(n);
+    q_long.resize(n);
+    q_short.resize(n);
+    psd.resize(n);
+    cfd_time_ns.resize(n);
+}
+
+void PulseColumns::set(size_t i, const PulseResult& r) {
+    baseline[i] = r.baseline;
+    amplitude[i] = r.amplitude;
+    q_long[i] = r.q_long;
+    q_short[i] = r.q_short;
+    psd[i] = r.psd;
+    cfd_time_ns[i] = r.cfd_time_ns;
+}
+
+PulseProcessor::PulseProcessor(const PsdParameters& params)
+    : params_(params), sign_(params.negative() ? -1.0f : 1.0f) {}
+
+PulseResult PulseProcessor::process(const int16_t* samples, size_t n, uint8_t time_resolution) {
+    PulseResult r;
+    if (n == 0) {
+        r.baseline = r.amplitude = r.q_long = r.q_short = r.psd = NaN;
+        r.cfd_time_ns = NaN;
+        return r;
+    }
+    const PulseKernels& k = kernels();
+    const double dt = params_.sample_ns * static_cast<double>(1u << std::min<uint8_t>(time_resolution, 3));
+
+    // Gates open gate_pre_ns before the trigger (pre_trigger_ns into the
+    // waveform); the baseline is the baseline_samples just before them
+    double gate_ns = static_cast<double>(params_.pre_trigger_ns) - params_.gate_pre_ns;
+    size_t gate = std::min(n, to_samples(gate_ns, dt));
+    size_t long_end = std::min(n, gate + to_samples(params_.gate_long_ns, dt));
+    size_t short_end = std::min(n, gate + to_samples(params_.gate_short_ns, dt));
+    size_t base_end = gate;
+    size_t base_begin = base_end - std::min<size_t>(base_end, params_.baseline_samples);
+    if (base_begin == base_end) {  // Gates at the first sample: baseline from the start
+        base_begin = 0;
+        base_end = std::min<size_t>(n, std::max<uint32_t>(params_.baseline_samples, 1));
+    }
+
+    prefix_.resize(n + 1);
+    k.prefix(samples, n, prefix_.data());
+    double baseline = static_cast<double>(window_sum(prefix_.data(), base_begin, base_end)) /
+                      static_cast<double>(base_end - base_begin);
+    double q_long = sign_ * (static_cast<double>(window_sum(prefix_.data(), gate, long_end)) -
+                             baseline * static_cast<double>(long_end - gate));
+    double q_short = sign_ * (static_cast<double>(window_sum(prefix_.data(), gate, short_end)) -
+                              baseline * static_cast<double>(short_end - gate));
+    r.baseline = static_cast<float>(baseline);
+    r.q_long = static_cast<float>(q_long);
+    r.q_short = static_cast<float>(q_short);
+    r.psd = q_long > 0.0 ? static_cast<float>((q_long - q_short) / q_long) : NaN;
+
+    signal_.resize(n);
+    cfd_.resize(n);
+    k.signal(samples, n, r.baseline, sign_, signal_.data());
+    r.amplitude = k.peak(signal_.data(), n);
+
+    // Armed at the first sample over the threshold; the zero crossing is the
+    // one next to it (the CFD signal goes from > 0 to <= 0 on the leading
+    // edge), linearly interpolated
+    r.cfd_time_ns = NaN;
+    float threshold = params_.trigger_threshold > 0 ? static_cast<float>(params_.trigger_threshold)
+                                                    : 0.5f * r.amplitude;
+    if (!(r.amplitude > 0.0f) || r.amplitude < threshold) return r;
+    size_t arm = 0;
+    while (signal_[arm] < threshold) arm++;
+    size_t delay = std::max<size_t>(1, to_samples(params_.cfd_delay_ns, dt));
+    k.cfd(signal_.data(), n, delay, static_cast<float>(params_.cfd_fraction), cfd_.data());
+    const float* c = cfd_.data();
+    size_t hi = arm;
+    if (c[hi] > 0.0f) {
+        while (hi < n && c[hi] > 0.0f) hi++;
+        if (hi == n) return r;
+    } else {
+        while (hi > 0 && c[hi - 1] <= 0.0f) hi--;
+        if (hi == 0) return r;
+    }
+    double lo = static_cast<double>(c[hi - 1]);
+    double frac = lo / (lo - static_cast<double>(c[hi]));
+    r.cfd_time_ns = (static_cast<double>(hi - 1) + frac) * dt;
+    return r;
+}
+
+void PulseProcessor::process(const EventColumns& cols, PulseColumns& out) {
+    out.resize(cols.size());
+    PulseResult none = process(nullptr, 0);
+    for (size_t i = 0; i < cols.size(); i++) {
+        if (!cols.has_waveform(i)) {
+            out.set(i, none);
+            continue;
+        }
+        size_t w = static_cast<size_t>(cols.waveform_index[i]);
+        out.set(i, process(cols.analog_probe1.data(w), cols.analog_probe1.size(w),
+                           cols.time_resolution[w]));
+    }
+}
+
+uint64_t reprocess_pulses(const std::vector<std::string>& paths, const PsdParameters& params,
+                          const PulseSink& sink, unsigned n_workers,
+                          std::vector<std::string>* errors, Metrics* metrics) {
+    if (n_workers == 0) n_workers = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<PulseProcessor> processors(n_workers, PulseProcessor(params));  // One per worker
+    // Blocks in flight: decoded in parallel, then handed to the sink in
+    // order. Slots are reused so their columns keep their capacity.
+    std::vector<PulseBlock> slots(4 * static_cast<size_t>(n_workers));
+    std::vector<char> ok(slots.size());
+    std::mutex error_mutex;
+    auto report = [&](const std::string& path, const std::string& msg) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (errors) errors->push_back(path + ": " + msg);
+    };
+
+    uint64_t events = 0;
+    for (const std::string& path : paths) {
+        FileReader reader;
+        if (!reader.open(path, ReadMode::Mmap)) {
+            report(path, reader.error());
+            continue;
+        }
+        reader.set_metrics(metrics);
+        std::vector<BlockView> blocks;
+        BlockView block;
+        while (reader.next_block(block)) blocks.push_back(block);
+        if (!reader.error().empty()) report(path, reader.error());  // Blocks before the damage
+
+        for (size_t first = 0; first < blocks.size(); first += slots.size()) {
+            size_t count = std::min(slots.size(), blocks.size() - first);
+            std::atomic<size_t> next{0};
+            auto work = [&](unsigned w) {
+                std::string err;
+                for (size_t i = next++; i < count; i = next++) {
+                    PulseBlock& slot = slots[i];
+                    err.clear();
+                    ok[i] = FileReader::decode_block(blocks[first + i], slot.header, slot.cols, &err,
+                                                     true, metrics);
+                    if (!ok[i]) {
+                        report(path, err);
+                        continue;
+                    }
+                    slot.path = &path;
+                    StageTimer timer(metrics, Stage::Fill);
+                    processors[w].process(slot.cols, slot.pulses);
+                }
+            };
+            unsigned n_threads = static_cast<unsigned>(std::min<size_t>(n_workers, count));
+            if (n_threads <= 1) {
+                work(0);
+            } else {
+                std::vector<std::thread> threads;
+                for (unsigned t = 0; t < n_threads; t++) threads.emplace_back(work, t);
+                for (auto& t : threads) t.join();
+            }
+            for (size_t i = 0; i < count; i++) {
+                if (!ok[i]) continue;
+                {
+                    StageTimer timer(metrics, Stage::Fill);
+                    sink(slots[i]);
+                }
+                events += slots[i].cols.size();
+                if (metrics) metrics->add_events_processed(slots[i].cols.size());
+            }
+        }
+    }
+    return events;
+}
+
+}  // namespace delila
@@ -0,0 +1,222 @@
+// Python module "delila": the columnar decoder as NumPy arrays
+//
+// Built when pybind11 is found (DELILA_BUILD_PYTHON). Every array points
+// into the EventColumns the decoder filled; the columns are owned by a
+// capsule that is the arrays' base, so nothing is copied and they live as
+// long as any array of theirs does.
+//
+//   import delila
+//   cols = delila.read(["run0010_0000_data.delila", "run0010_0001_data.delila"],
+//                      filter=delila.Filter().select(0, 3).energy(100, 4000),
+//                      threads=8)
+//   cols["energy"]                       # numpy.uint16, one entry per event
+//   offsets, samples = cols["analog_probe1"]
+//   wf = delila.waveforms(cols)          # awkward: per event, None without waveform
+//
+//   for block in delila.File("run0010_0000_data.delila", waveforms=False):
+//       block["timestamp_ns"], block["source_id"]
+//
+// Decoding (read() on `threads` workers, File.__next__ one block at a
+// time) runs with the GIL released. A File is read by one thread at a time.
+//
+// Waveforms are CSR like ProbeColumn: waveform w of a probe is
+// samples[offsets[w]:offsets[w + 1]], and waveform_index maps an event to
+// its waveform (-1: none). That is awkward-array's IndexedOptionArray over a
+// ListOffsetArray, which is what waveforms() builds, still without a copy.
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "delila/columns.hpp"
+#include "delila/filter.hpp"
+#include "delila/reader.hpp"
+#include "delila/run.hpp"
+
+namespace py = pybind11;
+
+namespace {
+
+const char* const PROBES[] = {"analog_probe1",  "analog_probe2",  "digital_probe1",
+                              "digital_probe2", "digital_probe3", "digital_probe4"};
+
+// 1-D array over `v`, kept alive by `owner`
+template <typename T>
+py::array_t<T> view(const std::vector<T>& v, const py::capsule& owner) {
+    return py::array_t<T>({static_cast<py::ssize_t>(v.size())},
+                          {static_cast<py::ssize_t>(sizeof(T))}, v.data(), owner);
+}
+
+template <typename T>
+py::tuple view(const delila::ProbeColumn<T>& probe, const py::capsule& owner) {
+    return py::make_tuple(view(probe.offsets, owner), view(probe.samples, owner));
+}
+
+// The columns, handed over to a capsule, as a dict of arrays
+py::dict columns_dict(std::unique_ptr<delila::EventColumns> cols) {
+    const delila::EventColumns& c = *cols;
+    py::capsule owner(cols.release(),
+                      [](void* p) { delete static_cast<delila::EventColumns*>(p); });
+    py::dict d;
+    d["module"] = view(c.module, owner);
+    d["channel"] = view(c.channel, owner);
+    d["energy"] = view(c.energy, owner);
+    d["energy_short"] = view(c.energy_short, owner);
+    d["timestamp_ns"] = view(c.timestamp_ns, owner);
+    d["flags"] = view(c.flags, owner);
+    d["waveform_index"] = view(c.waveform_index, owner);
+    d["time_resolution"] = view(c.time_resolution, owner);
+    d["trigger_threshold"] = view(c.trigger_threshold, owner);
+    d["analog_probe1"] = view(c.analog_probe1, owner);
+    d["analog_probe2"] = view(c.analog_probe2, owner);
+    d["digital_probe1"] = view(c.digital_probe1, owner);
+    d["digital_probe2"] = view(c.digital_probe2, owner);
+    d["digital_probe3"] = view(c.digital_probe3, owner);
+    d["digital_probe4"] = view(c.digital_probe4, owner);
+    return d;
+}
+
+py::dict read_files(const std::vector<std::string>& paths, const delila::EventFilter* filter,
+                    unsigned threads, bool waveforms) {
+    auto cols = std::make_unique<delila::EventColumns>();
+    std::vector<std::string> errors;
+    {
+        py::gil_scoped_release release;
+        *cols = delila::read_columns(paths, threads, filter, waveforms, &errors);
+    }
+    for (const auto& e : errors) {
+        if (PyErr_WarnEx(PyExc_RuntimeWarning, e.c_str(), 1) < 0) throw py::error_already_set();
+    }
+    return columns_dict(std::move(cols));
+}
+
+// One probe of read() / File output as an awkward array, one entry per
+// event (None without a waveform); the arrays are wrapped, not copied
+py::object waveforms(const py::dict& cols, const std::string& probe) {
+    py::object ak = py::module_::import("awkward");
+    py::object contents = ak.attr("contents");
+    py::object index = ak.attr("index");
+    py::tuple csr = cols[probe.c_str()].cast<py::tuple>();
+    py::object lists = contents.attr("ListOffsetArray")(index.attr("IndexU32")(csr[0]),
+                                                        contents.attr("NumpyArray")(csr[1]));
+    py::object events =
+        contents.attr("IndexedOptionArray")(index.attr("Index32")(cols["waveform_index"]), lists);
+    return ak.attr("Array")(events);
+}
+
+// Blocks of one file, one dict per block
+class File {
+public:
+    File(const std::string& path, const delila::EventFilter* filter, bool waveforms)
+        : waveforms_(waveforms) {
+        if (!reader_.open(path)) throw std::runtime_error(reader_.error());
+        if (filter) {
+            filter_ = *filter;
+            has_filter_ = true;
+            reader_.load_index(false);  // Sidecar only: prunes blocks
+        }
+    }
+
+    py::dict next() {
+        auto cols = std::make_unique<delila::EventColumns>();
+        delila::BatchHeader header;
+        bool ok;
+        {
+            py::gil_scoped_release release;
+            ok = has_filter_ ? reader_.next_columns(header, *cols, filter_, waveforms_)
+                             : reader_.next_columns(header, *cols, waveforms_);
+        }
+        if (!ok) {
+            if (!reader_.error().empty()) throw std::runtime_error(reader_.error());
+            throw py::stop_iteration();
+        }
+        py::dict d = columns_dict(std::move(cols));
+        d["source_id"] = header.source_id;
+        d["sequence_number"] = header.sequence_number;
+        d["timestamp"] = header.timestamp;
+        return d;
+    }
+
+    void rewind() { reader_.rewind(); }
+    const delila::FileReader& reader() const { return reader_; }
+
+private:
+    delila::FileReader reader_;
+    delila::EventFilter filter_;
+    bool has_filter_ = false;
+    bool waveforms_ = true;
+};
+
+py::dict footer_dict(const delila::FileReader& reader) {
+    const delila::Footer& f = reader.footer();
+    py::dict d;
+    d["data_checksum"] = f.data_checksum;
+    d["total_events"] = f.total_events;
+    d["data_bytes"] = f.data_bytes;
+    d["first_event_time_ns"] = f.first_event_time_ns;
+    d["last_event_time_ns"] = f.last_event_time_ns;
+    d["file_end_time_ns"] = f.file_end_time_ns;
+    d["write_complete"] = f.is_complete();
+    return d;
+}
+
+}  // namespace
+
+PYBIND11_MODULE(delila, m) {
+    m.doc() = "DELILA .delila files as NumPy columns (libdelila)";
+
+    using delila::EventFilter;
+    const auto self = py::return_value_policy::reference_internal;
+    py::class_<EventFilter>(m, "Filter", "Cuts applied while decoding (delila/filter.hpp)")
+        .def(py::init<>())
+        .def("select", &EventFilter::select, py::arg("module"), py::arg("channel") = -1, self,
+             "Accept (module, channel); -1 matches any")
+        .def("energy", &EventFilter::energy, py::arg("min"), py::arg("max"), self)
+        .def("energy_short", &EventFilter::energy_short, py::arg("min"), py::arg("max"), self)
+        .def("flags", &EventFilter::flags, py::arg("set"), py::arg("clear") = 0, self,
+             "Every bit of `set` present and every bit of `clear` absent")
+        .def("time", &EventFilter::time, py::arg("min"), py::arg("max"), self,
+             "timestamp_ns in [min, max)")
+        .def("clear", &EventFilter::clear);
+
+    m.attr("FLAG_PILEUP") = delila::FLAG_PILEUP;
+    m.attr("FLAG_TRIGGER_LOST") = delila::FLAG_TRIGGER_LOST;
+    m.attr("FLAG_OVER_RANGE") = delila::FLAG_OVER_RANGE;
+    m.attr("FLAG_1024_TRIGGER") = delila::FLAG_1024_TRIGGER;
+    m.attr("FLAG_N_LOST_TRIGGER") = delila::FLAG_N_LOST_TRIGGER;
+    m.attr("PROBES") = py::make_tuple(PROBES[0], PROBES[1], PROBES[2], PROBES[3], PROBES[4],
+                                      PROBES[5]);
+
+    m.def("read", &read_files, py::arg("paths"), py::arg("filter") = py::none(),
+          py::arg("threads") = 0, py::arg("waveforms") = true,
+          "Every event of the files, in order, as one dict of arrays. Decoded on "
+          "`threads` workers (0: all cores). Unreadable files and damaged blocks "
+          "are skipped with a RuntimeWarning.");
+    m.def(
+        "read",
+        [](const std::string& path, const EventFilter* filter, unsigned threads, bool wf) {
+            return read_files({path}, filter, threads, wf);
+        },
+        py::arg("path"), py::arg("filter") = py::none(), py::arg("threads") = 0,
+        py::arg("waveforms") = true);
+    m.def("waveforms", &waveforms, py::arg("columns"), py::arg("probe") = "analog_probe1",
+          "One probe as an awkward array with one (optional) waveform per event");
+
+    py::class_<File>(m, "File", "Iterate over the blocks of one file, one dict of arrays each")
+        .def(py::init<const std::string&, const EventFilter*, bool>(), py::arg("path"),
+             py::arg("filter") = py::none(), py::arg("waveforms") = true)
+        .def("__iter__", [](File& f) -> File& { return f; }, self)
+        .def("__next__", &File::next)
+        .def("rewind", &File::rewind)
+        .def_property_readonly("path", [](const File& f) { return f.reader().path(); })
+        .def_property_readonly("blocks_read", [](const File& f) { return f.reader().blocks_read(); })
+        .def_property_readonly("footer", [](const File& f) -> py::object {
+            if (!f.reader().has_footer()) return py::none();
+            return footer_dict(f.reader());
+        });
+}
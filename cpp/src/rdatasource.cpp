@@ -0,0 +1,283 @@
+// RDataFrame data source for .delila files
+
+#include "delila/rdatasource.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <typeinfo>
+
+namespace delila {
+
+namespace {
+
+enum Column {
+    COL_MODULE,
+    COL_CHANNEL,
+    COL_ENERGY,
+    COL_ENERGY_SHORT,
+    COL_TIMESTAMP_NS,
+    COL_FLAGS,
+    COL_HAS_WAVEFORM,
+    COL_ANALOG_PROBE1,  // First waveform column
+    COL_ANALOG_PROBE2,
+    COL_DIGITAL_PROBE1,
+    COL_DIGITAL_PROBE2,
+    COL_DIGITAL_PROBE3,
+    COL_DIGITAL_PROBE4,
+    COL_TIME_RESOLUTION,
+    COL_TRIGGER_THRESHOLD,
+    NUM_COLUMNS,
+};
+
+// The scalar columns are numbered as their FIELD_* bits in columns.hpp
+static_assert((1u << COL_MODULE) == FIELD_MODULE && (1u << COL_CHANNEL) == FIELD_CHANNEL &&
+                  (1u << COL_ENERGY) == FIELD_ENERGY &&
+                  (1u << COL_ENERGY_SHORT) == FIELD_ENERGY_SHORT &&
+                  (1u << COL_TIMESTAMP_NS) == FIELD_TIMESTAMP_NS &&
+                  (1u << COL_FLAGS) == FIELD_FLAGS,
+              "column numbers must match the FIELD_* bits");
+
+const std::vector<std::string> COLUMN_NAMES = {
+    "module",         "channel",        "energy",         "energy_short",
+    "timestamp_ns",   "flags",          "has_waveform",   "analog_probe1",
+    "analog_probe2",  "digital_probe1", "digital_probe2", "digital_probe3",
+    "digital_probe4", "time_resolution", "trigger_threshold",
+};
+
+// Names ROOT resolves to the types below
+const char* const COLUMN_TYPES[NUM_COLUMNS] = {
+    "unsigned char",       "unsigned char",       "unsigned short",      "unsigned short",
+    "double",              "ULong64_t",           "bool",                "std::vector<short>",
+    "std::vector<short>",  "std::vector<unsigned char>", "std::vector<unsigned char>",
+    "std::vector<unsigned char>", "std::vector<unsigned char>", "unsigned char",
+    "unsigned short",
+};
+
+const std::type_info& column_type(int col) {
+    switch (col) {
+        case COL_MODULE:
+        case COL_CHANNEL:
+        case COL_TIME_RESOLUTION:
+            return typeid(unsigned char);
+        case COL_ENERGY:
+        case COL_ENERGY_SHORT:
+        case COL_TRIGGER_THRESHOLD:
+            return typeid(unsigned short);
+        case COL_TIMESTAMP_NS:
+            return typeid(double);
+        case COL_FLAGS:
+            return typeid(ULong64_t);
+        case COL_HAS_WAVEFORM:
+            return typeid(bool);
+        case COL_ANALOG_PROBE1:
+        case COL_ANALOG_PROBE2:
+            return typeid(std::vector<short>);
+        default:
+            return typeid(std::vector<unsigned char>);
+    }
+}
+
+// Blocks per entry range: a few ranges per slot keeps the slots balanced
+constexpr size_t RANGES_PER_SLOT = 4;
+
+}  // namespace
+
+RDelilaDS::RDelilaDS(std::string_view path) {
+    std::string p(path);
+    if (!reader_.open(p, ReadMode::Mmap)) {
+        throw std::runtime_error("RDelilaDS: " + reader_.error());
+    }
+    if (reader_.mode() != ReadMode::Mmap) {
+        throw std::runtime_error("RDelilaDS: cannot map " + p);
+    }
+    // A damaged tail is not fatal: the index covers the readable blocks
+    reader_.load_index();
+
+    const BlockIndex& index = reader_.index();
+    block_first_entry_.resize(index.size() + 1, 0);
+    for (size_t i = 0; i < index.size(); i++) {
+        block_first_entry_[i + 1] = block_first_entry_[i] + index[i].num_events;
+    }
+    SetNSlots(1);
+}
+
+void RDelilaDS::SetNSlots(unsigned int n_slots) {
+    slots_.assign(n_slots, Slot());
+    for (auto& slot : slots_) slot.values.assign(NUM_COLUMNS, nullptr);
+}
+
+const std::vector<std::string>& RDelilaDS::GetColumnNames() const { return COLUMN_NAMES; }
+
+int RDelilaDS::column_index(std::string_view name) const {
+    auto it = std::find(COLUMN_NAMES.begin(), COLUMN_NAMES.end(), name);
+    return it == COLUMN_NAMES.end() ? -1 : static_cast<int>(it - COLUMN_NAMES.begin());
+}
+
+bool RDelilaDS::HasColumn(std::string_view name) const { return column_index(name) >= 0; }
+
+std::string RDelilaDS::GetTypeName(std::string_view name) const {
+    int col = column_index(name);
+    if (col < 0) {
+        throw std::runtime_error("RDelilaDS: no column " + std::string(name));
+    }
+    return COLUMN_TYPES[col];
+}
+
+RDelilaDS::Record_t RDelilaDS::GetColumnReadersImpl(std::string_view name,
+                                                    const std::type_info& type) {
+    int col = column_index(name);
+    if (col < 0) {
+        throw std::runtime_error("RDelilaDS: no column " + std::string(name));
+    }
+    if (type != column_type(col)) {
+        throw std::runtime_error("RDelilaDS: column " + std::string(name) + " has type " +
+                                 COLUMN_TYPES[col]);
+    }
+
+    // Only the columns a query uses get readers: the rest are not stored
+    // (and waveforms not decoded) while the event loop runs
+    used_columns_ |= 1u << col;
+    if (col >= COL_ANALOG_PROBE1) decode_waveforms_ = true;
+
+    // RDF reads through T**: hand out the address of each slot's value pointer
+    Record_t readers;
+    for (auto& slot : slots_) readers.push_back(&slot.values[col]);
+    return readers;
+}
+
+void RDelilaDS::Initialize() {
+    ranges_done_ = false;
+    for (auto& slot : slots_) slot.block = SIZE_MAX;
+}
+
+std::vector<std::pair<ULong64_t, ULong64_t>> RDelilaDS::GetEntryRanges() {
+    std::vector<std::pair<ULong64_t, ULong64_t>> ranges;
+    if (ranges_done_) return ranges;
+    ranges_done_ = true;
+
+    // Ranges end on block boundaries so each block is decoded by one slot
+    const size_t n_blocks = block_first_entry_.size() - 1;
+    const size_t target = std::max<size_t>(1, slots_.size() * RANGES_PER_SLOT);
+    const size_t per_range = std::max<size_t>(1, (n_blocks + target - 1) / target);
+    for (size_t b = 0; b < n_blocks; b += per_range) {
+        size_t e = std::min(b + per_range, n_blocks);
+        if (block_first_entry_[e] > block_first_entry_[b]) {
+            ranges.emplace_back(block_first_entry_[b], block_first_entry_[e]);
+        }
+    }
+    return ranges;
+}
+
+void RDelilaDS::load_block(Slot& slot, size_t block) {
+    slot.block = block;
+    slot.first_entry = block_first_entry_[block];
+    if (used_columns_ == 0) {
+        // Count() and friends: the index has the entries, nothing to decode
+        slot.end_entry = block_first_entry_[block + 1];
+        return;
+    }
+
+    BlockView view;
+    std::string err;
+    // The columnar decoder cannot tell a skipped waveform from none, so
+    // has_waveform without any waveform column goes through Event, which
+    // keeps the flag while skipping the samples
+    slot.events_layout = !decode_waveforms_ && (used_columns_ & (1u << COL_HAS_WAVEFORM));
+    bool ok = reader_.view_block(block, view) &&
+              (slot.events_layout
+                   ? FileReader::decode_block(view, slot.header, slot.events, &err, false)
+                   : FileReader::decode_block(view, slot.header, slot.cols, &err,
+                                              decode_waveforms_, nullptr,
+                                              used_columns_ & ALL_FIELDS));
+    if (!ok) {
+        throw std::runtime_error("RDelilaDS: " +
+                                 (err.empty() ? "cannot read block " + std::to_string(block) : err));
+    }
+    slot.end_entry =
+        block_first_entry_[block] + (slot.events_layout ? slot.events.size() : slot.cols.size());
+}
+
+void RDelilaDS::set_waveform(Slot& slot, size_t i) {
+    const EventColumns& c = slot.cols;
+    Waveform& wf = slot.waveform;
+    int32_t w = c.waveform_index[i];
+    if (w == NO_WAVEFORM) {
+        wf.clear();
+        return;
+    }
+    size_t k = static_cast<size_t>(w);
+    // Only the probes a query reads are copied out of the block's columns
+    auto copy = [&](int col, const auto& probe, auto& out) {
+        if (used_columns_ & (1u << col)) out.assign(probe.data(k), probe.data(k) + probe.size(k));
+    };
+    copy(COL_ANALOG_PROBE1, c.analog_probe1, wf.analog_probe1);
+    copy(COL_ANALOG_PROBE2, c.analog_probe2, wf.analog_probe2);
+    copy(COL_DIGITAL_PROBE1, c.digital_probe1, wf.digital_probe1);
+    copy(COL_DIGITAL_PROBE2, c.digital_probe2, wf.digital_probe2);
+    copy(COL_DIGITAL_PROBE3, c.digital_probe3, wf.digital_probe3);
+    copy(COL_DIGITAL_PROBE4, c.digital_probe4, wf.digital_probe4);
+    wf.time_resolution = c.time_resolution[k];
+    wf.trigger_threshold = c.trigger_threshold[k];
+}
+
+bool RDelilaDS::SetEntry(unsigned int slot_id, ULong64_t entry) {
+    Slot& slot = slots_[slot_id];
+    if (slot.block == SIZE_MAX || entry < slot.first_entry || entry >= slot.end_entry) {
+        // Last block whose first entry is <= entry (skips empty blocks)
+        size_t block = static_cast<size_t>(
+            std::upper_bound(block_first_entry_.begin(), block_first_entry_.end(), entry) -
+            block_first_entry_.begin() - 1);
+        load_block(slot, block);
+    }
+
+    if (used_columns_ == 0) return true;
+
+    std::vector<const void*>& v = slot.values;
+    const size_t i = entry - slot.first_entry;
+    if (slot.events_layout) {
+        const Event& ev = slot.events[i];
+        slot.flags = ev.flags;
+        slot.has_waveform = ev.has_waveform;
+        v[COL_MODULE] = &ev.module;
+        v[COL_CHANNEL] = &ev.channel;
+        v[COL_ENERGY] = &ev.energy;
+        v[COL_ENERGY_SHORT] = &ev.energy_short;
+        v[COL_TIMESTAMP_NS] = &ev.timestamp_ns;
+        v[COL_FLAGS] = &slot.flags;
+        v[COL_HAS_WAVEFORM] = &slot.has_waveform;
+        return true;
+    }
+
+    // Scalar columns no query reads were not decoded and are empty
+    const EventColumns& c = slot.cols;
+    auto used = [&](int col) { return (used_columns_ & (1u << col)) != 0; };
+    if (used(COL_MODULE)) v[COL_MODULE] = &c.module[i];
+    if (used(COL_CHANNEL)) v[COL_CHANNEL] = &c.channel[i];
+    if (used(COL_ENERGY)) v[COL_ENERGY] = &c.energy[i];
+    if (used(COL_ENERGY_SHORT)) v[COL_ENERGY_SHORT] = &c.energy_short[i];
+    if (used(COL_TIMESTAMP_NS)) v[COL_TIMESTAMP_NS] = &c.timestamp_ns[i];
+    if (used(COL_FLAGS)) slot.flags = c.flags[i];
+    slot.has_waveform = c.has_waveform(i);
+    v[COL_FLAGS] = &slot.flags;
+    v[COL_HAS_WAVEFORM] = &slot.has_waveform;
+    if (!decode_waveforms_) return true;
+
+    set_waveform(slot, i);
+    const Waveform& wf = slot.waveform;
+    v[COL_ANALOG_PROBE1] = &wf.analog_probe1;
+    v[COL_ANALOG_PROBE2] = &wf.analog_probe2;
+    v[COL_DIGITAL_PROBE1] = &wf.digital_probe1;
+    v[COL_DIGITAL_PROBE2] = &wf.digital_probe2;
+    v[COL_DIGITAL_PROBE3] = &wf.digital_probe3;
+    v[COL_DIGITAL_PROBE4] = &wf.digital_probe4;
+    v[COL_TIME_RESOLUTION] = &wf.time_resolution;
+    v[COL_TRIGGER_THRESHOLD] = &wf.trigger_threshold;
+    return true;
+}
+
+ROOT::RDataFrame MakeDelilaDataFrame(std::string_view path) {
+    return ROOT::RDataFrame(std::make_unique<RDelilaDS>(path));
+}
+
+}  // namespace delila
@@ -0,0 +1,215 @@
+// Read-ahead: a background I/O thread reading a file ahead of the decoder
+
+#include "delila/readahead.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+namespace delila {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+// pread until `size` bytes or end of file. Returns the bytes read, -1 on error.
+ssize_t read_fully(int fd, uint8_t* out, size_t size, uint64_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pread(fd, out + done, size - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        done += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(done);
+}
+
+}  // namespace
+
+ReadAhead::ReadAhead(ReadAheadOptions options) : options_(options) {
+    options_.depth = std::max<size_t>(options_.depth, 1);
+    options_.read_size = std::max<size_t>(options_.read_size, 1);
+}
+
+bool ReadAhead::open(const std::string& path, uint64_t begin, uint64_t end) {
+    close();
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        error_ = "Cannot open file: " + path;
+        return false;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    // Allocated once; reused across seeks and reopen
+    buffers_.resize(options_.depth);
+    free_.clear();
+    for (size_t b = 0; b < buffers_.size(); b++) {
+        buffers_[b].resize(options_.read_size);
+        free_.push_back(b);
+    }
+    read_pos_ = begin;
+    ahead_begin_ = begin;
+    end_ = end;
+    stop_ = false;
+    in_flight_ = false;
+    io_error_ = false;
+    io_ = std::thread([this] { io_loop(); });
+    return true;
+}
+
+void ReadAhead::close() {
+    if (io_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        free_cv_.notify_all();
+        io_.join();
+    }
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    filled_.clear();
+    error_.clear();
+    stats_ = ReadAheadStats();
+}
+
+void ReadAhead::set_end(uint64_t end) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        end_ = end;
+    }
+    free_cv_.notify_all();
+}
+
+ReadAheadStats ReadAhead::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void ReadAhead::io_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto has_work = [this] { return !io_error_ && read_pos_ < end_; };
+    auto ready = [&] { return stop_ || (has_work() && !free_.empty()); };
+    for (;;) {
+        if (!ready()) {
+            // Work to do but every buffer is full: the decoder is behind
+            bool ring_full = has_work();
+            Clock::time_point t0 = Clock::now();
+            free_cv_.wait(lock, ready);
+            if (ring_full) {
+                stats_.io_waits++;
+                stats_.io_wait_seconds += seconds_since(t0);
+            }
+        }
+        if (stop_) return;
+
+        Chunk chunk;
+        chunk.buffer = free_.back();
+        free_.pop_back();
+        chunk.offset = read_pos_;
+        chunk.size = static_cast<size_t>(std::min<uint64_t>(options_.read_size, end_ - read_pos_));
+        read_pos_ += chunk.size;
+        in_flight_ = true;
+        uint64_t generation = generation_;
+
+        lock.unlock();
+        ssize_t n = read_fully(fd_, buffers_[chunk.buffer].data(), chunk.size, chunk.offset);
+        lock.lock();
+
+        in_flight_ = false;
+        if (generation != generation_) {
+            // Seeked away meanwhile
+            free_.push_back(chunk.buffer);
+        } else if (n != static_cast<ssize_t>(chunk.size)) {
+            free_.push_back(chunk.buffer);
+            io_error_ = true;
+            error_ = n < 0 ? std::string("Read error: ") + std::strerror(errno)
+                           : "Unexpected end of file at offset " + std::to_string(chunk.offset + n);
+        } else {
+            filled_.push_back(chunk);
+            stats_.reads++;
+            stats_.bytes += chunk.size;
+        }
+        filled_cv_.notify_all();
+    }
+}
+
+void ReadAhead::restart(uint64_t offset) {
+    generation_++;
+    for (const Chunk& c : filled_) free_.push_back(c.buffer);
+    filled_.clear();
+    read_pos_ = offset;
+    ahead_begin_ = offset;
+    io_error_ = false;
+    error_.clear();
+    stats_.restarts++;
+    free_cv_.notify_all();
+}
+
+bool ReadAhead::wait_for_data(std::unique_lock<std::mutex>& lock) {
+    if (!filled_.empty()) return true;
+    auto done = [this] {
+        return !filled_.empty() || io_error_ || (!in_flight_ && read_pos_ >= end_);
+    };
+    if (!done()) {
+        stats_.decoder_waits++;
+        Clock::time_point t0 = Clock::now();
+        filled_cv_.wait(lock, done);
+        stats_.decoder_wait_seconds += seconds_since(t0);
+    }
+    return !filled_.empty();
+}
+
+void ReadAhead::release_front() {
+    ahead_begin_ = filled_.front().end();
+    free_.push_back(filled_.front().buffer);
+    filled_.pop_front();
+    free_cv_.notify_all();
+}
+
+const uint8_t* ReadAhead::fetch(uint64_t offset, size_t len) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (fd_ < 0 || offset + len > end_) return nullptr;
+
+    // Buffers the decoder has moved past go back to the I/O thread
+    while (!filled_.empty() && filled_.front().end() <= offset) release_front();
+    // Not read, being read or next in line: seek
+    if (offset < ahead_begin_ || offset > read_pos_) restart(offset);
+
+    for (;;) {
+        if (!wait_for_data(lock)) return nullptr;
+        if (filled_.front().end() > offset) break;
+        release_front();
+    }
+    const Chunk& first = filled_.front();
+    if (offset + len <= first.end()) {
+        return buffers_[first.buffer].data() + (offset - first.offset);
+    }
+
+    // Spans reads: copy out, handing each fully copied buffer back
+    joined_.resize(len);
+    size_t done = 0;
+    while (done < len) {
+        if (!wait_for_data(lock)) return nullptr;
+        const Chunk& c = filled_.front();
+        uint64_t at = offset + done;
+        size_t n = static_cast<size_t>(std::min<uint64_t>(len - done, c.end() - at));
+        std::memcpy(joined_.data() + done, buffers_[c.buffer].data() + (at - c.offset), n);
+        done += n;
+        if (c.end() <= offset + len) release_front();
+    }
+    return joined_.data();
+}
+
+}  // namespace delila
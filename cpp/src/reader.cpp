@@ -0,0 +1,830 @@
+// Sequential block reader for .delila files
+
+#include "delila/reader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#include "delila/compression.hpp"
+#include "delila/msgpack.hpp"
+
+namespace delila {
+
+namespace {
+
+// Resync scan: bytes searched per fetch, and bytes of a candidate block
+// checked (length prefix excluded; covers a batch's first four fields)
+constexpr size_t SCAN_WINDOW = 1 << 20;
+constexpr size_t PROBE_BYTES = 48;
+constexpr uint8_t BATCH_ARRAY = 0x94;     // fixarray of 4
+constexpr uint32_t ZSTD_MAGIC = 0xFD2FB528;
+
+// Size of the MessagePack unsigned integer at `p` (0: not one)
+size_t uint_at(const uint8_t* p, size_t avail, uint64_t& value) {
+    if (avail == 0) return 0;
+    if (p[0] < 0x80) {
+        value = p[0];
+        return 1;
+    }
+    size_t n = p[0] == 0xcc ? 1 : p[0] == 0xcd ? 2 : p[0] == 0xce ? 4 : p[0] == 0xcf ? 8 : 0;
+    if (n == 0 || avail < 1 + n) return 0;
+    value = 0;
+    for (size_t i = 1; i <= n; i++) value = (value << 8) | p[i];
+    return 1 + n;
+}
+
+// `p` starts like a batch: [source_id, sequence_number, timestamp, [events]]
+bool plausible_batch(const uint8_t* p, size_t avail, const std::vector<uint32_t>& sources) {
+    if (avail == 0 || p[0] != BATCH_ARRAY) return false;
+    size_t pos = 1;
+    uint64_t value;
+    size_t n = uint_at(p + pos, avail - pos, value);
+    if (n == 0 || value > UINT32_MAX) return false;
+    if (!sources.empty() && std::find(sources.begin(), sources.end(), value) == sources.end()) {
+        return false;
+    }
+    pos += n;
+    for (int field = 0; field < 2; field++) {
+        n = uint_at(p + pos, avail - pos, value);
+        if (n == 0) return false;
+        pos += n;
+    }
+    return pos < avail && ((p[pos] & 0xf0) == 0x90 || p[pos] == 0xdc || p[pos] == 0xdd);
+}
+
+// MessagePack bytes of a block: the view itself, or for v3 the payload after
+// the block header, decompressed into a per-thread buffer so decode_block()
+// stays thread-safe. Valid until the next call on the same thread.
+const uint8_t* msgpack_payload(const BlockView& block, size_t& size, std::string* error,
+                               Metrics* metrics) {
+    if (!block.has_block_header) {
+        size = block.size;
+        return block.data;
+    }
+    StageTimer timer(metrics, Stage::Decompress);
+    thread_local std::vector<uint8_t> scratch;
+    std::string err;
+    const uint8_t* data = block_payload(block.data, block.size, scratch, size, &err);
+    if (!data && error) *error = err + " in block " + std::to_string(block.index);
+    return data;
+}
+
+// Parse time since parse_start (less the waveforms in it) and the block's
+// counters into `metrics`; passes `ok` through
+bool count_block(Metrics* metrics, const MsgPackParser& parser, uint64_t parse_start, bool ok,
+                 size_t events, size_t waveform_samples) {
+    if (!metrics) return ok;
+    uint64_t elapsed = monotonic_ns() - parse_start;
+    uint64_t waveform = std::min(parser.waveform_ns(), elapsed);
+    metrics->add_time(Stage::Parse, elapsed - waveform);
+    metrics->add_time(Stage::Waveform, waveform);
+    if (!ok) {
+        metrics->inc_dropped();
+        return false;
+    }
+    metrics->add_processed();
+    metrics->add_events_received(events);
+    metrics->add_waveform_samples(waveform_samples);
+    return true;
+}
+
+uint64_t parse_start(Metrics* metrics, MsgPackParser& parser) {
+    if (!metrics) return 0;
+    parser.set_waveform_timing(true);
+    return monotonic_ns();
+}
+
+}  // namespace
+
+const char* checksum_status_name(ChecksumStatus status) {
+    switch (status) {
+    case ChecksumStatus::NoFooter: return "no footer";
+    case ChecksumStatus::Incomplete: return "incomplete";
+    case ChecksumStatus::Match: return "match";
+    case ChecksumStatus::Mismatch: return "mismatch";
+    }
+    return "unknown";
+}
+
+DamagedRange skipped_block(const BlockView& block, const std::string& reason) {
+    return {block.offset, 4 + static_cast<uint64_t>(block.size), reason};
+}
+
+std::vector<DamagedRange> merge_damaged(std::vector<DamagedRange> a,
+                                        const std::vector<DamagedRange>& b) {
+    a.insert(a.end(), b.begin(), b.end());
+    std::stable_sort(a.begin(), a.end(), [](const DamagedRange& x, const DamagedRange& y) {
+        return x.offset < y.offset;
+    });
+    return a;
+}
+
+bool FileReader::fail(const std::string& msg) {
+    error_ = msg;
+    return false;
+}
+
+bool FileReader::map_file() {
+    int fd = ::open(path_.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (addr == MAP_FAILED) return false;
+
+    // Blocks are consumed front to back: aggressive read-ahead, early drop
+    ::madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    map_ = static_cast<const uint8_t*>(addr);
+    file_size_ = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+void FileReader::unmap_file() {
+    if (map_) {
+        ::munmap(const_cast<uint8_t*>(map_), static_cast<size_t>(file_size_));
+        map_ = nullptr;
+    }
+}
+
+const uint8_t* FileReader::fetch(uint64_t offset, size_t len) {
+    if (offset + len > file_size_) return nullptr;
+    if (map_) return map_ + offset;
+    if (read_ahead_ && offset >= data_begin_ && offset + len <= data_end_) {
+        return read_ahead_->fetch(offset, len);
+    }
+
+    if (stream_pos_ != offset) {
+        f_.clear();
+        f_.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+        stream_pos_ = offset;
+    }
+    if (buffer_.size() < len) buffer_.resize(len);
+    if (!f_.read(reinterpret_cast<char*>(buffer_.data()), static_cast<std::streamsize>(len))) {
+        // Position unknown after a failed read; force a seek next time
+        stream_pos_ = UINT64_MAX;
+        return nullptr;
+    }
+    stream_pos_ += len;
+    return buffer_.data();
+}
+
+bool FileReader::open(const std::string& path, ReadMode mode) {
+    close();
+    path_ = path;
+
+    mode_ = mode;
+    if (mode_ == ReadMode::Mmap && !map_file()) {
+        mode_ = ReadMode::Stream;
+    }
+    // Header and footer come through the stream in ReadAhead mode too
+    if (mode_ != ReadMode::Mmap) {
+        f_.open(path, std::ios::binary);
+        if (!f_.is_open()) {
+            return fail("Cannot open file: " + path);
+        }
+        f_.seekg(0, std::ios::end);
+        file_size_ = static_cast<uint64_t>(f_.tellg());
+        f_.seekg(0, std::ios::beg);
+        stream_pos_ = 0;
+    }
+
+    // Magic + header length
+    const size_t prefix_size = MAGIC_SIZE + 4;
+    const uint8_t* prefix = fetch(0, prefix_size);
+    if (!prefix) {
+        return fail("File too small for header");
+    }
+    block_headers_ = std::memcmp(prefix, FILE_MAGIC_V3, MAGIC_SIZE) == 0;
+    if (!block_headers_ && std::memcmp(prefix, FILE_MAGIC, MAGIC_SIZE) != 0) {
+        return fail("Invalid file magic. Expected DELILA02 or DELILA03");
+    }
+    header_length_ = load_u32_le(prefix + MAGIC_SIZE);
+    data_begin_ = prefix_size + static_cast<uint64_t>(header_length_);
+    if (data_begin_ > file_size_) {
+        return fail("Header length exceeds file size");
+    }
+
+    // Header metadata (non-fatal: the data blocks are still readable)
+    const uint8_t* header_bytes = fetch(prefix_size, header_length_);
+    if (!header_bytes) {
+        return fail("Failed to read header");
+    }
+    header_valid_ = parse_file_header(header_bytes, header_length_, header_);
+
+    // Footer (missing while the recorder is still writing, or after a crash)
+    if (file_size_ >= data_begin_ + FOOTER_SIZE) {
+        const uint8_t* buf = fetch(file_size_ - FOOTER_SIZE, FOOTER_SIZE);
+        has_footer_ = buf && parse_footer(buf, footer_);
+    }
+    data_end_ = has_footer_ ? file_size_ - FOOTER_SIZE : file_size_;
+
+    if (mode_ == ReadMode::ReadAhead) {
+        read_ahead_.reset(new ReadAhead(read_ahead_options_));
+        if (!read_ahead_->open(path, data_begin_, data_end_)) return fail(read_ahead_->error());
+    }
+
+    is_open_ = true;
+    rewind();
+    return true;
+}
+
+void FileReader::close() {
+    unmap_file();
+    read_ahead_.reset();
+    if (f_.is_open()) f_.close();
+    f_.clear();
+    is_open_ = false;
+    stream_pos_ = 0;
+    path_.clear();
+    error_.clear();
+    file_size_ = 0;
+    header_length_ = 0;
+    header_ = FileHeader();
+    header_valid_ = false;
+    footer_ = Footer();
+    has_footer_ = false;
+    data_begin_ = 0;
+    data_end_ = 0;
+    pos_ = 0;
+    blocks_read_ = 0;
+    bytes_read_ = 0;
+    blocks_skipped_ = 0;
+    damaged_.clear();
+    index_.clear();
+    has_index_ = false;
+    index_from_sidecar_ = false;
+    checksum_.reset();
+}
+
+void FileReader::rewind() {
+    pos_ = data_begin_;
+    blocks_read_ = 0;
+    bytes_read_ = 0;
+    blocks_skipped_ = 0;
+    damaged_.clear();
+    error_.clear();
+    checksum_.reset();
+}
+
+bool FileReader::next_block(BlockView& block) {
+    if (!is_open_ || !error_.empty()) return false;
+    for (;;) {
+        if (pos_ + 4 > data_end_) return false;
+        uint64_t offset = pos_;
+        if (read_block_at(offset, blocks_read_, block)) return true;
+        // No error: the block is still being written (follow mode)
+        if (!resync_ || error_.empty() || !resync_from(offset, error_)) return false;
+    }
+}
+
+bool FileReader::plausible_block(const uint8_t* p, size_t avail, uint64_t offset, uint64_t& end,
+                                 bool truncated_ok) const {
+    if (avail < 4) return false;
+    uint32_t len = load_u32_le(p);
+    if (len == 0 || len > MAX_BLOCK_SIZE) return false;
+    end = offset + 4 + len;
+    if (end > data_end_ && !(truncated_ok && !has_footer_)) return false;
+    p += 4;
+    avail = std::min<size_t>(avail - 4, len);
+    if (!block_headers_) return plausible_batch(p, avail, header_.source_ids);
+
+    BlockHeader bh;
+    if (avail < BLOCK_HEADER_SIZE || p[1] != 0 || p[2] != 0 || p[3] != 0 ||
+        !parse_block_header(p, avail, bh) || bh.raw_size == 0 || bh.raw_size > MAX_BLOCK_SIZE) {
+        return false;
+    }
+    const uint8_t* payload = p + BLOCK_HEADER_SIZE;
+    size_t payload_avail = avail - BLOCK_HEADER_SIZE;
+    switch (bh.compression) {
+    case Compression::None:
+        return bh.raw_size == len - BLOCK_HEADER_SIZE &&
+               plausible_batch(payload, payload_avail, header_.source_ids);
+    case Compression::Zstd:
+        return payload_avail >= 4 && load_u32_le(payload) == ZSTD_MAGIC;
+    case Compression::Lz4:
+        return true;  // No magic: the next block has to vouch for it
+    }
+    return false;
+}
+
+bool FileReader::plausible_at(uint64_t offset, bool check_next) {
+    if (offset + 4 > data_end_) return false;
+    size_t avail = static_cast<size_t>(std::min<uint64_t>(data_end_ - offset, 4 + PROBE_BYTES));
+    const uint8_t* p = fetch(offset, avail);
+    uint64_t end;
+    if (!p || !plausible_block(p, avail, offset, end, !check_next)) return false;
+    return !check_next || end == data_end_ || plausible_at(end, false);
+}
+
+uint64_t FileReader::find_next_block(uint64_t from) {
+    if (!is_open_) return data_end_;
+    StageTimer timer(metrics_, Stage::Read);
+    // Anchor searched for, `anchor` bytes after a candidate's length prefix:
+    // the batch array tag (v2), or the zero bytes of the v3 block header
+    static const uint8_t BLOCK_HEADER_ZEROS[3] = {0, 0, 0};
+    const size_t anchor = block_headers_ ? 5 : 4;
+    std::vector<uint8_t> window;
+    for (uint64_t start = from; start + 4 <= data_end_; start += SCAN_WINDOW) {
+        // Candidates in [start, start + SCAN_WINDOW), with their probe bytes
+        size_t n = static_cast<size_t>(
+            std::min<uint64_t>(SCAN_WINDOW + 4 + PROBE_BYTES, data_end_ - start));
+        const uint8_t* p = fetch(start, n);
+        if (!p) break;
+        if (!map_) {
+            // fetch() reuses its buffer, and checking a candidate's next block fetches
+            window.assign(p, p + n);
+            p = window.data();
+        }
+        size_t last = std::min(SCAN_WINDOW, n);
+        for (size_t c = 0; c < last && c + anchor < n; c++) {
+            const void* hit =
+                block_headers_ ? ::memmem(p + c + anchor, n - c - anchor, BLOCK_HEADER_ZEROS, 3)
+                               : std::memchr(p + c + anchor, BATCH_ARRAY, n - c - anchor);
+            if (!hit) break;
+            c = static_cast<size_t>(static_cast<const uint8_t*>(hit) - p) - anchor;
+            if (c >= last) break;
+            uint64_t end;
+            if (plausible_block(p + c, n - c, start + c, end) &&
+                (end == data_end_ || plausible_at(end, false))) {
+                return start + c;
+            }
+        }
+    }
+    return data_end_;
+}
+
+bool FileReader::resync_from(uint64_t offset, const std::string& reason) {
+    // Where the block's length prefix says the next one starts: if a block
+    // checks out there, only this one is damaged (bad payload, bad codec)
+    uint64_t next = data_end_;
+    const uint8_t* p = offset + 4 <= data_end_ ? fetch(offset, 4) : nullptr;
+    if (p) {
+        uint32_t len = load_u32_le(p);
+        uint64_t end = offset + 4 + len;
+        if (len <= MAX_BLOCK_SIZE && end <= data_end_ &&
+            (end == data_end_ || plausible_at(end, false))) {
+            next = end;
+        } else {
+            next = find_next_block(offset + 1);
+        }
+    }
+    damaged_.push_back({offset, next - offset, reason});
+    error_.clear();
+    pos_ = next;
+    return pos_ + 4 <= data_end_;
+}
+
+bool FileReader::read_block_at(uint64_t offset, size_t index, BlockView& block) {
+    StageTimer timer(metrics_, Stage::Read);
+    // Read block length
+    const uint8_t* len_bytes = fetch(offset, 4);
+    if (!len_bytes) {
+        return fail("Read error at block " + std::to_string(index));
+    }
+    uint32_t block_len = load_u32_le(len_bytes);
+    if (block_len == 0 || block_len > MAX_BLOCK_SIZE) {
+        return fail("Invalid block length " + std::to_string(block_len) +
+                    " at offset " + std::to_string(offset));
+    }
+    if (offset + 4 + block_len > data_end_) {
+        // Rest of the block not written yet
+        if (follow_ && !has_footer_) return false;
+        return fail("Truncated block " + std::to_string(index) +
+                    " at offset " + std::to_string(offset));
+    }
+
+    // Block payload: a view into the mapping, or read into the reused buffer
+    const uint8_t* data = fetch(offset + 4, block_len);
+    if (!data) {
+        return fail("Read error at block " + std::to_string(index));
+    }
+
+    block.data = data;
+    block.size = block_len;
+    block.offset = offset;
+    block.index = index;
+    block.has_block_header = block_headers_;
+    if (verify_checksum_ && checksum_.blocks() == index) {
+        checksum_.add(index, data, block_len);
+    }
+
+    pos_ = offset + 4 + static_cast<uint64_t>(block_len);
+    bytes_read_ += 4 + static_cast<uint64_t>(block_len);
+    blocks_read_ = index + 1;
+    if (metrics_) {
+        metrics_->add_received();
+        metrics_->add_bytes(4 + static_cast<uint64_t>(block_len));
+    }
+    return true;
+}
+
+bool FileReader::next_batch(BatchHeader& header, std::vector<Event>& events) {
+    BlockView block;
+    std::string err;
+    while (next_block(block)) {
+        if (decode_block(block, header, events, &err, true, metrics_)) return true;
+        if (!resync_) return fail(err);
+        if (!resync_from(block.offset, err)) return false;
+    }
+    return false;
+}
+
+bool FileReader::next_columns(BatchHeader& header, EventColumns& cols, bool decode_waveforms) {
+    BlockView block;
+    std::string err;
+    while (next_block(block)) {
+        if (decode_block(block, header, cols, &err, decode_waveforms, metrics_)) return true;
+        if (!resync_) return fail(err);
+        if (!resync_from(block.offset, err)) return false;
+    }
+    return false;
+}
+
+bool FileReader::decode_block(const BlockView& block, BatchHeader& header, EventColumns& cols,
+                              std::string* error, bool decode_waveforms, Metrics* metrics,
+                              uint32_t fields) {
+    cols.clear();
+    size_t size;
+    const uint8_t* data = msgpack_payload(block, size, error, metrics);
+    if (!data) {
+        if (metrics) metrics->inc_dropped();
+        return false;
+    }
+    MsgPackParser parser(data, size);
+    uint64_t start = parse_start(metrics, parser);
+    if (!parser.parse_batch_header(header)) {
+        if (error) *error = "Failed to parse block " + std::to_string(block.index);
+        return count_block(metrics, parser, start, false, 0, 0);
+    }
+    if (!parser.parse_events_columns(header.num_events, cols, decode_waveforms, fields)) {
+        if (error) {
+            *error = "Failed to parse event " + std::to_string(cols.size()) + " in block " +
+                     std::to_string(block.index);
+        }
+        return count_block(metrics, parser, start, false, 0, 0);
+    }
+    return count_block(metrics, parser, start, true, cols.size(),
+                       cols.analog_probe1.samples.size());
+}
+
+bool FileReader::next_columns(BatchHeader& header, EventColumns& cols,
+                              const EventFilter& filter, bool decode_waveforms) {
+    // Block pruning: the index has every block's time range and zone map
+    if (has_index_ && !filter.accepts_all() && is_open_ && error_.empty()) {
+        while (blocks_read_ < index_.size() && index_[blocks_read_].offset == pos_ &&
+               !filter.may_match(index_[blocks_read_])) {
+            pos_ += 4 + index_[blocks_read_].length;
+            blocks_read_++;
+            blocks_skipped_++;
+        }
+    }
+
+    BlockView block;
+    std::string err;
+    while (next_block(block)) {
+        if (decode_block(block, header, cols, filter, &err, decode_waveforms, metrics_)) {
+            return true;
+        }
+        if (!resync_) return fail(err);
+        if (!resync_from(block.offset, err)) return false;
+    }
+    return false;
+}
+
+bool FileReader::decode_block(const BlockView& block, BatchHeader& header, EventColumns& cols,
+                              const EventFilter& filter, std::string* error,
+                              bool decode_waveforms, Metrics* metrics, uint32_t fields) {
+    cols.clear();
+    size_t size;
+    const uint8_t* data = msgpack_payload(block, size, error, metrics);
+    if (!data) {
+        if (metrics) metrics->inc_dropped();
+        return false;
+    }
+    MsgPackParser parser(data, size);
+    uint64_t start = parse_start(metrics, parser);
+    if (!parser.parse_batch_header(header)) {
+        if (error) *error = "Failed to parse block " + std::to_string(block.index);
+        return count_block(metrics, parser, start, false, 0, 0);
+    }
+    if (!parser.parse_events_columns(header.num_events, cols, filter, decode_waveforms, fields)) {
+        // Rejected events are not counted in cols, so report the byte offset
+        if (error) {
+            *error = "Failed to parse event at byte " + std::to_string(parser.position()) +
+                     " of block " + std::to_string(block.index);
+        }
+        return count_block(metrics, parser, start, false, 0, 0);
+    }
+    return count_block(metrics, parser, start, true, cols.size(),
+                       cols.analog_probe1.samples.size());
+}
+
+bool FileReader::decode_block(const BlockView& block, BatchHeader& header,
+                              std::vector<Event>& events, std::string* error,
+                              bool decode_waveforms, Metrics* metrics) {
+    // Decode over the existing elements so waveform vectors keep their capacity
+    size_t size;
+    const uint8_t* data = msgpack_payload(block, size, error, metrics);
+    if (!data) {
+        events.clear();
+        if (metrics) metrics->inc_dropped();
+        return false;
+    }
+    MsgPackParser parser(data, size);
+    uint64_t start = parse_start(metrics, parser);
+    if (!parser.parse_batch_header(header)) {
+        events.clear();
+        if (error) *error = "Failed to parse block " + std::to_string(block.index);
+        return count_block(metrics, parser, start, false, 0, 0);
+    }
+    if (!parser.parse_events(header.num_events, events, decode_waveforms)) {
+        if (error) {
+            *error = "Failed to parse event " + std::to_string(events.size()) + " in block " +
+                     std::to_string(block.index);
+        }
+        return count_block(metrics, parser, start, false, 0, 0);
+    }
+    size_t samples = 0;
+    if (metrics) {
+        for (const auto& ev : events) samples += ev.waveform.analog_probe1.size();
+    }
+    return count_block(metrics, parser, start, true, events.size(), samples);
+}
+
+bool FileReader::build_index() {
+    index_.clear();
+    index_.set_data_file_size(file_size_);
+
+    // Only the scalars are needed; skip waveforms instead of decoding them.
+    // The scan is not the caller's reading: keep it out of the metrics.
+    Metrics* metrics = metrics_;
+    metrics_ = nullptr;
+    struct Restore {
+        Metrics*& slot;
+        Metrics* value;
+        ~Restore() { slot = value; }
+    } restore{metrics_, metrics};
+    rewind();
+    // One block's entry, or false with `err` if it does not parse
+    auto index_block = [this](const BlockView& block, BlockIndexEntry& entry, std::string& err) {
+        size_t size;
+        const uint8_t* data = msgpack_payload(block, size, &err, nullptr);
+        if (!data) return false;
+        MsgPackParser parser(data, size);
+        BatchHeader header;
+        if (!parser.parse_batch_header(header)) {
+            err = "Failed to parse block " + std::to_string(block.index);
+            return false;
+        }
+
+        entry.offset = block.offset;
+        entry.length = static_cast<uint32_t>(block.size);
+        entry.source_id = header.source_id;
+        entry.num_events = static_cast<uint32_t>(header.num_events);
+        for (size_t i = 0; i < header.num_events; i++) {
+            size_t n_fields;
+            uint64_t module, channel, energy, skip_u;
+            double ts;
+            // [module, channel, energy, energy_short, timestamp_ns, flags, waveform?]
+            bool ok = parser.read_array_header(n_fields) && n_fields >= 6 &&
+                      parser.read_uint(module) && parser.read_uint(channel) &&
+                      parser.read_uint(energy) && parser.read_uint(skip_u) &&
+                      parser.read_float64(ts) && parser.read_uint(skip_u);
+            bool has_waveform = false;
+            if (ok && n_fields == 7 && !parser.read_nil()) {
+                ok = parser.skip_waveform();
+                has_waveform = true;
+            }
+            for (size_t f = 7; ok && f < n_fields; f++) ok = parser.skip();
+            if (!ok) {
+                err = "Failed to parse event " + std::to_string(i) + " in block " +
+                      std::to_string(block.index);
+                return false;
+            }
+            if (i == 0 || ts < entry.first_timestamp_ns) entry.first_timestamp_ns = ts;
+            if (i == 0 || ts > entry.last_timestamp_ns) entry.last_timestamp_ns = ts;
+            entry.add_to_zone_map(static_cast<uint8_t>(module), static_cast<uint8_t>(channel),
+                                  static_cast<uint16_t>(energy), has_waveform);
+        }
+        entry.has_zone_map = true;
+        return true;
+    };
+
+    BlockView block;
+    while (next_block(block)) {
+        BlockIndexEntry entry;
+        std::string err;
+        if (index_block(block, entry, err)) {
+            index_.push(entry);
+        } else if (!resync_) {
+            return fail(err);
+        } else if (!resync_from(block.offset, err)) {
+            break;
+        }
+    }
+    return error_.empty();
+}
+
+bool FileReader::load_index(bool scan) {
+    if (!is_open_) return false;
+
+    index_from_sidecar_ = index_.load(BlockIndex::sidecar_path(path_)) &&
+                          index_.data_file_size() == file_size_;
+    if (!index_from_sidecar_ && !scan) {
+        index_.clear();
+        return false;
+    }
+    bool ok = index_from_sidecar_ || build_index();
+    has_index_ = true;
+
+    // Keep the scan error and damaged ranges visible past rewind()
+    std::string err = error_;
+    std::vector<DamagedRange> damaged = std::move(damaged_);
+    rewind();
+    error_ = err;
+    damaged_ = std::move(damaged);
+    return ok;
+}
+
+bool FileReader::read_block(size_t i, BlockView& block) {
+    if (!is_open_) return false;
+    if (!has_index_) load_index();
+    if (i >= index_.size()) return false;
+    error_.clear();
+
+    const BlockIndexEntry& entry = index_[i];
+    if (!read_block_at(entry.offset, i, block)) return false;
+    if (block.size != entry.length) {
+        return fail("Index mismatch at block " + std::to_string(i) + " (stale index?)");
+    }
+    return true;
+}
+
+bool FileReader::view_block(size_t i, BlockView& block) const {
+    if (!map_ || !has_index_ || i >= index_.size()) return false;
+
+    const BlockIndexEntry& entry = index_[i];
+    if (entry.offset + 4 + entry.length > data_end_ ||
+        load_u32_le(map_ + entry.offset) != entry.length) {
+        return false;
+    }
+    block.data = map_ + entry.offset + 4;
+    block.size = entry.length;
+    block.offset = entry.offset;
+    block.index = i;
+    block.has_block_header = block_headers_;
+    return true;
+}
+
+bool FileReader::seek_to_time(double t_ns) {
+    if (!is_open_) return false;
+    if (!has_index_) load_index();
+    error_.clear();
+
+    size_t i = index_.lower_bound(t_ns);
+    if (i >= index_.size()) {
+        pos_ = data_end_;
+        blocks_read_ = index_.size();
+        return false;
+    }
+    pos_ = index_[i].offset;
+    blocks_read_ = i;
+    return true;
+}
+
+bool FileReader::refresh() {
+    if (!is_open_ || has_footer_) return false;
+
+    struct stat st;
+    if (::stat(path_.c_str(), &st) != 0) return fail("Cannot stat file: " + path_);
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    if (size < file_size_) return fail("File shrank while following: " + path_);
+    if (size == file_size_) return false;
+
+    if (map_) {
+        unmap_file();
+        if (!map_file()) {
+            // Keep following through the stream path
+            mode_ = ReadMode::Stream;
+            f_.open(path_, std::ios::binary);
+            if (!f_.is_open()) return fail("Cannot reopen file: " + path_);
+        }
+    }
+    if (!map_) {
+        f_.clear();
+        stream_pos_ = UINT64_MAX;
+        file_size_ = size;
+    }
+
+    // A footer only counts if it closes exactly the data written before it
+    if (file_size_ >= data_begin_ + FOOTER_SIZE) {
+        const uint8_t* buf = fetch(file_size_ - FOOTER_SIZE, FOOTER_SIZE);
+        Footer footer;
+        if (buf && parse_footer(buf, footer) &&
+            footer.data_bytes == file_size_ - FOOTER_SIZE - data_begin_) {
+            footer_ = footer;
+            has_footer_ = true;
+        }
+    }
+    data_end_ = has_footer_ ? file_size_ - FOOTER_SIZE : file_size_;
+    if (read_ahead_) read_ahead_->set_end(data_end_);
+
+    index_.clear();
+    has_index_ = false;
+    index_from_sidecar_ = false;
+    return true;
+}
+
+ChecksumStatus FileReader::check_checksum(const BlockChecksum& sum) const {
+    if (!has_footer_) return ChecksumStatus::NoFooter;
+    if (sum.bytes() != data_end_ - data_begin_) return ChecksumStatus::Incomplete;
+    return sum.finalize() == footer_.data_checksum ? ChecksumStatus::Match
+                                                   : ChecksumStatus::Mismatch;
+}
+
+ChecksumStatus FileReader::verify_checksum(unsigned n_threads) {
+    if (!is_open_) return ChecksumStatus::NoFooter;
+    if (!has_footer_) return ChecksumStatus::NoFooter;
+
+    BlockChecksum total;
+    // Block slices (offset, length) from the sidecar if there is a valid
+    // one, else from the length prefixes alone: no MessagePack parsing
+    std::vector<std::pair<uint64_t, uint32_t>> slices;
+    bool walked = false;
+    if (map_) {
+        if (has_index_ || load_index(false)) {
+            slices.reserve(index_.size());
+            for (size_t i = 0; i < index_.size(); i++) {
+                slices.emplace_back(index_[i].offset, index_[i].length);
+            }
+        } else {
+            for (uint64_t pos = data_begin_; pos + 4 <= data_end_;) {
+                uint32_t len = load_u32_le(map_ + pos);
+                if (len > MAX_BLOCK_SIZE || pos + 4 + len > data_end_) {
+                    slices.clear();  // Damaged framing: the sequential pass reports it
+                    break;
+                }
+                slices.emplace_back(pos, len);
+                pos += 4 + len;
+            }
+        }
+        walked = !slices.empty();
+    }
+    if (walked) {
+        // Contiguous slices, one per thread: each walks the mapping in order
+        if (n_threads == 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+        size_t n = slices.size();
+        n_threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(n_threads, n)));
+        std::vector<BlockChecksum> sums(n_threads);
+        std::atomic<bool> bad{false};
+        auto hash_slice = [&](unsigned t) {
+            size_t begin = n * t / n_threads;
+            size_t end = n * (t + 1) / n_threads;
+            for (size_t i = begin; i < end; i++) {
+                uint64_t offset = slices[i].first;
+                uint32_t len = slices[i].second;
+                if (offset + 4 + len > data_end_ || load_u32_le(map_ + offset) != len) {
+                    bad = true;  // Stale sidecar
+                    return;
+                }
+                sums[t].add(i, map_ + offset + 4, len);
+            }
+        };
+        if (n_threads == 1) {
+            hash_slice(0);
+        } else {
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < n_threads; t++) workers.emplace_back(hash_slice, t);
+            for (auto& w : workers) w.join();
+        }
+        if (bad) return ChecksumStatus::Incomplete;
+        for (const auto& s : sums) total.merge(s);
+    } else {
+        // Stream mode (or damaged framing): one pass
+        rewind();
+        BlockView block;
+        while (next_block(block)) total.add(block.index, block.data, static_cast<uint32_t>(block.size));
+    }
+
+    std::string err = error_;
+    rewind();
+    error_ = err;
+    return check_checksum(total);
+}
+
+}  // namespace delila
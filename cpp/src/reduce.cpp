@@ -0,0 +1,242 @@
+// Waveform reduction at conversion time
+
+#include "delila/reduce.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+
+namespace delila {
+
+namespace {
+
+bool set_error(std::string* error, const std::string& msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+bool parse_u32(const std::string& s, uint32_t& out) {
+    if (s.empty() || s[0] == '-') return false;
+    errno = 0;
+    char* end = nullptr;
+    unsigned long v = std::strtoul(s.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || v > UINT32_MAX) return false;
+    out = static_cast<uint32_t>(v);
+    return true;
+}
+
+// Original samples [begin, end) of `src`, one per `step`: the rounded mean
+// of each group (or its first sample with `pick`)
+void reduce_analog(const std::vector<int16_t>& src, size_t begin, size_t end, uint32_t step,
+                   bool pick, std::vector<int16_t>& dst) {
+    end = std::min(end, src.size());
+    dst.clear();
+    if (begin >= end) return;
+    if (step <= 1) {
+        dst.assign(src.begin() + static_cast<std::ptrdiff_t>(begin),
+                   src.begin() + static_cast<std::ptrdiff_t>(end));
+        return;
+    }
+    dst.reserve((end - begin + step - 1) / step);
+    for (size_t g = begin; g < end; g += step) {
+        if (pick) {
+            dst.push_back(src[g]);
+            continue;
+        }
+        size_t n = std::min<size_t>(step, end - g);
+        int32_t sum = 0;
+        for (size_t i = g; i < g + n; i++) sum += src[i];
+        int32_t half = static_cast<int32_t>(n / 2);
+        int32_t n32 = static_cast<int32_t>(n);
+        dst.push_back(static_cast<int16_t>(sum >= 0 ? (sum + half) / n32 : (sum - half) / n32));
+    }
+}
+
+// Digital: one sample per `step`, set if any sample of the group is
+void reduce_digital(const std::vector<uint8_t>& src, size_t begin, size_t end, uint32_t step,
+                    std::vector<uint8_t>& dst) {
+    end = std::min(end, src.size());
+    dst.clear();
+    if (begin >= end) return;
+    if (step <= 1) {
+        dst.assign(src.begin() + static_cast<std::ptrdiff_t>(begin),
+                   src.begin() + static_cast<std::ptrdiff_t>(end));
+        return;
+    }
+    dst.reserve((end - begin + step - 1) / step);
+    for (size_t g = begin; g < end; g += step) {
+        size_t last = std::min<size_t>(g + step, end);
+        uint8_t v = 0;
+        for (size_t i = g; i < last; i++) v |= src[i];
+        dst.push_back(v);
+    }
+}
+
+void features_of(const std::vector<int16_t>& s, size_t begin, size_t end,
+                 uint32_t baseline_samples, WaveformFeatures& f) {
+    f = WaveformFeatures();
+    if (s.empty()) return;
+    size_t nb = std::max<size_t>(1, std::min<size_t>(baseline_samples, s.size()));
+    double sum = 0.0, sum2 = 0.0;
+    for (size_t i = 0; i < nb; i++) sum += s[i];
+    double baseline = sum / static_cast<double>(nb);
+    for (size_t i = 0; i < nb; i++) sum2 += (s[i] - baseline) * (s[i] - baseline);
+    f.baseline = static_cast<float>(baseline);
+    f.baseline_rms = static_cast<float>(std::sqrt(sum2 / static_cast<double>(nb)));
+
+    double peak = 0.0;
+    size_t peak_at = 0;
+    for (size_t i = 0; i < s.size(); i++) {
+        double d = s[i] - baseline;
+        if (std::fabs(d) > std::fabs(peak)) {
+            peak = d;
+            peak_at = i;
+        }
+    }
+    f.peak = static_cast<float>(peak);
+    f.peak_sample = static_cast<int32_t>(peak_at);
+
+    end = std::min(end, s.size());
+    int64_t total = 0;
+    for (size_t i = begin; i < end; i++) total += s[i];
+    f.integral = begin < end
+                     ? static_cast<float>(static_cast<double>(total) -
+                                          baseline * static_cast<double>(end - begin))
+                     : 0.0f;
+}
+
+}  // namespace
+
+bool ReduceOptions::set(const std::string& name, const std::string& value, std::string* error) {
+    if (name == "crop") {
+        size_t colon = value.find(':');
+        uint32_t pre, post;
+        if (colon == std::string::npos || !parse_u32(value.substr(0, colon), pre) ||
+            !parse_u32(value.substr(colon + 1), post) || pre + uint64_t(post) == 0) {
+            return set_error(error, "Bad crop (PRE:POST samples): " + value);
+        }
+        crop = true;
+        pre_samples = pre;
+        post_samples = post;
+        return true;
+    }
+    if (name == "trigger") {
+        uint32_t k;
+        if (!parse_u32(value, k) || k < 1 || k > 4) {
+            return set_error(error, "Bad trigger (digital probe 1-4): " + value);
+        }
+        trigger_probe = static_cast<int>(k);
+        return true;
+    }
+    if (name == "decimate") {
+        uint32_t n;
+        if (!parse_u32(value, n) || n < 1) return set_error(error, "Bad decimate: " + value);
+        decimate = n;
+        return true;
+    }
+    if (name == "baseline") {
+        uint32_t n;
+        if (!parse_u32(value, n) || n < 1) return set_error(error, "Bad baseline: " + value);
+        baseline_samples = n;
+        return true;
+    }
+    if (name == "digital") {
+        if (value == "keep") {
+            digital = DigitalMode::Keep;
+        } else if (value == "drop") {
+            digital = DigitalMode::DropConstant;
+        } else if (value == "rle") {
+            digital = DigitalMode::RunLength;
+        } else {
+            return set_error(error, "Bad digital (keep / drop / rle): " + value);
+        }
+        return true;
+    }
+    bool* flag = name == "pick" ? &pick : name == "features" ? &features : nullptr;
+    if (flag) {
+        if (!value.empty()) return set_error(error, name + " takes no value: " + value);
+        *flag = true;
+        return true;
+    }
+    return set_error(error, "Unknown waveform reduction option: " + name);
+}
+
+int32_t find_trigger(const Waveform& wf, int probe) {
+    const std::vector<uint8_t>* p = probe == 1   ? &wf.digital_probe1
+                                    : probe == 2 ? &wf.digital_probe2
+                                    : probe == 3 ? &wf.digital_probe3
+                                    : probe == 4 ? &wf.digital_probe4
+                                                 : nullptr;
+    if (!p) return -1;
+    auto it = std::find_if(p->begin(), p->end(), [](uint8_t v) { return v != 0; });
+    return it == p->end() ? -1 : static_cast<int32_t>(it - p->begin());
+}
+
+void reduce_waveform(const Waveform& in, const ReduceOptions& opt, ReducedWaveform& out) {
+    const std::vector<uint8_t>* digital[4] = {&in.digital_probe1, &in.digital_probe2,
+                                              &in.digital_probe3, &in.digital_probe4};
+    std::vector<uint8_t>* kept[4] = {&out.wf.digital_probe1, &out.wf.digital_probe2,
+                                     &out.wf.digital_probe3, &out.wf.digital_probe4};
+    size_t n = std::max(in.analog_probe1.size(), in.analog_probe2.size());
+    for (const auto* d : digital) n = std::max(n, d->size());
+
+    out.wf.time_resolution = in.time_resolution;
+    out.wf.trigger_threshold = in.trigger_threshold;
+    out.n_samples = static_cast<uint32_t>(n);
+    out.trigger_sample = find_trigger(in, opt.trigger_probe);
+    out.decimation = std::max<uint32_t>(1, opt.decimate);
+    out.digital_levels = 0;
+    for (auto& e : out.digital_edges) e.clear();
+
+    // Kept window; waveforms without the marker are kept whole
+    size_t begin = 0, end = n;
+    if (opt.crop && out.trigger_sample >= 0) {
+        size_t t = static_cast<size_t>(out.trigger_sample);
+        begin = t > opt.pre_samples ? t - opt.pre_samples : 0;
+        end = std::min<size_t>(n, t + opt.post_samples);
+    }
+    out.first_sample = static_cast<uint32_t>(begin);
+
+    if (opt.features) {
+        features_of(in.analog_probe1, begin, end, opt.baseline_samples, out.features);
+        out.wf.analog_probe1.clear();
+        out.wf.analog_probe2.clear();
+        for (auto* k : kept) k->clear();
+        return;
+    }
+
+    reduce_analog(in.analog_probe1, begin, end, out.decimation, opt.pick, out.wf.analog_probe1);
+    reduce_analog(in.analog_probe2, begin, end, out.decimation, opt.pick, out.wf.analog_probe2);
+    for (int k = 0; k < 4; k++) {
+        const std::vector<uint8_t>& src = *digital[k];
+        size_t last = std::min(end, src.size());
+        if (opt.digital == DigitalMode::Keep) {
+            reduce_digital(src, begin, end, out.decimation, *kept[k]);
+            continue;
+        }
+        kept[k]->clear();
+        bool level = begin < last && src[begin] != 0;
+        if (level) out.digital_levels |= static_cast<uint8_t>(1u << k);
+        if (opt.digital == DigitalMode::RunLength) {
+            for (size_t i = begin + 1; i < last; i++) {
+                bool v = src[i] != 0;
+                if (v != level) {
+                    out.digital_edges[k].push_back(static_cast<uint32_t>(i - begin));
+                    level = v;
+                }
+            }
+            continue;
+        }
+        // DropConstant: keep the samples of a probe that changes
+        for (size_t i = begin + 1; i < last; i++) {
+            if ((src[i] != 0) != level) {
+                out.digital_levels &= static_cast<uint8_t>(~(1u << k));
+                reduce_digital(src, begin, end, out.decimation, *kept[k]);
+                break;
+            }
+        }
+    }
+}
+
+}  // namespace delila
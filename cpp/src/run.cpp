@@ -0,0 +1,225 @@
+// Multi-file run processing
+
+#include "delila/run.hpp"
+
+#include <cstdio>
+#include <limits>
+#include <mutex>
+
+namespace delila {
+
+namespace {
+
+// Blocks decoded per window by read_columns(), per worker
+constexpr size_t BLOCKS_PER_WORKER = 4;
+
+template <typename T>
+bool fits(const ProbeColumn<T>& to, const ProbeColumn<T>& from) {
+    return to.samples.size() + from.samples.size() <= std::numeric_limits<uint32_t>::max();
+}
+
+// Appending `from` keeps every probe offset within uint32_t
+bool fits(const EventColumns& to, const EventColumns& from) {
+    return fits(to.analog_probe1, from.analog_probe1) &&
+           fits(to.analog_probe2, from.analog_probe2) &&
+           fits(to.digital_probe1, from.digital_probe1) &&
+           fits(to.digital_probe2, from.digital_probe2) &&
+           fits(to.digital_probe3, from.digital_probe3) &&
+           fits(to.digital_probe4, from.digital_probe4);
+}
+
+std::string mismatch(const char* what, double read, double footer) {
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "%s: read %.17g, footer %.17g", what, read, footer);
+    return buf;
+}
+
+}  // namespace
+
+void FileSummary::add_block(const std::vector<Event>& batch) {
+    if (batch.empty()) return;
+    events += batch.size();
+    for (const auto& ev : batch) waveforms += ev.has_waveform;
+    first_ts = std::min(first_ts, batch.front().timestamp_ns);
+    last_ts = std::max(last_ts, batch.back().timestamp_ns);
+}
+
+void FileSummary::add_block(const EventColumns& cols) {
+    if (cols.empty()) return;
+    events += cols.size();
+    for (int32_t w : cols.waveform_index) waveforms += (w != NO_WAVEFORM);
+    first_ts = std::min(first_ts, cols.timestamp_ns.front());
+    last_ts = std::max(last_ts, cols.timestamp_ns.back());
+}
+
+void FileSummary::finish(const FileReader& reader) {
+    blocks = reader.blocks_read();
+    data_bytes = reader.bytes_read();
+    has_footer = reader.has_footer();
+    if (has_footer) footer = reader.footer();
+    checksum_checked = reader.verify_checksum_enabled();
+    if (checksum_checked) checksum = reader.check_checksum();
+    error = reader.error();
+}
+
+std::vector<std::string> FileSummary::check_footer() const {
+    std::vector<std::string> problems;
+    if (!has_footer) {
+        problems.push_back("no valid footer");
+        return problems;
+    }
+    if (events != footer.total_events) {
+        problems.push_back(mismatch("total_events", static_cast<double>(events),
+                                    static_cast<double>(footer.total_events)));
+    }
+    if (data_bytes != footer.data_bytes) {
+        problems.push_back(mismatch("data_bytes", static_cast<double>(data_bytes),
+                                    static_cast<double>(footer.data_bytes)));
+    }
+    // An empty file keeps the footer's initial range; nothing to compare
+    if (events > 0) {
+        if (first_ts != footer.first_event_time_ns) {
+            problems.push_back(mismatch("first_event_time_ns", first_ts, footer.first_event_time_ns));
+        }
+        if (last_ts != footer.last_event_time_ns) {
+            problems.push_back(mismatch("last_event_time_ns", last_ts, footer.last_event_time_ns));
+        }
+    }
+    // A partial read already shows up as a data_bytes mismatch
+    if (checksum_checked && checksum == ChecksumStatus::Mismatch) {
+        problems.push_back("data_checksum mismatch");
+    }
+    if (!footer.is_complete()) problems.push_back("footer not marked write_complete");
+    return problems;
+}
+
+void RunSummary::add(const FileSummary& file) {
+    files++;
+    if (!file.error.empty()) files_with_errors++;
+    if (!file.check_footer().empty()) files_failing_footer++;
+    events += file.events;
+    waveforms += file.waveforms;
+    blocks += file.blocks;
+    data_bytes += file.data_bytes;
+    first_ts = std::min(first_ts, file.first_ts);
+    last_ts = std::max(last_ts, file.last_ts);
+}
+
+RunSummary RunSummary::of(const std::vector<FileSummary>& files) {
+    RunSummary run;
+    for (const auto& f : files) run.add(f);
+    return run;
+}
+
+std::vector<FileSummary> summarize_files(const std::vector<std::string>& paths, unsigned n_workers,
+                                         ReadMode mode, bool verify_checksum) {
+    std::vector<FileSummary> out(paths.size());
+    for_each_parallel(paths.size(), n_workers, [&](size_t i) {
+        FileSummary& summary = out[i];
+        summary.path = paths[i];
+
+        FileReader reader;
+        if (!reader.open(paths[i], mode)) {
+            summary.error = reader.error();
+            return;
+        }
+        reader.set_verify_checksum(verify_checksum);
+        BlockView block;
+        BatchHeader header;
+        std::vector<Event> events;
+        while (reader.next_block(block)) {
+            std::string err;
+            if (!FileReader::decode_block(block, header, events, &err, false)) {
+                summary.finish(reader);
+                summary.error = err;
+                return;
+            }
+            summary.add_block(events);
+        }
+        summary.finish(reader);
+    });
+    return out;
+}
+
+EventColumns read_columns(const std::vector<std::string>& paths, unsigned n_workers,
+                          const EventFilter* filter, bool decode_waveforms,
+                          std::vector<std::string>* errors, Metrics* metrics) {
+    if (n_workers == 0) n_workers = std::max(1u, std::thread::hardware_concurrency());
+    // Decoded in parallel, then appended in order; slots keep their capacity
+    std::vector<EventColumns> slots(BLOCKS_PER_WORKER * static_cast<size_t>(n_workers));
+    std::vector<char> ok(slots.size());
+    std::mutex error_mutex;
+    auto report = [&](const std::string& path, const std::string& msg) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (errors) errors->push_back(path + ": " + msg);
+    };
+
+    EventColumns out;
+    for (const std::string& path : paths) {
+        FileReader reader;
+        if (!reader.open(path, ReadMode::Mmap)) {
+            report(path, reader.error());
+            continue;
+        }
+        reader.set_metrics(metrics);
+        // As in fill_histograms(): views into the mapping, pruned by a
+        // sidecar index for a filter
+        std::vector<BlockView> blocks;
+        BlockView block;
+        if (filter && reader.load_index(false)) {
+            const BlockIndex& index = reader.index();
+            for (size_t i = 0; i < index.size(); i++) {
+                if (filter->may_match(index[i]) && reader.view_block(i, block)) {
+                    blocks.push_back(block);
+                    if (metrics) {
+                        metrics->add_received();
+                        metrics->add_bytes(4 + static_cast<uint64_t>(block.size));
+                    }
+                }
+            }
+        } else {
+            while (reader.next_block(block)) blocks.push_back(block);
+            if (!reader.error().empty()) report(path, reader.error());  // Blocks before the damage
+        }
+
+        for (size_t first = 0; first < blocks.size(); first += slots.size()) {
+            size_t count = std::min(slots.size(), blocks.size() - first);
+            std::atomic<size_t> next{0};
+            auto work = [&] {
+                BatchHeader header;
+                std::string err;
+                for (size_t i = next++; i < count; i = next++) {
+                    err.clear();
+                    ok[i] = filter ? FileReader::decode_block(blocks[first + i], header, slots[i],
+                                                              *filter, &err, decode_waveforms,
+                                                              metrics)
+                                   : FileReader::decode_block(blocks[first + i], header, slots[i],
+                                                              &err, decode_waveforms, metrics);
+                    if (!ok[i]) report(path, err);
+                }
+            };
+            unsigned n_threads = static_cast<unsigned>(std::min<size_t>(n_workers, count));
+            if (n_threads <= 1) {
+                work();
+            } else {
+                std::vector<std::thread> threads;
+                for (unsigned t = 0; t < n_threads; t++) threads.emplace_back(work);
+                for (auto& t : threads) t.join();
+            }
+            StageTimer timer(metrics, Stage::Fill);
+            for (size_t i = 0; i < count; i++) {
+                if (!ok[i]) continue;
+                if (!fits(out, slots[i])) {
+                    report(path, "block " + std::to_string(blocks[first + i].index) +
+                                     ": waveform samples past 2^32, skipped");
+                    continue;
+                }
+                out.append(slots[i], 0, slots[i].size());
+                if (metrics) metrics->add_events_processed(slots[i].size());
+            }
+        }
+    }
+    return out;
+}
+
+}  // namespace delila
@@ -0,0 +1,316 @@
+// SIMD kernels for waveform sample arrays
+
+#include "delila/simd.hpp"
+
+#include <atomic>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DELILA_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define DELILA_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace delila {
+
+namespace {
+
+// --- Scalar (also the tail of every vector kernel) -----------------------
+
+size_t fixint_scalar(const uint8_t* in, size_t n, int16_t* out) {
+    size_t i = 0;
+    for (; i < n; i++) {
+        // Positive (0x00-0x7f) and negative (0xe0-0xff) fixint: int8 >= -32
+        int8_t v = static_cast<int8_t>(in[i]);
+        if (v < -32) break;
+        out[i] = v;
+    }
+    return i;
+}
+
+bool is_int16_tag(uint8_t b) { return b == 0xd1 || b == 0xcd; }
+
+size_t int16_scalar(const uint8_t* in, size_t n, int16_t* out) {
+    size_t i = 0;
+    for (; i < n; i++) {
+        const uint8_t* p = in + 3 * i;
+        if (!is_int16_tag(p[0])) break;
+        out[i] = static_cast<int16_t>((p[1] << 8) | p[2]);
+    }
+    return i;
+}
+
+// Skip kernels: run length only, nothing stored (rejected waveforms)
+size_t skip_fixint_scalar(const uint8_t* in, size_t n) {
+    size_t i = 0;
+    while (i < n && static_cast<int8_t>(in[i]) >= -32) i++;
+    return i;
+}
+
+size_t skip_int16_scalar(const uint8_t* in, size_t n) {
+    size_t i = 0;
+    while (i < n && is_int16_tag(in[3 * i])) i++;
+    return i;
+}
+
+#if DELILA_SIMD_X86
+
+// First zero bit of a lane mask
+inline size_t first_clear(uint32_t mask) { return static_cast<size_t>(__builtin_ctz(~mask)); }
+
+__attribute__((target("sse4.1")))
+size_t fixint_sse41(const uint8_t* in, size_t n, int16_t* out) {
+    const __m128i limit = _mm_set1_epi8(-33);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(v, limit)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_cvtepi8_epi16(v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_cvtepi8_epi16(_mm_srli_si128(v, 8)));
+        if (mask != 0xffff) return i + first_clear(mask);
+    }
+    return i + fixint_scalar(in + i, n - i, out + i);
+}
+
+// Eight 3-byte records (24 bytes) per step, from two overlapping loads:
+// records 0-4 from bytes 0-15, records 5-7 from bytes 8-23
+__attribute__((target("sse4.1")))
+size_t int16_sse41(const uint8_t* in, size_t n, int16_t* out) {
+    const __m128i tags_a = _mm_setr_epi8(0, 3, 6, 9, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i tags_b = _mm_setr_epi8(-1, -1, -1, -1, -1, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+    // Big-endian payload bytes swapped into little-endian lanes
+    const __m128i vals_a = _mm_setr_epi8(2, 1, 5, 4, 8, 7, 11, 10, 14, 13, -1, -1, -1, -1, -1, -1);
+    const __m128i vals_b = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 9, 8, 12, 11, 15, 14);
+    const __m128i int16_tag = _mm_set1_epi8(static_cast<char>(0xd1));
+    const __m128i uint16_tag = _mm_set1_epi8(static_cast<char>(0xcd));
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const uint8_t* p = in + 3 * i;
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8));
+        __m128i tags = _mm_or_si128(_mm_shuffle_epi8(a, tags_a), _mm_shuffle_epi8(b, tags_b));
+        __m128i ok = _mm_or_si128(_mm_cmpeq_epi8(tags, int16_tag), _mm_cmpeq_epi8(tags, uint16_tag));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(ok)) | 0xff00u;
+        __m128i vals = _mm_or_si128(_mm_shuffle_epi8(a, vals_a), _mm_shuffle_epi8(b, vals_b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), vals);
+        if (mask != 0xffff) return i + first_clear(mask);
+    }
+    return i + int16_scalar(in + 3 * i, n - i, out + i);
+}
+
+__attribute__((target("sse4.1")))
+size_t skip_fixint_sse41(const uint8_t* in, size_t n) {
+    const __m128i limit = _mm_set1_epi8(-33);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(v, limit)));
+        if (mask != 0xffff) return i + first_clear(mask);
+    }
+    return i + skip_fixint_scalar(in + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+size_t skip_int16_sse41(const uint8_t* in, size_t n) {
+    const __m128i tags_a = _mm_setr_epi8(0, 3, 6, 9, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i tags_b = _mm_setr_epi8(-1, -1, -1, -1, -1, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i int16_tag = _mm_set1_epi8(static_cast<char>(0xd1));
+    const __m128i uint16_tag = _mm_set1_epi8(static_cast<char>(0xcd));
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const uint8_t* p = in + 3 * i;
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8));
+        __m128i tags = _mm_or_si128(_mm_shuffle_epi8(a, tags_a), _mm_shuffle_epi8(b, tags_b));
+        __m128i ok = _mm_or_si128(_mm_cmpeq_epi8(tags, int16_tag), _mm_cmpeq_epi8(tags, uint16_tag));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(ok)) | 0xff00u;
+        if (mask != 0xffff) return i + first_clear(mask);
+    }
+    return i + skip_int16_scalar(in + 3 * i, n - i);
+}
+
+__attribute__((target("avx2")))
+size_t skip_fixint_avx2(const uint8_t* in, size_t n) {
+    const __m256i limit = _mm256_set1_epi8(-33);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, limit)));
+        if (mask != 0xffffffffu) return i + first_clear(mask);
+    }
+    return i + skip_fixint_sse41(in + i, n - i);
+}
+
+__attribute__((target("avx2")))
+size_t fixint_avx2(const uint8_t* in, size_t n, int16_t* out) {
+    const __m256i limit = _mm256_set1_epi8(-33);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, limit)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_cvtepi8_epi16(_mm256_castsi256_si128(v)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 16),
+                            _mm256_cvtepi8_epi16(_mm256_extracti128_si256(v, 1)));
+        if (mask != 0xffffffffu) return i + first_clear(mask);
+    }
+    return i + fixint_sse41(in + i, n - i, out + i);
+}
+
+#endif  // DELILA_SIMD_X86
+
+#if DELILA_SIMD_NEON
+
+size_t fixint_neon(const uint8_t* in, size_t n, int16_t* out) {
+    const int8x16_t limit = vdupq_n_s8(-32);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t v = vreinterpretq_s8_u8(vld1q_u8(in + i));
+        if (vminvq_u8(vcgeq_s8(v, limit)) != 0xff) break;
+        vst1q_s16(out + i, vmovl_s8(vget_low_s8(v)));
+        vst1q_s16(out + i + 8, vmovl_s8(vget_high_s8(v)));
+    }
+    return i + fixint_scalar(in + i, n - i, out + i);
+}
+
+// vld3 splits 16 records into tag, high byte and low byte planes
+size_t int16_neon(const uint8_t* in, size_t n, int16_t* out) {
+    const uint8x16_t int16_tag = vdupq_n_u8(0xd1);
+    const uint8x16_t uint16_tag = vdupq_n_u8(0xcd);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x3_t r = vld3q_u8(in + 3 * i);
+        uint8x16_t ok = vorrq_u8(vceqq_u8(r.val[0], int16_tag), vceqq_u8(r.val[0], uint16_tag));
+        if (vminvq_u8(ok) != 0xff) break;
+        uint8x16x2_t le = {{r.val[2], r.val[1]}};
+        vst2q_u8(reinterpret_cast<uint8_t*>(out + i), le);
+    }
+    return i + int16_scalar(in + 3 * i, n - i, out + i);
+}
+
+size_t skip_fixint_neon(const uint8_t* in, size_t n) {
+    const int8x16_t limit = vdupq_n_s8(-32);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t v = vreinterpretq_s8_u8(vld1q_u8(in + i));
+        if (vminvq_u8(vcgeq_s8(v, limit)) != 0xff) break;
+    }
+    return i + skip_fixint_scalar(in + i, n - i);
+}
+
+size_t skip_int16_neon(const uint8_t* in, size_t n) {
+    const uint8x16_t int16_tag = vdupq_n_u8(0xd1);
+    const uint8x16_t uint16_tag = vdupq_n_u8(0xcd);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x3_t r = vld3q_u8(in + 3 * i);
+        uint8x16_t ok = vorrq_u8(vceqq_u8(r.val[0], int16_tag), vceqq_u8(r.val[0], uint16_tag));
+        if (vminvq_u8(ok) != 0xff) break;
+    }
+    return i + skip_int16_scalar(in + 3 * i, n - i);
+}
+
+#endif  // DELILA_SIMD_NEON
+
+struct Kernels {
+    SimdLevel level;
+    size_t (*fixint)(const uint8_t*, size_t, int16_t*);
+    size_t (*int16)(const uint8_t*, size_t, int16_t*);
+    size_t (*skip_fixint)(const uint8_t*, size_t);
+    size_t (*skip_int16)(const uint8_t*, size_t);
+};
+
+constexpr Kernels SCALAR_KERNELS{SimdLevel::Scalar, fixint_scalar, int16_scalar,
+                                 skip_fixint_scalar, skip_int16_scalar};
+#if DELILA_SIMD_X86
+// The 3-byte stride does not split across 256-bit lanes; AVX2 keeps the
+// 128-bit record kernel
+constexpr Kernels SSE41_KERNELS{SimdLevel::SSE41, fixint_sse41, int16_sse41,
+                                skip_fixint_sse41, skip_int16_sse41};
+constexpr Kernels AVX2_KERNELS{SimdLevel::AVX2, fixint_avx2, int16_sse41,
+                               skip_fixint_avx2, skip_int16_sse41};
+#endif
+#if DELILA_SIMD_NEON
+constexpr Kernels NEON_KERNELS{SimdLevel::NEON, fixint_neon, int16_neon,
+                               skip_fixint_neon, skip_int16_neon};
+#endif
+
+const Kernels* kernels_for(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Scalar:
+        return &SCALAR_KERNELS;
+#if DELILA_SIMD_X86
+    case SimdLevel::SSE41:
+        return __builtin_cpu_supports("sse4.1") ? &SSE41_KERNELS : nullptr;
+    case SimdLevel::AVX2:
+        return __builtin_cpu_supports("avx2") ? &AVX2_KERNELS : nullptr;
+#endif
+#if DELILA_SIMD_NEON
+    case SimdLevel::NEON:
+        return &NEON_KERNELS;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+const Kernels* best_kernels() {
+    for (SimdLevel level : {SimdLevel::AVX2, SimdLevel::SSE41, SimdLevel::NEON}) {
+        if (const Kernels* k = kernels_for(level)) return k;
+    }
+    return &SCALAR_KERNELS;
+}
+
+std::atomic<const Kernels*>& active() {
+    static std::atomic<const Kernels*> kernels{best_kernels()};
+    return kernels;
+}
+
+}  // namespace
+
+SimdLevel simd_level() {
+    return active().load(std::memory_order_relaxed)->level;
+}
+
+bool simd_supported(SimdLevel level) {
+    return kernels_for(level) != nullptr;
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::SSE41: return "sse4.1";
+    case SimdLevel::AVX2: return "avx2";
+    case SimdLevel::NEON: return "neon";
+    }
+    return "unknown";
+}
+
+bool set_simd_level(SimdLevel level) {
+    const Kernels* k = kernels_for(level);
+    if (k == nullptr) return false;
+    active().store(k, std::memory_order_relaxed);
+    return true;
+}
+
+size_t decode_fixint_run(const uint8_t* in, size_t n, int16_t* out) {
+    return active().load(std::memory_order_relaxed)->fixint(in, n, out);
+}
+
+size_t decode_int16_run(const uint8_t* in, size_t n, int16_t* out) {
+    return active().load(std::memory_order_relaxed)->int16(in, n, out);
+}
+
+size_t skip_fixint_run(const uint8_t* in, size_t n) {
+    return active().load(std::memory_order_relaxed)->skip_fixint(in, n);
+}
+
+size_t skip_int16_run(const uint8_t* in, size_t n) {
+    return active().load(std::memory_order_relaxed)->skip_int16(in, n);
+}
+
+}  // namespace delila
@@ -0,0 +1,175 @@
+// TTree branch layout of converted .delila files
+
+#include "delila/tree_output.hpp"
+
+#include <TString.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace delila {
+
+namespace {
+
+// Copy a probe into a fixed-size branch buffer, truncating at MAX_BRANCH_SAMPLES
+template <typename T>
+Int_t copy_probe(const std::vector<T>& src, T* dst) {
+    Int_t n = static_cast<Int_t>(std::min(src.size(), static_cast<size_t>(MAX_BRANCH_SAMPLES)));
+    if (n > 0) std::memcpy(dst, src.data(), n * sizeof(T));
+    return n;
+}
+
+}  // namespace
+
+void EventBranches::attach(TTree* scalars, TTree* waveforms, Int_t basket_size,
+                           const ReduceOptions& reduce) {
+    scalars_ = scalars;
+    waveforms_ = waveforms;
+    scalars->Branch("module", &module, "module/b", basket_size);
+    scalars->Branch("channel", &channel, "channel/b", basket_size);
+    scalars->Branch("energy", &energy, "energy/s", basket_size);
+    scalars->Branch("energy_short", &energy_short, "energy_short/s", basket_size);
+    scalars->Branch("timestamp_ns", &timestamp_ns, "timestamp_ns/D", basket_size);
+    scalars->Branch("flags", &flags, "flags/l", basket_size);
+    scalars->Branch("has_waveform", &has_waveform, "has_waveform/O", basket_size);
+    if (waveforms == nullptr) return;
+
+    TTree* t = waveforms;
+    if (reduce.active()) {
+        reduce_ = &reduce;
+        t->Branch("wf_n_samples", &wf_n_samples, "wf_n_samples/i", basket_size);
+        t->Branch("trigger_sample", &trigger_sample, "trigger_sample/I", basket_size);
+    }
+    if (reduce.features) {
+        t->Branch("wf_baseline", &wf_baseline, "wf_baseline/F", basket_size);
+        t->Branch("wf_baseline_rms", &wf_baseline_rms, "wf_baseline_rms/F", basket_size);
+        t->Branch("wf_peak", &wf_peak, "wf_peak/F", basket_size);
+        t->Branch("wf_peak_sample", &wf_peak_sample, "wf_peak_sample/I", basket_size);
+        t->Branch("wf_integral", &wf_integral, "wf_integral/F", basket_size);
+        t->Branch("time_resolution", &time_resolution, "time_resolution/b", basket_size);
+        t->Branch("trigger_threshold", &trigger_threshold, "trigger_threshold/s", basket_size);
+        return;
+    }
+    if (reduce_) {
+        t->Branch("wf_first_sample", &wf_first_sample, "wf_first_sample/i", basket_size);
+        t->Branch("wf_decimation", &wf_decimation, "wf_decimation/i", basket_size);
+    }
+    if (reduce.digital != DigitalMode::Keep) {
+        t->Branch("digital_levels", &digital_levels, "digital_levels/b", basket_size);
+    }
+
+    for (auto* v : {&analog1, &analog2}) v->resize(MAX_BRANCH_SAMPLES);
+    for (auto* v : {&digital1, &digital2, &digital3, &digital4}) v->resize(MAX_BRANCH_SAMPLES);
+
+    // Waveform branches (variable-length arrays)
+    t->Branch("n_analog1", &n_analog1, "n_analog1/I", basket_size);
+    t->Branch("n_analog2", &n_analog2, "n_analog2/I", basket_size);
+    t->Branch("analog1", analog1.data(), "analog1[n_analog1]/S", basket_size);
+    t->Branch("analog2", analog2.data(), "analog2[n_analog2]/S", basket_size);
+    if (reduce.digital == DigitalMode::RunLength) {
+        for (int k = 0; k < 4; k++) {
+            edges[k].resize(MAX_BRANCH_SAMPLES);
+            TString n = TString::Format("n_digital%d_edges", k + 1);
+            TString name = TString::Format("digital%d_edges", k + 1);
+            t->Branch(n, &n_edges[k], n + "/I", basket_size);
+            t->Branch(name, edges[k].data(), name + "[" + n + "]/i", basket_size);
+        }
+    } else {
+        t->Branch("n_digital1", &n_digital1, "n_digital1/I", basket_size);
+        t->Branch("n_digital2", &n_digital2, "n_digital2/I", basket_size);
+        t->Branch("n_digital3", &n_digital3, "n_digital3/I", basket_size);
+        t->Branch("n_digital4", &n_digital4, "n_digital4/I", basket_size);
+        t->Branch("digital1", digital1.data(), "digital1[n_digital1]/b", basket_size);
+        t->Branch("digital2", digital2.data(), "digital2[n_digital2]/b", basket_size);
+        t->Branch("digital3", digital3.data(), "digital3[n_digital3]/b", basket_size);
+        t->Branch("digital4", digital4.data(), "digital4[n_digital4]/b", basket_size);
+    }
+    t->Branch("time_resolution", &time_resolution, "time_resolution/b", basket_size);
+    t->Branch("trigger_threshold", &trigger_threshold, "trigger_threshold/s", basket_size);
+}
+
+void EventBranches::set(const Event& ev) {
+    module = ev.module;
+    channel = ev.channel;
+    energy = ev.energy;
+    energy_short = ev.energy_short;
+    timestamp_ns = ev.timestamp_ns;
+    flags = ev.flags;
+    has_waveform = ev.has_waveform;
+    if (waveforms_ == nullptr) return;
+
+    const Waveform* stored = &ev.waveform;
+    if (reduce_) {
+        reduce_waveform(ev.waveform, *reduce_, reduced_);
+        stored = &reduced_.wf;
+        wf_n_samples = reduced_.n_samples;
+        trigger_sample = reduced_.trigger_sample;
+        wf_first_sample = reduced_.first_sample;
+        wf_decimation = reduced_.decimation;
+        digital_levels = reduced_.digital_levels;
+        if (reduce_->features) {
+            const WaveformFeatures& f = reduced_.features;
+            wf_baseline = f.baseline;
+            wf_baseline_rms = f.baseline_rms;
+            wf_peak = f.peak;
+            wf_peak_sample = f.peak_sample;
+            wf_integral = f.integral;
+            time_resolution = ev.waveform.time_resolution;
+            trigger_threshold = ev.waveform.trigger_threshold;
+            return;
+        }
+        if (reduce_->digital == DigitalMode::RunLength) {
+            for (int k = 0; k < 4; k++) {
+                n_edges[k] = copy_probe(reduced_.digital_edges[k], edges[k].data());
+            }
+        }
+    }
+
+    const Waveform& wf = *stored;
+    n_analog1 = copy_probe(wf.analog_probe1, analog1.data());
+    n_analog2 = copy_probe(wf.analog_probe2, analog2.data());
+    n_digital1 = copy_probe(wf.digital_probe1, digital1.data());
+    n_digital2 = copy_probe(wf.digital_probe2, digital2.data());
+    n_digital3 = copy_probe(wf.digital_probe3, digital3.data());
+    n_digital4 = copy_probe(wf.digital_probe4, digital4.data());
+    time_resolution = wf.time_resolution;
+    trigger_threshold = wf.trigger_threshold;
+}
+
+void OutputTrees::create(TDirectory* dir, const OutputProfile& profile) {
+    events = new TTree("events", "DELILA Event Data");
+    events->SetDirectory(dir);
+    if (profile.waveforms == WaveformLayout::Friend) {
+        waveforms = new TTree("waveforms", "DELILA Waveforms (friend of events)");
+        waveforms->SetDirectory(dir);
+    }
+    if (profile.auto_flush != 0) {
+        events->SetAutoFlush(profile.auto_flush);
+        if (waveforms) waveforms->SetAutoFlush(profile.auto_flush);
+    }
+
+    TTree* wf_tree = profile.waveforms == WaveformLayout::Inline ? events : waveforms;
+    br = std::make_unique<EventBranches>();
+    br->attach(events, wf_tree, profile.basket_size, profile.reduce);
+}
+
+std::unique_ptr<TFile> create_tree_file(const std::string& path, const OutputProfile& profile,
+                                        std::string* error) {
+    std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "RECREATE"));
+    if (!file || file->IsZombie() || !file->IsOpen()) {
+        if (error) *error = "Cannot create output file " + path;
+        return nullptr;
+    }
+    if (profile.compression >= 0) file->SetCompressionSettings(profile.compression);
+    return file;
+}
+
+std::unique_ptr<ROOT::TBufferMerger> create_tree_merger(const std::string& path,
+                                                        const OutputProfile& profile) {
+    if (profile.compression < 0) {
+        return std::make_unique<ROOT::TBufferMerger>(path.c_str(), "RECREATE");
+    }
+    return std::make_unique<ROOT::TBufferMerger>(path.c_str(), "RECREATE", profile.compression);
+}
+
+}  // namespace delila
@@ -0,0 +1,113 @@
+// Output profile of a TTree conversion
+
+#include "delila/tree_profile.hpp"
+
+#include <cstdlib>
+#include <sstream>
+
+namespace delila {
+
+namespace {
+
+// Options handed to ReduceOptions::set()
+const char* const REDUCE_OPTIONS[] = {"crop", "trigger", "decimate", "pick",
+                                      "digital", "features", "baseline"};
+
+bool is_reduce_option(const std::string& key) {
+    for (const char* name : REDUCE_OPTIONS) {
+        if (key == name) return true;
+    }
+    return false;
+}
+
+// ROOT::RCompressionSetting::EAlgorithm numbering
+int compression_algorithm(const std::string& name) {
+    if (name == "zlib") return 1;
+    if (name == "lzma") return 2;
+    if (name == "lz4") return 4;
+    if (name == "zstd") return 5;
+    return -1;
+}
+
+bool set_error(std::string* error, const std::string& msg) {
+    if (error) *error = msg;
+    return false;
+}
+
+}  // namespace
+
+const char* waveform_layout_name(WaveformLayout layout) {
+    switch (layout) {
+    case WaveformLayout::None: return "scalar";
+    case WaveformLayout::Friend: return "friend";
+    default: return "full";
+    }
+}
+
+bool OutputProfile::parse(const std::string& spec, std::string* error) {
+    size_t begin = 0;
+    while (begin <= spec.size()) {
+        size_t end = spec.find(',', begin);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = spec.substr(begin, end - begin);
+        begin = end + 1;
+        if (item.empty()) continue;
+
+        size_t eq = item.find_first_of(":=");
+        std::string key = item.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : item.substr(eq + 1);
+
+        if (key == "full") {
+            waveforms = WaveformLayout::Inline;
+        } else if (key == "scalar") {
+            waveforms = WaveformLayout::None;
+        } else if (key == "friend") {
+            waveforms = WaveformLayout::Friend;
+        } else if (key == "none") {
+            compression = 0;
+        } else if (compression_algorithm(key) > 0) {
+            // Default levels: fast for LZ4 / ZLIB, archive-oriented for ZSTD / LZMA
+            int level = key == "lz4" ? 4 : key == "zstd" ? 5 : key == "lzma" ? 7 : 1;
+            if (!value.empty()) level = std::atoi(value.c_str());
+            if (level < 1 || level > 9) {
+                return set_error(error, "compression level must be 1-9: " + item);
+            }
+            compression = compression_algorithm(key) * 100 + level;
+        } else if (key == "flush" && !value.empty()) {
+            auto_flush = std::atoll(value.c_str());
+        } else if (key == "basket" && std::atoi(value.c_str()) > 0) {
+            basket_size = std::atoi(value.c_str());
+        } else if (is_reduce_option(key)) {
+            if (!reduce.set(key, value, error)) return false;
+        } else {
+            return set_error(error, "unknown output profile option '" + item + "'");
+        }
+    }
+    return true;
+}
+
+std::string OutputProfile::describe() const {
+    std::ostringstream out;
+    out << "Profile: " << waveform_layout_name(waveforms);
+    if (compression >= 0) out << ", compression " << compression;
+    if (auto_flush != 0) out << ", auto-flush " << auto_flush;
+    out << ", basket " << basket_size << " bytes";
+    const ReduceOptions& r = reduce;
+    if (!r.active() || waveforms == WaveformLayout::None) return out.str();
+
+    out << "\nWaveforms:";
+    if (r.features) {
+        out << " features only (baseline over " << r.baseline_samples << " samples)";
+    } else {
+        if (r.decimate > 1) out << " decimate " << r.decimate << (r.pick ? " (pick)" : " (mean)");
+        if (r.digital == DigitalMode::DropConstant) out << " digital drop";
+        if (r.digital == DigitalMode::RunLength) out << " digital rle";
+    }
+    if (r.crop) {
+        out << " crop " << r.pre_samples << ":" << r.post_samples << " around digital"
+            << r.trigger_probe;
+    }
+    return out.str();
+}
+
+}  // namespace delila
@@ -0,0 +1,134 @@
+// Unit tests for arrow.hpp (Parquet / IPC stream export)
+
+#include <gtest/gtest.h>
+
+#include <arrow/array/concatenate.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/reader.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/file_reader.h>
+
+#include "delila/arrow.hpp"
+#include "delila/reader.hpp"
+#include "test_writer.hpp"
+
+using delila::ArrowFormat;
+using delila::ArrowOptions;
+using delila_test::build_file;
+using delila_test::make_event;
+using delila_test::TempFile;
+using delila_test::TestBatch;
+
+namespace {
+
+// Two blocks: waveforms on events 1 and 2 of 5
+std::vector<TestBatch> two_blocks() {
+    return {{0, {make_event(1, 2, 1000, 10.0), make_event(1, 3, 2000, 20.0, 10)}},
+            {1, {make_event(2, 4, 3000, 30.0, 5), make_event(2, 5, 4000, 40.0),
+                 make_event(2, 6, 5000, 50.0)}}};
+}
+
+// Columns of the exported events, in row order, checked against two_blocks()
+void expect_events(const arrow::Table& table) {
+    ASSERT_EQ(table.num_rows(), 5);
+    auto col = [&](const char* name) {
+        auto c = table.GetColumnByName(name);
+        EXPECT_NE(c, nullptr) << name;
+        return c;
+    };
+    auto module = col("module");
+    auto energy = col("energy");
+    auto flags = col("flags");
+    auto probe = col("analog_probe1");
+    ASSERT_TRUE(module && energy && flags && probe);
+
+    // Flatten to one chunk, so rows index the same way for both formats
+    auto combined = arrow::Concatenate(energy->chunks());
+    ASSERT_TRUE(combined.ok());
+    auto energies = std::static_pointer_cast<arrow::UInt16Array>(*combined);
+    EXPECT_EQ(energies->Value(0), 1000);
+    EXPECT_EQ(energies->Value(4), 5000);
+    combined = arrow::Concatenate(flags->chunks());
+    ASSERT_TRUE(combined.ok());
+    EXPECT_EQ(std::static_pointer_cast<arrow::UInt64Array>(*combined)->Value(2), 0x01u);
+
+    combined = arrow::Concatenate(probe->chunks());
+    ASSERT_TRUE(combined.ok());
+    auto list = std::static_pointer_cast<arrow::ListArray>(*combined);
+    EXPECT_EQ(list->null_count(), 3);
+    EXPECT_TRUE(list->IsNull(0));
+    EXPECT_FALSE(list->IsNull(1));
+    EXPECT_FALSE(list->IsNull(2));
+    EXPECT_TRUE(list->IsNull(3));
+    EXPECT_TRUE(list->IsNull(4));
+    EXPECT_EQ(list->value_length(1), 10);
+    EXPECT_EQ(list->value_length(2), 5);
+    auto samples = std::static_pointer_cast<arrow::Int16Array>(list->values());
+    EXPECT_EQ(samples->Value(list->value_offset(1) + 1), 37 - 10000);
+    EXPECT_EQ(samples->Value(list->value_offset(2) + 0), -10000);
+}
+
+}  // namespace
+
+TEST(ArrowExport, IpcStreamOneBatchPerBlock) {
+    TempFile in(build_file(two_blocks()), "arrow");
+    TempFile out({}, "ipc");
+    ArrowOptions opt;
+    opt.format = ArrowFormat::IpcStream;
+    std::vector<std::string> errors;
+    ASSERT_TRUE(delila::export_arrow({in.path()}, out.path(), opt, nullptr, &errors));
+    EXPECT_TRUE(errors.empty());
+
+    auto file = arrow::io::ReadableFile::Open(out.path());
+    ASSERT_TRUE(file.ok());
+    auto stream = arrow::ipc::RecordBatchStreamReader::Open(*file);
+    ASSERT_TRUE(stream.ok()) << stream.status().ToString();
+    EXPECT_TRUE((*stream)->schema()->Equals(*delila::arrow_schema()));
+
+    auto table = (*stream)->ToTable();
+    ASSERT_TRUE(table.ok()) << table.status().ToString();
+    // One record batch per block
+    ASSERT_EQ((*table)->column(0)->num_chunks(), 2);
+    EXPECT_EQ((*table)->column(0)->chunk(0)->length(), 2);
+    EXPECT_EQ((*table)->column(0)->chunk(1)->length(), 3);
+    expect_events(**table);
+}
+
+TEST(ArrowExport, ParquetOneRowGroupPerBlock) {
+    TempFile in(build_file(two_blocks()), "arrow");
+    TempFile out({}, "parquet");
+    ASSERT_TRUE(delila::export_arrow({in.path()}, out.path()));
+
+    auto metadata = parquet::ParquetFileReader::OpenFile(out.path())->metadata();
+    ASSERT_EQ(metadata->num_row_groups(), 2);
+    EXPECT_EQ(metadata->RowGroup(0)->num_rows(), 2);
+    EXPECT_EQ(metadata->RowGroup(1)->num_rows(), 3);
+    EXPECT_EQ(metadata->num_rows(), 5);
+
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    ASSERT_TRUE(parquet::arrow::FileReader::Make(arrow::default_memory_pool(),
+                                                 parquet::ParquetFileReader::OpenFile(out.path()),
+                                                 &reader)
+                    .ok());
+    std::shared_ptr<arrow::Table> table;
+    ASSERT_TRUE(reader->ReadTable(&table).ok());
+    EXPECT_TRUE(table->schema()->Equals(*delila::arrow_schema(), false))
+        << table->schema()->ToString();
+    expect_events(*table);
+}
+
+TEST(ArrowExport, WithoutWaveforms) {
+    TempFile in(build_file(two_blocks()), "arrow");
+    delila::FileReader reader;
+    ASSERT_TRUE(reader.open(in.path()));
+    delila::BatchHeader header;
+    delila::EventColumns cols;
+    ASSERT_TRUE(reader.next_columns(header, cols, false));
+
+    auto batch = delila::to_record_batch(cols, false);
+    ASSERT_TRUE(batch.ok());
+    EXPECT_EQ((*batch)->num_columns(), 6);
+    EXPECT_EQ((*batch)->num_rows(), 2);
+    EXPECT_TRUE((*batch)->schema()->Equals(*delila::arrow_schema(false)));
+    EXPECT_EQ((*batch)->schema()->GetFieldIndex("analog_probe1"), -1);
+}
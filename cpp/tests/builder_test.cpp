@@ -0,0 +1,113 @@
+// Unit tests for the coincidence event builder
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "delila/builder.hpp"
+#include "test_writer.hpp"
+
+using delila::BuilderOptions;
+using delila::BuiltEvent;
+using delila::EventBuilder;
+using delila::TimeMerger;
+using delila_test::build_file;
+using delila_test::make_event;
+using delila_test::TempFile;
+using delila_test::TestBatch;
+
+namespace {
+
+struct TestHit {
+    uint8_t module;
+    uint8_t channel;
+    double ts;
+};
+
+TestBatch hits_batch(uint32_t source_id, const std::vector<TestHit>& hits) {
+    TestBatch b;
+    b.source_id = source_id;
+    for (const auto& h : hits) b.events.push_back(make_event(h.module, h.channel, 100, h.ts));
+    return b;
+}
+
+// Multiplicities of all built events
+std::vector<size_t> multiplicities(const std::string& path, const BuilderOptions& options) {
+    TimeMerger merger;
+    merger.add_file(path);
+    EventBuilder builder(merger, options);
+    std::vector<size_t> out;
+    BuiltEvent ev;
+    while (builder.next(ev)) out.push_back(ev.multiplicity());
+    return out;
+}
+
+}  // namespace
+
+TEST(EventBuilder, FixedWindowWithoutTrigger) {
+    TempFile file(build_file({hits_batch(0, {{0, 0, 0}, {0, 1, 10}, {0, 2, 20}, {0, 0, 1000},
+                                             {0, 1, 1005}, {0, 0, 3000}})}));
+    BuilderOptions options;
+    options.window_ns = 50;
+    EXPECT_EQ(multiplicities(file.path(), options), (std::vector<size_t>{3, 2, 1}));
+
+    options.min_multiplicity = 2;
+    EXPECT_EQ(multiplicities(file.path(), options), (std::vector<size_t>{3, 2}));
+
+    options.max_multiplicity = 2;
+    EXPECT_EQ(multiplicities(file.path(), options), (std::vector<size_t>{2}));
+}
+
+TEST(EventBuilder, ExtendingWindow) {
+    TempFile file(build_file({hits_batch(0, {{0, 0, 0}, {0, 0, 40}, {0, 0, 80}, {0, 0, 120},
+                                             {0, 0, 500}})}));
+    BuilderOptions options;
+    options.window_ns = 50;
+    EXPECT_EQ(multiplicities(file.path(), options), (std::vector<size_t>{2, 2, 1}));
+
+    options.extend_window = true;
+    EXPECT_EQ(multiplicities(file.path(), options), (std::vector<size_t>{4, 1}));
+}
+
+TEST(EventBuilder, TriggerWithPreWindow) {
+    // Trigger: module 1 channel 0. Hit at 100 is too early for the first trigger.
+    TempFile file(build_file({
+        hits_batch(0, {{0, 1, 100}, {0, 2, 185}, {0, 3, 230}, {0, 4, 240}, {0, 5, 900}}),
+        hits_batch(1, {{1, 0, 200}, {1, 1, 210}, {1, 0, 950}}),
+    }));
+    TimeMerger merger;
+    merger.add_file(file.path());
+    BuilderOptions options;
+    options.window_ns = 30;
+    options.pre_window_ns = 20;
+    options.triggers = {{1, 0}};
+    EventBuilder builder(merger, options);
+
+    BuiltEvent ev;
+    ASSERT_TRUE(builder.next(ev));
+    EXPECT_DOUBLE_EQ(ev.trigger_ts, 200.0);
+    ASSERT_EQ(ev.multiplicity(), 4u);  // 185, 200, 210, 230
+    EXPECT_EQ(ev.trigger, 1u);
+    EXPECT_EQ(ev.hits[ev.trigger].module, 1);
+    EXPECT_DOUBLE_EQ(ev.hits.front().timestamp_ns, 185.0);
+    EXPECT_DOUBLE_EQ(ev.hits.back().timestamp_ns, 230.0);
+    EXPECT_EQ(ev.source_ids, (std::vector<uint32_t>{0, 1, 1, 0}));
+
+    ASSERT_TRUE(builder.next(ev));
+    EXPECT_DOUBLE_EQ(ev.trigger_ts, 950.0);
+    EXPECT_EQ(ev.multiplicity(), 1u);  // 900 is before the pre-window (930)
+    EXPECT_FALSE(builder.next(ev));
+
+    const auto& stats = builder.stats();
+    EXPECT_EQ(stats.hits, 8u);
+    EXPECT_EQ(stats.events, 2u);
+    EXPECT_EQ(stats.hits_used, 5u);
+}
+
+TEST(EventBuilder, AnyChannelOfModule) {
+    TempFile file(build_file({hits_batch(0, {{0, 0, 0}, {2, 7, 10}, {0, 0, 20}, {2, 3, 500}})}));
+    BuilderOptions options;
+    options.window_ns = 100;
+    options.triggers = {{2, -1}};
+    EXPECT_EQ(multiplicities(file.path(), options), (std::vector<size_t>{2, 1}));
+}
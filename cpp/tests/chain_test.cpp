@@ -0,0 +1,168 @@
+// Unit tests for FileChain
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include "delila/chain.hpp"
+#include "test_writer.hpp"
+
+using delila::BatchHeader;
+using delila::Event;
+using delila::EventColumns;
+using delila::FileChain;
+using delila_test::build_file;
+using delila_test::make_event;
+using delila_test::TestBatch;
+
+namespace {
+
+// Directory of named files, removed on destruction
+class TempDir {
+public:
+    TempDir() {
+        char tmpl[] = "/tmp/delila_chain_XXXXXX";
+        path_ = ::mkdtemp(tmpl);
+    }
+    ~TempDir() {
+        for (const auto& f : files_) std::remove(f.c_str());
+        ::rmdir(path_.c_str());
+    }
+
+    std::string write(const std::string& name, const std::vector<uint8_t>& content) {
+        std::string p = path_ + "/" + name;
+        std::ofstream f(p, std::ios::binary);
+        f.write(reinterpret_cast<const char*>(content.data()),
+                static_cast<std::streamsize>(content.size()));
+        files_.push_back(p);
+        return p;
+    }
+
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+    std::vector<std::string> files_;
+};
+
+// One file of `n_blocks` blocks whose energies are base, base + 1, ...
+std::vector<uint8_t> numbered_file(uint16_t base, int n_blocks) {
+    std::vector<TestBatch> batches(n_blocks);
+    for (int b = 0; b < n_blocks; b++) {
+        batches[b].events.push_back(make_event(0, 0, static_cast<uint16_t>(base + b), b * 10.0));
+    }
+    return build_file(batches);
+}
+
+std::vector<uint16_t> energies(FileChain& chain) {
+    std::vector<uint16_t> out;
+    BatchHeader hdr;
+    EventColumns cols;
+    while (chain.next_columns(hdr, cols)) {
+        out.insert(out.end(), cols.energy.begin(), cols.energy.end());
+    }
+    return out;
+}
+
+}  // namespace
+
+TEST(FileChain, RunFilesInSequenceOrder) {
+    TempDir dir;
+    // Written out of order; sequence 10 must sort after 2
+    dir.write("run0042_0010_CRIB.delila", numbered_file(300, 1));
+    dir.write("run0042_0000_CRIB.delila", numbered_file(100, 2));
+    dir.write("run0042_0002_CRIB.delila", numbered_file(200, 2));
+    dir.write("run0043_0000_CRIB.delila", numbered_file(900, 1));
+
+    FileChain chain;
+    ASSERT_TRUE(chain.add_run(dir.path(), 42));
+    ASSERT_EQ(chain.files().size(), 3u);
+    EXPECT_EQ(energies(chain), (std::vector<uint16_t>{100, 101, 200, 201, 300}));
+    EXPECT_TRUE(chain.errors().empty());
+    EXPECT_EQ(chain.blocks_read(), 5u);
+    EXPECT_EQ(chain.file_index(), 3u);
+
+    chain.rewind();
+    EXPECT_EQ(chain.blocks_read(), 0u);
+    EXPECT_EQ(energies(chain).size(), 5u);
+}
+
+TEST(FileChain, GlobSkipsSidecars) {
+    TempDir dir;
+    dir.write("run0001_0000_X.delila", numbered_file(1, 1));
+    dir.write("run0001_0000_X.delila.idx", {1, 2, 3});
+
+    FileChain chain;
+    ASSERT_TRUE(chain.add_glob(dir.path() + "/run0001_*"));
+    ASSERT_EQ(chain.files().size(), 1u);
+    EXPECT_FALSE(chain.add_glob(dir.path() + "/nothing_*.delila"));
+    EXPECT_FALSE(chain.add_run(dir.path(), 7));
+}
+
+TEST(FileChain, BadFilesRecordedAndSkipped) {
+    TempDir dir;
+    dir.write("run0005_0000_X.delila", numbered_file(10, 2));
+    dir.write("run0005_0001_X.delila", {'N', 'O', 'P', 'E'});
+
+    // Third file is cut inside its second block
+    auto cut = numbered_file(30, 2);
+    cut.resize(cut.size() - delila::FOOTER_SIZE - 3);
+    dir.write("run0005_0002_X.delila", cut);
+    dir.write("run0005_0003_X.delila", numbered_file(40, 1));
+
+    FileChain chain;
+    ASSERT_TRUE(chain.add_run(dir.path(), 5));
+    chain.add_file(dir.path() + "/run0005_0004_missing.delila");
+    ASSERT_EQ(chain.files().size(), 5u);
+
+    EXPECT_EQ(energies(chain), (std::vector<uint16_t>{10, 11, 30, 40}));
+    ASSERT_EQ(chain.errors().size(), 3u);
+    EXPECT_NE(chain.errors()[0].find("run0005_0001_X.delila: "), std::string::npos);
+    EXPECT_NE(chain.errors()[1].find("run0005_0002_X.delila: "), std::string::npos);
+    EXPECT_NE(chain.errors()[2].find("run0005_0004_missing.delila: "), std::string::npos);
+}
+
+TEST(FileChain, RowBatches) {
+    TempDir dir;
+    dir.write("run0009_0001_X.delila", numbered_file(2, 1));
+    dir.write("run0009_0000_X.delila", numbered_file(1, 1));
+
+    FileChain chain;
+    ASSERT_TRUE(chain.add_glob(dir.path() + "/*.delila"));
+    BatchHeader hdr;
+    std::vector<Event> events;
+    ASSERT_TRUE(chain.next_batch(hdr, events));
+    EXPECT_EQ(events[0].energy, 1);
+    EXPECT_EQ(chain.reader().header().run_number, 10u);
+    ASSERT_TRUE(chain.next_batch(hdr, events));
+    EXPECT_EQ(events[0].energy, 2);
+    EXPECT_FALSE(chain.next_batch(hdr, events));
+}
+
+
+TEST(FileChain, FollowsLiveRun) {
+    TempDir dir;
+    auto first = numbered_file(100, 3);
+    size_t first_data = first.size() - delila::FOOTER_SIZE;
+    std::string path0 = dir.write("run0042_0000_CRIB.delila", std::vector<uint8_t>(
+        first.begin(), first.begin() + static_cast<std::ptrdiff_t>(first_data)));
+
+    FileChain chain;
+    ASSERT_TRUE(chain.add_run(dir.path(), 42));
+    chain.set_follow(true);
+    EXPECT_EQ(energies(chain), (std::vector<uint16_t>{100, 101, 102}));
+    EXPECT_FALSE(chain.refresh());
+
+    // Rotation: footer on the first file, a second file appears
+    delila_test::append_bytes(path0, first, first_data, first.size());
+    dir.write("run0042_0001_CRIB.delila", numbered_file(200, 2));
+    EXPECT_TRUE(chain.refresh());
+    ASSERT_EQ(chain.files().size(), 2u);
+    EXPECT_EQ(energies(chain), (std::vector<uint16_t>{200, 201}));
+    EXPECT_TRUE(chain.errors().empty());
+    EXPECT_EQ(chain.blocks_read(), 5u);
+}
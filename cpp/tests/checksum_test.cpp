@@ -0,0 +1,197 @@
+// Unit tests for the data checksum (footer.data_checksum)
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "delila/checksum.hpp"
+#include "delila/reader.hpp"
+#include "delila/run.hpp"
+#include "test_writer.hpp"
+
+using delila::BlockChecksum;
+using delila::ChecksumCalculator;
+using delila::ChecksumStatus;
+using delila::FileReader;
+using delila::ReadMode;
+using delila_test::BatchPattern;
+using delila_test::build_file;
+using delila_test::generate_batches;
+using delila_test::make_event;
+using delila_test::TempFile;
+using delila_test::TestBatch;
+
+namespace {
+
+// 10 + b events in block b, a waveform on every fourth
+std::vector<TestBatch> checksum_batches(int n_blocks) {
+    BatchPattern p;
+    p.sources = 3;
+    p.events_cycle = 16;
+    p.block_ns = 100.0;
+    p.waveform_every = 4;
+    return generate_batches(n_blocks, p);
+}
+
+class ChecksumReaderTest : public ::testing::TestWithParam<ReadMode> {};
+
+}  // namespace
+
+TEST(Xxh64, ReferenceVectors) {
+    EXPECT_EQ(delila::xxh64("", 0), 0xEF46DB3751D8E999ULL);
+    EXPECT_EQ(delila::xxh64("abc", 3), 0x44BC2CF5AD770999ULL);
+    // >= 32 bytes: the four-lane loop
+    const char* fox = "The quick brown fox jumps over the lazy dog";
+    EXPECT_EQ(delila::xxh64(fox, std::strlen(fox)), 0x0B242D361FDA71BCULL);
+}
+
+TEST(Xxh64, EveryTailLength) {
+    // Hashes of all prefixes of a 100-byte buffer differ from each other
+    std::vector<uint8_t> buf(100);
+    for (size_t i = 0; i < buf.size(); i++) buf[i] = static_cast<uint8_t>(i * 7 + 1);
+    std::vector<uint64_t> seen;
+    for (size_t n = 0; n <= buf.size(); n++) {
+        uint64_t h = delila::xxh64(buf.data(), n);
+        for (uint64_t s : seen) ASSERT_NE(h, s) << n;
+        seen.push_back(h);
+    }
+}
+
+TEST(BlockChecksum, MatchesSequentialInAnyOrder) {
+    std::vector<std::vector<uint8_t>> blocks;
+    for (int b = 0; b < 37; b++) {
+        blocks.emplace_back(static_cast<size_t>(1 + b * 13));
+        for (size_t i = 0; i < blocks.back().size(); i++) {
+            blocks.back()[i] = static_cast<uint8_t>(b + i);
+        }
+    }
+
+    ChecksumCalculator seq;
+    for (const auto& blk : blocks) {
+        uint32_t len = static_cast<uint32_t>(blk.size());
+        uint8_t prefix[4];
+        std::memcpy(prefix, &len, 4);
+        seq.update(prefix, 4);
+        seq.update(blk.data(), blk.size());
+    }
+
+    // Backwards, split over two partial sums
+    BlockChecksum even, odd;
+    for (size_t i = blocks.size(); i-- > 0;) {
+        (i % 2 ? odd : even).add(i, blocks[i].data(), static_cast<uint32_t>(blocks[i].size()));
+    }
+    BlockChecksum total;
+    total.merge(odd);
+    total.merge(even);
+    EXPECT_EQ(total.blocks(), blocks.size());
+    EXPECT_EQ(total.bytes(), seq.bytes_processed());
+    EXPECT_EQ(total.finalize(), seq.finalize());
+
+    EXPECT_EQ(BlockChecksum().finalize(), ChecksumCalculator().finalize());
+}
+
+TEST_P(ChecksumReaderTest, MatchWhileDecoding) {
+    TempFile file(build_file(checksum_batches(5)));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), GetParam()));
+    reader.set_verify_checksum(true);
+
+    delila::BatchHeader header;
+    std::vector<delila::Event> events;
+    while (reader.next_batch(header, events)) {
+    }
+    ASSERT_TRUE(reader.error().empty()) << reader.error();
+    EXPECT_EQ(reader.checksum().blocks(), 5u);
+    EXPECT_EQ(reader.check_checksum(), ChecksumStatus::Match);
+
+    reader.rewind();
+    EXPECT_EQ(reader.check_checksum(), ChecksumStatus::Incomplete);
+    EXPECT_EQ(reader.verify_checksum(3), ChecksumStatus::Match);
+}
+
+TEST_P(ChecksumReaderTest, SeekLeavesSumIncomplete) {
+    TempFile file(build_file(checksum_batches(5)));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), GetParam()));
+    reader.set_verify_checksum(true);
+
+    delila::BlockView block;
+    ASSERT_TRUE(reader.read_block(2, block));
+    while (reader.next_block(block)) {
+    }
+    EXPECT_EQ(reader.checksum().blocks(), 0u);
+    EXPECT_EQ(reader.check_checksum(), ChecksumStatus::Incomplete);
+}
+
+TEST_P(ChecksumReaderTest, DetectsCorruptedPayload) {
+    auto bytes = build_file(checksum_batches(6));
+    // Flip a timestamp byte of the last event (the block still decodes)
+    bytes[bytes.size() - delila::FOOTER_SIZE - 3] ^= 0x01;
+    TempFile file(bytes);
+
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), GetParam()));
+    EXPECT_EQ(reader.verify_checksum(4), ChecksumStatus::Mismatch);
+    EXPECT_EQ(reader.verify_checksum(1), ChecksumStatus::Mismatch);
+}
+
+TEST_P(ChecksumReaderTest, NoFooter) {
+    auto bytes = build_file(checksum_batches(2), false);
+    TempFile file(bytes);
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), GetParam()));
+    EXPECT_EQ(reader.verify_checksum(), ChecksumStatus::NoFooter);
+}
+
+TEST_P(ChecksumReaderTest, EmptyFileMatches) {
+    TempFile file(build_file({}));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), GetParam()));
+    EXPECT_EQ(reader.verify_checksum(), ChecksumStatus::Match);
+}
+
+INSTANTIATE_TEST_SUITE_P(Modes, ChecksumReaderTest,
+                         ::testing::Values(ReadMode::Mmap, ReadMode::Stream,
+                                           ReadMode::ReadAhead));
+
+TEST(FileReader, VerifyChecksumWalksLengthPrefixes) {
+    // No sidecar: the blocks come from the length prefixes, not an index scan
+    auto bytes = build_file(checksum_batches(5));
+    TempFile file(bytes);
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), ReadMode::Mmap));
+    EXPECT_EQ(reader.verify_checksum(3), ChecksumStatus::Match);
+    EXPECT_FALSE(reader.has_index());
+
+    // A payload that does not parse is still hashed (and mismatches)
+    delila::BlockView block;
+    ASSERT_TRUE(reader.read_block(2, block));
+    bytes[static_cast<size_t>(block.offset) + 4] = 0xc1;
+    TempFile bad(bytes);
+    FileReader bad_reader;
+    ASSERT_TRUE(bad_reader.open(bad.path(), ReadMode::Mmap));
+    EXPECT_EQ(bad_reader.verify_checksum(2), ChecksumStatus::Mismatch);
+    EXPECT_TRUE(bad_reader.error().empty()) << bad_reader.error();
+}
+
+TEST(SummarizeFiles, ReportsChecksumMismatch) {
+    auto bytes = build_file(checksum_batches(3));
+    bytes[bytes.size() - delila::FOOTER_SIZE - 3] ^= 0x01;
+    TempFile bad(bytes, "run");
+    TempFile good(build_file(checksum_batches(3)), "run");
+
+    auto files = delila::summarize_files({bad.path(), good.path()}, 2);
+    EXPECT_TRUE(files[0].checksum_checked);
+    EXPECT_EQ(files[0].checksum, ChecksumStatus::Mismatch);
+    auto problems = files[0].check_footer();
+    EXPECT_NE(std::find(problems.begin(), problems.end(), "data_checksum mismatch"), problems.end());
+    EXPECT_EQ(files[1].checksum, ChecksumStatus::Match);
+    EXPECT_TRUE(files[1].check_footer().empty());
+
+    files = delila::summarize_files({bad.path()}, 1, ReadMode::Mmap, false);
+    EXPECT_FALSE(files[0].checksum_checked);
+    problems = files[0].check_footer();
+    EXPECT_EQ(std::find(problems.begin(), problems.end(), "data_checksum mismatch"), problems.end());
+}
@@ -0,0 +1,151 @@
+// Unit tests for columnar batch decoding
+
+#include <gtest/gtest.h>
+
+#include "delila/columns.hpp"
+#include "delila/filter.hpp"
+#include "delila/msgpack.hpp"
+#include "delila/reader.hpp"
+#include "test_writer.hpp"
+
+using delila::BatchHeader;
+using delila::BlockView;
+using delila::Event;
+using delila::EventColumns;
+using delila::EventFilter;
+using delila::FileReader;
+using delila::NO_WAVEFORM;
+using delila_test::make_event;
+using delila_test::MsgPackWriter;
+using delila_test::view_of;
+
+namespace {
+
+std::vector<Event> mixed_events() {
+    return {make_event(1, 2, 1000, 10.0), make_event(3, 4, 2000, 20.0, 50),
+            make_event(5, 6, 3000, 30.0), make_event(7, 8, 4000, 40.0, 120)};
+}
+
+}  // namespace
+
+TEST(EventColumns, DecodeMatchesRowDecode) {
+    auto in = mixed_events();
+    MsgPackWriter w;
+    w.write_batch(2, 9, in);
+
+    BatchHeader hdr;
+    EventColumns cols;
+    ASSERT_TRUE(FileReader::decode_block(view_of(w), hdr, cols));
+    EXPECT_EQ(hdr.source_id, 2u);
+    ASSERT_EQ(cols.size(), 4u);
+    ASSERT_EQ(cols.num_waveforms(), 2u);
+
+    for (size_t i = 0; i < in.size(); i++) {
+        EXPECT_EQ(cols.module[i], in[i].module);
+        EXPECT_EQ(cols.channel[i], in[i].channel);
+        EXPECT_EQ(cols.energy[i], in[i].energy);
+        EXPECT_EQ(cols.energy_short[i], in[i].energy_short);
+        EXPECT_DOUBLE_EQ(cols.timestamp_ns[i], in[i].timestamp_ns);
+        EXPECT_EQ(cols.flags[i], in[i].flags);
+        EXPECT_EQ(cols.has_waveform(i), in[i].has_waveform);
+    }
+
+    // Second waveform sits right after the first in the flat buffer
+    ASSERT_EQ(cols.waveform_index[3], 1);
+    EXPECT_EQ(cols.analog_probe1.size(1), 120u);
+    EXPECT_EQ(cols.analog_probe1.data(1), cols.analog_probe1.data(0) + 50);
+    std::vector<int16_t> ap1(cols.analog_probe1.data(1), cols.analog_probe1.data(1) + 120);
+    EXPECT_EQ(ap1, in[3].waveform.analog_probe1);
+    std::vector<uint8_t> dp4(cols.digital_probe4.data(0), cols.digital_probe4.data(0) + 50);
+    EXPECT_EQ(dp4, in[1].waveform.digital_probe4);
+    EXPECT_EQ(cols.trigger_threshold[1], 300);
+}
+
+TEST(EventColumns, SkipsWaveformsOnRequest) {
+    MsgPackWriter w;
+    w.write_batch(0, 0, mixed_events());
+
+    BatchHeader hdr;
+    EventColumns cols;
+    ASSERT_TRUE(FileReader::decode_block(view_of(w), hdr, cols, nullptr, false));
+    ASSERT_EQ(cols.size(), 4u);
+    EXPECT_EQ(cols.num_waveforms(), 0u);
+    EXPECT_EQ(cols.waveform_index[1], NO_WAVEFORM);
+    EXPECT_EQ(cols.energy[3], 4000);
+}
+
+TEST(EventColumns, DecodesOnlySelectedFields) {
+    MsgPackWriter w;
+    w.write_batch(0, 0, mixed_events());
+
+    BatchHeader hdr;
+    EventColumns cols;
+    ASSERT_TRUE(FileReader::decode_block(view_of(w), hdr, cols, nullptr, true, nullptr,
+                                         delila::FIELD_ENERGY));
+    ASSERT_EQ(cols.size(), 4u);
+    EXPECT_EQ(cols.energy, (std::vector<uint16_t>{1000, 2000, 3000, 4000}));
+    EXPECT_TRUE(cols.module.empty());
+    EXPECT_TRUE(cols.timestamp_ns.empty());
+    EXPECT_TRUE(cols.flags.empty());
+    EXPECT_EQ(cols.waveform_index, (std::vector<int32_t>{NO_WAVEFORM, 0, NO_WAVEFORM, 1}));
+
+    // The filter still cuts on columns that are not stored
+    EventFilter f;
+    f.select(5).select(7);
+    ASSERT_TRUE(FileReader::decode_block(view_of(w), hdr, cols, f, nullptr, false, nullptr,
+                                         delila::FIELD_ENERGY | delila::FIELD_CHANNEL));
+    ASSERT_EQ(cols.size(), 2u);
+    EXPECT_EQ(cols.energy, (std::vector<uint16_t>{3000, 4000}));
+    EXPECT_EQ(cols.channel, (std::vector<uint8_t>{6, 8}));
+    EXPECT_TRUE(cols.energy_short.empty());
+
+    // Appending leaves the missing columns missing
+    EventColumns all;
+    all.append(cols, 1, 1);
+    EXPECT_EQ(all.size(), 1u);
+    EXPECT_EQ(all.energy, (std::vector<uint16_t>{4000}));
+    EXPECT_TRUE(all.module.empty());
+}
+
+TEST(EventColumns, BadEventKeepsPrefix) {
+    MsgPackWriter w;
+    w.write_array(4);
+    w.write_uint(0);
+    w.write_uint(0);
+    w.write_uint(0);
+    w.write_array(3);
+    w.write_event(make_event(1, 1, 100, 1.0, 10));
+    w.write_event(make_event(1, 2, 200, 2.0));
+    w.write_array(5);  // bad arity
+
+    BatchHeader hdr;
+    EventColumns cols;
+    std::string err;
+    EXPECT_FALSE(FileReader::decode_block(view_of(w), hdr, cols, &err));
+    EXPECT_EQ(err, "Failed to parse event 2 in block 0");
+    ASSERT_EQ(cols.size(), 2u);
+    EXPECT_EQ(cols.num_waveforms(), 1u);
+    EXPECT_EQ(cols.analog_probe1.samples.size(), 10u);
+}
+
+TEST(EventColumns, AppendRenumbersWaveforms) {
+    MsgPackWriter w;
+    w.write_batch(0, 0, mixed_events());
+    BatchHeader hdr;
+    EventColumns batch;
+    ASSERT_TRUE(FileReader::decode_block(view_of(w), hdr, batch));
+
+    EventColumns all;
+    all.append(batch, 2, 2);  // events 2, 3 (one waveform)
+    all.append(batch, 0, 2);  // events 0, 1 (one waveform)
+    ASSERT_EQ(all.size(), 4u);
+    ASSERT_EQ(all.num_waveforms(), 2u);
+    EXPECT_EQ(all.energy, (std::vector<uint16_t>{3000, 4000, 1000, 2000}));
+    EXPECT_EQ(all.waveform_index, (std::vector<int32_t>{NO_WAVEFORM, 0, NO_WAVEFORM, 1}));
+    EXPECT_EQ(all.analog_probe1.size(0), 120u);
+    EXPECT_EQ(all.analog_probe1.size(1), 50u);
+
+    all.clear();
+    EXPECT_TRUE(all.empty());
+    EXPECT_EQ(all.analog_probe1.offsets.size(), 1u);
+}
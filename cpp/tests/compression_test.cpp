@@ -0,0 +1,202 @@
+// Unit tests for compressed v3 blocks (compression.hpp) and reading v3 files
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "delila/compression.hpp"
+#include "delila/reader.hpp"
+#include "delila/run.hpp"
+#include "test_writer.hpp"
+
+using delila::BatchHeader;
+using delila::BlockHeader;
+using delila::ChecksumStatus;
+using delila::Compression;
+using delila::EventColumns;
+using delila::FileReader;
+using delila::ReadMode;
+using delila_test::BatchPattern;
+using delila_test::build_file;
+using delila_test::build_file_v3;
+using delila_test::generate_batches;
+using delila_test::make_event;
+using delila_test::MsgPackWriter;
+using delila_test::TempFile;
+using delila_test::TestBatch;
+
+namespace {
+
+// Two sources, 40 events per block, a 128-sample waveform on every fourth
+std::vector<TestBatch> waveform_batches(int n_blocks) {
+    BatchPattern p;
+    p.sources = 2;
+    p.module_is_source = true;
+    p.events = 40;
+    p.energy = 0;
+    p.block_energy = 100;
+    p.event_energy = 1;
+    p.waveform_every = 4;
+    p.waveform_samples = 128;
+    return generate_batches(n_blocks, p);
+}
+
+std::vector<uint8_t> batch_bytes(const TestBatch& batch) {
+    MsgPackWriter w;
+    w.write_batch(batch.source_id, 0, batch.events);
+    return w.buf;
+}
+
+// Offset of the first block's length prefix
+size_t first_block(const std::vector<uint8_t>& file) {
+    return delila::MAGIC_SIZE + 4 + delila::load_u32_le(file.data() + delila::MAGIC_SIZE);
+}
+
+class CompressionTest : public ::testing::TestWithParam<Compression> {
+protected:
+    void SetUp() override {
+        if (!delila::compression_available(GetParam())) {
+            GTEST_SKIP() << delila::compression_name(GetParam()) << " not built in";
+        }
+    }
+};
+
+}  // namespace
+
+TEST_P(CompressionTest, BlockRoundtrip) {
+    std::vector<uint8_t> raw = batch_bytes(waveform_batches(1)[0]);
+    std::vector<uint8_t> block;
+    ASSERT_TRUE(delila::encode_block(raw.data(), raw.size(), GetParam(), 3, block));
+
+    BlockHeader header;
+    ASSERT_TRUE(delila::parse_block_header(block.data(), block.size(), header));
+    EXPECT_EQ(header.compression, GetParam());
+    EXPECT_EQ(header.raw_size, raw.size());
+    EXPECT_LT(block.size(), raw.size() / 2);
+
+    std::vector<uint8_t> scratch;
+    size_t size = 0;
+    std::string err;
+    const uint8_t* payload = delila::block_payload(block.data(), block.size(), scratch, size, &err);
+    ASSERT_NE(payload, nullptr) << err;
+    EXPECT_EQ(std::vector<uint8_t>(payload, payload + size), raw);
+}
+
+TEST_P(CompressionTest, IncompressibleBlockIsStored) {
+    std::vector<uint8_t> raw(64);
+    uint32_t x = 12345;
+    for (auto& b : raw) b = static_cast<uint8_t>((x = x * 1103515245 + 12345) >> 24);
+    std::vector<uint8_t> block;
+    ASSERT_TRUE(delila::encode_block(raw.data(), raw.size(), GetParam(), 3, block));
+    EXPECT_EQ(block[0], static_cast<uint8_t>(Compression::None));
+    EXPECT_EQ(std::vector<uint8_t>(block.begin() + delila::BLOCK_HEADER_SIZE, block.end()), raw);
+}
+
+TEST_P(CompressionTest, ReaderDecodesLikeV2) {
+    auto batches = waveform_batches(5);
+    auto v3_bytes = build_file_v3(batches, GetParam());
+    auto v2_bytes = build_file(batches);
+    EXPECT_LT(v3_bytes.size(), v2_bytes.size());
+    TempFile v3(v3_bytes);
+    TempFile v2(v2_bytes);
+
+    for (ReadMode mode : {ReadMode::Mmap, ReadMode::Stream, ReadMode::ReadAhead}) {
+        FileReader expected;
+        ASSERT_TRUE(expected.open(v2.path(), mode));
+        FileReader reader;
+        reader.set_verify_checksum(true);
+        ASSERT_TRUE(reader.open(v3.path(), mode)) << reader.error();
+        EXPECT_TRUE(reader.has_block_headers());
+        EXPECT_EQ(reader.header().version, 3u);
+
+        BatchHeader h1, h2;
+        EventColumns c1, c2;
+        while (expected.next_columns(h1, c1)) {
+            ASSERT_TRUE(reader.next_columns(h2, c2)) << reader.error();
+            EXPECT_EQ(h2.sequence_number, h1.sequence_number);
+            EXPECT_EQ(c2.energy, c1.energy);
+            EXPECT_EQ(c2.analog_probe1.samples, c1.analog_probe1.samples);
+        }
+        EXPECT_FALSE(reader.next_columns(h2, c2));
+        EXPECT_TRUE(reader.error().empty()) << reader.error();
+        EXPECT_EQ(reader.check_checksum(), ChecksumStatus::Match);
+        EXPECT_EQ(reader.verify_checksum(2), ChecksumStatus::Match);
+    }
+}
+
+TEST_P(CompressionTest, IndexScanAndWorkerDecode) {
+    auto batches = waveform_batches(8);
+    TempFile file(build_file_v3(batches, GetParam()));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path()));
+    ASSERT_TRUE(reader.load_index()) << reader.error();
+    ASSERT_EQ(reader.index().size(), 8u);
+    EXPECT_TRUE(reader.index()[3].has_zone_map);
+    EXPECT_EQ(reader.index()[3].min_energy, 300);
+
+    // Views decoded (and decompressed) on worker threads
+    std::vector<size_t> events(batches.size());
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < 4; t++) {
+        workers.emplace_back([&, t] {
+            BatchHeader header;
+            EventColumns cols;
+            for (size_t i = t; i < batches.size(); i += 4) {
+                delila::BlockView view;
+                if (reader.view_block(i, view) &&
+                    FileReader::decode_block(view, header, cols, nullptr)) {
+                    events[i] = cols.size();
+                }
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    for (size_t i = 0; i < batches.size(); i++) EXPECT_EQ(events[i], 40u) << "block " << i;
+}
+
+TEST_P(CompressionTest, CorruptPayloadFails) {
+    auto file_bytes = build_file_v3(waveform_batches(2), GetParam());
+    size_t at = first_block(file_bytes) + 4 + delila::BLOCK_HEADER_SIZE;
+    for (size_t i = 0; i < 16; i++) file_bytes[at + i] ^= 0x5a;
+    TempFile file(file_bytes);
+
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path()));
+    BatchHeader header;
+    EventColumns cols;
+    EXPECT_FALSE(reader.next_columns(header, cols));
+    EXPECT_NE(reader.error().find("block 0"), std::string::npos) << reader.error();
+}
+
+INSTANTIATE_TEST_SUITE_P(Codecs, CompressionTest,
+                         ::testing::Values(Compression::Lz4, Compression::Zstd),
+                         [](const ::testing::TestParamInfo<Compression>& info) {
+                             return std::string(delila::compression_name(info.param));
+                         });
+
+TEST(V3Blocks, StoredBlocksNeedNoCodec) {
+    auto batches = waveform_batches(3);
+    TempFile file(build_file_v3(batches, Compression::None));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path()));
+    BatchHeader header;
+    std::vector<delila::Event> events;
+    size_t total = 0;
+    while (reader.next_batch(header, events)) total += events.size();
+    EXPECT_TRUE(reader.error().empty()) << reader.error();
+    EXPECT_EQ(total, 120u);
+    EXPECT_EQ(reader.verify_checksum(), ChecksumStatus::Match);
+}
+
+TEST(V3Blocks, BadBlockHeader) {
+    uint8_t block[delila::BLOCK_HEADER_SIZE] = {7, 0, 0, 0, 16, 0, 0, 0};
+    BlockHeader header;
+    EXPECT_FALSE(delila::parse_block_header(block, sizeof(block), header));
+    EXPECT_FALSE(delila::parse_block_header(block, 4, header));
+
+    std::vector<uint8_t> scratch;
+    size_t size;
+    std::string err;
+    EXPECT_EQ(delila::block_payload(block, sizeof(block), scratch, size, &err), nullptr);
+    EXPECT_NE(err.find("Unknown block compression 7"), std::string::npos) << err;
+}
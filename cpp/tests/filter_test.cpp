@@ -0,0 +1,277 @@
+// Unit tests for filtered (predicate pushdown) decoding
+
+#include <gtest/gtest.h>
+
+#include "delila/chain.hpp"
+#include "delila/filter.hpp"
+#include "delila/msgpack.hpp"
+#include "delila/reader.hpp"
+#include "test_writer.hpp"
+
+using delila::BatchHeader;
+using delila::BlockView;
+using delila::Event;
+using delila::EventColumns;
+using delila::EventFilter;
+using delila::FileReader;
+using delila_test::build_file;
+using delila_test::make_event;
+using delila_test::MsgPackWriter;
+using delila_test::TempFile;
+using delila_test::TestBatch;
+using delila_test::view_of;
+
+namespace {
+
+// Channels 0..3 of modules 0 and 1, a waveform on every other event
+std::vector<Event> grid_events() {
+    std::vector<Event> events;
+    for (int i = 0; i < 16; i++) {
+        events.push_back(make_event(static_cast<uint8_t>(i / 8), static_cast<uint8_t>(i % 4),
+                                    static_cast<uint16_t>(100 * (i + 1)), 10.0 * i,
+                                    i % 2 ? 200 : 0));
+    }
+    events[5].flags = 0x04;
+    return events;
+}
+
+}  // namespace
+
+TEST(EventFilter, DefaultAcceptsAll) {
+    EventFilter f;
+    EXPECT_TRUE(f.accepts_all());
+    EXPECT_FALSE(f.has_time_window());
+    EXPECT_TRUE(f.matches(make_event(255, 255, 65535, -1e300)));
+    f.energy(10, 20);
+    EXPECT_FALSE(f.accepts_all());
+    f.clear();
+    EXPECT_TRUE(f.accepts_all());
+}
+
+TEST(EventFilter, Cuts) {
+    EventFilter f;
+    f.select(0, 3).select(2);
+    EXPECT_TRUE(f.matches(make_event(0, 3, 100, 0)));
+    EXPECT_FALSE(f.matches(make_event(0, 2, 100, 0)));
+    EXPECT_TRUE(f.matches(make_event(2, 200, 100, 0)));
+    EXPECT_FALSE(f.matches(make_event(1, 3, 100, 0)));
+
+    EventFilter any_module;
+    any_module.select(-1, 7);
+    EXPECT_TRUE(any_module.matches(make_event(9, 7, 100, 0)));
+    EXPECT_FALSE(any_module.matches(make_event(9, 6, 100, 0)));
+
+    EventFilter e;
+    e.energy(100, 200).energy_short(0, 40);  // make_event: energy_short = energy / 4
+    EXPECT_TRUE(e.matches(make_event(0, 0, 100, 0)));
+    EXPECT_TRUE(e.matches(make_event(0, 0, 160, 0)));
+    EXPECT_FALSE(e.matches(make_event(0, 0, 164, 0)));
+    EXPECT_FALSE(e.matches(make_event(0, 0, 99, 0)));
+
+    EventFilter fl;
+    fl.flags(0x01, 0x04);
+    Event ev = make_event(0, 0, 100, 0);  // flags 0x01
+    EXPECT_TRUE(fl.matches(ev));
+    ev.flags = 0x05;
+    EXPECT_FALSE(fl.matches(ev));
+    ev.flags = 0;
+    EXPECT_FALSE(fl.matches(ev));
+
+    EventFilter t;
+    t.time(10.0, 20.0);
+    EXPECT_TRUE(t.matches(make_event(0, 0, 100, 10.0)));
+    EXPECT_FALSE(t.matches(make_event(0, 0, 100, 20.0)));
+    EXPECT_TRUE(t.overlaps(0.0, 10.0));
+    EXPECT_FALSE(t.overlaps(20.0, 30.0));
+    EXPECT_FALSE(t.overlaps(0.0, 9.9));
+}
+
+TEST(EventFilter, DecodeKeepsMatchingEvents) {
+    auto in = grid_events();
+    MsgPackWriter w;
+    w.write_batch(0, 0, in);
+
+    EventFilter f;
+    f.select(1, 1).select(0, 3);
+    BatchHeader hdr;
+    EventColumns cols;
+    ASSERT_TRUE(FileReader::decode_block(view_of(w), hdr, cols, f));
+    EXPECT_EQ(hdr.num_events, 16u);
+
+    // Events 3, 7 (module 0 ch 3) and 9, 13 (module 1 ch 1), all with waveforms
+    const size_t expected[] = {3, 7, 9, 13};
+    ASSERT_EQ(cols.size(), 4u);
+    ASSERT_EQ(cols.num_waveforms(), 4u);
+    for (size_t k = 0; k < 4; k++) {
+        const Event& ev = in[expected[k]];
+        EXPECT_EQ(cols.module[k], ev.module);
+        EXPECT_EQ(cols.channel[k], ev.channel);
+        EXPECT_EQ(cols.energy[k], ev.energy);
+        EXPECT_DOUBLE_EQ(cols.timestamp_ns[k], ev.timestamp_ns);
+        ASSERT_EQ(cols.waveform_index[k], static_cast<int32_t>(k));
+        std::vector<int16_t> ap1(cols.analog_probe1.data(k),
+                                 cols.analog_probe1.data(k) + cols.analog_probe1.size(k));
+        EXPECT_EQ(ap1, ev.waveform.analog_probe1);
+    }
+}
+
+TEST(EventFilter, RejectedWaveformsAreSkipped) {
+    // Both sample encodings: the events after a skipped waveform must
+    // still line up
+    auto in = grid_events();
+    in[1].waveform.analog_probe1.assign(300, 5);        // Fixint run
+    in[3].waveform.analog_probe1.assign(300, -20000);   // int16 run
+    for (bool as_bin : {false, true}) {
+        MsgPackWriter w;
+        w.analog_as_bin = as_bin;
+        w.write_batch(0, 0, in);
+        EventFilter f;
+        f.energy(1500, 65535);  // Events 14, 15
+        BatchHeader hdr;
+        EventColumns cols;
+        ASSERT_TRUE(FileReader::decode_block(view_of(w), hdr, cols, f));
+        ASSERT_EQ(cols.size(), 2u);
+        EXPECT_EQ(cols.energy[0], 1500);
+        EXPECT_EQ(cols.energy[1], 1600);
+        ASSERT_EQ(cols.num_waveforms(), 1u);
+        EXPECT_EQ(cols.waveform_index[1], 0);
+        std::vector<int16_t> ap1(cols.analog_probe1.data(0),
+                                 cols.analog_probe1.data(0) + cols.analog_probe1.size(0));
+        EXPECT_EQ(ap1, in[15].waveform.analog_probe1);
+    }
+}
+
+TEST(EventFilter, SkipWaveformMatchesSkip) {
+    Event ev = make_event(0, 0, 100, 0, 1000);
+    MsgPackWriter w;
+    w.write_event(ev);
+    w.put(0xc0);
+
+    delila::MsgPackParser a(w.buf.data(), w.buf.size());
+    delila::MsgPackParser b(w.buf.data(), w.buf.size());
+    size_t n;
+    ASSERT_TRUE(a.read_array_header(n));
+    ASSERT_TRUE(b.read_array_header(n));
+    for (int i = 0; i < 6; i++) ASSERT_TRUE(a.skip() && b.skip());
+    ASSERT_TRUE(a.skip());
+    ASSERT_TRUE(b.skip_waveform());
+    EXPECT_EQ(a.position(), b.position());
+    EXPECT_TRUE(b.read_nil());
+
+    // Truncated waveform
+    delila::MsgPackParser c(w.buf.data(), w.buf.size() - 10);
+    ASSERT_TRUE(c.read_array_header(n));
+    for (int i = 0; i < 6; i++) ASSERT_TRUE(c.skip());
+    EXPECT_FALSE(c.skip_waveform());
+}
+
+TEST(EventFilter, TimeWindowSkipsBlocks) {
+    std::vector<TestBatch> batches(4);
+    for (int b = 0; b < 4; b++) {
+        for (int i = 0; i < 10; i++) {
+            batches[b].events.push_back(make_event(0, 0, 100, 1000.0 * b + 10.0 * i, 64));
+        }
+    }
+    TempFile file(build_file(batches));
+
+    EventFilter f;
+    f.time(2000.0, 2050.0);
+    for (bool indexed : {false, true}) {
+        FileReader reader;
+        ASSERT_TRUE(reader.open(file.path()));
+        if (indexed) ASSERT_TRUE(reader.load_index());
+        BatchHeader hdr;
+        EventColumns cols;
+        size_t events = 0;
+        size_t decoded = 0;
+        while (reader.next_columns(hdr, cols, f)) {
+            events += cols.size();
+            decoded++;
+        }
+        EXPECT_TRUE(reader.error().empty()) << reader.error();
+        EXPECT_EQ(events, 5u);
+        EXPECT_EQ(reader.blocks_read(), 4u);
+        // Only block 2 is read once the index gives the block time ranges
+        EXPECT_EQ(decoded, indexed ? 1u : 4u);
+    }
+}
+
+TEST(EventFilter, ZoneMapsPruneBlocks) {
+    // Block b holds channel b only, energies 1000 * b + [0, 10)
+    std::vector<TestBatch> batches(6);
+    for (int b = 0; b < 6; b++) {
+        for (int i = 0; i < 10; i++) {
+            batches[b].events.push_back(make_event(0, static_cast<uint8_t>(b),
+                                                   static_cast<uint16_t>(1000 * b + i), i, 16));
+        }
+    }
+    TempFile file(build_file(batches));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), delila::ReadMode::Stream));
+    ASSERT_TRUE(reader.load_index());
+
+    auto count = [&](const EventFilter& f) {
+        reader.rewind();
+        BatchHeader hdr;
+        EventColumns cols;
+        size_t events = 0;
+        while (reader.next_columns(hdr, cols, f)) events += cols.size();
+        EXPECT_TRUE(reader.error().empty()) << reader.error();
+        return events;
+    };
+
+    EventFilter channels;
+    channels.select(0, 1).select(0, 4);
+    EXPECT_EQ(count(channels), 20u);
+    EXPECT_EQ(reader.blocks_skipped(), 4u);
+    EXPECT_EQ(reader.blocks_read(), 6u);
+
+    EventFilter energy;
+    energy.energy(2005, 3002);
+    EXPECT_EQ(count(energy), 8u);
+    EXPECT_EQ(reader.blocks_skipped(), 4u);
+
+    EventFilter none;
+    none.select(1);
+    EXPECT_EQ(count(none), 0u);
+    EXPECT_EQ(reader.blocks_skipped(), 6u);
+    EXPECT_EQ(reader.bytes_read(), 0u);
+
+    EventFilter flags;
+    flags.flags(0x01);  // Not in the zone map: nothing pruned
+    EXPECT_EQ(count(flags), 60u);
+    EXPECT_EQ(reader.blocks_skipped(), 0u);
+}
+
+TEST(EventFilter, ChainUsesSidecarZoneMaps) {
+    std::vector<TestBatch> a(2), b(2);
+    for (int i = 0; i < 4; i++) {
+        a[i / 2].events.push_back(make_event(0, 1, 100, i));
+        b[i / 2].events.push_back(make_event(0, 2, 100, i));
+    }
+    TempFile fa(build_file(a)), fb(build_file(b));
+    for (const TempFile* f : {&fa, &fb}) {
+        FileReader r;
+        ASSERT_TRUE(r.open(f->path()));
+        ASSERT_TRUE(r.load_index());
+        ASSERT_TRUE(r.index().save(delila::BlockIndex::sidecar_path(f->path())));
+    }
+
+    delila::FileChain chain;
+    chain.add_file(fa.path());
+    chain.add_file(fb.path());
+    EventFilter f;
+    f.select(0, 2);
+    BatchHeader hdr;
+    EventColumns cols;
+    size_t events = 0;
+    while (chain.next_columns(hdr, cols, f)) events += cols.size();
+    EXPECT_EQ(events, 4u);
+    // Nothing of the first file is read
+    FileReader rb;
+    ASSERT_TRUE(rb.open(fb.path()));
+    EXPECT_EQ(chain.bytes_read(), rb.footer().data_bytes);
+    for (const TempFile* file : {&fa, &fb}) {
+        std::remove(delila::BlockIndex::sidecar_path(file->path()).c_str());
+    }
+}
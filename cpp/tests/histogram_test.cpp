@@ -0,0 +1,246 @@
+// Unit tests for histogram.hpp
+
+#include <gtest/gtest.h>
+
+#include "delila/histogram.hpp"
+#include "delila/reader.hpp"
+#include "test_writer.hpp"
+
+using delila::EventColumns;
+using delila::HistogramConfig;
+using delila::HistogramOptions;
+using delila::HistogramSet;
+using delila::Histogram1D;
+using delila::Histogram2D;
+using delila_test::BatchPattern;
+using delila_test::build_file;
+using delila_test::generate_batches;
+using delila_test::make_event;
+using delila_test::TempFile;
+using delila_test::TestBatch;
+
+namespace {
+
+// 200 events per block on 3 modules x 5 channels, energies spread over
+// the whole range
+std::vector<TestBatch> spectrum_batches(int n_blocks) {
+    BatchPattern p;
+    p.events = 200;
+    p.channels = 5;
+    p.block_ns = 1e6;
+    p.edit = [](int b, int i, delila::Event& ev) {
+        ev.module = static_cast<uint8_t>(i % 3);
+        ev.energy = static_cast<uint16_t>((b * 7919 + i * 331) % 65536);
+        ev.energy_short = static_cast<uint16_t>(ev.energy / 2 + i);
+    };
+    return generate_batches(n_blocks, p);
+}
+
+// Every event of `path` filled one block at a time on this thread
+HistogramSet fill_sequential(const std::string& path, const HistogramOptions& opt) {
+    HistogramSet set(opt);
+    delila::FileReader reader;
+    EXPECT_TRUE(reader.open(path));
+    delila::BatchHeader header;
+    EventColumns cols;
+    while (reader.next_columns(header, cols)) set.fill(cols);
+    return set;
+}
+
+// Scalar columns of ev appended to cols (no waveform)
+void push_event(EventColumns& cols, const delila::Event& ev) {
+    size_t i = cols.size();
+    cols.resize_events(i + 1);
+    cols.module[i] = ev.module;
+    cols.channel[i] = ev.channel;
+    cols.energy[i] = ev.energy;
+    cols.energy_short[i] = ev.energy_short;
+    cols.timestamp_ns[i] = ev.timestamp_ns;
+    cols.flags[i] = ev.flags;
+    cols.waveform_index[i] = delila::NO_WAVEFORM;
+}
+
+}  // namespace
+
+// Same cases as the monitor's Histogram1D tests (src/monitor/mod.rs)
+TEST(Histogram1D, BinsLikeMonitor) {
+    HistogramConfig config;
+    EXPECT_EQ(config.num_bins, 65536u);
+    EXPECT_EQ(config.min_value, 0.0f);
+    EXPECT_EQ(config.max_value, 65536.0f);
+
+    Histogram1D hist(HistogramConfig{100, 0.0f, 100.0f});
+    hist.fill(50.0f);
+    hist.fill(0.0f);
+    hist.fill(99.9f);
+    EXPECT_EQ(hist.total_counts(), 3u);
+    EXPECT_EQ(hist.bins()[50], 1u);
+    EXPECT_EQ(hist.bins()[0], 1u);
+    EXPECT_EQ(hist.bins()[99], 1u);
+
+    hist.fill(-10.0f);
+    hist.fill(100.0f);
+    hist.fill(150.0f);
+    EXPECT_EQ(hist.total_counts(), 6u);
+    EXPECT_EQ(hist.underflow(), 1u);
+    EXPECT_EQ(hist.overflow(), 2u);
+
+    hist.clear();
+    EXPECT_EQ(hist.total_counts(), 0u);
+    EXPECT_EQ(hist.bins()[50], 0u);
+}
+
+TEST(Histogram1D, UnevenBinWidth) {
+    // 3 bins over [0, 10): width 3.333..., 9.99 must land in the last bin
+    Histogram1D hist(HistogramConfig{3, 0.0f, 10.0f});
+    for (float v : {0.0f, 3.3f, 3.34f, 6.6f, 6.7f, 9.99f}) hist.fill(v);
+    EXPECT_EQ(hist.bins(), (std::vector<uint64_t>{2, 2, 2}));
+    EXPECT_NEAR(hist.axis().bin_low_edge(1), 3.3333, 1e-4);
+    EXPECT_EQ(hist.axis().bin_of(-0.5f), -1);
+    EXPECT_EQ(hist.axis().bin_of(10.0f), 3);
+}
+
+TEST(Histogram2D, FillAndOutside) {
+    Histogram2D hist(HistogramConfig{4, 0.0f, 4.0f}, HistogramConfig{2, 0.0f, 2.0f});
+    hist.fill(0.5f, 0.5f);
+    hist.fill(3.5f, 1.5f);
+    hist.fill(3.5f, 1.5f);
+    hist.fill(5.0f, 0.5f);   // x overflow
+    hist.fill(1.0f, -1.0f);  // y underflow
+    EXPECT_EQ(hist.total_counts(), 5u);
+    EXPECT_EQ(hist.outside(), 2u);
+    EXPECT_EQ(hist.at(0, 0), 1u);
+    EXPECT_EQ(hist.at(3, 1), 2u);
+    EXPECT_EQ(hist.bins()[1 * 4 + 3], 2u);
+
+    Histogram2D other = hist;
+    hist.add(other);
+    EXPECT_EQ(hist.at(3, 1), 4u);
+    EXPECT_EQ(hist.outside(), 4u);
+}
+
+TEST(HistogramSet, OnePassFillsEverything) {
+    HistogramOptions opt;
+    opt.energy = HistogramConfig{1024, 0.0f, 65536.0f};
+    opt.psd = true;
+    opt.per_channel = true;
+    opt.psd_per_channel = true;
+    HistogramSet set(opt);
+
+    EventColumns cols;
+    for (int i = 0; i < 10; i++) {
+        delila::Event ev = make_event(1, static_cast<uint8_t>(i % 2), static_cast<uint16_t>(i * 64),
+                                      i, 0);
+        ev.energy_short = static_cast<uint16_t>(i * 32);
+        push_event(cols, ev);
+    }
+    set.fill(cols, 8);  // First 8 only
+
+    EXPECT_EQ(set.events(), 8u);
+    EXPECT_EQ(set.energy().total_counts(), 8u);
+    EXPECT_EQ(set.energy().bins()[7], 1u);  // 7 * 64 / 64
+    EXPECT_EQ(set.energy_short().bins()[3], 2u);  // 192 and 224
+    EXPECT_EQ(set.module().bins()[1], 8u);
+    EXPECT_EQ(set.channel().bins()[0], 4u);
+    EXPECT_EQ(set.psd().total_counts(), 8u);
+    EXPECT_EQ(set.psd().at(7, 3), 1u);
+
+    ASSERT_EQ(set.channels().size(), 2u);
+    const Histogram1D* ch1 = set.channel_energy(1, 1);
+    ASSERT_NE(ch1, nullptr);
+    EXPECT_EQ(ch1->total_counts(), 4u);
+    EXPECT_EQ(ch1->bins()[1], 1u);
+    EXPECT_EQ(ch1->bins()[0], 0u);
+    ASSERT_NE(set.channel_psd(1, 0), nullptr);
+    EXPECT_EQ(set.channel_psd(1, 0)->total_counts(), 4u);
+    EXPECT_EQ(set.channel_energy(0, 0), nullptr);
+
+    HistogramSet copy = set;
+    set.add(copy);
+    EXPECT_EQ(set.events(), 16u);
+    EXPECT_EQ(set.channel_energy(1, 1)->total_counts(), 8u);
+    set.clear();
+    EXPECT_EQ(set.events(), 0u);
+    EXPECT_TRUE(set.channels().empty());
+    EXPECT_EQ(set.channel_energy(1, 1), nullptr);
+}
+
+TEST(HistogramSet, LookupBinsLikeFloatFill) {
+    // Every u16 through the set's lookup tables vs Histogram1D::fill()
+    HistogramOptions opt;
+    opt.energy = HistogramConfig{1000, 13.5f, 60000.7f};
+    opt.psd = true;
+    opt.psd_energy = HistogramConfig{77, 100.0f, 5000.0f};
+    opt.psd_short = HistogramConfig{3, 0.0f, 10.0f};
+    HistogramSet set(opt);
+    Histogram1D expected(opt.energy);
+    Histogram2D expected_psd(opt.psd_energy, opt.psd_short);
+
+    EventColumns cols;
+    for (uint32_t v = 0; v < 65536; v++) {
+        delila::Event ev = make_event(0, 0, static_cast<uint16_t>(v), v, 0);
+        ev.energy_short = static_cast<uint16_t>(v % 12);
+        push_event(cols, ev);
+        expected.fill(static_cast<float>(v));
+        expected_psd.fill(static_cast<float>(v), static_cast<float>(v % 12));
+    }
+    set.fill(cols);
+    EXPECT_EQ(set.energy().bins(), expected.bins());
+    EXPECT_EQ(set.energy().underflow(), expected.underflow());
+    EXPECT_EQ(set.energy().overflow(), expected.overflow());
+    EXPECT_EQ(set.energy().total_counts(), 65536u);
+    EXPECT_EQ(set.psd().bins(), expected_psd.bins());
+    EXPECT_EQ(set.psd().outside(), expected_psd.outside());
+}
+
+TEST(HistogramSet, PerChannelOffByDefault) {
+    HistogramSet set;
+    EventColumns cols;
+    push_event(cols, make_event(0, 0, 100, 0, 0));
+    set.fill(cols);
+    EXPECT_TRUE(set.channels().empty());
+    EXPECT_EQ(set.channel_energy(0, 0), nullptr);
+    EXPECT_TRUE(set.psd().bins().empty());
+    EXPECT_EQ(set.energy().bins()[100], 1u);
+}
+
+TEST(FillHistograms, ParallelMatchesSequential) {
+    TempFile a(build_file(spectrum_batches(9)));
+    TempFile b(build_file(spectrum_batches(4)));
+    HistogramOptions opt;
+    opt.psd = true;
+    opt.per_channel = true;
+
+    HistogramSet expected = fill_sequential(a.path(), opt);
+    expected.add(fill_sequential(b.path(), opt));
+
+    std::vector<std::string> errors;
+    HistogramSet got = delila::fill_histograms({a.path(), b.path()}, opt, 4, &errors);
+    EXPECT_TRUE(errors.empty());
+    EXPECT_EQ(got.events(), 13u * 200);
+    EXPECT_EQ(got.events(), expected.events());
+    EXPECT_EQ(got.energy().bins(), expected.energy().bins());
+    EXPECT_EQ(got.energy_short().bins(), expected.energy_short().bins());
+    EXPECT_EQ(got.channel().bins(), expected.channel().bins());
+    EXPECT_EQ(got.psd().bins(), expected.psd().bins());
+    ASSERT_EQ(got.channels().size(), 15u);
+    for (const auto& ch : expected.channels()) {
+        const Histogram1D* h = got.channel_energy(ch.module, ch.channel);
+        ASSERT_NE(h, nullptr);
+        EXPECT_EQ(h->bins(), ch.energy.bins());
+    }
+}
+
+TEST(FillHistograms, FilterAndErrors) {
+    TempFile file(build_file(spectrum_batches(6)));
+    delila::EventFilter filter;
+    filter.select(2);
+
+    std::vector<std::string> errors;
+    HistogramSet got = delila::fill_histograms({file.path(), "/nonexistent.delila"},
+                                               HistogramOptions(), 3, &errors, &filter);
+    ASSERT_EQ(errors.size(), 1u);
+    EXPECT_NE(errors[0].find("/nonexistent.delila"), std::string::npos);
+    EXPECT_EQ(got.module().bins()[2], got.events());
+    EXPECT_EQ(got.events(), 6u * 66);  // i % 3 == 2 for 66 of 200
+}
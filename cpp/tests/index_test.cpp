@@ -0,0 +1,277 @@
+// Unit tests for BlockIndex and FileReader random access
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+
+#include "delila/index.hpp"
+#include "delila/reader.hpp"
+#include "test_writer.hpp"
+
+using delila::BatchHeader;
+using delila::BlockIndex;
+using delila::BlockIndexEntry;
+using delila::BlockView;
+using delila::Event;
+using delila::FileReader;
+using delila_test::BatchPattern;
+using delila_test::build_file;
+using delila_test::generate_batches;
+using delila_test::make_event;
+using delila_test::TempFile;
+using delila_test::TestBatch;
+
+namespace {
+
+// Two interleaved sources, 10 events per block, 100 ns apart.
+// Block b covers [b * 500, b * 500 + 900] ns, so neighbouring blocks overlap.
+// Waveforms in block 2 only.
+std::vector<TestBatch> interleaved_batches(int n_blocks) {
+    BatchPattern p;
+    p.sources = 2;
+    p.block_ns = 500.0;
+    p.event_ns = 100.0;
+    p.edit = [](int b, int, delila::Event& ev) {
+        if (b == 2) ev = make_event(ev.module, ev.channel, ev.energy, ev.timestamp_ns, 32);
+    };
+    return generate_batches(n_blocks, p);
+}
+
+BlockIndexEntry entry(uint64_t offset, double first, double last) {
+    BlockIndexEntry e;
+    e.offset = offset;
+    e.length = 10;
+    e.num_events = 1;
+    e.first_timestamp_ns = first;
+    e.last_timestamp_ns = last;
+    return e;
+}
+
+// Removes <file>.idx on destruction
+class SidecarGuard {
+public:
+    explicit SidecarGuard(const std::string& data_path)
+        : path_(BlockIndex::sidecar_path(data_path)) {}
+    ~SidecarGuard() { std::remove(path_.c_str()); }
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+};
+
+}  // namespace
+
+TEST(BlockIndex, BytesRoundtrip) {
+    BlockIndex index;
+    index.set_data_file_size(4096);
+    index.push(entry(100, 5.0, 50.0));
+    index.push(entry(200, 40.0, 90.5));
+
+    auto bytes = index.to_bytes();
+    ASSERT_EQ(bytes.size(), delila::INDEX_HEADER_SIZE + 2 * delila::INDEX_ENTRY_SIZE);
+    EXPECT_EQ(std::string(bytes.begin(), bytes.begin() + 8), "DLIDX001");
+
+    BlockIndex restored;
+    ASSERT_TRUE(restored.parse(bytes.data(), bytes.size()));
+    EXPECT_EQ(restored.data_file_size(), 4096u);
+    ASSERT_EQ(restored.size(), 2u);
+    EXPECT_EQ(restored[1].offset, 200u);
+    EXPECT_DOUBLE_EQ(restored[1].last_timestamp_ns, 90.5);
+}
+
+TEST(BlockIndex, ZoneMapRoundtrip) {
+    BlockIndexEntry e = entry(100, 5.0, 50.0);
+    e.add_to_zone_map(1, 3, 700, true);
+    e.add_to_zone_map(17, 3, 90, false);  // Module 17 shares the bits of module 1
+    EXPECT_TRUE(e.has_zone_map);
+    EXPECT_EQ(e.min_energy, 90);
+    EXPECT_EQ(e.max_energy, 700);
+    EXPECT_EQ(e.waveform_events, 1u);
+    EXPECT_TRUE(e.may_contain(1, 3));
+    EXPECT_TRUE(e.may_contain(17, 3));
+    EXPECT_FALSE(e.may_contain(1, 4));
+
+    BlockIndex index;
+    index.push(e);
+    index.push(entry(200, 40.0, 90.5));  // No zone map
+    auto bytes = index.to_bytes();
+    BlockIndex restored;
+    ASSERT_TRUE(restored.parse(bytes.data(), bytes.size()));
+    EXPECT_TRUE(restored[0].has_zone_map);
+    EXPECT_EQ(restored[0].max_energy, 700);
+    EXPECT_EQ(restored[0].waveform_events, 1u);
+    EXPECT_EQ(restored[0].channels, e.channels);
+    EXPECT_FALSE(restored[1].has_zone_map);
+    EXPECT_TRUE(restored[1].may_contain(5, 5));
+}
+
+TEST(BlockIndex, ReadsEntriesWithoutZoneMap) {
+    // 40-byte entries of sidecars written before zone maps
+    BlockIndex index;
+    index.set_data_file_size(4096);
+    index.push(entry(100, 5.0, 50.0));
+    auto bytes = index.to_bytes();
+    std::vector<uint8_t> old(bytes.begin(), bytes.begin() + delila::INDEX_HEADER_SIZE +
+                                                delila::INDEX_ENTRY_MIN_SIZE);
+    old[8] = static_cast<uint8_t>(delila::INDEX_ENTRY_MIN_SIZE);
+
+    BlockIndex restored;
+    ASSERT_TRUE(restored.parse(old.data(), old.size()));
+    ASSERT_EQ(restored.size(), 1u);
+    EXPECT_EQ(restored[0].offset, 100u);
+    EXPECT_DOUBLE_EQ(restored[0].last_timestamp_ns, 50.0);
+    EXPECT_FALSE(restored[0].has_zone_map);
+}
+
+TEST(BlockIndex, RejectsBadMagicAndTruncation) {
+    BlockIndex index;
+    index.push(entry(0, 0.0, 1.0));
+    auto bytes = index.to_bytes();
+
+    BlockIndex parsed;
+    EXPECT_FALSE(parsed.parse(bytes.data(), bytes.size() - 1));
+    bytes[0] = 'X';
+    EXPECT_FALSE(parsed.parse(bytes.data(), bytes.size()));
+}
+
+TEST(BlockIndex, LowerBoundHandlesOverlap) {
+    // Block 1 (source B) ends late; block 2 starts early
+    BlockIndex index;
+    index.push(entry(0, 0.0, 100.0));
+    index.push(entry(1, 50.0, 400.0));
+    index.push(entry(2, 30.0, 200.0));
+    index.push(entry(3, 300.0, 500.0));
+
+    EXPECT_EQ(index.lower_bound(-1.0), 0u);
+    EXPECT_EQ(index.lower_bound(150.0), 1u);
+    EXPECT_EQ(index.lower_bound(450.0), 3u);
+    EXPECT_EQ(index.lower_bound(501.0), 4u);
+
+    EXPECT_EQ(index.blocks_overlapping(120.0, 250.0), (std::vector<size_t>{1, 2}));
+    EXPECT_EQ(index.blocks_overlapping(0.0, 40.0), (std::vector<size_t>{0, 2}));
+    EXPECT_EQ(index.blocks_overlapping(600.0, 700.0), (std::vector<size_t>{}));
+}
+
+TEST(FileReaderIndex, ScanBuildsIndexWithoutSidecar) {
+    TempFile file(build_file(interleaved_batches(6)));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path()));
+    ASSERT_TRUE(reader.load_index()) << reader.error();
+    EXPECT_FALSE(reader.index_from_sidecar());
+
+    const BlockIndex& index = reader.index();
+    ASSERT_EQ(index.size(), 6u);
+    EXPECT_EQ(index.total_events(), 60u);
+    EXPECT_EQ(index[0].offset, reader.data_begin());
+    EXPECT_EQ(index[3].source_id, 1u);
+    EXPECT_DOUBLE_EQ(index[2].first_timestamp_ns, 1000.0);
+    EXPECT_DOUBLE_EQ(index[2].last_timestamp_ns, 1900.0);
+    EXPECT_EQ(reader.blocks_read(), 0u);
+
+    // Zone maps: channels 0..9, waveforms only in block 2
+    EXPECT_TRUE(index[2].has_zone_map);
+    EXPECT_EQ(index[2].waveform_events, 10u);
+    EXPECT_EQ(index[1].waveform_events, 0u);
+    EXPECT_EQ(index[1].min_energy, 100);
+    EXPECT_TRUE(index[1].may_contain(0, 9));
+    EXPECT_FALSE(index[1].may_contain(0, 10));
+}
+
+TEST(FileReaderIndex, UsesMatchingSidecarAndIgnoresStaleOne) {
+    TempFile file(build_file(interleaved_batches(4)));
+    SidecarGuard sidecar(file.path());
+
+    BlockIndex index;
+    {
+        FileReader reader;
+        ASSERT_TRUE(reader.open(file.path()));
+        ASSERT_TRUE(reader.load_index());
+        index = reader.index();
+    }
+    ASSERT_TRUE(index.save(sidecar.path()));
+
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path()));
+    ASSERT_TRUE(reader.load_index());
+    EXPECT_TRUE(reader.index_from_sidecar());
+    EXPECT_EQ(reader.index().size(), 4u);
+
+    // A sidecar for a different file size is rebuilt instead of trusted
+    index.set_data_file_size(index.data_file_size() + 1);
+    ASSERT_TRUE(index.save(sidecar.path()));
+    ASSERT_TRUE(reader.open(file.path()));
+    ASSERT_TRUE(reader.load_index());
+    EXPECT_FALSE(reader.index_from_sidecar());
+    EXPECT_EQ(reader.index().size(), 4u);
+}
+
+TEST(FileReaderIndex, ReadBlockIsRandomAccess) {
+    TempFile file(build_file(interleaved_batches(5)));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), delila::ReadMode::Stream));
+
+    BlockView block;
+    ASSERT_TRUE(reader.read_block(3, block));
+    EXPECT_EQ(block.index, 3u);
+    EXPECT_EQ(block.offset, reader.index()[3].offset);
+
+    // Sequential iteration continues after the block
+    BatchHeader hdr;
+    std::vector<Event> events;
+    ASSERT_TRUE(reader.next_batch(hdr, events));
+    EXPECT_EQ(hdr.sequence_number, 4u);
+    EXPECT_FALSE(reader.next_batch(hdr, events));
+
+    ASSERT_TRUE(reader.read_block(0, block));
+    EXPECT_EQ(block.offset, reader.data_begin());
+    EXPECT_FALSE(reader.read_block(5, block));
+}
+
+TEST(FileReaderIndex, SeekToTimeSkipsEarlierBlocks) {
+    TempFile file(build_file(interleaved_batches(8)));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path()));
+
+    // 1950 ns: block 2 ends at 1900, block 3 covers [1500, 2400]
+    ASSERT_TRUE(reader.seek_to_time(1950.0));
+    BatchHeader hdr;
+    std::vector<Event> events;
+    ASSERT_TRUE(reader.next_batch(hdr, events));
+    EXPECT_EQ(hdr.sequence_number, 3u);
+
+    // Every event at or after t0 is still reachable
+    ASSERT_TRUE(reader.seek_to_time(1950.0));
+    size_t in_window = 0;
+    while (reader.next_batch(hdr, events)) {
+        for (const auto& ev : events) in_window += ev.timestamp_ns >= 1950.0;
+    }
+    EXPECT_EQ(in_window, 80u - 30u - 5u);  // not blocks 0-2 or the first 5 of block 3
+
+    EXPECT_FALSE(reader.seek_to_time(1e9));
+    EXPECT_FALSE(reader.next_batch(hdr, events));
+    EXPECT_TRUE(reader.error().empty());
+}
+
+TEST(FileReaderIndex, ViewBlockLeavesIterationAlone) {
+    TempFile file(build_file(interleaved_batches(4)));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), delila::ReadMode::Mmap));
+    BlockView block;
+    EXPECT_FALSE(reader.view_block(0, block));  // no index yet
+    ASSERT_TRUE(reader.load_index());
+
+    ASSERT_TRUE(reader.view_block(2, block));
+    EXPECT_EQ(block.index, 2u);
+    EXPECT_EQ(block.offset, reader.index()[2].offset);
+    EXPECT_FALSE(reader.view_block(4, block));
+
+    // Sequential iteration still starts at block 0
+    BlockView first;
+    ASSERT_TRUE(reader.next_block(first));
+    EXPECT_EQ(first.index, 0u);
+
+    FileReader stream;
+    ASSERT_TRUE(stream.open(file.path(), delila::ReadMode::Stream));
+    ASSERT_TRUE(stream.load_index());
+    EXPECT_FALSE(stream.view_block(0, block));
+}
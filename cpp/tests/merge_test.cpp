@@ -0,0 +1,177 @@
+// Unit tests for the time-ordered merge
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "delila/merge.hpp"
+#include "test_writer.hpp"
+
+using delila::Event;
+using delila::MergeOptions;
+using delila::TimeMerger;
+using delila_test::build_file;
+using delila_test::make_event;
+using delila_test::TempFile;
+using delila_test::TestBatch;
+
+namespace {
+
+TestBatch batch_of(uint32_t source_id, const std::vector<double>& ts) {
+    TestBatch b;
+    b.source_id = source_id;
+    for (double t : ts) b.events.push_back(make_event(static_cast<uint8_t>(source_id), 0, 1, t));
+    return b;
+}
+
+std::vector<Event> drain(TimeMerger& merger) {
+    std::vector<Event> out;
+    Event ev;
+    while (merger.next(ev)) out.push_back(ev);
+    return out;
+}
+
+bool in_order(const std::vector<Event>& events) {
+    return std::is_sorted(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        return a.timestamp_ns < b.timestamp_ns;
+    });
+}
+
+}  // namespace
+
+TEST(TimeMerger, InterleavesSourcesOfOneFile) {
+    // Source 1 lags source 0 by one block
+    TempFile file(build_file({
+        batch_of(0, {10, 20, 30}),
+        batch_of(0, {40, 50, 60}),
+        batch_of(1, {15, 25, 35}),
+        batch_of(0, {70, 80}),
+        batch_of(1, {45, 55, 65, 75}),
+    }));
+    MergeOptions options;
+    options.max_disorder_ns = 50;
+    TimeMerger merger(options);
+    merger.add_file(file.path());
+
+    std::vector<uint32_t> sources;
+    std::vector<Event> out;
+    Event ev;
+    while (merger.next(ev)) {
+        out.push_back(ev);
+        sources.push_back(merger.source_id());
+    }
+    ASSERT_EQ(out.size(), 15u);
+    EXPECT_TRUE(in_order(out));
+    EXPECT_EQ(sources[0], 0u);
+    EXPECT_EQ(sources[1], 1u);
+    for (size_t i = 0; i < out.size(); i++) EXPECT_EQ(out[i].module, sources[i]);
+
+    const auto& stats = merger.stats();
+    EXPECT_EQ(stats.events, 15u);
+    EXPECT_EQ(stats.late_events, 0u);
+    EXPECT_EQ(stats.forced, 0u);
+    EXPECT_EQ(stats.blocks, 5u);
+    EXPECT_EQ(stats.lanes, 2u);
+    EXPECT_TRUE(merger.errors().empty());
+}
+
+TEST(TimeMerger, MergesInputs) {
+    std::vector<TestBatch> a, b;
+    for (int k = 0; k < 20; k++) {
+        a.push_back(batch_of(0, {k * 100.0, k * 100.0 + 30, k * 100.0 + 60}));
+        b.push_back(batch_of(0, {k * 100.0 + 10, k * 100.0 + 50}));
+    }
+    TempFile fa(build_file(a));
+    TempFile fb(build_file(b));
+    MergeOptions options;
+    options.max_disorder_ns = 0;
+    TimeMerger merger(options);
+    merger.add_file(fa.path());
+    merger.add_file(fb.path());
+
+    auto out = drain(merger);
+    ASSERT_EQ(out.size(), 100u);
+    EXPECT_TRUE(in_order(out));
+    EXPECT_EQ(merger.stats().lanes, 2u);
+    // Inputs advance together, so only about a block per input is held
+    EXPECT_LE(merger.stats().peak_buffered, 10u);
+}
+
+TEST(TimeMerger, DisorderWithinSource) {
+    // Later blocks reach back up to 35 ns, and one batch is unsorted in itself
+    TempFile file(build_file({
+        batch_of(2, {100, 110, 120, 130}),
+        batch_of(2, {105, 140, 150}),
+        batch_of(2, {170, 160, 135}),
+        batch_of(2, {180, 190}),
+    }));
+    MergeOptions options;
+    options.max_disorder_ns = 50;
+    TimeMerger merger(options);
+    merger.add_file(file.path());
+    auto out = drain(merger);
+    ASSERT_EQ(out.size(), 12u);
+    EXPECT_TRUE(in_order(out));
+    EXPECT_EQ(merger.stats().late_events, 0u);
+
+    // A window too short lets the stragglers out late, but none are lost
+    options.max_disorder_ns = 0;
+    TimeMerger strict(options);
+    strict.add_file(file.path());
+    out = drain(strict);
+    EXPECT_EQ(out.size(), 12u);
+    EXPECT_GT(strict.stats().late_events, 0u);
+}
+
+TEST(TimeMerger, FileBoundaryWithinWindow) {
+    // The next file of the chain starts with events older than the end of
+    // the previous one (rotation while events were still buffered)
+    TempFile first(build_file({batch_of(0, {0, 10, 20}), batch_of(1, {5, 15})}), "merge_a");
+    TempFile second(build_file({batch_of(1, {25}), batch_of(0, {30, 40}), batch_of(1, {18, 35})}),
+                    "merge_b");
+    MergeOptions options;
+    options.max_disorder_ns = 100;
+    TimeMerger merger(options);
+    auto& chain = merger.add_input();
+    chain.add_file(first.path());
+    chain.add_file(second.path());
+
+    auto out = drain(merger);
+    ASSERT_EQ(out.size(), 10u);
+    EXPECT_TRUE(in_order(out));
+    EXPECT_EQ(merger.stats().late_events, 0u);
+}
+
+TEST(TimeMerger, BufferCap) {
+    std::vector<TestBatch> batches;
+    for (int k = 0; k < 50; k++) {
+        batches.push_back(batch_of(0, {k * 10.0, k * 10.0 + 5}));
+    }
+    TempFile file(build_file(batches));
+    MergeOptions options;
+    options.max_disorder_ns = 1e12;  // Would hold the whole file
+    options.max_buffered_events = 8;
+    TimeMerger merger(options);
+    merger.add_file(file.path());
+
+    auto out = drain(merger);
+    EXPECT_EQ(out.size(), 100u);
+    EXPECT_TRUE(in_order(out));
+    EXPECT_GT(merger.stats().forced, 0u);
+    EXPECT_LE(merger.stats().peak_buffered, 9u);
+}
+
+TEST(TimeMerger, NextEventsAndErrors) {
+    TempFile file(build_file({batch_of(0, {1, 2, 3}), batch_of(1, {1.5, 2.5})}));
+    TimeMerger merger;
+    merger.add_file(file.path());
+    merger.add_file("/nonexistent/run9999_0000_x.delila");
+
+    std::vector<Event> events;
+    EXPECT_EQ(merger.next_events(events, 4), 4u);
+    EXPECT_EQ(merger.next_events(events, 4), 1u);
+    EXPECT_EQ(merger.next_events(events, 4), 0u);
+    EXPECT_TRUE(in_order(events));
+    EXPECT_EQ(merger.errors().size(), 1u);
+}
@@ -0,0 +1,96 @@
+// Unit tests for the pipeline Message envelope
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "delila/message.hpp"
+#include "delila/msgpack.hpp"
+#include "test_writer.hpp"
+
+using delila::BatchHeader;
+using delila::Event;
+using delila::Message;
+using delila::MessageKind;
+using delila::MsgPackParser;
+using delila::parse_message;
+using delila_test::make_event;
+using delila_test::MsgPackWriter;
+
+TEST(Message, DataCarriesBatch) {
+    std::vector<Event> events = {make_event(1, 2, 300, 10.0), make_event(1, 3, 400, 20.0)};
+    MsgPackWriter w;
+    w.write_map(1);
+    w.write_str("Data");
+    w.write_batch(7, 42, events);
+
+    Message msg;
+    ASSERT_TRUE(parse_message(w.buf.data(), w.buf.size(), msg));
+    EXPECT_EQ(msg.kind, MessageKind::Data);
+    EXPECT_EQ(msg.source_id, 7u);
+    EXPECT_EQ(msg.sequence_number, 42u);
+
+    MsgPackParser p(msg.payload, msg.payload_size);
+    BatchHeader header;
+    std::vector<Event> got;
+    ASSERT_TRUE(p.parse_batch(header, got));
+    ASSERT_EQ(got.size(), 2u);
+    EXPECT_EQ(got[1].channel, 3);
+    EXPECT_TRUE(p.at_end());
+}
+
+TEST(Message, BareBatchIsData) {
+    MsgPackWriter w;
+    w.write_batch(3, 1, {make_event(0, 0, 1, 0.0)});
+    Message msg;
+    ASSERT_TRUE(parse_message(w.buf.data(), w.buf.size(), msg));
+    EXPECT_EQ(msg.kind, MessageKind::Data);
+    EXPECT_EQ(msg.source_id, 3u);
+    EXPECT_EQ(msg.payload, w.buf.data());
+}
+
+TEST(Message, ControlVariants) {
+    MsgPackWriter eos;
+    eos.write_map(1);
+    eos.write_str("EndOfStream");
+    eos.write_array(1);
+    eos.write_uint(5);
+    Message msg;
+    ASSERT_TRUE(parse_message(eos.buf.data(), eos.buf.size(), msg));
+    EXPECT_EQ(msg.kind, MessageKind::EndOfStream);
+    EXPECT_EQ(msg.source_id, 5u);
+    EXPECT_EQ(msg.payload, nullptr);
+
+    // Struct fields by name are accepted as well
+    MsgPackWriter hb;
+    hb.write_map(1);
+    hb.write_str("Heartbeat");
+    hb.write_map(3);
+    hb.write_str("counter");
+    hb.write_uint(9);
+    hb.write_str("source_id");
+    hb.write_uint(2);
+    hb.write_str("timestamp");
+    hb.write_uint(1000);
+    ASSERT_TRUE(parse_message(hb.buf.data(), hb.buf.size(), msg));
+    EXPECT_EQ(msg.kind, MessageKind::Heartbeat);
+    EXPECT_EQ(msg.source_id, 2u);
+    EXPECT_EQ(msg.timestamp, 1000u);
+    EXPECT_EQ(msg.counter, 9u);
+}
+
+TEST(Message, RejectsUnknownAndTruncated) {
+    MsgPackWriter w;
+    w.write_map(1);
+    w.write_str("Command");
+    w.write_array(0);
+    Message msg;
+    EXPECT_FALSE(parse_message(w.buf.data(), w.buf.size(), msg));
+
+    MsgPackWriter d;
+    d.write_map(1);
+    d.write_str("Data");
+    d.write_batch(1, 1, {make_event(0, 0, 1, 0.0)});
+    EXPECT_FALSE(parse_message(d.buf.data(), 8, msg));
+    EXPECT_FALSE(parse_message(d.buf.data(), 0, msg));
+}
@@ -0,0 +1,229 @@
+// Unit tests for metrics.hpp
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "delila/histogram.hpp"
+#include "delila/metrics.hpp"
+#include "delila/reader.hpp"
+#include "test_writer.hpp"
+
+using delila::Metrics;
+using delila::MetricsSnapshot;
+using delila::RateSnapshot;
+using delila::Stage;
+using delila_test::BatchPattern;
+using delila_test::build_file;
+using delila_test::build_file_v3;
+using delila_test::generate_batches;
+using delila_test::make_event;
+using delila_test::TempFile;
+using delila_test::TestBatch;
+
+namespace {
+
+// 3 blocks of 10 events, every other one with a 50-sample waveform
+std::vector<TestBatch> waveform_batches() {
+    BatchPattern p;
+    p.energy = 1000;
+    p.block_ns = 100.0;
+    p.waveform_every = 2;
+    p.waveform_phase = 1;
+    p.waveform_samples = 50;
+    return generate_batches(3, p);
+}
+
+}  // namespace
+
+// Same cases as the counter and rate tests of src/common/metrics.rs
+TEST(Metrics, CountersLikeRust) {
+    Metrics m;
+    m.add_received();
+    m.add_received();
+    m.add_processed();
+    m.inc_dropped();
+    m.add_events_received(100);
+    m.add_events_processed(95);
+    m.add_bytes(1000);
+    m.add_time(Stage::Fill, 42);
+
+    MetricsSnapshot s = m.snapshot();
+    EXPECT_EQ(s.received, 2u);
+    EXPECT_EQ(s.processed, 1u);
+    EXPECT_EQ(s.dropped, 1u);
+    EXPECT_EQ(s.events_received, 100u);
+    EXPECT_EQ(s.events_processed, 95u);
+    EXPECT_EQ(s.bytes, 1000u);
+    EXPECT_EQ(s.ns(Stage::Fill), 42u);
+    EXPECT_EQ(s.ns(Stage::Parse), 0u);
+
+    m.reset();
+    s = m.snapshot();
+    EXPECT_EQ(s.received, 0u);
+    EXPECT_EQ(s.ns(Stage::Fill), 0u);
+}
+
+TEST(Metrics, RatesLikeRust) {
+    MetricsSnapshot prev;
+    prev.received = 100;
+    prev.processed = 90;
+    prev.events_processed = 900;
+    prev.bytes = 10000;
+    MetricsSnapshot cur;
+    cur.received = 200;
+    cur.processed = 180;
+    cur.events_processed = 1800;
+    cur.bytes = 20000;
+
+    RateSnapshot r = cur.rate_from(prev, 2.0);
+    EXPECT_EQ(r.received_rate, 50.0);
+    EXPECT_EQ(r.processed_rate, 45.0);
+    EXPECT_EQ(r.events_rate, 450.0);
+    EXPECT_EQ(r.bytes_rate, 5000.0);
+    EXPECT_EQ(cur.rate_from(prev, 0.0).bytes_rate, 0.0);
+
+    RateSnapshot f;
+    f.bytes_rate = 500.0;
+    EXPECT_EQ(f.format_bytes_rate(), "500 B/s");
+    f.bytes_rate = 1500.0;
+    EXPECT_EQ(f.format_bytes_rate(), "1.50 KB/s");
+    f.bytes_rate = 1.5e6;
+    EXPECT_EQ(f.format_bytes_rate(), "1.50 MB/s");
+    f.bytes_rate = 1.5e9;
+    EXPECT_EQ(f.format_bytes_rate(), "1.50 GB/s");
+    f.events_rate = 500.0;
+    EXPECT_EQ(f.format_events_rate(), "500 /s");
+    f.events_rate = 1500.0;
+    EXPECT_EQ(f.format_events_rate(), "1.50 K/s");
+    f.events_rate = 1.5e6;
+    EXPECT_EQ(f.format_events_rate(), "1.50 M/s");
+}
+
+TEST(Metrics, JsonFieldNames) {
+    MetricsSnapshot s;
+    s.received = 3;
+    s.events_processed = 30;
+    s.bytes = 1234;
+    s.stage_ns[static_cast<size_t>(Stage::Write)] = 7;
+    s.elapsed_secs = 2.0;
+    std::string json = s.to_json("convert \"run\"");
+
+    EXPECT_EQ(json.front(), '{');
+    EXPECT_EQ(json.back(), '}');
+    EXPECT_NE(json.find("\"component\": \"convert \\\"run\\\"\""), std::string::npos);
+    // ComponentMetrics
+    EXPECT_NE(json.find("\"events_processed\": 30"), std::string::npos);
+    EXPECT_NE(json.find("\"bytes_transferred\": 1234"), std::string::npos);
+    EXPECT_NE(json.find("\"event_rate\": 15"), std::string::npos);
+    EXPECT_NE(json.find("\"data_rate\": 617"), std::string::npos);
+    // CounterSnapshot / RateSnapshot
+    EXPECT_NE(json.find("\"received\": 3"), std::string::npos);
+    EXPECT_NE(json.find("\"events_rate\": 15"), std::string::npos);
+    EXPECT_NE(json.find("\"bytes_rate\": 617"), std::string::npos);
+    EXPECT_NE(json.find("\"write_ns\": 7"), std::string::npos);
+    EXPECT_NE(json.find("\"waveform_ns\": 0"), std::string::npos);
+}
+
+TEST(Metrics, StageTimerAndNull) {
+    Metrics m;
+    {
+        delila::StageTimer t(&m, Stage::Write);
+    }
+    delila::StageTimer none(nullptr, Stage::Write);
+    none.stop();
+    EXPECT_GT(m.snapshot().ns(Stage::Write), 0u);
+}
+
+TEST(Metrics, ReaderCountsEveryStage) {
+    auto batches = waveform_batches();
+    TempFile file(build_file(batches));
+
+    Metrics m;
+    delila::FileReader reader;
+    ASSERT_TRUE(reader.open(file.path()));
+    reader.set_metrics(&m);
+    ASSERT_TRUE(reader.load_index());  // The scan is not counted
+    delila::BatchHeader header;
+    std::vector<delila::Event> events;
+    while (reader.next_batch(header, events)) {}
+    EXPECT_TRUE(reader.error().empty());
+
+    MetricsSnapshot s = m.snapshot();
+    EXPECT_EQ(s.received, 3u);
+    EXPECT_EQ(s.processed, 3u);
+    EXPECT_EQ(s.dropped, 0u);
+    EXPECT_EQ(s.events_received, 30u);
+    EXPECT_EQ(s.events_processed, 0u);  // Handing on is the caller's
+    EXPECT_EQ(s.bytes, reader.bytes_read());
+    EXPECT_EQ(s.waveform_samples, 3u * 5 * 50);
+    EXPECT_GT(s.ns(Stage::Parse), 0u);
+    EXPECT_GT(s.ns(Stage::Waveform), 0u);
+    EXPECT_EQ(s.ns(Stage::Decompress), 0u);
+
+    // Columns, with and without waveforms
+    m.reset();
+    reader.rewind();
+    delila::EventColumns cols;
+    ASSERT_TRUE(reader.next_columns(header, cols));
+    ASSERT_TRUE(reader.next_columns(header, cols, false));
+    s = m.snapshot();
+    EXPECT_EQ(s.processed, 2u);
+    EXPECT_EQ(s.waveform_samples, 5u * 50);
+}
+
+TEST(Metrics, DecompressAndDropped) {
+    if (!delila::compression_available(delila::Compression::Lz4)) GTEST_SKIP();
+    TempFile file(build_file_v3(waveform_batches(), delila::Compression::Lz4));
+    Metrics m;
+    delila::FileReader reader;
+    ASSERT_TRUE(reader.open(file.path()));
+    reader.set_metrics(&m);
+    delila::BlockView block;
+    ASSERT_TRUE(reader.next_block(block));
+    delila::BatchHeader header;
+    delila::EventColumns cols;
+    ASSERT_TRUE(delila::FileReader::decode_block(block, header, cols, nullptr, true, &m));
+    EXPECT_GT(m.snapshot().ns(Stage::Decompress), 0u);
+
+    delila::BlockView bad = block;
+    bad.size = 12;  // Payload cut short
+    EXPECT_FALSE(delila::FileReader::decode_block(bad, header, cols, nullptr, true, &m));
+    MetricsSnapshot s = m.snapshot();
+    EXPECT_EQ(s.received, 1u);
+    EXPECT_EQ(s.processed, 1u);
+    EXPECT_EQ(s.dropped, 1u);
+}
+
+TEST(Metrics, FillHistogramsCountsFill) {
+    TempFile file(build_file(waveform_batches()));
+    Metrics m;
+    delila::HistogramSet h =
+        delila::fill_histograms({file.path()}, delila::HistogramOptions(), 2, nullptr, nullptr, &m);
+    MetricsSnapshot s = m.snapshot();
+    EXPECT_EQ(h.events(), 30u);
+    EXPECT_EQ(s.received, 3u);
+    EXPECT_EQ(s.processed, 3u);
+    EXPECT_EQ(s.events_processed, 30u);
+    EXPECT_EQ(s.waveform_samples, 0u);  // Not decoded
+    EXPECT_GT(s.ns(Stage::Fill), 0u);
+}
+
+TEST(MetricsReporter, ReportsStageShares) {
+    Metrics m;
+    std::ostringstream out;
+    delila::MetricsReporter report(m, 1000.0, &out);
+    m.add_processed(12);
+    m.add_events_processed(3000);
+    m.add_time(Stage::Parse, 300);
+    m.add_time(Stage::Fill, 100);
+    EXPECT_FALSE(report.poll());
+    report.report();
+    std::string line = out.str();
+    EXPECT_NE(line.find("(12 blocks, 3000 events)"), std::string::npos) << line;
+    EXPECT_NE(line.find("parse 75%"), std::string::npos) << line;
+    EXPECT_NE(line.find("fill 25%"), std::string::npos) << line;
+
+    delila::MetricsReporter never(m, 0.0, &out);
+    EXPECT_FALSE(never.poll());
+}
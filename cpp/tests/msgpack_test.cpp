@@ -0,0 +1,273 @@
+// Unit tests for the MessagePack batch parser
+
+#include <gtest/gtest.h>
+
+#include "delila/msgpack.hpp"
+#include "test_writer.hpp"
+
+using delila::BatchHeader;
+using delila::Event;
+using delila::MsgPackParser;
+using delila_test::make_event;
+using delila_test::MsgPackWriter;
+
+TEST(MsgPackParser, UintAllWidths) {
+    MsgPackWriter w;
+    const uint64_t values[] = {0, 127, 128, 255, 256, 65535, 65536, 4294967295ULL,
+                               4294967296ULL, 18446744073709551615ULL};
+    for (uint64_t v : values) w.write_uint(v);
+
+    MsgPackParser p(w.buf.data(), w.buf.size());
+    for (uint64_t v : values) {
+        uint64_t got;
+        ASSERT_TRUE(p.read_uint(got));
+        EXPECT_EQ(got, v);
+    }
+    EXPECT_TRUE(p.at_end());
+}
+
+TEST(MsgPackParser, SignedIntAllWidths) {
+    MsgPackWriter w;
+    const int64_t values[] = {0, 1, -1, -32, -33, -128, -129, -32768, 127, 200, 32767, -8192};
+    for (int64_t v : values) w.write_int(v);
+
+    MsgPackParser p(w.buf.data(), w.buf.size());
+    for (int64_t v : values) {
+        int64_t got;
+        ASSERT_TRUE(p.read_int(got));
+        EXPECT_EQ(got, v);
+    }
+}
+
+TEST(MsgPackParser, TruncatedInputFails) {
+    MsgPackWriter w;
+    w.write_uint(70000);  // 0xce + 4 bytes
+    MsgPackParser p(w.buf.data(), w.buf.size() - 1);
+    uint64_t v;
+    EXPECT_FALSE(p.read_uint(v));
+}
+
+TEST(MsgPackParser, ScalarEventRoundtrip) {
+    std::vector<Event> in = {make_event(1, 2, 1000, 12345.5), make_event(3, 63, 65535, 1e15)};
+    MsgPackWriter w;
+    w.write_batch(7, 42, in);
+
+    MsgPackParser p(w.buf.data(), w.buf.size());
+    BatchHeader hdr;
+    std::vector<Event> out;
+    ASSERT_TRUE(p.parse_batch(hdr, out));
+    EXPECT_EQ(hdr.source_id, 7u);
+    EXPECT_EQ(hdr.sequence_number, 42u);
+    ASSERT_EQ(out.size(), 2u);
+    EXPECT_EQ(out[1].module, 3);
+    EXPECT_EQ(out[1].channel, 63);
+    EXPECT_EQ(out[1].energy, 65535);
+    EXPECT_EQ(out[1].energy_short, 65535 / 4);
+    EXPECT_DOUBLE_EQ(out[1].timestamp_ns, 1e15);
+    EXPECT_EQ(out[1].flags, 1u);
+    EXPECT_FALSE(out[1].has_waveform);
+    EXPECT_TRUE(p.at_end());
+}
+
+TEST(MsgPackParser, WaveformEventRoundtrip) {
+    std::vector<Event> in = {make_event(0, 5, 800, 1.0, 300)};
+    MsgPackWriter w;
+    w.write_batch(0, 0, in);
+
+    MsgPackParser p(w.buf.data(), w.buf.size());
+    BatchHeader hdr;
+    std::vector<Event> out;
+    ASSERT_TRUE(p.parse_batch(hdr, out));
+    ASSERT_EQ(out.size(), 1u);
+    ASSERT_TRUE(out[0].has_waveform);
+    EXPECT_EQ(out[0].waveform.analog_probe1, in[0].waveform.analog_probe1);
+    EXPECT_EQ(out[0].waveform.analog_probe2, in[0].waveform.analog_probe2);
+    EXPECT_EQ(out[0].waveform.digital_probe1, in[0].waveform.digital_probe1);
+    EXPECT_EQ(out[0].waveform.digital_probe4, in[0].waveform.digital_probe4);
+    EXPECT_EQ(out[0].waveform.time_resolution, 1);
+    EXPECT_EQ(out[0].waveform.trigger_threshold, 300);
+}
+
+TEST(MsgPackParser, SkipsWaveformWhenNotRequested) {
+    std::vector<Event> in = {make_event(0, 5, 800, 1.0, 300), make_event(1, 6, 900, 2.0)};
+    MsgPackWriter w;
+    w.write_batch(0, 0, in);
+
+    MsgPackParser p(w.buf.data(), w.buf.size());
+    BatchHeader hdr;
+    ASSERT_TRUE(p.parse_batch_header(hdr));
+    Event ev;
+    ASSERT_TRUE(p.parse_event(ev, false));
+    EXPECT_TRUE(ev.has_waveform);
+    EXPECT_TRUE(ev.waveform.analog_probe1.empty());
+    EXPECT_EQ(ev.energy, 800);
+    ASSERT_TRUE(p.parse_event(ev, false));
+    EXPECT_EQ(ev.channel, 6);
+    EXPECT_TRUE(p.at_end());
+}
+
+TEST(MsgPackParser, DigitalProbeAsBin) {
+    MsgPackWriter w;
+    w.put(0xc4);
+    w.put(3);
+    w.put(1);
+    w.put(0);
+    w.put(1);
+
+    MsgPackParser p(w.buf.data(), w.buf.size());
+    std::vector<uint8_t> arr;
+    ASSERT_TRUE(p.read_u8_array(arr));
+    EXPECT_EQ(arr, (std::vector<uint8_t>{1, 0, 1}));
+}
+
+TEST(MsgPackParser, TruncatedDigitalProbeFails) {
+    // Two elements, the first one 0xcc 0x80: the second lies past the end.
+    // The byte after the parsed range must not be read as that element.
+    const uint8_t buf[] = {0x92, 0xcc, 0x80, 0x01};
+    MsgPackParser p(buf, 3);
+    std::vector<uint8_t> arr;
+    EXPECT_FALSE(p.read_u8_array(arr));
+}
+
+TEST(MsgPackParser, SkipTruncatedDigitalProbeFails) {
+    // Waveform whose digital_probe1 claims two elements but ends after the
+    // first (0xcc 0x80); exact-size heap buffer, so a sanitizer build
+    // catches a read past it
+    std::vector<uint8_t> buf = {0x98, 0x90, 0x90, 0x92, 0xcc, 0x80};
+    MsgPackParser p(buf.data(), buf.size());
+    EXPECT_FALSE(p.skip_waveform());
+}
+
+TEST(MsgPackParser, SkipNestedObjects) {
+    MsgPackWriter w;
+    w.write_map(1);
+    w.write_str("key");
+    w.write_array(3);
+    w.write_f64(1.5);
+    w.write_int(-300);
+    w.write_str("value");
+    w.write_uint(99);
+
+    MsgPackParser p(w.buf.data(), w.buf.size());
+    ASSERT_TRUE(p.skip());
+    uint64_t v;
+    ASSERT_TRUE(p.read_uint(v));
+    EXPECT_EQ(v, 99u);
+}
+
+TEST(MsgPackParser, RejectsBadEventArity) {
+    MsgPackWriter w;
+    w.write_array(5);
+    for (int i = 0; i < 5; i++) w.write_uint(1);
+
+    MsgPackParser p(w.buf.data(), w.buf.size());
+    Event ev;
+    EXPECT_FALSE(p.parse_event(ev));
+}
+
+namespace {
+
+// Events covering every scalar width the batch loops specialize on:
+// fixint / uint8 / uint16 energies, module >= 128, every flags width
+std::vector<Event> mixed_width_events() {
+    const uint16_t energies[] = {5, 127, 128, 255, 256, 40000, 65535};
+    const uint64_t flags[] = {0, 1, 200, 70000, 5000000000ULL};
+    std::vector<Event> events;
+    for (int i = 0; i < 70; i++) {
+        Event ev = make_event(static_cast<uint8_t>(i % 3 == 0 ? 200 : i % 4),
+                              static_cast<uint8_t>(i % 64), energies[i % 7], i * 8.5,
+                              i % 5 == 0 ? 20 : 0);
+        ev.energy_short = energies[(i + 3) % 7];
+        ev.flags = flags[i % 5];
+        events.push_back(ev);
+    }
+    return events;
+}
+
+// parse_events() of `events`, checked event by event against parse_event()
+void expect_batch_matches_events(const std::vector<Event>& events) {
+    MsgPackWriter w;
+    w.write_batch(0, 0, events);
+
+    MsgPackParser one(w.buf.data(), w.buf.size());
+    BatchHeader hdr;
+    ASSERT_TRUE(one.parse_batch_header(hdr));
+    std::vector<Event> expected(events.size());
+    for (auto& ev : expected) ASSERT_TRUE(one.parse_event(ev));
+
+    MsgPackParser batch(w.buf.data(), w.buf.size());
+    ASSERT_TRUE(batch.parse_batch_header(hdr));
+    std::vector<Event> got;
+    ASSERT_TRUE(batch.parse_events(events.size(), got));
+    EXPECT_TRUE(batch.at_end());
+    ASSERT_EQ(got.size(), events.size());
+    for (size_t i = 0; i < got.size(); i++) {
+        SCOPED_TRACE(i);
+        EXPECT_EQ(got[i].module, events[i].module);
+        EXPECT_EQ(got[i].module, expected[i].module);
+        EXPECT_EQ(got[i].channel, expected[i].channel);
+        EXPECT_EQ(got[i].energy, events[i].energy);
+        EXPECT_EQ(got[i].energy_short, events[i].energy_short);
+        EXPECT_EQ(got[i].energy_short, expected[i].energy_short);
+        EXPECT_DOUBLE_EQ(got[i].timestamp_ns, expected[i].timestamp_ns);
+        EXPECT_EQ(got[i].flags, events[i].flags);
+        EXPECT_EQ(got[i].has_waveform, expected[i].has_waveform);
+        EXPECT_EQ(got[i].waveform.analog_probe1, expected[i].waveform.analog_probe1);
+    }
+
+    // Columns take the same paths
+    MsgPackParser columns(w.buf.data(), w.buf.size());
+    ASSERT_TRUE(columns.parse_batch_header(hdr));
+    delila::EventColumns cols;
+    ASSERT_TRUE(columns.parse_events_columns(events.size(), cols));
+    EXPECT_TRUE(columns.at_end());
+    ASSERT_EQ(cols.size(), events.size());
+    for (size_t i = 0; i < cols.size(); i++) {
+        SCOPED_TRACE(i);
+        EXPECT_EQ(cols.module[i], expected[i].module);
+        EXPECT_EQ(cols.energy[i], expected[i].energy);
+        EXPECT_EQ(cols.energy_short[i], expected[i].energy_short);
+        EXPECT_EQ(cols.flags[i], expected[i].flags);
+        EXPECT_EQ(cols.has_waveform(i), expected[i].has_waveform);
+    }
+}
+
+}  // namespace
+
+TEST(MsgPackParser, BatchLoopsMatchEventByEvent) {
+    std::vector<Event> events = mixed_width_events();
+    // First event picks the loop: wide 7-field, narrow 6-field, ...
+    expect_batch_matches_events(events);
+    for (size_t first = 1; first < 8; first++) {
+        SCOPED_TRACE(first);
+        expect_batch_matches_events(
+            std::vector<Event>(events.begin() + static_cast<std::ptrdiff_t>(first), events.end()));
+    }
+}
+
+TEST(MsgPackParser, BatchLoopsWideLayout) {
+    // All wide (uint16 energies, fixint flags), without and with waveforms,
+    // the last events closer to the end than the widest scalar prefix
+    std::vector<Event> events;
+    for (int i = 0; i < 40; i++) {
+        Event ev = make_event(static_cast<uint8_t>(i % 2), static_cast<uint8_t>(i % 16),
+                              static_cast<uint16_t>(1000 + i), i * 2.0, i % 9 == 8 ? 10 : 0);
+        ev.flags = static_cast<uint64_t>(i % 3);
+        events.push_back(ev);
+    }
+    expect_batch_matches_events(events);
+    events.front().flags = 300;  // First event not wide: 6-field narrow loop
+    expect_batch_matches_events(events);
+}
+
+TEST(MsgPackParser, BatchLoopsRejectTruncatedEvent) {
+    std::vector<Event> events(3, make_event(1, 2, 1000, 1.0));
+    MsgPackWriter w;
+    w.write_batch(0, 0, events);
+
+    MsgPackParser p(w.buf.data(), w.buf.size() - 1);
+    BatchHeader hdr;
+    ASSERT_TRUE(p.parse_batch_header(hdr));
+    std::vector<Event> got;
+    EXPECT_FALSE(p.parse_events(events.size(), got));
+}
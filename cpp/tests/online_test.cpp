@@ -0,0 +1,265 @@
+// Unit tests for online.hpp: OnlineConsumer threads fed over an inproc PUB
+
+#include <gtest/gtest.h>
+
+#include <zmq.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "delila/online.hpp"
+#include "test_writer.hpp"
+
+using delila::BatchHeader;
+using delila::EventColumns;
+using delila::OnlineConsumer;
+using delila::OnlineOptions;
+using delila::OnlineStats;
+using delila::WorkerStates;
+using delila_test::make_event;
+using delila_test::MsgPackWriter;
+
+namespace {
+
+std::vector<uint8_t> data_frame(uint32_t source, uint64_t seq, int n_events) {
+    std::vector<delila::Event> events;
+    for (int i = 0; i < n_events; i++) {
+        events.push_back(make_event(static_cast<uint8_t>(source), static_cast<uint8_t>(i),
+                                    static_cast<uint16_t>(100 + i), seq * 1000.0 + i,
+                                    i == 0 ? 16 : 0));
+    }
+    MsgPackWriter w;
+    w.write_map(1);
+    w.write_str("Data");
+    w.write_batch(source, seq, events);
+    return w.buf;
+}
+
+std::vector<uint8_t> end_of_stream_frame(uint32_t source) {
+    MsgPackWriter w;
+    w.write_map(1);
+    w.write_str("EndOfStream");
+    w.write_array(1);
+    w.write_uint(source);
+    return w.buf;
+}
+
+std::vector<uint8_t> heartbeat_frame(uint64_t counter) {
+    MsgPackWriter w;
+    w.write_map(1);
+    w.write_str("Heartbeat");
+    w.write_array(3);
+    w.write_uint(0);
+    w.write_uint(1000);
+    w.write_uint(counter);
+    return w.buf;
+}
+
+// Poll until pred() holds; false after 5 s
+bool wait_for(const std::function<bool()>& pred) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// A PUB socket bound to an inproc endpoint of its own context, and the
+// options that point an OnlineConsumer at it
+class Publisher {
+public:
+    Publisher() {
+        static int counter = 0;
+        endpoint_ = "inproc://online_test_" + std::to_string(counter++);
+        context_ = zmq_ctx_new();
+        socket_ = zmq_socket(context_, ZMQ_PUB);
+        int linger = 0;
+        zmq_setsockopt(socket_, ZMQ_LINGER, &linger, sizeof(linger));
+        bound_ = zmq_bind(socket_, endpoint_.c_str()) == 0;
+    }
+    ~Publisher() {
+        zmq_close(socket_);
+        zmq_ctx_term(context_);
+    }
+
+    bool bound() const { return bound_; }
+
+    OnlineOptions options(unsigned n_workers, size_t queue_frames = 1024) const {
+        OnlineOptions opt;
+        opt.endpoint = endpoint_;
+        opt.context = context_;
+        opt.n_workers = n_workers;
+        opt.queue_frames = queue_frames;
+        return opt;
+    }
+
+    void send(const std::vector<uint8_t>& frame) {
+        zmq_send(socket_, frame.data(), frame.size(), 0);
+    }
+
+    // PUB drops everything until the subscription arrives: send heartbeats
+    // until one is received. Returns the frames spent on it.
+    uint64_t sync(const OnlineConsumer& consumer) {
+        uint64_t sent = 0;
+        wait_for([&] {
+            send(heartbeat_frame(sent++));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return consumer.stats().heartbeats > 0;
+        });
+        // Heartbeats sent before the one that got through may still arrive
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return consumer.stats().frames;
+    }
+
+private:
+    std::string endpoint_;
+    void* context_ = nullptr;
+    void* socket_ = nullptr;
+    bool bound_ = false;
+};
+
+struct Seen {
+    std::vector<std::pair<uint32_t, uint64_t>> batches;  // (source_id, sequence_number)
+    uint64_t events = 0;
+    uint64_t waveforms = 0;
+};
+
+}  // namespace
+
+TEST(OnlineConsumer, EveryBatchReachesHandler) {
+    Publisher pub;
+    ASSERT_TRUE(pub.bound());
+    OnlineConsumer consumer(pub.options(4));
+    WorkerStates<Seen> seen(consumer.n_workers());
+    std::atomic<int> bad_worker{0};
+    std::atomic<int> end_of_stream{0};
+    consumer.set_control_handler([&](const delila::Message& m) {
+        if (m.kind == delila::MessageKind::EndOfStream) end_of_stream++;
+    });
+    ASSERT_TRUE(consumer.start([&](unsigned w, const BatchHeader& h, const EventColumns& cols) {
+        if (w >= consumer.n_workers()) bad_worker++;
+        seen.update(w, [&](Seen& s) {
+            s.batches.emplace_back(h.source_id, h.sequence_number);
+            s.events += cols.size();
+            s.waveforms += cols.num_waveforms();
+        });
+    })) << consumer.error();
+    ASSERT_TRUE(consumer.running());
+    pub.sync(consumer);
+
+    uint64_t expected_events = 0;
+    for (uint64_t seq = 0; seq < 100; seq++) {
+        for (uint32_t source = 0; source < 2; source++) {
+            int n = static_cast<int>(seq % 5) + 1;
+            pub.send(data_frame(source, seq, n));
+            expected_events += static_cast<uint64_t>(n);
+        }
+    }
+    pub.send(end_of_stream_frame(0));
+    pub.send(end_of_stream_frame(1));
+    // Frames arrive in order, so everything is queued once both EOS are in
+    ASSERT_TRUE(wait_for([&] { return end_of_stream == 2; }));
+    consumer.stop();
+    EXPECT_FALSE(consumer.running());
+
+    OnlineStats s = consumer.stats();
+    EXPECT_EQ(s.batches, 200u);
+    EXPECT_EQ(s.events, expected_events);
+    EXPECT_EQ(s.dropped, 0u);
+    EXPECT_EQ(s.missing_batches, 0u);
+    EXPECT_EQ(s.bad_frames, 0u);
+    EXPECT_EQ(s.end_of_stream, 2u);
+    EXPECT_EQ(bad_worker, 0);
+
+    std::set<std::pair<uint32_t, uint64_t>> keys;
+    uint64_t events = 0, waveforms = 0, handled = 0;
+    seen.snapshot([&](const Seen& w) {
+        keys.insert(w.batches.begin(), w.batches.end());
+        handled += w.batches.size();
+        events += w.events;
+        waveforms += w.waveforms;
+    });
+    EXPECT_EQ(handled, 200u);
+    EXPECT_EQ(keys.size(), 200u);
+    EXPECT_EQ(events, expected_events);
+    EXPECT_EQ(waveforms, 200u);
+}
+
+TEST(OnlineConsumer, CountsGapsAndBadFrames) {
+    Publisher pub;
+    ASSERT_TRUE(pub.bound());
+    OnlineConsumer consumer(pub.options(2));
+    ASSERT_TRUE(consumer.start([](unsigned, const BatchHeader&, const EventColumns&) {}))
+        << consumer.error();
+    uint64_t base = pub.sync(consumer);
+
+    // Source 0 misses 2 and 3, source 1 starts at 10 and misses 12..14
+    for (uint64_t seq : {0, 1, 4, 5}) pub.send(data_frame(0, seq, 2));
+    for (uint64_t seq : {10, 11, 15}) pub.send(data_frame(1, seq, 2));
+    pub.send({0x01, 0x02, 0x03});  // Not a Message
+    MsgPackWriter bad;             // A Data envelope around a broken batch
+    bad.write_map(1);
+    bad.write_str("Data");
+    bad.write_array(4);
+    bad.write_uint(2);
+    bad.write_uint(0);
+    bad.write_uint(0);
+    bad.write_array(1);
+    bad.write_array(5);
+    pub.send(bad.buf);
+    pub.send(end_of_stream_frame(0));
+    ASSERT_TRUE(wait_for([&] { return consumer.stats().end_of_stream == 1; }));
+    consumer.stop();
+
+    OnlineStats s = consumer.stats();
+    EXPECT_EQ(s.frames, base + 10);
+    EXPECT_EQ(s.missing_batches, 5u);
+    EXPECT_EQ(s.bad_frames, 2u);
+    EXPECT_EQ(s.batches, 7u);
+    EXPECT_EQ(s.events, 14u);
+    EXPECT_EQ(s.dropped, 0u);
+}
+
+TEST(OnlineConsumer, DropsWhenQueueFullAndStopDrains) {
+    Publisher pub;
+    ASSERT_TRUE(pub.bound());
+    OnlineConsumer consumer(pub.options(1, 2));
+    std::promise<void> entered_promise, release_promise;
+    std::shared_future<void> release = release_promise.get_future().share();
+    std::future<void> entered = entered_promise.get_future();
+    std::vector<uint64_t> handled;  // One worker: no lock needed
+    ASSERT_TRUE(consumer.start([&](unsigned, const BatchHeader& h, const EventColumns&) {
+        if (handled.empty()) {
+            entered_promise.set_value();
+            release.wait();
+        }
+        // Slow, so frames are still queued when stop() is called
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        handled.push_back(h.sequence_number);
+    })) << consumer.error();
+    uint64_t base = pub.sync(consumer);
+
+    // The worker holds batch 0; 1 and 2 fill the queue, 3..5 are dropped
+    pub.send(data_frame(0, 0, 1));
+    ASSERT_EQ(entered.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    for (uint64_t seq = 1; seq < 6; seq++) pub.send(data_frame(0, seq, 1));
+    ASSERT_TRUE(wait_for([&] { return consumer.stats().frames == base + 6; }));
+    EXPECT_EQ(consumer.stats().dropped, 3u);
+
+    release_promise.set_value();
+    consumer.stop();
+    OnlineStats s = consumer.stats();
+    EXPECT_EQ(handled, (std::vector<uint64_t>{0, 1, 2}));
+    EXPECT_EQ(s.batches, 3u);
+    EXPECT_EQ(s.dropped, 3u);
+    // Dropped here is not missing upstream
+    EXPECT_EQ(s.missing_batches, 0u);
+}
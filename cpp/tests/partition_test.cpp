@@ -0,0 +1,224 @@
+// Unit tests for partition.hpp
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+
+#include "delila/index.hpp"
+#include "delila/partition.hpp"
+#include "test_writer.hpp"
+
+using delila::BlockRange;
+using delila::FileSummary;
+using delila::PartitionPlan;
+using delila::PartitionReader;
+using delila::PartitionResult;
+using delila::PlanOptions;
+using delila_test::BatchPattern;
+using delila_test::build_file;
+using delila_test::generate_batches;
+using delila_test::make_event;
+using delila_test::TempFile;
+using delila_test::TestBatch;
+
+namespace {
+
+// Two sources, 20 to 26 events per block, a waveform on every fourth
+std::vector<TestBatch> batches(int n_blocks, double t0) {
+    BatchPattern p;
+    p.sources = 2;
+    p.events = 20;
+    p.events_cycle = 7;
+    p.channels = 8;
+    p.energy = 1000;
+    p.t0 = t0;
+    p.waveform_every = 4;
+    p.waveform_samples = 30;
+    return generate_batches(n_blocks, p);
+}
+
+// Three files of 9, 2 and 14 blocks; sidecars removed afterwards
+struct Campaign {
+    std::vector<std::unique_ptr<TempFile>> files;
+    std::vector<std::string> paths;
+
+    Campaign() {
+        int blocks[] = {9, 2, 14};
+        for (int f = 0; f < 3; f++) {
+            files.emplace_back(new TempFile(build_file(batches(blocks[f], f * 1e6))));
+            paths.push_back(files.back()->path());
+        }
+    }
+    ~Campaign() {
+        for (const auto& p : paths) std::remove(delila::BlockIndex::sidecar_path(p).c_str());
+    }
+};
+
+// Run the worker of every partition and collect the results
+std::vector<PartitionResult> run_all(const PartitionPlan& plan, bool columns = false) {
+    std::vector<PartitionResult> results;
+    for (size_t p = 0; p < plan.partitions.size(); p++) {
+        PartitionReader reader;
+        EXPECT_TRUE(reader.open(plan, p));
+        delila::BatchHeader header;
+        std::vector<delila::Event> events;
+        delila::EventColumns cols;
+        if (columns) {
+            while (reader.next_columns(header, cols)) {}
+        } else {
+            while (reader.next_batch(header, events)) {}
+        }
+        EXPECT_TRUE(reader.error().empty()) << reader.error();
+        results.push_back(reader.result());
+    }
+    return results;
+}
+
+}  // namespace
+
+TEST(PlanPartitions, BalancedContiguousAndDeterministic) {
+    Campaign c;
+    PlanOptions opt;
+    opt.partitions = 4;
+    std::vector<std::string> errors;
+    PartitionPlan plan = delila::plan_partitions(c.paths, opt, &errors);
+    EXPECT_TRUE(errors.empty());
+    ASSERT_EQ(plan.files.size(), 3u);
+    EXPECT_EQ(plan.files[2].blocks, 14u);
+    ASSERT_EQ(plan.partitions.size(), 4u);
+
+    // Every block exactly once, in file and block order
+    size_t file = 0, next = 0;
+    uint64_t total = 0, largest = 0;
+    for (const auto& part : plan.partitions) {
+        ASSERT_FALSE(part.ranges.empty());
+        for (const BlockRange& r : part.ranges) {
+            if (r.file != file) {
+                EXPECT_EQ(next, plan.files[file].blocks);
+                file = r.file;
+                next = 0;
+            }
+            EXPECT_EQ(r.first_block, next);
+            next = r.end_block;
+        }
+        total += part.bytes();
+        largest = std::max(largest, part.bytes());
+    }
+    EXPECT_EQ(file, 2u);
+    EXPECT_EQ(next, 14u);
+    EXPECT_LT(largest, total / 4 + total / 10);  // Within a block or so of 1/4
+    // Scanned indices were saved for the workers
+    std::ifstream sidecar(delila::BlockIndex::sidecar_path(c.paths[0]));
+    EXPECT_TRUE(sidecar.good());
+
+    // Same input, same plan; and the manifest round-trips
+    PartitionPlan again = delila::plan_partitions(c.paths, opt);
+    std::string path = c.paths[0] + ".plan";
+    ASSERT_TRUE(plan.save(path));
+    PartitionPlan loaded;
+    std::string err;
+    ASSERT_TRUE(loaded.load(path, &err)) << err;
+    std::remove(path.c_str());
+    for (const PartitionPlan* p : {&again, &loaded}) {
+        ASSERT_EQ(p->partitions.size(), plan.partitions.size());
+        for (size_t i = 0; i < plan.partitions.size(); i++) {
+            ASSERT_EQ(p->partitions[i].ranges.size(), plan.partitions[i].ranges.size());
+            for (size_t k = 0; k < plan.partitions[i].ranges.size(); k++) {
+                EXPECT_EQ(p->partitions[i].ranges[k].first_block,
+                          plan.partitions[i].ranges[k].first_block);
+                EXPECT_EQ(p->partitions[i].ranges[k].end_block,
+                          plan.partitions[i].ranges[k].end_block);
+            }
+        }
+    }
+    EXPECT_EQ(loaded.files[1].path, c.paths[1]);
+    EXPECT_EQ(loaded.files[1].footer.data_checksum, plan.files[1].footer.data_checksum);
+    EXPECT_EQ(loaded.files[1].footer.first_event_time_ns, plan.files[1].footer.first_event_time_ns);
+}
+
+TEST(PlanPartitions, TargetBytesAndClamp) {
+    Campaign c;
+    PlanOptions opt;
+    opt.target_bytes = 1;  // One block per partition at most
+    PartitionPlan plan = delila::plan_partitions(c.paths, opt);
+    EXPECT_EQ(plan.partitions.size(), 25u);
+
+    opt.target_bytes = 1ull << 40;
+    EXPECT_EQ(delila::plan_partitions(c.paths, opt).partitions.size(), 1u);
+
+    std::vector<std::string> errors;
+    plan = delila::plan_partitions({"/nonexistent.delila"}, PlanOptions(), &errors);
+    EXPECT_TRUE(plan.partitions.empty());
+    EXPECT_EQ(errors.size(), 1u);
+}
+
+TEST(PartitionReader, ResultsCombineToFooters) {
+    Campaign c;
+    PlanOptions opt;
+    opt.partitions = 5;
+    PartitionPlan plan = delila::plan_partitions(c.paths, opt);
+
+    for (bool columns : {false, true}) {
+        std::vector<PartitionResult> results = run_all(plan, columns);
+        // Through the result files, as on the merge node
+        for (auto& r : results) {
+            std::string path = c.paths[0] + ".result";
+            ASSERT_TRUE(r.save(path));
+            std::string err;
+            ASSERT_TRUE(r.load(path, &err)) << err;
+            std::remove(path.c_str());
+        }
+        std::vector<std::string> problems;
+        std::vector<FileSummary> files = delila::combine_partitions(plan, results, &problems);
+        EXPECT_TRUE(problems.empty());
+        ASSERT_EQ(files.size(), 3u);
+        for (const auto& f : files) {
+            EXPECT_TRUE(f.check_footer().empty()) << f.path << ": " << f.check_footer()[0];
+            EXPECT_EQ(f.checksum, delila::ChecksumStatus::Match);
+        }
+        EXPECT_EQ(files[2].blocks, 14u);
+        EXPECT_EQ(delila::RunSummary::of(files).waveforms,
+                  delila::RunSummary::of(delila::summarize_files(c.paths, 1)).waveforms);
+    }
+}
+
+TEST(PartitionReader, MissingAndFailedPartitions) {
+    Campaign c;
+    PlanOptions opt;
+    opt.partitions = 3;
+    PartitionPlan plan = delila::plan_partitions(c.paths, opt);
+    std::vector<PartitionResult> results = run_all(plan);
+
+    std::vector<PartitionResult> partial(results.begin(), results.end() - 1);
+    partial.push_back(results[0]);  // Twice
+    std::vector<std::string> problems;
+    std::vector<FileSummary> files = delila::combine_partitions(plan, partial, &problems);
+    ASSERT_EQ(problems.size(), 2u);
+    EXPECT_NE(problems[0].find("more than one"), std::string::npos);
+    EXPECT_NE(problems[1].find("partition 2: no result"), std::string::npos);
+    EXPECT_FALSE(files[2].check_footer().empty());
+    EXPECT_EQ(files[2].checksum, delila::ChecksumStatus::Incomplete);
+
+    PartitionReader reader;
+    EXPECT_FALSE(reader.open(plan, 3));
+    EXPECT_FALSE(reader.error().empty());
+}
+
+TEST(PartitionReader, RefusesFileChangedSincePlanning) {
+    Campaign c;
+    PlanOptions opt;
+    opt.partitions = 1;
+    PartitionPlan plan = delila::plan_partitions(c.paths, opt);
+    std::vector<uint8_t> tail = {1, 2, 3};
+    delila_test::append_bytes(c.paths[0], tail, 0, tail.size());
+
+    PartitionReader reader;
+    ASSERT_TRUE(reader.open(plan, 0));
+    delila::BatchHeader header;
+    std::vector<delila::Event> events;
+    EXPECT_FALSE(reader.next_batch(header, events));
+    EXPECT_NE(reader.error().find("changed since planning"), std::string::npos) << reader.error();
+    EXPECT_EQ(reader.result().error, reader.error());
+}
@@ -0,0 +1,263 @@
+// Unit tests for pulse.hpp
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#include "delila/pulse.hpp"
+#include "delila/reader.hpp"
+#include "delila/simd.hpp"
+#include "test_writer.hpp"
+
+using delila::PsdParameters;
+using delila::PulseBlock;
+using delila::PulseColumns;
+using delila::PulseProcessor;
+using delila::PulseResult;
+using delila::SimdLevel;
+using delila_test::build_file;
+using delila_test::make_event;
+using delila_test::TempFile;
+using delila_test::TestBatch;
+
+namespace {
+
+const SimdLevel ALL_LEVELS[] = {SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2,
+                                SimdLevel::NEON};
+
+// Baseline, then a pulse of `height` over [start, start + width) (negative
+// if height < 0)
+std::vector<int16_t> box_pulse(size_t n, int16_t baseline, int height, size_t start,
+                               size_t width) {
+    std::vector<int16_t> s(n, baseline);
+    for (size_t i = start; i < start + width && i < n; i++) {
+        s[i] = static_cast<int16_t>(baseline + height);
+    }
+    return s;
+}
+
+// Scintillator-like noisy pulses, negative polarity
+std::vector<int16_t> noisy_pulse(size_t n, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0.0, 3.0);
+    double amplitude = 500.0 + rng() % 8000;
+    double decay = 5.0 + rng() % 40;
+    std::vector<int16_t> s(n);
+    for (size_t i = 0; i < n; i++) {
+        double t = static_cast<double>(i) - 100.0;
+        double pulse = t < 0   ? 0.0
+                       : t < 4 ? amplitude * t / 4
+                               : amplitude * std::exp(-(t - 4) / decay);
+        s[i] = static_cast<int16_t>(std::lround(8000.0 - pulse + noise(rng)));
+    }
+    return s;
+}
+
+bool same_bits(float a, float b) { return std::memcmp(&a, &b, sizeof(a)) == 0; }
+bool same_bits(double a, double b) { return std::memcmp(&a, &b, sizeof(a)) == 0; }
+
+class PulseLevelTest : public ::testing::TestWithParam<SimdLevel> {
+protected:
+    void SetUp() override {
+        saved_ = delila::simd_level();
+        if (!delila::set_simd_level(GetParam())) {
+            GTEST_SKIP() << delila::simd_level_name(GetParam()) << " not supported";
+        }
+    }
+    void TearDown() override { delila::set_simd_level(saved_); }
+
+    SimdLevel saved_ = SimdLevel::Scalar;
+};
+
+}  // namespace
+
+TEST(PsdParameters, SetByDigitizerName) {
+    PsdParameters par;
+    std::string err;
+    EXPECT_TRUE(par.set("gate_long_ns", "320", &err)) << err;
+    EXPECT_TRUE(par.set("gate_short_ns", "48"));
+    EXPECT_TRUE(par.set("gate_pre_ns", "16"));
+    EXPECT_TRUE(par.set("cfd_delay_ns", "6"));
+    EXPECT_TRUE(par.set("trigger_threshold", "150"));
+    EXPECT_TRUE(par.set("polarity", "POLARITY_POSITIVE"));
+    EXPECT_TRUE(par.set("cfd_fraction", "0.5"));
+    EXPECT_EQ(par.gate_long_ns, 320u);
+    EXPECT_EQ(par.gate_short_ns, 48u);
+    EXPECT_EQ(par.gate_pre_ns, 16u);
+    EXPECT_EQ(par.cfd_delay_ns, 6u);
+    EXPECT_EQ(par.trigger_threshold, 150u);
+    EXPECT_FALSE(par.negative());
+    EXPECT_EQ(par.cfd_fraction, 0.5);
+    EXPECT_TRUE(par.set("polarity", "Negative"));
+    EXPECT_TRUE(par.negative());
+
+    EXPECT_FALSE(par.set("gate_long_ns", "-4", &err));
+    EXPECT_NE(err.find("gate_long_ns"), std::string::npos) << err;
+    EXPECT_FALSE(par.set("gate_long_ns", "40ns"));
+    EXPECT_FALSE(par.set("polarity", "Up", &err));
+    EXPECT_FALSE(par.set("sample_ns", "0"));
+    EXPECT_FALSE(par.set("gate_length", "40", &err));
+    EXPECT_NE(err.find("Unknown"), std::string::npos) << err;
+    EXPECT_EQ(par.gate_long_ns, 320u);
+}
+
+TEST_P(PulseLevelTest, BoxPulseCharges) {
+    PsdParameters par;  // Negative, gates from sample (200 - 40) / 2 = 80
+    par.gate_pre_ns = 40;
+    par.gate_long_ns = 400;   // 200 samples
+    par.gate_short_ns = 40;   // 20 samples
+    PulseProcessor proc(par);
+    for (size_t n : {size_t(300), size_t(301), size_t(333)}) {
+        std::vector<int16_t> s = box_pulse(n, 1000, -250, 100, 50);
+        PulseResult r = proc.process(s.data(), s.size());
+        EXPECT_EQ(r.baseline, 1000.0f);
+        EXPECT_EQ(r.amplitude, 250.0f);
+        EXPECT_EQ(r.q_long, 50.0f * 250);
+        EXPECT_EQ(r.q_short, 0.0f);  // Short gate ends at sample 100
+        EXPECT_FLOAT_EQ(r.psd, 1.0f);
+    }
+
+    // Gates cut at the end of the waveform
+    std::vector<int16_t> s = box_pulse(120, 1000, -250, 90, 50);
+    PulseResult r = proc.process(s.data(), s.size());
+    EXPECT_EQ(r.q_long, 30.0f * 250);
+    EXPECT_EQ(r.q_short, 10.0f * 250);
+    EXPECT_FLOAT_EQ(r.psd, 2.0f / 3);
+}
+
+TEST_P(PulseLevelTest, CfdOnLinearRise) {
+    // Positive, rising 100 ADC per sample from sample 100 to 2000 at 120
+    std::vector<int16_t> s(400, 500);
+    for (size_t i = 100; i < s.size(); i++) {
+        s[i] = static_cast<int16_t>(500 + std::min<size_t>(i - 100, 20) * 100);
+    }
+    PsdParameters par;
+    par.polarity = "Positive";
+    par.cfd_delay_ns = 8;  // 4 samples
+    par.cfd_fraction = 0.25;
+    PulseProcessor proc(par);
+    PulseResult r = proc.process(s.data(), s.size());
+    EXPECT_EQ(r.baseline, 500.0f);
+    EXPECT_EQ(r.amplitude, 2000.0f);
+    // 0.25 * (i - 100) = i - 104 at i = 105.333
+    EXPECT_NEAR(r.cfd_time_ns, (100 + 4 / 0.75) * 2.0, 1e-4);
+
+    // Armed by a threshold before the crossing: same crossing
+    par.trigger_threshold = 150;
+    PulseProcessor armed(par);
+    EXPECT_NEAR(armed.process(s.data(), s.size()).cfd_time_ns, r.cfd_time_ns, 1e-9);
+
+    // time_resolution 1 doubles the sample period (and halves the gates and delay)
+    PulseResult slow = proc.process(s.data(), s.size(), 1);
+    EXPECT_NEAR(slow.cfd_time_ns, (100 + 2 / 0.75) * 4.0, 1e-4);
+
+    // Flat waveform: nothing to time
+    std::vector<int16_t> flat(200, 500);
+    PulseResult none = proc.process(flat.data(), flat.size());
+    EXPECT_EQ(none.amplitude, 0.0f);
+    EXPECT_TRUE(std::isnan(none.cfd_time_ns));
+    EXPECT_TRUE(std::isnan(none.psd));
+}
+
+TEST_P(PulseLevelTest, SameResultsAsScalar) {
+    PsdParameters par;
+    par.trigger_threshold = 100;
+    PulseProcessor proc(par);
+    std::vector<PulseResult> got;
+    std::vector<std::vector<int16_t>> waves;
+    for (uint32_t seed = 0; seed < 40; seed++) {
+        waves.push_back(noisy_pulse(300 + seed * 13, seed));
+        got.push_back(proc.process(waves.back().data(), waves.back().size()));
+    }
+    ASSERT_TRUE(delila::set_simd_level(SimdLevel::Scalar));
+    for (size_t i = 0; i < waves.size(); i++) {
+        PulseResult want = proc.process(waves[i].data(), waves[i].size());
+        EXPECT_TRUE(same_bits(got[i].baseline, want.baseline)) << i;
+        EXPECT_TRUE(same_bits(got[i].amplitude, want.amplitude)) << i;
+        EXPECT_TRUE(same_bits(got[i].q_long, want.q_long)) << i;
+        EXPECT_TRUE(same_bits(got[i].q_short, want.q_short)) << i;
+        EXPECT_TRUE(same_bits(got[i].psd, want.psd)) << i;
+        EXPECT_TRUE(same_bits(got[i].cfd_time_ns, want.cfd_time_ns)) << i;
+        EXPECT_GT(want.q_long, want.q_short);
+        EXPECT_FALSE(std::isnan(want.cfd_time_ns)) << i;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Levels, PulseLevelTest, ::testing::ValuesIn(ALL_LEVELS),
+                         [](const auto& info) {
+                             std::string name = delila::simd_level_name(info.param);
+                             return name == "sse4.1" ? std::string("sse41") : name;
+                         });
+
+TEST(PulseProcessor, ColumnsWithoutWaveforms) {
+    TestBatch batch;
+    for (int i = 0; i < 6; i++) {
+        batch.events.push_back(make_event(0, static_cast<uint8_t>(i), 100, i, i % 2 ? 64 : 0));
+    }
+    TempFile file(build_file({batch}));
+    delila::FileReader reader;
+    ASSERT_TRUE(reader.open(file.path()));
+    delila::BatchHeader header;
+    delila::EventColumns cols;
+    ASSERT_TRUE(reader.next_columns(header, cols));
+
+    PulseProcessor proc;
+    PulseColumns pulses;
+    proc.process(cols, pulses);
+    ASSERT_EQ(pulses.size(), 6u);
+    for (size_t i = 0; i < 6; i++) {
+        EXPECT_EQ(std::isnan(pulses.q_long[i]), i % 2 == 0) << i;
+        EXPECT_EQ(std::isnan(pulses.baseline[i]), i % 2 == 0) << i;
+    }
+    size_t w = static_cast<size_t>(cols.waveform_index[1]);
+    PulseResult r = proc.process(cols.analog_probe1.data(w), 64, cols.time_resolution[w]);
+    EXPECT_EQ(pulses.q_long[1], r.q_long);
+    EXPECT_EQ(pulses.amplitude[1], r.amplitude);
+}
+
+TEST(ReprocessPulses, ParallelInFileOrder) {
+    std::vector<TestBatch> batches(40);
+    for (int b = 0; b < 40; b++) {
+        for (int i = 0; i < 20; i++) {
+            batches[b].events.push_back(make_event(0, static_cast<uint8_t>(i % 4), 100,
+                                                   b * 1000.0 + i, i % 3 ? 96 + b : 0));
+        }
+    }
+    TempFile file(build_file(batches));
+
+    PsdParameters par;
+    par.gate_long_ns = 120;
+    PulseProcessor proc(par);
+    std::vector<PulseColumns> expected;
+    delila::FileReader reader;
+    ASSERT_TRUE(reader.open(file.path()));
+    delila::BatchHeader header;
+    delila::EventColumns cols;
+    while (reader.next_columns(header, cols)) {
+        expected.emplace_back();
+        proc.process(cols, expected.back());
+    }
+
+    std::vector<std::string> errors;
+    size_t n_blocks = 0;
+    uint64_t events = delila::reprocess_pulses(
+        {file.path(), "/nonexistent.delila", file.path()}, par,
+        [&](const PulseBlock& block) {
+            size_t b = n_blocks++ % expected.size();
+            EXPECT_EQ(block.header.sequence_number, b);
+            EXPECT_EQ(*block.path, file.path());
+            ASSERT_EQ(block.pulses.size(), block.cols.size());
+            EXPECT_EQ(block.cols.timestamp_ns[0], b * 1000.0);
+            for (size_t i = 0; i < block.cols.size(); i++) {
+                EXPECT_TRUE(same_bits(block.pulses.q_long[i], expected[b].q_long[i]));
+                EXPECT_TRUE(same_bits(block.pulses.cfd_time_ns[i], expected[b].cfd_time_ns[i]));
+            }
+        },
+        4, &errors);
+    EXPECT_EQ(n_blocks, 80u);
+    EXPECT_EQ(events, 2u * 40 * 20);
+    ASSERT_EQ(errors.size(), 1u);
+    EXPECT_NE(errors[0].find("/nonexistent.delila"), std::string::npos);
+}
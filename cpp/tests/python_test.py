@@ -0,0 +1,103 @@
+"""Tests of the delila Python module (src/python.cpp)
+
+Run by CTest (python_module) with the built module on PYTHONPATH and
+DELILA_WRITE_TEST_FILE naming write_test_file, which writes the test file
+with test_writer.hpp: two blocks, events (module, channel, energy, ts)
+(1, 2, 1000, 10), (1, 3, 2000, 20) + 10 samples | (2, 4, 3000, 30) + 5
+samples, (2, 5, 4000, 40).
+"""
+
+import gc
+import os
+import subprocess
+
+import numpy as np
+import pytest
+
+import delila
+
+
+@pytest.fixture
+def data_file(tmp_path):
+    path = tmp_path / "run0010_0000_test.delila"
+    subprocess.run([os.environ["DELILA_WRITE_TEST_FILE"], str(path)], check=True)
+    return str(path)
+
+
+def expect_column(cols, name, dtype, values):
+    assert cols[name].dtype == dtype, name
+    np.testing.assert_array_equal(cols[name], values)
+
+
+def test_read_columns(data_file):
+    cols = delila.read(data_file, threads=1)
+    expect_column(cols, "module", np.uint8, [1, 1, 2, 2])
+    expect_column(cols, "channel", np.uint8, [2, 3, 4, 5])
+    expect_column(cols, "energy", np.uint16, [1000, 2000, 3000, 4000])
+    expect_column(cols, "energy_short", np.uint16, [250, 500, 750, 1000])
+    expect_column(cols, "timestamp_ns", np.float64, [10.0, 20.0, 30.0, 40.0])
+    expect_column(cols, "flags", np.uint64, [1, 1, 1, 1])
+    expect_column(cols, "waveform_index", np.int32, [-1, 0, 1, -1])
+    expect_column(cols, "time_resolution", np.uint8, [1, 1])
+    expect_column(cols, "trigger_threshold", np.uint16, [300, 300])
+
+    offsets, samples = cols["analog_probe1"]
+    assert offsets.dtype == np.uint32
+    assert samples.dtype == np.int16
+    np.testing.assert_array_equal(offsets, [0, 10, 15])
+    assert samples[1] == 37 - 10000
+    assert samples[10] == -10000
+    offsets, samples = cols["digital_probe4"]
+    assert samples.dtype == np.uint8
+    np.testing.assert_array_equal(samples[:4], [0, 1, 0, 1])
+
+
+def test_read_without_waveforms(data_file):
+    cols = delila.read([data_file], waveforms=False)
+    expect_column(cols, "waveform_index", np.int32, [-1, -1, -1, -1])
+    offsets, samples = cols["analog_probe1"]
+    assert len(samples) == 0
+
+
+def test_read_filter(data_file):
+    cols = delila.read(data_file, filter=delila.Filter().energy(1500, 3500))
+    expect_column(cols, "energy", np.uint16, [2000, 3000])
+    expect_column(cols, "waveform_index", np.int32, [0, 1])
+
+
+def test_arrays_keep_columns_alive(data_file):
+    # The dict and every other array are gone; the capsule that owns the
+    # EventColumns must stay with the arrays still in use
+    cols = delila.read(data_file)
+    energy = cols["energy"]
+    offsets, samples = cols["analog_probe2"]
+    assert energy.base is not None
+    assert energy.base is samples.base
+    assert not energy.flags.owndata
+    del cols, offsets
+    gc.collect()
+    # Reuse freed memory, so a dangling view would read garbage
+    junk = [np.full(4096, 7, dtype=np.uint16) for _ in range(256)]
+    np.testing.assert_array_equal(energy, [1000, 2000, 3000, 4000])
+    np.testing.assert_array_equal(samples[:3], [0, -1, -2])
+    del junk
+
+
+def test_file_blocks(data_file):
+    f = delila.File(data_file, waveforms=False)
+    blocks = list(f)
+    assert [b["source_id"] for b in blocks] == [0, 1]
+    assert [b["sequence_number"] for b in blocks] == [0, 1]
+    expect_column(blocks[1], "energy", np.uint16, [3000, 4000])
+    assert f.blocks_read == 2
+    assert f.footer["total_events"] == 4
+    assert f.footer["write_complete"]
+
+    f.rewind()
+    assert len(next(f)["energy"]) == 2
+
+
+def test_unreadable_file_warns(tmp_path):
+    with pytest.warns(RuntimeWarning):
+        cols = delila.read([str(tmp_path / "missing.delila")])
+    assert len(cols["energy"]) == 0
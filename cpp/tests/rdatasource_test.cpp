@@ -0,0 +1,124 @@
+// Unit tests for rdatasource.hpp: RDataFrame results against FileReader
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+
+#include "delila/rdatasource.hpp"
+#include "delila/reader.hpp"
+#include "test_writer.hpp"
+
+using delila::EventColumns;
+using delila::MakeDelilaDataFrame;
+using delila_test::BatchPattern;
+using delila_test::build_file;
+using delila_test::generate_batches;
+using delila_test::TempFile;
+
+namespace {
+
+// Five blocks of 10-14 events, a waveform on every third event
+std::vector<uint8_t> test_file() {
+    BatchPattern p;
+    p.sources = 2;
+    p.module_is_source = true;
+    p.events_cycle = 5;
+    p.channels = 8;
+    p.block_energy = 100;
+    p.event_energy = 7;
+    p.waveform_every = 3;
+    p.waveform_samples = 20;
+    return build_file(generate_batches(5, p));
+}
+
+// What the queries below should see, summed with FileReader
+struct Expected {
+    ULong64_t events = 0;
+    ULong64_t waveforms = 0;
+    double energy = 0;
+    double module_channel = 0;  // sum of module * 100 + channel
+    double analog_probe1 = 0;   // sum of all samples
+    double digital_probe4 = 0;
+};
+
+Expected read_expected(const std::string& path) {
+    Expected e;
+    delila::FileReader reader;
+    EXPECT_TRUE(reader.open(path));
+    delila::BatchHeader header;
+    EventColumns cols;
+    while (reader.next_columns(header, cols)) {
+        for (size_t i = 0; i < cols.size(); i++) {
+            e.events++;
+            e.energy += cols.energy[i];
+            e.module_channel += cols.module[i] * 100 + cols.channel[i];
+            if (!cols.has_waveform(i)) continue;
+            e.waveforms++;
+            size_t w = static_cast<size_t>(cols.waveform_index[i]);
+            const int16_t* a = cols.analog_probe1.data(w);
+            e.analog_probe1 += std::accumulate(a, a + cols.analog_probe1.size(w), 0.0);
+            const uint8_t* d = cols.digital_probe4.data(w);
+            e.digital_probe4 += std::accumulate(d, d + cols.digital_probe4.size(w), 0.0);
+        }
+    }
+    return e;
+}
+
+template <typename T>
+double sum_samples(const std::vector<T>& v) {
+    return std::accumulate(v.begin(), v.end(), 0.0);
+}
+
+}  // namespace
+
+// Each query runs on its own data frame, so each decodes only its own
+// columns: none for Count(), one scalar, has_waveform alone, waveforms
+
+TEST(RDelilaDS, CountWithoutColumns) {
+    TempFile f(test_file(), "rdf");
+    Expected e = read_expected(f.path());
+    ASSERT_EQ(e.events, 5u * 10 + 0 + 1 + 2 + 3 + 4);
+    EXPECT_EQ(*MakeDelilaDataFrame(f.path()).Count(), e.events);
+}
+
+TEST(RDelilaDS, ScalarSums) {
+    TempFile f(test_file(), "rdf");
+    Expected e = read_expected(f.path());
+
+    auto energy = MakeDelilaDataFrame(f.path())
+                      .Define("e", [](unsigned short v) { return double(v); }, {"energy"})
+                      .Sum<double>("e");
+    EXPECT_DOUBLE_EQ(*energy, e.energy);
+
+    auto mc = MakeDelilaDataFrame(f.path())
+                  .Define("mc", [](unsigned char m, unsigned char c) { return m * 100.0 + c; },
+                          {"module", "channel"})
+                  .Sum<double>("mc");
+    EXPECT_DOUBLE_EQ(*mc, e.module_channel);
+}
+
+TEST(RDelilaDS, HasWaveformWithoutWaveformColumns) {
+    TempFile f(test_file(), "rdf");
+    Expected e = read_expected(f.path());
+    ASSERT_GT(e.waveforms, 0u);
+    auto n = MakeDelilaDataFrame(f.path()).Filter([](bool w) { return w; }, {"has_waveform"}).Count();
+    EXPECT_EQ(*n, e.waveforms);
+}
+
+TEST(RDelilaDS, WaveformSums) {
+    TempFile f(test_file(), "rdf");
+    Expected e = read_expected(f.path());
+
+    auto df = MakeDelilaDataFrame(f.path())
+                  .Define("a1", sum_samples<short>, {"analog_probe1"})
+                  .Define("d4", sum_samples<unsigned char>, {"digital_probe4"})
+                  .Define("e", [](unsigned short v) { return double(v); }, {"energy"});
+    auto a1 = df.Sum<double>("a1");
+    auto d4 = df.Sum<double>("d4");
+    auto energy = df.Sum<double>("e");
+    auto with_waveform = df.Filter([](bool w) { return w; }, {"has_waveform"}).Count();
+    EXPECT_DOUBLE_EQ(*a1, e.analog_probe1);
+    EXPECT_DOUBLE_EQ(*d4, e.digital_probe4);
+    EXPECT_DOUBLE_EQ(*energy, e.energy);
+    EXPECT_EQ(*with_waveform, e.waveforms);
+}
@@ -0,0 +1,159 @@
+// Unit tests for ReadAhead and FileReader in ReadMode::ReadAhead
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "delila/readahead.hpp"
+#include "delila/reader.hpp"
+#include "test_writer.hpp"
+
+using delila::BatchHeader;
+using delila::ChecksumStatus;
+using delila::Event;
+using delila::FileReader;
+using delila::ReadAhead;
+using delila::ReadAheadOptions;
+using delila::ReadMode;
+using delila_test::BatchPattern;
+using delila_test::build_file;
+using delila_test::generate_batches;
+using delila_test::make_event;
+using delila_test::TempFile;
+using delila_test::TestBatch;
+
+namespace {
+
+std::vector<uint8_t> pattern(size_t n) {
+    std::vector<uint8_t> bytes(n);
+    for (size_t i = 0; i < n; i++) bytes[i] = static_cast<uint8_t>(i * 7 + i / 251);
+    return bytes;
+}
+
+bool same(const uint8_t* got, const std::vector<uint8_t>& bytes, uint64_t offset, size_t len) {
+    return got && std::memcmp(got, bytes.data() + offset, len) == 0;
+}
+
+// 50 events per block, numbered by energy, a waveform on every fifth
+std::vector<TestBatch> many_batches(int n_batches) {
+    BatchPattern p;
+    p.events = 50;
+    p.energy = 0;
+    p.block_energy = 50;
+    p.event_energy = 1;
+    p.waveform_every = 5;
+    return generate_batches(n_batches, p);
+}
+
+}  // namespace
+
+TEST(ReadAhead, SequentialFetchesMatchFile) {
+    auto bytes = pattern(10000);
+    TempFile file(bytes);
+    ReadAhead ra({2, 256});
+    ASSERT_TRUE(ra.open(file.path(), 100, bytes.size()));
+
+    // Lengths below, at and above the read size so ranges span several reads
+    const size_t lengths[] = {4, 1, 255, 256, 257, 600, 3, 1000};
+    uint64_t offset = 100;
+    for (size_t i = 0; offset < bytes.size(); i++) {
+        size_t len = std::min<size_t>(lengths[i % 8], bytes.size() - offset);
+        ASSERT_TRUE(same(ra.fetch(offset, len), bytes, offset, len)) << "offset " << offset;
+        offset += len;
+    }
+    EXPECT_EQ(ra.fetch(bytes.size() - 1, 2), nullptr);
+    EXPECT_TRUE(ra.error().empty()) << ra.error();
+
+    delila::ReadAheadStats stats = ra.stats();
+    EXPECT_EQ(stats.bytes, bytes.size() - 100);
+    EXPECT_EQ(stats.reads, (bytes.size() - 100 + 255) / 256);
+    EXPECT_EQ(stats.restarts, 0u);
+}
+
+TEST(ReadAhead, SeeksRestartReading) {
+    auto bytes = pattern(5000);
+    TempFile file(bytes);
+    ReadAhead ra({3, 128});
+    ASSERT_TRUE(ra.open(file.path(), 0, bytes.size()));
+
+    EXPECT_TRUE(same(ra.fetch(0, 100), bytes, 0, 100));
+    EXPECT_TRUE(same(ra.fetch(4000, 300), bytes, 4000, 300));  // Forward past read-ahead
+    EXPECT_TRUE(same(ra.fetch(50, 10), bytes, 50, 10));        // Backward
+    EXPECT_TRUE(same(ra.fetch(60, 500), bytes, 60, 500));      // Continues from there
+    EXPECT_EQ(ra.stats().restarts, 2u);
+
+    ra.set_end(4000);
+    EXPECT_EQ(ra.fetch(3990, 20), nullptr);
+    EXPECT_TRUE(same(ra.fetch(3990, 10), bytes, 3990, 10));
+}
+
+TEST(ReadAhead, ShortFileReportsError) {
+    auto bytes = pattern(1000);
+    TempFile file(bytes);
+    ReadAhead ra({2, 256});
+    ASSERT_TRUE(ra.open(file.path(), 0, 2000));  // Claims more than the file holds
+    EXPECT_TRUE(same(ra.fetch(0, 500), bytes, 0, 500));
+    EXPECT_EQ(ra.fetch(900, 200), nullptr);
+    EXPECT_NE(ra.error().find("Unexpected end of file"), std::string::npos) << ra.error();
+}
+
+TEST(ReadAhead, MissingFileFails) {
+    ReadAhead ra;
+    EXPECT_FALSE(ra.open("/nonexistent/file.delila", 0, 100));
+    EXPECT_FALSE(ra.is_open());
+    EXPECT_NE(ra.error().find("Cannot open"), std::string::npos);
+}
+
+TEST(FileReaderReadAhead, BlocksSpanningReadsDecodeLikeStream) {
+    TempFile file(build_file(many_batches(20)));
+    FileReader stream;
+    ASSERT_TRUE(stream.open(file.path(), ReadMode::Stream));
+    FileReader reader;
+    reader.set_read_ahead({2, 100});  // Far smaller than a block
+    reader.set_verify_checksum(true);
+    ASSERT_TRUE(reader.open(file.path(), ReadMode::ReadAhead)) << reader.error();
+    EXPECT_EQ(reader.mode(), ReadMode::ReadAhead);
+
+    BatchHeader h1, h2;
+    std::vector<Event> e1, e2;
+    size_t blocks = 0;
+    while (stream.next_batch(h1, e1)) {
+        ASSERT_TRUE(reader.next_batch(h2, e2)) << reader.error();
+        EXPECT_EQ(h2.sequence_number, h1.sequence_number);
+        ASSERT_EQ(e2.size(), e1.size());
+        for (size_t i = 0; i < e1.size(); i++) {
+            EXPECT_EQ(e2[i].energy, e1[i].energy);
+            EXPECT_EQ(e2[i].waveform.analog_probe1, e1[i].waveform.analog_probe1);
+        }
+        blocks++;
+    }
+    EXPECT_FALSE(reader.next_batch(h2, e2));
+    EXPECT_TRUE(reader.error().empty()) << reader.error();
+    EXPECT_EQ(blocks, 20u);
+    EXPECT_EQ(reader.check_checksum(), ChecksumStatus::Match);
+
+    delila::ReadAheadStats stats = reader.read_ahead_stats();
+    EXPECT_EQ(stats.bytes, reader.footer().data_bytes);
+    EXPECT_GT(stats.reads, 20u);
+}
+
+TEST(FileReaderReadAhead, RandomAccessRestarts) {
+    TempFile file(build_file(many_batches(10)));
+    FileReader reader;
+    reader.set_read_ahead({2, 512});
+    ASSERT_TRUE(reader.open(file.path(), ReadMode::ReadAhead));
+    ASSERT_TRUE(reader.load_index());
+
+    delila::BlockView block;
+    ASSERT_TRUE(reader.read_block(7, block));
+    EXPECT_EQ(block.index, 7u);
+    ASSERT_TRUE(reader.seek_to_time(2000.0));
+    BatchHeader hdr;
+    std::vector<Event> events;
+    ASSERT_TRUE(reader.next_batch(hdr, events)) << reader.error();
+    EXPECT_EQ(hdr.sequence_number, 2u);
+    EXPECT_GE(reader.read_ahead_stats().restarts, 2u);
+
+    reader.close();
+    EXPECT_EQ(reader.read_ahead_stats().reads, 0u);
+}
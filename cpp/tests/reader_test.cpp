@@ -0,0 +1,426 @@
+// Unit tests for FileReader
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "delila/reader.hpp"
+#include "test_writer.hpp"
+
+using delila::BatchHeader;
+using delila::Event;
+using delila::FileReader;
+using delila::ReadMode;
+using delila_test::build_file;
+using delila_test::make_event;
+using delila_test::TempFile;
+using delila_test::TestBatch;
+
+namespace {
+
+std::vector<TestBatch> sample_batches() {
+    std::vector<TestBatch> batches(3);
+    for (int b = 0; b < 3; b++) {
+        batches[b].source_id = static_cast<uint32_t>(b % 2);
+        for (int i = 0; i < 100; i++) {
+            batches[b].events.push_back(
+                make_event(static_cast<uint8_t>(b), static_cast<uint8_t>(i % 16),
+                           static_cast<uint16_t>(i * 10), b * 1000.0 + i, b == 1 ? 64 : 0));
+        }
+    }
+    return batches;
+}
+
+// Offsets of the blocks of a file image
+std::vector<size_t> block_offsets(const std::vector<uint8_t>& bytes) {
+    TempFile file(bytes);
+    FileReader reader;
+    std::vector<size_t> offsets;
+    delila::BlockView block;
+    if (reader.open(file.path())) {
+        while (reader.next_block(block)) offsets.push_back(static_cast<size_t>(block.offset));
+    }
+    return offsets;
+}
+
+// Five blocks of 100 events, block b holding module b
+std::vector<TestBatch> five_batches() {
+    std::vector<TestBatch> batches(5);
+    for (int b = 0; b < 5; b++) {
+        batches[b].source_id = static_cast<uint32_t>(b % 2);
+        for (int i = 0; i < 100; i++) {
+            batches[b].events.push_back(make_event(static_cast<uint8_t>(b), 0, 100, b * 1000.0 + i,
+                                                   i % 3 == 0 ? 16 : 0));
+        }
+    }
+    return batches;
+}
+
+// Modules of the blocks read with resync on
+std::vector<int> resync_modules(const std::vector<uint8_t>& bytes, ReadMode mode,
+                                std::vector<delila::DamagedRange>& damaged, std::string& error) {
+    TempFile file(bytes);
+    FileReader reader;
+    reader.set_resync(true);
+    std::vector<int> modules;
+    if (!reader.open(file.path(), mode)) return modules;
+    BatchHeader hdr;
+    std::vector<Event> events;
+    while (reader.next_batch(hdr, events)) modules.push_back(events.at(0).module);
+    damaged = reader.damaged();
+    error = reader.error();
+    return modules;
+}
+
+class FileReaderTest : public ::testing::TestWithParam<ReadMode> {};
+
+}  // namespace
+
+TEST_P(FileReaderTest, ReadsHeaderFooterAndBlocks) {
+    TempFile file(build_file(sample_batches()));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), GetParam())) << reader.error();
+
+    EXPECT_TRUE(reader.has_header_metadata());
+    EXPECT_EQ(reader.header().run_number, 10u);
+    EXPECT_EQ(reader.header().exp_name, "CRIB2026");
+    EXPECT_EQ(reader.header().source_ids, (std::vector<uint32_t>{0, 1}));
+
+    ASSERT_TRUE(reader.has_footer());
+    EXPECT_EQ(reader.footer().total_events, 300u);
+    EXPECT_TRUE(reader.footer().is_complete());
+    EXPECT_EQ(reader.data_end(), reader.file_size() - delila::FOOTER_SIZE);
+
+    BatchHeader hdr;
+    std::vector<Event> events;
+    uint64_t total = 0;
+    size_t waveforms = 0;
+    while (reader.next_batch(hdr, events)) {
+        total += events.size();
+        for (const auto& ev : events) waveforms += ev.has_waveform;
+    }
+    EXPECT_TRUE(reader.error().empty()) << reader.error();
+    EXPECT_EQ(total, 300u);
+    EXPECT_EQ(waveforms, 100u);
+    EXPECT_EQ(reader.blocks_read(), 3u);
+    EXPECT_EQ(reader.bytes_read(), reader.footer().data_bytes);
+}
+
+TEST_P(FileReaderTest, RewindRestartsIteration) {
+    TempFile file(build_file(sample_batches()));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), GetParam()));
+
+    delila::BlockView block;
+    ASSERT_TRUE(reader.next_block(block));
+    EXPECT_EQ(block.offset, reader.data_begin());
+    ASSERT_TRUE(reader.next_block(block));
+    reader.rewind();
+    ASSERT_TRUE(reader.next_block(block));
+    EXPECT_EQ(block.index, 0u);
+    EXPECT_EQ(block.offset, reader.data_begin());
+}
+
+TEST_P(FileReaderTest, FileWithoutFooterReadsToEnd) {
+    TempFile file(build_file(sample_batches(), false));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), GetParam()));
+    EXPECT_FALSE(reader.has_footer());
+    EXPECT_EQ(reader.data_end(), reader.file_size());
+
+    BatchHeader hdr;
+    std::vector<Event> events;
+    uint64_t total = 0;
+    while (reader.next_batch(hdr, events)) total += events.size();
+    EXPECT_TRUE(reader.error().empty());
+    EXPECT_EQ(total, 300u);
+}
+
+TEST_P(FileReaderTest, TruncatedTailStopsWithError) {
+    auto bytes = build_file(sample_batches(), false);
+    bytes.resize(bytes.size() - 10);
+    TempFile file(bytes);
+
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), GetParam()));
+    BatchHeader hdr;
+    std::vector<Event> events;
+    size_t blocks = 0;
+    while (reader.next_batch(hdr, events)) blocks++;
+    EXPECT_EQ(blocks, 2u);
+    EXPECT_FALSE(reader.error().empty());
+}
+
+TEST_P(FileReaderTest, RejectsBadMagic) {
+    auto bytes = build_file(sample_batches());
+    bytes[0] = 'X';
+    TempFile file(bytes);
+
+    FileReader reader;
+    EXPECT_FALSE(reader.open(file.path(), GetParam()));
+    EXPECT_FALSE(reader.error().empty());
+}
+
+TEST_P(FileReaderTest, MissingFileFails) {
+    FileReader reader;
+    EXPECT_FALSE(reader.open("/nonexistent/run9999_0000_data.delila", GetParam()));
+}
+
+TEST(FileReader, MmapViewsStayValidAcrossBlocks) {
+    TempFile file(build_file(sample_batches()));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), ReadMode::Mmap));
+    ASSERT_EQ(reader.mode(), ReadMode::Mmap);
+
+    delila::BlockView first, second;
+    ASSERT_TRUE(reader.next_block(first));
+    std::vector<uint8_t> copy(first.data, first.data + first.size);
+    ASSERT_TRUE(reader.next_block(second));
+
+    // Views point straight into the mapping: the first is untouched
+    EXPECT_NE(first.data, second.data);
+    EXPECT_EQ(first.data + first.size + 4, second.data);
+    EXPECT_TRUE(std::equal(copy.begin(), copy.end(), first.data));
+}
+
+TEST(FileReader, DecodeBlockFromWorkerThreads) {
+    TempFile file(build_file(sample_batches()));
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), ReadMode::Mmap));
+
+    std::vector<delila::BlockView> blocks;
+    delila::BlockView block;
+    while (reader.next_block(block)) blocks.push_back(block);
+    ASSERT_EQ(blocks.size(), 3u);
+
+    std::atomic<uint64_t> total{0};
+    std::vector<std::thread> workers;
+    for (const auto& b : blocks) {
+        workers.emplace_back([&total, b] {
+            BatchHeader hdr;
+            std::vector<Event> events;
+            if (FileReader::decode_block(b, hdr, events)) total += events.size();
+        });
+    }
+    for (auto& w : workers) w.join();
+    EXPECT_EQ(total.load(), 300u);
+}
+
+TEST(FileReader, DecodeBlockReportsBadEvent) {
+    delila_test::MsgPackWriter w;
+    w.write_array(4);
+    w.write_uint(0);
+    w.write_uint(0);
+    w.write_uint(0);
+    w.write_array(2);
+    w.write_event(make_event(0, 0, 1, 1.0));
+    w.write_array(3);  // bad arity
+
+    delila::BlockView block = delila_test::view_of(w);
+    block.index = 7;
+    BatchHeader hdr;
+    std::vector<Event> events;
+    std::string err;
+    EXPECT_FALSE(FileReader::decode_block(block, hdr, events, &err));
+    EXPECT_EQ(events.size(), 1u);
+    EXPECT_EQ(err, "Failed to parse event 1 in block 7");
+}
+
+TEST_P(FileReaderTest, FollowPicksUpAppendedBlocks) {
+    auto full = build_file(sample_batches());
+    size_t data_end = full.size() - delila::FOOTER_SIZE;
+    // Header, first block and half of the second
+    FileReader probe;
+    TempFile whole(full);
+    ASSERT_TRUE(probe.open(whole.path()));
+    delila::BlockView block;
+    ASSERT_TRUE(probe.read_block(1, block));
+    size_t cut = static_cast<size_t>(block.offset) + block.size / 2;
+
+    TempFile file(std::vector<uint8_t>(full.begin(), full.begin() + static_cast<std::ptrdiff_t>(cut)));
+    FileReader reader;
+    reader.set_follow(true);
+    ASSERT_TRUE(reader.open(file.path(), GetParam()));
+    EXPECT_FALSE(reader.has_footer());
+
+    BatchHeader hdr;
+    std::vector<Event> events;
+    size_t total = 0;
+    while (reader.next_batch(hdr, events)) total += events.size();
+    EXPECT_TRUE(reader.error().empty()) << reader.error();
+    EXPECT_EQ(total, 100u);
+    EXPECT_GT(reader.pending_bytes(), 0u);
+    EXPECT_FALSE(reader.refresh());  // Nothing appended
+
+    delila_test::append_bytes(file.path(), full, cut, data_end);
+    EXPECT_TRUE(reader.refresh());
+    while (reader.next_batch(hdr, events)) total += events.size();
+    EXPECT_TRUE(reader.error().empty()) << reader.error();
+    EXPECT_EQ(total, 300u);
+    EXPECT_EQ(reader.pending_bytes(), 0u);
+    EXPECT_FALSE(reader.has_footer());
+
+    // Recorder closes the file
+    delila_test::append_bytes(file.path(), full, data_end, full.size());
+    EXPECT_TRUE(reader.refresh());
+    EXPECT_TRUE(reader.has_footer());
+    EXPECT_EQ(reader.footer().total_events, 300u);
+    EXPECT_FALSE(reader.next_batch(hdr, events));
+    EXPECT_TRUE(reader.error().empty());
+    EXPECT_EQ(reader.blocks_read(), 3u);
+    EXPECT_FALSE(reader.refresh());
+}
+
+TEST_P(FileReaderTest, ResyncSkipsBlockWithBadLength) {
+    auto bytes = build_file(five_batches());
+    std::vector<size_t> at = block_offsets(bytes);
+    ASSERT_EQ(at.size(), 5u);
+    bytes[at[2] + 3] = 0x7f;  // Length far past MAX_BLOCK_SIZE
+
+    std::vector<delila::DamagedRange> damaged;
+    std::string error;
+    EXPECT_EQ(resync_modules(bytes, GetParam(), damaged, error), (std::vector<int>{0, 1, 3, 4}));
+    EXPECT_TRUE(error.empty()) << error;
+    ASSERT_EQ(damaged.size(), 1u);
+    EXPECT_EQ(damaged[0].offset, at[2]);
+    EXPECT_EQ(damaged[0].length, at[3] - at[2]);
+    EXPECT_FALSE(damaged[0].reason.empty());
+
+    // Without resync the first damaged block ends the file
+    TempFile file(bytes);
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path(), GetParam()));
+    BatchHeader hdr;
+    std::vector<Event> events;
+    size_t blocks = 0;
+    while (reader.next_batch(hdr, events)) blocks++;
+    EXPECT_EQ(blocks, 2u);
+    EXPECT_FALSE(reader.error().empty());
+    EXPECT_TRUE(reader.damaged().empty());
+}
+
+TEST_P(FileReaderTest, ResyncSkipsInsertedGarbage) {
+    auto bytes = build_file(five_batches());
+    std::vector<size_t> at = block_offsets(bytes);
+    // Garbage shaped like the format: lengths, batch tags and zero runs
+    std::vector<uint8_t> garbage;
+    for (int i = 0; i < 3000; i++) {
+        static const uint8_t pattern[] = {0xff, 0x94, 0x00, 0x00, 0x00, 0x01, 0x94, 0xcc};
+        garbage.push_back(pattern[(i * 7) % 8]);
+    }
+    bytes.insert(bytes.begin() + static_cast<std::ptrdiff_t>(at[3]), garbage.begin(), garbage.end());
+
+    std::vector<delila::DamagedRange> damaged;
+    std::string error;
+    EXPECT_EQ(resync_modules(bytes, GetParam(), damaged, error),
+              (std::vector<int>{0, 1, 2, 3, 4}));
+    EXPECT_TRUE(error.empty()) << error;
+    ASSERT_EQ(damaged.size(), 1u);
+    EXPECT_EQ(damaged[0].offset, at[3]);
+    EXPECT_EQ(damaged[0].length, garbage.size());
+}
+
+TEST_P(FileReaderTest, ResyncSkipsOnlyTheBlockThatFailsToDecode) {
+    auto bytes = build_file(five_batches());
+    std::vector<size_t> at = block_offsets(bytes);
+    bytes[at[1] + 4] = 0xc1;  // Never used in MessagePack; the framing holds
+
+    std::vector<delila::DamagedRange> damaged;
+    std::string error;
+    EXPECT_EQ(resync_modules(bytes, GetParam(), damaged, error), (std::vector<int>{0, 2, 3, 4}));
+    EXPECT_TRUE(error.empty()) << error;
+    ASSERT_EQ(damaged.size(), 1u);
+    EXPECT_EQ(damaged[0].offset, at[1]);
+    EXPECT_EQ(damaged[0].length, at[2] - at[1]);
+}
+
+TEST_P(FileReaderTest, ResyncReportsTruncatedTail) {
+    auto bytes = build_file(five_batches(), false);
+    std::vector<size_t> at = block_offsets(bytes);
+    bytes.resize(bytes.size() - 10);
+
+    std::vector<delila::DamagedRange> damaged;
+    std::string error;
+    EXPECT_EQ(resync_modules(bytes, GetParam(), damaged, error), (std::vector<int>{0, 1, 2, 3}));
+    EXPECT_TRUE(error.empty()) << error;
+    ASSERT_EQ(damaged.size(), 1u);
+    EXPECT_EQ(damaged[0].offset, at[4]);
+    EXPECT_EQ(damaged[0].offset + damaged[0].length, bytes.size());
+}
+
+TEST(FileReader, ResyncInCompressedFiles) {
+    auto bytes = delila_test::build_file_v3(five_batches(), delila::Compression::Zstd);
+    std::vector<size_t> at = block_offsets(bytes);
+    ASSERT_EQ(at.size(), 5u);
+    bytes[at[1] + 4] = 7;  // Unknown codec
+    bytes[at[3] + 2] = 0x40;  // Length
+
+    std::vector<delila::DamagedRange> damaged;
+    std::string error;
+    EXPECT_EQ(resync_modules(bytes, ReadMode::Mmap, damaged, error), (std::vector<int>{0, 2, 4}));
+    EXPECT_TRUE(error.empty()) << error;
+    ASSERT_EQ(damaged.size(), 2u);
+    EXPECT_EQ(damaged[0].offset, at[1]);
+    EXPECT_EQ(damaged[0].length, at[2] - at[1]);
+    EXPECT_EQ(damaged[1].offset, at[3]);
+    EXPECT_EQ(damaged[1].length, at[4] - at[3]);
+}
+
+TEST(FileReader, FindNextBlockAndResyncedIndex) {
+    auto bytes = build_file(five_batches());
+    std::vector<size_t> at = block_offsets(bytes);
+    bytes[at[2] + 1] = 0xee;  // Length
+
+    TempFile file(bytes);
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path()));
+    EXPECT_EQ(reader.find_next_block(at[0]), at[0]);
+    // Not block 1: the damaged block after it does not vouch for it
+    EXPECT_EQ(reader.find_next_block(at[0] + 1), at[3]);
+    EXPECT_EQ(reader.find_next_block(at[3] + 1), at[4]);
+    EXPECT_EQ(reader.find_next_block(at[4] + 1), reader.data_end());
+
+    reader.set_resync(true);
+    ASSERT_TRUE(reader.load_index(true)) << reader.error();
+    ASSERT_EQ(reader.index().size(), 4u);
+    EXPECT_EQ(reader.index()[2].offset, at[3]);
+    ASSERT_EQ(reader.damaged().size(), 1u);
+    EXPECT_EQ(reader.damaged()[0].offset, at[2]);
+}
+
+TEST(FileReader, SkippedBlocksJoinDamagedInFileOrder) {
+    auto bytes = build_file(five_batches());
+    std::vector<size_t> at = block_offsets(bytes);
+    TempFile file(bytes);
+    FileReader reader;
+    ASSERT_TRUE(reader.open(file.path()));
+    std::vector<delila::BlockView> blocks;
+    delila::BlockView block;
+    while (reader.next_block(block)) blocks.push_back(block);
+    ASSERT_EQ(blocks.size(), 5u);
+
+    // What a worker records for a block it could not decode
+    delila::DamagedRange d = delila::skipped_block(blocks[3], "bad batch");
+    EXPECT_EQ(d.offset, at[3]);
+    EXPECT_EQ(d.length, at[4] - at[3]);
+    EXPECT_EQ(d.reason, "bad batch");
+
+    std::vector<delila::DamagedRange> all = delila::merge_damaged(
+        {{at[4], 10, "resync"}, {at[0], 5, "resync"}}, {d, delila::skipped_block(blocks[1], "x")});
+    ASSERT_EQ(all.size(), 4u);
+    EXPECT_EQ(all[0].offset, at[0]);
+    EXPECT_EQ(all[1].offset, at[1]);
+    EXPECT_EQ(all[2].offset, at[3]);
+    EXPECT_EQ(all[3].offset, at[4]);
+}
+
+INSTANTIATE_TEST_SUITE_P(Modes, FileReaderTest,
+                         ::testing::Values(ReadMode::Mmap, ReadMode::Stream,
+                                           ReadMode::ReadAhead),
+                         [](const ::testing::TestParamInfo<ReadMode>& info) {
+                             return info.param == ReadMode::Mmap     ? "Mmap"
+                                    : info.param == ReadMode::Stream ? "Stream"
+                                                                     : "ReadAhead";
+                         });
@@ -0,0 +1,197 @@
+// Unit tests for reduce.hpp
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "delila/reduce.hpp"
+
+using delila::DigitalMode;
+using delila::ReducedWaveform;
+using delila::ReduceOptions;
+using delila::Waveform;
+
+namespace {
+
+// 200 samples at baseline 1000, a negative pulse of -300 over [100, 120);
+// digital_probe1 marks the trigger from sample 100, digital_probe2 is a
+// gate over [90, 150), digital_probe3 is constant 0 and digital_probe4
+// constant 1
+Waveform trigger_waveform() {
+    Waveform wf;
+    for (int i = 0; i < 200; i++) {
+        wf.analog_probe1.push_back(static_cast<int16_t>(i >= 100 && i < 120 ? 700 : 1000));
+        wf.analog_probe2.push_back(static_cast<int16_t>(i));
+        wf.digital_probe1.push_back(i >= 100 ? 1 : 0);
+        wf.digital_probe2.push_back(i >= 90 && i < 150 ? 1 : 0);
+        wf.digital_probe3.push_back(0);
+        wf.digital_probe4.push_back(1);
+    }
+    wf.time_resolution = 1;
+    wf.trigger_threshold = 50;
+    return wf;
+}
+
+}  // namespace
+
+TEST(ReduceWaveform, DefaultsKeepEverything) {
+    Waveform wf = trigger_waveform();
+    ReduceOptions opt;
+    EXPECT_FALSE(opt.active());
+    ReducedWaveform red;
+    delila::reduce_waveform(wf, opt, red);
+    EXPECT_EQ(red.wf.analog_probe1, wf.analog_probe1);
+    EXPECT_EQ(red.wf.digital_probe4, wf.digital_probe4);
+    EXPECT_EQ(red.wf.time_resolution, 1);
+    EXPECT_EQ(red.wf.trigger_threshold, 50);
+    EXPECT_EQ(red.n_samples, 200u);
+    EXPECT_EQ(red.trigger_sample, 100);
+    EXPECT_EQ(red.first_sample, 0u);
+    EXPECT_EQ(red.decimation, 1u);
+}
+
+TEST(ReduceWaveform, CropsAroundTheTriggerMarker) {
+    Waveform wf = trigger_waveform();
+    ReduceOptions opt;
+    ASSERT_TRUE(opt.set("crop", "10:30"));
+    ReducedWaveform red;
+    delila::reduce_waveform(wf, opt, red);
+    EXPECT_EQ(red.first_sample, 90u);
+    ASSERT_EQ(red.wf.analog_probe2.size(), 40u);
+    EXPECT_EQ(red.wf.analog_probe2.front(), 90);
+    EXPECT_EQ(red.wf.analog_probe2.back(), 129);
+    ASSERT_EQ(red.wf.digital_probe1.size(), 40u);
+    EXPECT_EQ(red.wf.digital_probe1[9], 0);
+    EXPECT_EQ(red.wf.digital_probe1[10], 1);
+
+    // Clipped at the ends of the waveform
+    ASSERT_TRUE(opt.set("crop", "150:150"));
+    delila::reduce_waveform(wf, opt, red);
+    EXPECT_EQ(red.first_sample, 0u);
+    EXPECT_EQ(red.wf.analog_probe1.size(), 200u);
+
+    // Another marker; none at all keeps the waveform whole
+    ASSERT_TRUE(opt.set("crop", "0:5"));
+    ASSERT_TRUE(opt.set("trigger", "2"));
+    delila::reduce_waveform(wf, opt, red);
+    EXPECT_EQ(red.trigger_sample, 90);
+    EXPECT_EQ(red.wf.analog_probe2, (std::vector<int16_t>{90, 91, 92, 93, 94}));
+    ASSERT_TRUE(opt.set("trigger", "3"));
+    delila::reduce_waveform(wf, opt, red);
+    EXPECT_EQ(red.trigger_sample, -1);
+    EXPECT_EQ(red.first_sample, 0u);
+    EXPECT_EQ(red.wf.analog_probe2.size(), 200u);
+}
+
+TEST(ReduceWaveform, DecimatesByMeanOrPick) {
+    Waveform wf;
+    wf.analog_probe1 = {1, 2, 3, 4, -5, -6, -7, -8, 10};
+    wf.digital_probe1 = {0, 0, 0, 1, 0, 0, 0, 0, 0};
+    ReduceOptions opt;
+    ASSERT_TRUE(opt.set("decimate", "4"));
+    ReducedWaveform red;
+    delila::reduce_waveform(wf, opt, red);
+    EXPECT_EQ(red.decimation, 4u);
+    // Means rounded half away from zero; the last group is partial
+    EXPECT_EQ(red.wf.analog_probe1, (std::vector<int16_t>{3, -7, 10}));
+    // A one-sample digital pulse survives
+    EXPECT_EQ(red.wf.digital_probe1, (std::vector<uint8_t>{1, 0, 0}));
+
+    ASSERT_TRUE(opt.set("pick", ""));
+    delila::reduce_waveform(wf, opt, red);
+    EXPECT_EQ(red.wf.analog_probe1, (std::vector<int16_t>{1, -5, 10}));
+}
+
+TEST(ReduceWaveform, DropsConstantDigitalProbes) {
+    Waveform wf = trigger_waveform();
+    ReduceOptions opt;
+    ASSERT_TRUE(opt.set("digital", "drop"));
+    ASSERT_TRUE(opt.set("crop", "5:20"));  // digital_probe1 and 2 change; 3 and 4 do not
+    ReducedWaveform red;
+    delila::reduce_waveform(wf, opt, red);
+    EXPECT_EQ(red.wf.digital_probe1.size(), 25u);
+    EXPECT_EQ(red.wf.digital_probe2.size(), 0u);  // Gate is set all over [95, 120)
+    EXPECT_TRUE(red.wf.digital_probe3.empty());
+    EXPECT_TRUE(red.wf.digital_probe4.empty());
+    EXPECT_EQ(red.digital_levels, 0x2 | 0x8);
+}
+
+TEST(ReduceWaveform, RunLengthEncodesDigitalProbes) {
+    Waveform wf = trigger_waveform();
+    ReduceOptions opt;
+    ASSERT_TRUE(opt.set("digital", "rle"));
+    ASSERT_TRUE(opt.set("crop", "20:80"));
+    ASSERT_TRUE(opt.set("decimate", "2"));
+    ReducedWaveform red;
+    delila::reduce_waveform(wf, opt, red);
+    EXPECT_EQ(red.first_sample, 80u);
+    EXPECT_EQ(red.wf.analog_probe1.size(), 50u);
+    for (const auto* d : {&red.wf.digital_probe1, &red.wf.digital_probe2, &red.wf.digital_probe3,
+                          &red.wf.digital_probe4}) {
+        EXPECT_TRUE(d->empty());
+    }
+    EXPECT_EQ(red.digital_levels, 0x8);
+    // Not decimated: exact positions from first_sample
+    EXPECT_EQ(red.digital_edges[0], (std::vector<uint32_t>{20}));
+    EXPECT_EQ(red.digital_edges[1], (std::vector<uint32_t>{10, 70}));
+    EXPECT_TRUE(red.digital_edges[2].empty());
+    EXPECT_TRUE(red.digital_edges[3].empty());
+
+    // Edges are cleared between waveforms
+    ASSERT_TRUE(opt.set("digital", "keep"));
+    delila::reduce_waveform(wf, opt, red);
+    EXPECT_TRUE(red.digital_edges[1].empty());
+    EXPECT_EQ(red.digital_levels, 0);
+}
+
+TEST(ReduceWaveform, FeaturesOnly) {
+    Waveform wf = trigger_waveform();
+    wf.analog_probe1[0] = 1002;
+    wf.analog_probe1[1] = 998;
+    ReduceOptions opt;
+    ASSERT_TRUE(opt.set("features", ""));
+    ASSERT_TRUE(opt.set("baseline", "4"));
+    ReducedWaveform red;
+    delila::reduce_waveform(wf, opt, red);
+    EXPECT_TRUE(red.wf.analog_probe1.empty());
+    EXPECT_TRUE(red.wf.digital_probe1.empty());
+    EXPECT_EQ(red.n_samples, 200u);
+    EXPECT_EQ(red.trigger_sample, 100);
+    EXPECT_FLOAT_EQ(red.features.baseline, 1000.0f);
+    EXPECT_FLOAT_EQ(red.features.baseline_rms, std::sqrt(2.0f));
+    EXPECT_FLOAT_EQ(red.features.peak, -300.0f);
+    EXPECT_EQ(red.features.peak_sample, 100);
+    EXPECT_FLOAT_EQ(red.features.integral, -6000.0f);
+
+    // The integral covers the kept window only
+    ASSERT_TRUE(opt.set("crop", "0:10"));
+    delila::reduce_waveform(wf, opt, red);
+    EXPECT_FLOAT_EQ(red.features.integral, -3000.0f);
+
+    delila::reduce_waveform(Waveform(), opt, red);
+    EXPECT_EQ(red.features.peak_sample, -1);
+    EXPECT_EQ(red.n_samples, 0u);
+}
+
+TEST(ReduceOptions, SetByName) {
+    ReduceOptions opt;
+    std::string err;
+    EXPECT_TRUE(opt.set("crop", "32:160"));
+    EXPECT_TRUE(opt.crop);
+    EXPECT_EQ(opt.pre_samples, 32u);
+    EXPECT_EQ(opt.post_samples, 160u);
+    EXPECT_TRUE(opt.set("digital", "rle"));
+    EXPECT_EQ(opt.digital, DigitalMode::RunLength);
+    EXPECT_TRUE(opt.active());
+
+    EXPECT_FALSE(opt.set("crop", "32", &err));
+    EXPECT_NE(err.find("PRE:POST"), std::string::npos);
+    EXPECT_FALSE(opt.set("crop", "0:0"));
+    EXPECT_FALSE(opt.set("decimate", "0"));
+    EXPECT_FALSE(opt.set("trigger", "5"));
+    EXPECT_FALSE(opt.set("digital", "zip"));
+    EXPECT_FALSE(opt.set("features", "yes"));
+    EXPECT_FALSE(opt.set("nonsense", "", &err));
+    EXPECT_EQ(err, "Unknown waveform reduction option: nonsense");
+    EXPECT_EQ(opt.pre_samples, 32u);  // Unchanged by the failures
+}
@@ -0,0 +1,138 @@
+// Unit tests for multi-file run processing
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstring>
+
+#include "delila/run.hpp"
+#include "test_writer.hpp"
+
+using delila::FileSummary;
+using delila::RunSummary;
+using delila_test::build_file;
+using delila_test::make_event;
+using delila_test::TempFile;
+using delila_test::TestBatch;
+
+namespace {
+
+// n_blocks blocks of 5 events; block b spans [t0 + 100 b, t0 + 100 b + 40]
+std::vector<uint8_t> run_file(double t0, int n_blocks) {
+    std::vector<TestBatch> batches(n_blocks);
+    for (int b = 0; b < n_blocks; b++) {
+        for (int i = 0; i < 5; i++) {
+            batches[b].events.push_back(
+                make_event(0, static_cast<uint8_t>(i), 100, t0 + b * 100.0 + i * 10.0, i == 0 ? 16 : 0));
+        }
+    }
+    return build_file(batches);
+}
+
+}  // namespace
+
+TEST(ForEachParallel, VisitsEveryItemOnce) {
+    std::vector<std::atomic<int>> hits(100);
+    delila::for_each_parallel(hits.size(), 7, [&](size_t i) { hits[i]++; });
+    for (const auto& h : hits) EXPECT_EQ(h.load(), 1);
+
+    int calls = 0;
+    delila::for_each_parallel(0, 4, [&](size_t) { calls++; });
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(SummarizeFiles, MatchesFootersAndTotals) {
+    TempFile a(run_file(0.0, 3), "run");
+    TempFile b(run_file(1000.0, 2), "run");
+    TempFile c(run_file(5000.0, 4), "run");
+
+    auto files = delila::summarize_files({a.path(), b.path(), c.path()}, 3);
+    ASSERT_EQ(files.size(), 3u);
+    EXPECT_EQ(files[1].path, b.path());
+    for (const auto& f : files) {
+        EXPECT_TRUE(f.error.empty()) << f.error;
+        EXPECT_TRUE(f.check_footer().empty()) << f.path << ": " << f.check_footer()[0];
+    }
+    EXPECT_EQ(files[2].events, 20u);
+    EXPECT_EQ(files[2].waveforms, 4u);
+    EXPECT_DOUBLE_EQ(files[2].first_ts, 5000.0);
+    EXPECT_DOUBLE_EQ(files[2].last_ts, 5340.0);
+
+    RunSummary run = RunSummary::of(files);
+    EXPECT_EQ(run.files, 3u);
+    EXPECT_EQ(run.files_failing_footer, 0u);
+    EXPECT_EQ(run.events, 45u);
+    EXPECT_EQ(run.blocks, 9u);
+    EXPECT_DOUBLE_EQ(run.first_ts, 0.0);
+    EXPECT_DOUBLE_EQ(run.last_ts, 5340.0);
+}
+
+TEST(SummarizeFiles, ReportsFooterMismatch) {
+    auto bytes = run_file(0.0, 2);
+    uint64_t wrong = 11;
+    std::memcpy(bytes.data() + bytes.size() - delila::FOOTER_SIZE + 16, &wrong, 8);
+    double late = 9999.0;
+    std::memcpy(bytes.data() + bytes.size() - delila::FOOTER_SIZE + 40, &late, 8);
+    TempFile bad(bytes, "run");
+
+    auto no_footer = run_file(0.0, 1);
+    no_footer.resize(no_footer.size() - delila::FOOTER_SIZE);
+    TempFile open(no_footer, "run");
+
+    auto files = delila::summarize_files({bad.path(), open.path(), "/nonexistent/x.delila"}, 2);
+    auto problems = files[0].check_footer();
+    ASSERT_EQ(problems.size(), 2u);
+    EXPECT_EQ(problems[0], "total_events: read 10, footer 11");
+    EXPECT_EQ(problems[1].rfind("last_event_time_ns: read 140", 0), 0u);
+
+    ASSERT_EQ(files[1].check_footer().size(), 1u);
+    EXPECT_EQ(files[1].check_footer()[0], "no valid footer");
+    EXPECT_EQ(files[1].events, 5u);
+
+    EXPECT_FALSE(files[2].error.empty());
+
+    RunSummary run = RunSummary::of(files);
+    EXPECT_EQ(run.files_with_errors, 1u);
+    EXPECT_EQ(run.files_failing_footer, 3u);
+    EXPECT_EQ(run.events, 15u);
+}
+
+TEST(ReadColumns, ConcatenatesInFileOrder) {
+    TempFile a(run_file(0.0, 3), "run");
+    TempFile b(run_file(1000.0, 20), "run");  // More blocks than one window of 2 workers
+
+    std::vector<std::string> errors;
+    delila::EventColumns cols =
+        delila::read_columns({a.path(), "/nonexistent/x.delila", b.path()}, 2, nullptr, true, &errors);
+    ASSERT_EQ(errors.size(), 1u);
+    ASSERT_EQ(cols.size(), 115u);
+    EXPECT_DOUBLE_EQ(cols.timestamp_ns[0], 0.0);
+    EXPECT_DOUBLE_EQ(cols.timestamp_ns[15], 1000.0);
+    for (size_t i = 1; i < cols.size(); i++) EXPECT_LT(cols.timestamp_ns[i - 1], cols.timestamp_ns[i]);
+
+    // Same columns as reading block by block on one thread
+    delila::EventColumns one = delila::read_columns({a.path(), b.path()}, 1);
+    EXPECT_EQ(one.timestamp_ns, cols.timestamp_ns);
+    EXPECT_EQ(one.waveform_index, cols.waveform_index);
+    EXPECT_EQ(one.analog_probe1.offsets, cols.analog_probe1.offsets);
+    EXPECT_EQ(one.analog_probe1.samples, cols.analog_probe1.samples);
+    ASSERT_EQ(cols.num_waveforms(), 23u);  // Event 0 of every block
+    EXPECT_EQ(cols.waveform_index[5], 1);
+    EXPECT_EQ(cols.analog_probe1.size(22), 16u);
+
+    // Waveforms skipped, not decoded
+    delila::EventColumns scalars = delila::read_columns({a.path()}, 2, nullptr, false);
+    EXPECT_EQ(scalars.size(), 15u);
+    EXPECT_EQ(scalars.num_waveforms(), 0u);
+}
+
+TEST(ReadColumns, AppliesFilter) {
+    TempFile a(run_file(0.0, 3), "run");
+    delila::EventFilter filter;
+    filter.select(0, 0).time(0.0, 150.0);
+    delila::EventColumns cols = delila::read_columns({a.path()}, 4, &filter);
+    ASSERT_EQ(cols.size(), 2u);  // Blocks 0 and 1, channel 0
+    EXPECT_DOUBLE_EQ(cols.timestamp_ns[1], 100.0);
+    EXPECT_EQ(cols.num_waveforms(), 2u);
+    EXPECT_EQ(cols.waveform_index[1], 1);
+}
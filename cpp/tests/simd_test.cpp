@@ -0,0 +1,163 @@
+// Unit tests for the waveform sample kernels
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "delila/msgpack.hpp"
+#include "delila/simd.hpp"
+#include "test_writer.hpp"
+
+using delila::MsgPackParser;
+using delila::SimdLevel;
+using delila_test::MsgPackWriter;
+
+namespace {
+
+const SimdLevel ALL_LEVELS[] = {SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2,
+                                SimdLevel::NEON};
+
+// Restores the default level when a test is done
+class SimdTest : public ::testing::TestWithParam<SimdLevel> {
+protected:
+    void SetUp() override {
+        saved_ = delila::simd_level();
+        if (!delila::set_simd_level(GetParam())) {
+            GTEST_SKIP() << delila::simd_level_name(GetParam()) << " not supported";
+        }
+    }
+    void TearDown() override { delila::set_simd_level(saved_); }
+
+private:
+    SimdLevel saved_ = SimdLevel::Scalar;
+};
+
+// Waveform-like samples: baseline runs near zero (fixints), pulses in
+// int16 range, and the odd int8 / uint8 / large uint16 value in between
+std::vector<int16_t> mixed_samples(size_t n, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<int16_t> out;
+    while (out.size() < n) {
+        size_t run = rng() % 70 + 1;
+        int kind = static_cast<int>(rng() % 4);
+        for (size_t i = 0; i < run && out.size() < n; i++) {
+            switch (kind) {
+            case 0: out.push_back(static_cast<int16_t>(static_cast<int>(rng() % 160) - 32)); break;
+            case 1: out.push_back(static_cast<int16_t>(-static_cast<int>(rng() % 30000) - 129)); break;
+            case 2: out.push_back(static_cast<int16_t>(rng() % 16000 + 256)); break;
+            default: out.push_back(static_cast<int16_t>(static_cast<int>(rng() % 256) - 128)); break;
+            }
+        }
+    }
+    return out;
+}
+
+std::vector<int16_t> decode(const MsgPackWriter& w, bool* ok) {
+    MsgPackParser p(w.buf.data(), w.buf.size());
+    std::vector<int16_t> out;
+    *ok = p.read_i16_array(out) && p.at_end();
+    return out;
+}
+
+}  // namespace
+
+TEST_P(SimdTest, ArrayMatchesInput) {
+    for (size_t n : {0u, 1u, 15u, 16u, 17u, 100u, 1000u, 16384u}) {
+        auto in = mixed_samples(n, static_cast<uint32_t>(n));
+        MsgPackWriter w;
+        w.write_i16_probe(in);
+        bool ok = false;
+        EXPECT_EQ(decode(w, &ok), in) << "n = " << n;
+        EXPECT_TRUE(ok);
+    }
+}
+
+TEST_P(SimdTest, LongUniformRuns) {
+    std::vector<int16_t> fix(1000, -5), wide(1000, 12000);
+    wide[997] = 200;  // uint8 record near the end
+    for (const auto& in : {fix, wide}) {
+        MsgPackWriter w;
+        w.write_i16_probe(in);
+        bool ok = false;
+        EXPECT_EQ(decode(w, &ok), in);
+        EXPECT_TRUE(ok);
+    }
+}
+
+TEST_P(SimdTest, KernelsStopAtRunEnd) {
+    // 40 fixints then an int16 record
+    std::vector<uint8_t> in(40, 0x05);
+    in.insert(in.end(), {0xd1, 0x80, 0x00});
+    std::vector<int16_t> out(in.size());
+    EXPECT_EQ(delila::decode_fixint_run(in.data(), in.size(), out.data()), 40u);
+    EXPECT_EQ(out[39], 5);
+
+    // 20 uint16 / int16 records then a fixint
+    std::vector<uint8_t> rec;
+    for (int i = 0; i < 20; i++) rec.insert(rec.end(), {static_cast<uint8_t>(i % 2 ? 0xd1 : 0xcd), 0x12, 0x34});
+    rec.insert(rec.end(), {0x01, 0x00, 0x00});
+    EXPECT_EQ(delila::decode_int16_run(rec.data(), rec.size() / 3, out.data()), 20u);
+    EXPECT_EQ(out[19], 0x1234);
+
+    EXPECT_EQ(delila::skip_fixint_run(in.data(), in.size()), 40u);
+    EXPECT_EQ(delila::skip_int16_run(rec.data(), rec.size() / 3), 20u);
+}
+
+TEST_P(SimdTest, SkipMatchesDecode) {
+    // Every run of the encoded samples: same length from skip and decode
+    auto in = mixed_samples(5000, 3);
+    MsgPackWriter w;
+    w.write_i16_probe(in);
+    MsgPackParser p(w.buf.data(), w.buf.size());
+    size_t n;
+    ASSERT_TRUE(p.read_array_header(n));
+    const uint8_t* pos = w.buf.data() + p.position();
+    const uint8_t* end = w.buf.data() + w.buf.size();
+    std::vector<int16_t> out(n);
+    size_t runs = 0;
+    while (pos < end) {
+        size_t avail = static_cast<size_t>(end - pos);
+        size_t fix = delila::skip_fixint_run(pos, avail);
+        EXPECT_EQ(fix, delila::decode_fixint_run(pos, avail, out.data()));
+        size_t wide = delila::skip_int16_run(pos, avail / 3);
+        EXPECT_EQ(wide, delila::decode_int16_run(pos, avail / 3, out.data()));
+        ASSERT_TRUE(fix == 0 || wide == 0);
+        pos += fix ? fix : wide ? 3 * wide : (*pos == 0xd0 || *pos == 0xcc ? 2 : 3);
+        runs++;
+    }
+    EXPECT_GT(runs, 50u);
+}
+
+TEST_P(SimdTest, TruncatedArrayFails) {
+    MsgPackWriter w;
+    w.write_i16_probe(std::vector<int16_t>(64, 1000));
+    w.buf.resize(w.buf.size() - 2);
+    bool ok = true;
+    decode(w, &ok);
+    EXPECT_FALSE(ok);
+}
+
+INSTANTIATE_TEST_SUITE_P(Levels, SimdTest, ::testing::ValuesIn(ALL_LEVELS),
+                         [](const auto& info) {
+                             std::string name = delila::simd_level_name(info.param);
+                             return name == "sse4.1" ? std::string("sse41") : name;
+                         });
+
+TEST(MsgPackParser, AnalogProbesAsBin) {
+    auto in = mixed_samples(300, 7);
+    MsgPackWriter w;
+    w.analog_as_bin = true;
+    w.write_i16_probe(in);
+    EXPECT_EQ(w.buf[0], 0xc5);  // bin16
+
+    bool ok = false;
+    EXPECT_EQ(decode(w, &ok), in);
+    EXPECT_TRUE(ok);
+
+    // Odd byte count is not a sample array
+    MsgPackWriter odd;
+    const uint8_t bytes[3] = {1, 2, 3};
+    odd.write_bin(bytes, 3);
+    decode(odd, &ok);
+    EXPECT_FALSE(ok);
+}
@@ -0,0 +1,373 @@
+// Test helper: builds .delila files byte-for-byte the way rmp_serde and
+// the Rust recorder write them (compact arrays, minimal-width integers).
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "delila/checksum.hpp"
+#include "delila/compression.hpp"
+#include "delila/event.hpp"
+#include "delila/format.hpp"
+#include "delila/reader.hpp"
+
+namespace delila_test {
+
+class MsgPackWriter {
+public:
+    std::vector<uint8_t> buf;
+    // Analog probes as little-endian bin blobs (MsgpackOptions::analog_probes_as_bin)
+    bool analog_as_bin = false;
+
+    void put(uint8_t b) { buf.push_back(b); }
+    void put_be(uint64_t v, int bytes) {
+        for (int i = bytes - 1; i >= 0; i--) put(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    // rmp::encode::write_uint
+    void write_uint(uint64_t v) {
+        if (v < 128) {
+            put(static_cast<uint8_t>(v));
+        } else if (v < 256) {
+            put(0xcc);
+            put_be(v, 1);
+        } else if (v < 65536) {
+            put(0xcd);
+            put_be(v, 2);
+        } else if (v < 4294967296ULL) {
+            put(0xce);
+            put_be(v, 4);
+        } else {
+            put(0xcf);
+            put_be(v, 8);
+        }
+    }
+
+    // rmp::encode::write_sint (non-negative values use the uint encodings)
+    void write_int(int64_t v) {
+        if (v >= 0) {
+            write_uint(static_cast<uint64_t>(v));
+        } else if (v >= -32) {
+            put(static_cast<uint8_t>(v));
+        } else if (v >= -128) {
+            put(0xd0);
+            put_be(static_cast<uint64_t>(v), 1);
+        } else if (v >= -32768) {
+            put(0xd1);
+            put_be(static_cast<uint64_t>(v), 2);
+        } else if (v >= -2147483648LL) {
+            put(0xd2);
+            put_be(static_cast<uint64_t>(v), 4);
+        } else {
+            put(0xd3);
+            put_be(static_cast<uint64_t>(v), 8);
+        }
+    }
+
+    void write_f64(double v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, 8);
+        put(0xcb);
+        put_be(bits, 8);
+    }
+
+    void write_bool(bool v) { put(v ? 0xc3 : 0xc2); }
+
+    void write_array(size_t n) {
+        if (n < 16) {
+            put(static_cast<uint8_t>(0x90 | n));
+        } else if (n < 65536) {
+            put(0xdc);
+            put_be(n, 2);
+        } else {
+            put(0xdd);
+            put_be(n, 4);
+        }
+    }
+
+    void write_map(size_t n) {
+        if (n < 16) {
+            put(static_cast<uint8_t>(0x80 | n));
+        } else {
+            put(0xde);
+            put_be(n, 2);
+        }
+    }
+
+    void write_str(const std::string& s) {
+        if (s.size() < 32) {
+            put(static_cast<uint8_t>(0xa0 | s.size()));
+        } else {
+            put(0xd9);
+            put_be(s.size(), 1);
+        }
+        buf.insert(buf.end(), s.begin(), s.end());
+    }
+
+    void write_bin(const uint8_t* data, size_t n) {
+        if (n < 256) {
+            put(0xc4);
+            put_be(n, 1);
+        } else if (n < 65536) {
+            put(0xc5);
+            put_be(n, 2);
+        } else {
+            put(0xc6);
+            put_be(n, 4);
+        }
+        buf.insert(buf.end(), data, data + n);
+    }
+
+    void write_i16_probe(const std::vector<int16_t>& samples) {
+        if (analog_as_bin) {
+            std::vector<uint8_t> le;
+            for (int16_t v : samples) {
+                le.push_back(static_cast<uint8_t>(v));
+                le.push_back(static_cast<uint8_t>(static_cast<uint16_t>(v) >> 8));
+            }
+            write_bin(le.data(), le.size());
+            return;
+        }
+        write_array(samples.size());
+        for (int16_t v : samples) write_int(v);
+    }
+
+    void write_waveform(const delila::Waveform& wf) {
+        write_array(8);
+        write_i16_probe(wf.analog_probe1);
+        write_i16_probe(wf.analog_probe2);
+        for (const auto* p : {&wf.digital_probe1, &wf.digital_probe2,
+                              &wf.digital_probe3, &wf.digital_probe4}) {
+            write_array(p->size());
+            for (uint8_t v : *p) write_uint(v);
+        }
+        write_uint(wf.time_resolution);
+        write_uint(wf.trigger_threshold);
+    }
+
+    void write_event(const delila::Event& ev) {
+        write_array(ev.has_waveform ? 7 : 6);
+        write_uint(ev.module);
+        write_uint(ev.channel);
+        write_uint(ev.energy);
+        write_uint(ev.energy_short);
+        write_f64(ev.timestamp_ns);
+        write_uint(ev.flags);
+        if (ev.has_waveform) write_waveform(ev.waveform);
+    }
+
+    void write_batch(uint32_t source_id, uint64_t seq, const std::vector<delila::Event>& events) {
+        write_array(4);
+        write_uint(source_id);
+        write_uint(seq);
+        write_uint(1767225600000000000ULL);  // batch creation time
+        write_array(events.size());
+        for (const auto& ev : events) write_event(ev);
+    }
+};
+
+struct TestBatch {
+    uint32_t source_id = 0;
+    std::vector<delila::Event> events;
+};
+
+// Build a complete file image: header + blocks (+ footer). With `v3` the
+// file is DELILA03 and every block is framed by encode_block().
+inline std::vector<uint8_t> build_file_framed(const std::vector<TestBatch>& batches,
+                                              bool with_footer, uint32_t run_number, bool v3,
+                                              delila::Compression compression) {
+    const char* magic = v3 ? delila::FILE_MAGIC_V3 : delila::FILE_MAGIC;
+    std::vector<uint8_t> out(magic, magic + 8);
+
+    MsgPackWriter h;
+    h.write_array(10);
+    h.write_uint(v3 ? 3 : 2);  // version
+    h.write_uint(run_number);  // run_number
+    h.write_str("CRIB2026");   // exp_name
+    h.write_uint(0);           // file_sequence
+    h.write_uint(1767225600000000000ULL);
+    h.write_str("test run");   // comment
+    h.write_f64(0.0);          // sort_margin_ratio
+    h.write_bool(false);       // is_sorted
+    h.write_array(2);          // source_ids
+    h.write_uint(0);
+    h.write_uint(1);
+    h.write_map(1);            // metadata
+    h.write_str("operator");
+    h.write_str("Aogaki");
+    uint32_t hlen = static_cast<uint32_t>(h.buf.size());
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(hlen >> (8 * i)));
+    out.insert(out.end(), h.buf.begin(), h.buf.end());
+
+    uint64_t total_events = 0;
+    uint64_t data_bytes = 0;
+    uint64_t seq = 0;
+    delila::ChecksumCalculator checksum;
+    // FileFooter::update_timestamp_range: first / last event of each batch
+    double first_ts = DBL_MAX;
+    double last_ts = -DBL_MAX;
+    for (const auto& b : batches) {
+        MsgPackWriter w;
+        w.write_batch(b.source_id, seq++, b.events);
+        if (v3) {
+            std::vector<uint8_t> block;
+            if (!delila::encode_block(w.buf.data(), w.buf.size(), compression, 3, block)) {
+                delila::encode_block(w.buf.data(), w.buf.size(), delila::Compression::None, 0,
+                                     block);
+            }
+            w.buf.swap(block);
+        }
+        uint32_t len = static_cast<uint32_t>(w.buf.size());
+        for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(len >> (8 * i)));
+        checksum.update(out.data() + out.size() - 4, 4);
+        out.insert(out.end(), w.buf.begin(), w.buf.end());
+        checksum.update(w.buf.data(), w.buf.size());
+        total_events += b.events.size();
+        data_bytes += 4 + len;
+        if (!b.events.empty()) {
+            first_ts = std::min(first_ts, b.events.front().timestamp_ns);
+            last_ts = std::max(last_ts, b.events.back().timestamp_ns);
+        }
+    }
+
+    if (with_footer) {
+        uint8_t footer[delila::FOOTER_SIZE] = {0};
+        std::memcpy(footer, delila::FOOTER_MAGIC, 8);
+        uint64_t data_checksum = checksum.finalize();
+        std::memcpy(footer + 8, &data_checksum, 8);
+        std::memcpy(footer + 16, &total_events, 8);
+        std::memcpy(footer + 24, &data_bytes, 8);
+        std::memcpy(footer + 32, &first_ts, 8);
+        std::memcpy(footer + 40, &last_ts, 8);
+        footer[56] = 1;
+        out.insert(out.end(), footer, footer + delila::FOOTER_SIZE);
+    }
+    return out;
+}
+
+inline std::vector<uint8_t> build_file(const std::vector<TestBatch>& batches,
+                                       bool with_footer = true, uint32_t run_number = 10) {
+    return build_file_framed(batches, with_footer, run_number, false, delila::Compression::None);
+}
+
+// DELILA03 file with every block compressed (stored where that does not help)
+inline std::vector<uint8_t> build_file_v3(const std::vector<TestBatch>& batches,
+                                          delila::Compression compression,
+                                          bool with_footer = true) {
+    return build_file_framed(batches, with_footer, 10, true, compression);
+}
+
+inline delila::Event make_event(uint8_t module, uint8_t channel, uint16_t energy,
+                                double ts, size_t n_samples = 0) {
+    delila::Event ev;
+    ev.module = module;
+    ev.channel = channel;
+    ev.energy = energy;
+    ev.energy_short = static_cast<uint16_t>(energy / 4);
+    ev.timestamp_ns = ts;
+    ev.flags = 0x01;
+    if (n_samples > 0) {
+        ev.has_waveform = true;
+        for (size_t i = 0; i < n_samples; i++) {
+            ev.waveform.analog_probe1.push_back(static_cast<int16_t>(i * 37 % 20000 - 10000));
+            ev.waveform.analog_probe2.push_back(static_cast<int16_t>(-static_cast<int>(i % 50)));
+            ev.waveform.digital_probe1.push_back(i > n_samples / 2 ? 1 : 0);
+            ev.waveform.digital_probe2.push_back(0);
+            ev.waveform.digital_probe3.push_back(1);
+            ev.waveform.digital_probe4.push_back(static_cast<uint8_t>(i & 1));
+        }
+        ev.waveform.time_resolution = 1;
+        ev.waveform.trigger_threshold = 300;
+    }
+    return ev;
+}
+
+// Shape of the blocks generate_batches() builds. Block b comes from
+// source b % sources and holds events + b % events_cycle events (events
+// without a cycle). Event i of block b is make_event(module, i % channels,
+// energy + b * block_energy + i * event_energy,
+// t0 + b * block_ns + i * event_ns), with module = the source id when
+// module_is_source, else 0. It gets waveform_samples samples when
+// i % waveform_every == waveform_phase (never with waveform_every 0).
+// `edit`, if set, changes each event after that.
+struct BatchPattern {
+    uint32_t sources = 1;
+    bool module_is_source = false;
+    int events = 10;
+    int events_cycle = 0;
+    int channels = 16;
+    uint16_t energy = 100;
+    int block_energy = 0;
+    int event_energy = 0;
+    double t0 = 0.0;
+    double block_ns = 1000.0;
+    double event_ns = 1.0;
+    int waveform_every = 0;
+    int waveform_phase = 0;
+    size_t waveform_samples = 32;
+    std::function<void(int block, int event, delila::Event& ev)> edit;
+};
+
+inline std::vector<TestBatch> generate_batches(int n_blocks, const BatchPattern& p = {}) {
+    std::vector<TestBatch> batches(static_cast<size_t>(n_blocks));
+    for (int b = 0; b < n_blocks; b++) {
+        TestBatch& batch = batches[static_cast<size_t>(b)];
+        batch.source_id = static_cast<uint32_t>(b) % p.sources;
+        int n = p.events + (p.events_cycle > 0 ? b % p.events_cycle : 0);
+        for (int i = 0; i < n; i++) {
+            bool waveform = p.waveform_every > 0 && i % p.waveform_every == p.waveform_phase;
+            batch.events.push_back(make_event(
+                static_cast<uint8_t>(p.module_is_source ? batch.source_id : 0),
+                static_cast<uint8_t>(i % p.channels),
+                static_cast<uint16_t>(p.energy + b * p.block_energy + i * p.event_energy),
+                p.t0 + b * p.block_ns + i * p.event_ns, waveform ? p.waveform_samples : 0));
+            if (p.edit) p.edit(b, i, batch.events.back());
+        }
+    }
+    return batches;
+}
+
+// A MsgPackWriter's buffer as a block, for FileReader::decode_block
+inline delila::BlockView view_of(const MsgPackWriter& w) {
+    delila::BlockView block;
+    block.data = w.buf.data();
+    block.size = w.buf.size();
+    return block;
+}
+
+// Append bytes [begin, end) of `content` to the file at `path` (a recorder
+// still writing, for follow-mode tests)
+inline void append_bytes(const std::string& path, const std::vector<uint8_t>& content,
+                         size_t begin, size_t end) {
+    std::ofstream f(path, std::ios::binary | std::ios::app);
+    f.write(reinterpret_cast<const char*>(content.data() + begin),
+            static_cast<std::streamsize>(end - begin));
+}
+
+// Temporary file removed on destruction
+class TempFile {
+public:
+    explicit TempFile(const std::vector<uint8_t>& content, const std::string& tag = "t") {
+        static int counter = 0;
+        path_ = "/tmp/delila_test_" + tag + "_" + std::to_string(counter++) + "_" +
+                std::to_string(reinterpret_cast<uintptr_t>(this)) + ".delila";
+        std::ofstream f(path_, std::ios::binary);
+        f.write(reinterpret_cast<const char*>(content.data()),
+                static_cast<std::streamsize>(content.size()));
+    }
+    ~TempFile() { std::remove(path_.c_str()); }
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+};
+
+}  // namespace delila_test
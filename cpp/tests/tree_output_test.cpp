@@ -0,0 +1,95 @@
+// Unit tests for tree_output.hpp (TTree branch layout)
+
+#include <gtest/gtest.h>
+
+#include <TMemFile.h>
+
+#include <string>
+
+#include "delila/tree_output.hpp"
+#include "test_writer.hpp"
+
+using delila::OutputProfile;
+using delila::OutputTrees;
+using delila_test::make_event;
+
+namespace {
+
+// Fill two events, the second with a 10-sample waveform
+void fill_two(OutputTrees& trees) {
+    trees.br->set(make_event(1, 2, 1000, 10.0));
+    trees.br->fill();
+    trees.br->set(make_event(1, 3, 2000, 20.0, 10));
+    trees.br->fill();
+}
+
+}  // namespace
+
+TEST(OutputTrees, InlineReadsBack) {
+    TMemFile file("inline.root", "RECREATE");
+    OutputProfile profile;
+    OutputTrees trees;
+    trees.create(&file, profile);
+    fill_two(trees);
+    EXPECT_EQ(trees.waveforms, nullptr);
+    ASSERT_EQ(trees.events->GetEntries(), 2);
+    ASSERT_NE(trees.events->GetBranch("analog1"), nullptr);
+
+    // The branches read back into the same buffers
+    trees.events->GetEntry(0);
+    EXPECT_EQ(trees.br->energy, 1000);
+    EXPECT_FALSE(trees.br->has_waveform);
+    EXPECT_EQ(trees.br->n_analog1, 0);
+    trees.events->GetEntry(1);
+    EXPECT_EQ(trees.br->channel, 3);
+    EXPECT_DOUBLE_EQ(trees.br->timestamp_ns, 20.0);
+    EXPECT_TRUE(trees.br->has_waveform);
+    ASSERT_EQ(trees.br->n_analog1, 10);
+    EXPECT_EQ(trees.br->analog1[1], 37 - 10000);
+    EXPECT_EQ(trees.br->trigger_threshold, 300);
+}
+
+TEST(OutputTrees, FriendAndScalarLayouts) {
+    TMemFile file("layouts.root", "RECREATE");
+    OutputProfile friends;
+    ASSERT_TRUE(friends.parse("friend"));
+    OutputTrees split;
+    split.create(&file, friends);
+    fill_two(split);
+    ASSERT_NE(split.waveforms, nullptr);
+    EXPECT_EQ(split.events->GetBranch("analog1"), nullptr);
+    EXPECT_NE(split.waveforms->GetBranch("analog1"), nullptr);
+    EXPECT_EQ(split.events->GetEntries(), 2);
+    EXPECT_EQ(split.waveforms->GetEntries(), 2);
+
+    TMemFile scalar_file("scalar.root", "RECREATE");
+    OutputProfile scalar;
+    ASSERT_TRUE(scalar.parse("scalar,basket=4096"));
+    OutputTrees scalars;
+    scalars.create(&scalar_file, scalar);
+    fill_two(scalars);
+    EXPECT_EQ(scalars.waveforms, nullptr);
+    EXPECT_EQ(scalars.events->GetBranch("n_analog1"), nullptr);
+    EXPECT_NE(scalars.events->GetBranch("energy"), nullptr);
+}
+
+TEST(OutputTrees, ReductionBranches) {
+    TMemFile file("features.root", "RECREATE");
+    OutputProfile profile;
+    ASSERT_TRUE(profile.parse("features"));
+    OutputTrees trees;
+    trees.create(&file, profile);
+    fill_two(trees);
+    EXPECT_NE(trees.events->GetBranch("wf_peak"), nullptr);
+    EXPECT_NE(trees.events->GetBranch("wf_n_samples"), nullptr);
+    EXPECT_EQ(trees.events->GetBranch("analog1"), nullptr);
+    trees.events->GetEntry(1);
+    EXPECT_EQ(trees.br->wf_n_samples, 10u);
+}
+
+TEST(OutputTrees, UncreatableFile) {
+    OutputProfile profile;
+    std::string err;
+    EXPECT_EQ(delila::create_tree_file("/nonexistent/dir/out.root", profile, &err), nullptr);
+    EXPECT_EQ(err, "Cannot create output file /nonexistent/dir/out.root");
+}
@@ -0,0 +1,76 @@
+// Unit tests for tree_profile.hpp
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "delila/tree_profile.hpp"
+
+using delila::DigitalMode;
+using delila::OutputProfile;
+using delila::WaveformLayout;
+
+TEST(OutputProfile, Defaults) {
+    OutputProfile p;
+    ASSERT_TRUE(p.parse(""));
+    EXPECT_EQ(p.waveforms, WaveformLayout::Inline);
+    EXPECT_EQ(p.compression, -1);
+    EXPECT_EQ(p.auto_flush, 0);
+    EXPECT_EQ(p.basket_size, 32000);
+    EXPECT_FALSE(p.reduce.active());
+    EXPECT_EQ(p.describe(), "Profile: full, basket 32000 bytes");
+}
+
+TEST(OutputProfile, LayoutCompressionAndSizes) {
+    OutputProfile p;
+    ASSERT_TRUE(p.parse("friend,zstd,flush=-30000000,basket=256000"));
+    EXPECT_EQ(p.waveforms, WaveformLayout::Friend);
+    EXPECT_EQ(p.compression, 505);
+    EXPECT_EQ(p.auto_flush, -30000000);
+    EXPECT_EQ(p.basket_size, 256000);
+    EXPECT_STREQ(delila::waveform_layout_name(p.waveforms), "friend");
+
+    // Later items win; levels after ':' or '='
+    ASSERT_TRUE(p.parse("scalar,lz4:1"));
+    EXPECT_EQ(p.waveforms, WaveformLayout::None);
+    EXPECT_EQ(p.compression, 401);
+    ASSERT_TRUE(p.parse("lzma,,full"));
+    EXPECT_EQ(p.compression, 207);
+    EXPECT_EQ(p.waveforms, WaveformLayout::Inline);
+    ASSERT_TRUE(p.parse("zlib=9"));
+    EXPECT_EQ(p.compression, 109);
+    ASSERT_TRUE(p.parse("none"));
+    EXPECT_EQ(p.compression, 0);
+}
+
+TEST(OutputProfile, ReductionOptions) {
+    OutputProfile p;
+    ASSERT_TRUE(p.parse("crop=32:160,trigger=2,decimate=2,pick,digital=rle"));
+    EXPECT_TRUE(p.reduce.crop);
+    EXPECT_EQ(p.reduce.pre_samples, 32u);
+    EXPECT_EQ(p.reduce.post_samples, 160u);
+    EXPECT_EQ(p.reduce.trigger_probe, 2);
+    EXPECT_EQ(p.reduce.decimate, 2u);
+    EXPECT_TRUE(p.reduce.pick);
+    EXPECT_EQ(p.reduce.digital, DigitalMode::RunLength);
+    EXPECT_EQ(p.describe(), "Profile: full, basket 32000 bytes\n"
+                            "Waveforms: decimate 2 (pick) digital rle crop 32:160 around digital2");
+
+    // No waveforms written, nothing to reduce
+    ASSERT_TRUE(p.parse("scalar"));
+    EXPECT_EQ(p.describe(), "Profile: scalar, basket 32000 bytes");
+}
+
+TEST(OutputProfile, RejectsBadOptions) {
+    OutputProfile p;
+    std::string err;
+    EXPECT_FALSE(p.parse("full,bogus", &err));
+    EXPECT_EQ(err, "unknown output profile option 'bogus'");
+    EXPECT_FALSE(p.parse("zstd:12", &err));
+    EXPECT_EQ(err, "compression level must be 1-9: zstd:12");
+    EXPECT_FALSE(p.parse("basket=0", &err));
+    EXPECT_FALSE(p.parse("flush", &err));
+    EXPECT_FALSE(p.parse("crop=32", &err));
+    EXPECT_EQ(err, "Bad crop (PRE:POST samples): 32");
+    EXPECT_FALSE(p.parse("lz5"));  // No error string asked for
+}
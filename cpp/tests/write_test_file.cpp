@@ -0,0 +1,26 @@
+// Write the Python module's test file (python_test.py) with test_writer.hpp
+//
+//   write_test_file PATH
+//
+// Two blocks of two events; waveforms on events 1 (10 samples) and 2 (5).
+
+#include <cstdio>
+#include <fstream>
+
+#include "test_writer.hpp"
+
+using delila_test::make_event;
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s PATH\n", argv[0]);
+        return 2;
+    }
+    std::vector<uint8_t> content = delila_test::build_file(
+        {{0, {make_event(1, 2, 1000, 10.0), make_event(1, 3, 2000, 20.0, 10)}},
+         {1, {make_event(2, 4, 3000, 30.0, 5), make_event(2, 5, 4000, 40.0)}}});
+    std::ofstream f(argv[1], std::ios::binary);
+    f.write(reinterpret_cast<const char*>(content.data()),
+            static_cast<std::streamsize>(content.size()));
+    return f ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+// delila-arrow: .delila files to Parquet or an Arrow IPC stream
+//
+//   delila-arrow run0010.parquet data/run0010_*.delila
+//   delila-arrow --ipc - data/run0010_*.delila | python -c 'import pyarrow as pa, sys; ...'
+//   delila-arrow --no-waveforms --level 9 scalars.parquet data/*.delila
+//
+// Progress, errors and the metrics summary go to stderr, so stdout can
+// carry the stream.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "delila/arrow.hpp"
+#include "delila/metrics.hpp"
+
+namespace {
+
+int usage() {
+    std::cerr << "usage: delila-arrow [--ipc] [--no-waveforms] [--level N] OUTPUT INPUT...\n"
+                 "  OUTPUT  .parquet file (default), or IPC stream file / '-' for stdout with --ipc\n";
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    delila::ArrowOptions options;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--ipc") == 0) {
+            options.format = delila::ArrowFormat::IpcStream;
+        } else if (std::strcmp(argv[i], "--no-waveforms") == 0) {
+            options.waveforms = false;
+        } else if (std::strcmp(argv[i], "--level") == 0 && i + 1 < argc) {
+            options.compression_level = std::atoi(argv[++i]);
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            return usage();
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (args.size() < 2) return usage();
+    const std::string output = args[0];
+    std::vector<std::string> inputs(args.begin() + 1, args.end());
+
+    delila::Metrics metrics;
+    delila::MetricsReporter reporter(metrics, 0.0, &std::cerr);  // One line at the end
+    std::vector<std::string> errors;
+    bool ok = delila::export_arrow(inputs, output, options, nullptr, &errors, &metrics);
+    for (const auto& e : errors) std::cerr << "Error: " << e << std::endl;
+    reporter.report();
+    std::cerr << metrics.snapshot().to_json("delila-arrow") << std::endl;
+    return ok && errors.empty() ? 0 : 1;
+}
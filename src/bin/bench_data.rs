@@ -0,0 +1,241 @@
+//! Synthetic .delila files for the libdelila benchmarks (cpp/bench)
+//!
+//! Events come from the emulator's generator and are encoded with
+//! `EventDataBatch::to_msgpack_with` and framed (header, length-prefixed
+//! blocks, footer, `.idx` sidecar) exactly as the recorder writes them, so
+//! the C++ read side is measured on production bytes.
+//!
+//! Usage:
+//!   cargo run --release --bin bench_data -- /tmp/delila_bench
+//!   cargo run --release --bin bench_data -- /tmp/delila_bench --mb 64 --profile scalar,long
+//!   cargo run --release --bin bench_data -- /tmp/delila_zstd --compression zstd
+//!   DELILA_BENCH_DATA=/tmp/delila_bench cpp/build/bench/delila_bench
+//!
+//! Profiles (bench_<name>.delila):
+//!   scalar  no waveforms
+//!   short   256-sample analog probes on every event
+//!   long    16384-sample waveforms, all probes, on every event
+//!   mixed   1024-sample analog probes on every 10th event
+
+use std::fs::File;
+use std::io::{BufWriter, Write};
+use std::path::{Path, PathBuf};
+
+use anyhow::{bail, Context, Result};
+use clap::Parser;
+use rand::rngs::StdRng;
+use rand::SeedableRng;
+
+use delila_rs::common::{EventDataBatch, MsgpackOptions};
+use delila_rs::data_source_emulator::{generate_event, waveform_probes};
+use delila_rs::recorder::{
+    encode_block, BlockCompression, BlockIndex, BlockIndexEntry, ChecksumCalculator, FileFooter,
+    FileHeader, FOOTER_SIZE, FORMAT_VERSION_V3,
+};
+
+/// One benchmark data profile
+struct Profile {
+    name: &'static str,
+    /// Events per block (~1 MB blocks, like a loaded digitizer)
+    events_per_batch: usize,
+    /// Every n-th event has a waveform (0: none)
+    waveform_every: u64,
+    samples: usize,
+    probes: u8,
+}
+
+const PROFILES: &[Profile] = &[
+    Profile {
+        name: "scalar",
+        events_per_batch: 50_000,
+        waveform_every: 0,
+        samples: 0,
+        probes: 0,
+    },
+    Profile {
+        name: "short",
+        events_per_batch: 1_000,
+        waveform_every: 1,
+        samples: 256,
+        probes: waveform_probes::ALL_ANALOG,
+    },
+    Profile {
+        name: "long",
+        events_per_batch: 16,
+        waveform_every: 1,
+        samples: 16_384,
+        probes: waveform_probes::ALL,
+    },
+    Profile {
+        name: "mixed",
+        events_per_batch: 5_000,
+        waveform_every: 10,
+        samples: 1_024,
+        probes: waveform_probes::ALL_ANALOG,
+    },
+];
+
+#[derive(Parser)]
+#[command(name = "bench_data")]
+#[command(about = "Write synthetic .delila files for the libdelila benchmarks")]
+struct Cli {
+    /// Output directory
+    directory: PathBuf,
+
+    /// Data size per profile in MB
+    #[arg(long, default_value_t = 256)]
+    mb: u64,
+
+    /// Profiles to write (comma-separated; default: all)
+    #[arg(long, value_delimiter = ',')]
+    profile: Vec<String>,
+
+    /// Encode analog probes as bin blobs (recorder `analog_probes_as_bin`)
+    #[arg(long)]
+    analog_probes_as_bin: bool,
+
+    /// Block compression (none, lz4, zstd); anything but none writes v3 files
+    #[arg(long, value_enum, default_value = "none")]
+    compression: Compression,
+
+    /// zstd level
+    #[arg(long, default_value_t = 3)]
+    level: i32,
+
+    /// RNG seed, so files are reproducible
+    #[arg(long, default_value_t = 1)]
+    seed: u64,
+}
+
+#[derive(Clone, Copy, clap::ValueEnum)]
+enum Compression {
+    None,
+    Lz4,
+    Zstd,
+}
+
+impl From<Compression> for BlockCompression {
+    fn from(c: Compression) -> Self {
+        match c {
+            Compression::None => BlockCompression::None,
+            Compression::Lz4 => BlockCompression::Lz4,
+            Compression::Zstd => BlockCompression::Zstd,
+        }
+    }
+}
+
+fn main() -> Result<()> {
+    let cli = Cli::parse();
+    std::fs::create_dir_all(&cli.directory)
+        .with_context(|| format!("creating {}", cli.directory.display()))?;
+
+    for name in &cli.profile {
+        if !PROFILES.iter().any(|p| p.name == name) {
+            bail!("unknown profile '{}'", name);
+        }
+    }
+    let options = MsgpackOptions {
+        analog_probes_as_bin: cli.analog_probes_as_bin,
+    };
+
+    for profile in PROFILES {
+        if !cli.profile.is_empty() && !cli.profile.iter().any(|p| p == profile.name) {
+            continue;
+        }
+        let path = cli.directory.join(format!("bench_{}.delila", profile.name));
+        let target_bytes = cli.mb * 1_000_000;
+        let compression = (cli.compression.into(), cli.level);
+        let (events, bytes) = write_profile(
+            &path,
+            profile,
+            target_bytes,
+            &options,
+            compression,
+            cli.seed,
+        )
+        .with_context(|| format!("writing {}", path.display()))?;
+        println!(
+            "{:<8} {:>12} events {:>10.1} MB  {}",
+            profile.name,
+            events,
+            bytes as f64 / 1_000_000.0,
+            path.display()
+        );
+    }
+    Ok(())
+}
+
+/// Write one file of about `target_bytes` of data blocks (as stored, so
+/// compressed files hold more events). Returns (events, data bytes).
+fn write_profile(
+    path: &Path,
+    profile: &Profile,
+    target_bytes: u64,
+    options: &MsgpackOptions,
+    (compression, level): (BlockCompression, i32),
+    seed: u64,
+) -> Result<(u64, u64)> {
+    let mut writer = BufWriter::with_capacity(1 << 20, File::create(path)?);
+
+    let mut header = FileHeader::new(0, "BENCH".to_string(), 0);
+    header.comment = format!("bench_data profile {}", profile.name);
+    header.source_ids = vec![0];
+    if compression != BlockCompression::None {
+        header.version = FORMAT_VERSION_V3;
+    }
+    let header_bytes = header.to_bytes()?;
+    writer.write_all(&header_bytes)?;
+    let mut offset = header_bytes.len() as u64;
+
+    let mut rng = StdRng::seed_from_u64(seed);
+    let mut checksum = ChecksumCalculator::new();
+    let mut footer = FileFooter::new();
+    let mut index = BlockIndex::new();
+    let mut timestamp_ns = 0.0;
+    let mut n: u64 = 0;
+    let mut sequence: u64 = 0;
+
+    while checksum.bytes_processed() < target_bytes {
+        let mut batch = EventDataBatch::with_capacity(0, sequence, profile.events_per_batch);
+        for _ in 0..profile.events_per_batch {
+            let waveform = if profile.waveform_every > 0 && n % profile.waveform_every == 0 {
+                Some((profile.samples, profile.probes))
+            } else {
+                None
+            };
+            batch.push(generate_event(&mut rng, 0, 16, &mut timestamp_ns, waveform));
+            n += 1;
+        }
+        if let (Some(first), Some(last)) = (batch.events.first(), batch.events.last()) {
+            footer.update_timestamp_range(first.timestamp_ns, last.timestamp_ns);
+        }
+
+        let mut data = batch.to_msgpack_with(options)?;
+        if compression != BlockCompression::None {
+            data = encode_block(&data, compression, level)?;
+        }
+        let len_bytes = (data.len() as u32).to_le_bytes();
+        writer.write_all(&len_bytes)?;
+        writer.write_all(&data)?;
+        index.push(BlockIndexEntry::from_batch(
+            offset,
+            data.len() as u32,
+            &batch,
+        ));
+        checksum.update(&len_bytes);
+        checksum.update(&data);
+        offset += 4 + data.len() as u64;
+        footer.total_events += batch.events.len() as u64;
+        sequence += 1;
+    }
+
+    footer.data_checksum = checksum.finalize();
+    footer.data_bytes = checksum.bytes_processed();
+    footer.finalize();
+    writer.write_all(&footer.to_bytes())?;
+    writer.flush()?;
+
+    index.data_file_size = offset + FOOTER_SIZE as u64;
+    std::fs::write(BlockIndex::sidecar_path(path), index.to_bytes())?;
+    Ok((footer.total_events, footer.data_bytes))
+}
@@ -8,9 +8,9 @@
 use std::path::PathBuf;
 
 use clap::Parser;
-use delila_rs::common::{setup_shutdown_with_message, RecorderArgs};
+use delila_rs::common::{setup_shutdown_with_message, MsgpackOptions, RecorderArgs};
 use delila_rs::config::Config;
-use delila_rs::recorder::{Recorder, RecorderConfig};
+use delila_rs::recorder::{BlockCompression, Recorder, RecorderConfig};
 use tracing::info;
 use tracing_subscriber::EnvFilter;
 
@@ -37,7 +37,7 @@ async fn main() -> anyhow::Result<()> {
     let config = Config::load(&args.recorder.common.config_file)?;
     info!(config_file = %args.recorder.common.config_file, "Loaded configuration");
 
-    let (subscribe_addr, command_addr, out_dir, max_size_mb, max_duration_sec) =
+    let (subscribe_addr, command_addr, out_dir, max_size_mb, max_duration_sec, probes_as_bin) =
         if let Some(ref recorder) = config.network.recorder {
             (
                 recorder.subscribe.clone(),
@@ -48,6 +48,7 @@ async fn main() -> anyhow::Result<()> {
                 recorder.output_dir.clone(),
                 recorder.max_file_size_mb,
                 recorder.max_file_duration_sec,
+                recorder.analog_probes_as_bin,
             )
         } else {
             (
@@ -56,9 +57,18 @@ async fn main() -> anyhow::Result<()> {
                 "./data".to_string(),
                 1024,
                 600,
+                false,
             )
         };
 
+    let (compression, compression_level) = config
+        .network
+        .recorder
+        .as_ref()
+        .map_or((BlockCompression::None, 3), |r| {
+            (r.compression, r.compression_level)
+        });
+
     // CLI overrides config file
     let recorder_config = RecorderConfig {
         subscribe_address: args.recorder.address.unwrap_or(subscribe_addr),
@@ -66,6 +76,11 @@ async fn main() -> anyhow::Result<()> {
         output_dir: PathBuf::from(args.recorder.output_dir.unwrap_or(out_dir)),
         max_file_size: max_size_mb * 1024 * 1024,
         max_file_duration_secs: max_duration_sec,
+        msgpack_options: MsgpackOptions {
+            analog_probes_as_bin: probes_as_bin,
+        },
+        compression,
+        compression_level,
     };
 
     // Setup shutdown handling
@@ -90,6 +105,7 @@ async fn main() -> anyhow::Result<()> {
         recorder_config.max_file_duration_secs
     );
     println!("  Mode:           Raw (unsorted)");
+    println!("  Compression:    {:?}", recorder_config.compression);
     println!();
     println!("  Press Ctrl+C to stop.");
     println!("========================================");
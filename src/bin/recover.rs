@@ -5,13 +5,19 @@
 //!   delila-recover info <file>          - Show file metadata
 //!   delila-recover recover <file> [--output <path>]  - Recover data from incomplete file
 //!   delila-recover list <directory>     - List all .delila files with status
+//!   delila-recover index <files...> [--force]  - (Re)build block index sidecars
+//!   delila-recover dump <files...> --output <path> [--columnar]  - Flat binary for ROOT
 
 use std::fs::File;
 use std::io::{BufReader, BufWriter, Write};
 use std::path::{Path, PathBuf};
 
 use clap::{Parser, Subcommand};
-use delila_rs::recorder::{ChecksumCalculator, DataFileReader, FileFooter, FileValidationResult};
+use delila_rs::common::EventData;
+use delila_rs::recorder::{
+    BlockIndex, BlockIndexEntry, ChecksumCalculator, DataFileReader, FileFooter,
+    FileValidationResult, FORMAT_VERSION,
+};
 
 #[derive(Parser)]
 #[command(name = "delila-recover")]
@@ -65,6 +71,21 @@ enum Commands {
         /// Output flat binary path
         #[arg(short, long)]
         output: PathBuf,
+
+        /// Write DLDUMP02 (aligned column chunks) instead of DLDUMP01 records
+        #[arg(long)]
+        columnar: bool,
+    },
+
+    /// Build block index sidecars (<file>.idx) for fast seeking
+    Index {
+        /// Input .delila file(s)
+        #[arg(required = true)]
+        files: Vec<PathBuf>,
+
+        /// Rebuild even if an up-to-date index exists
+        #[arg(short, long)]
+        force: bool,
     },
 }
 
@@ -99,8 +120,18 @@ fn main() {
                 std::process::exit(1);
             }
         }
-        Commands::Dump { files, output } => {
-            if let Err(e) = dump_files(&files, &output) {
+        Commands::Dump {
+            files,
+            output,
+            columnar,
+        } => {
+            if let Err(e) = dump_files(&files, &output, columnar) {
+                eprintln!("Error: {}", e);
+                std::process::exit(1);
+            }
+        }
+        Commands::Index { files, force } => {
+            if let Err(e) = index_files(&files, force) {
                 eprintln!("Error: {}", e);
                 std::process::exit(1);
             }
@@ -228,16 +259,20 @@ fn recover_file(
     let out_file = File::create(&output)?;
     let mut writer = BufWriter::with_capacity(64 * 1024, out_file);
 
-    // Write header (copy from original)
-    let header = result.header.clone().ok_or("No header found")?;
+    // Write header (copy from original). Blocks are re-encoded uncompressed,
+    // so a v3 input becomes a v2 file.
+    let mut header = result.header.clone().ok_or("No header found")?;
+    header.version = FORMAT_VERSION;
     let header_bytes = header
         .to_bytes()
         .map_err(|e| format!("Failed to serialize header: {}", e))?;
     writer.write_all(&header_bytes)?;
 
-    // Prepare footer and checksum
+    // Prepare footer, checksum and block index
     let mut footer = FileFooter::new();
     let mut checksum = ChecksumCalculator::new();
+    let mut index = BlockIndex::new();
+    let mut offset = header_bytes.len() as u64;
 
     // Copy recoverable data blocks
     let mut events_written = 0u64;
@@ -260,6 +295,13 @@ fn recover_file(
                 writer.write_all(&len_bytes)?;
                 writer.write_all(&data)?;
 
+                index.push(BlockIndexEntry::from_batch(
+                    offset,
+                    data.len() as u32,
+                    &batch,
+                ));
+                offset += 4 + data.len() as u64;
+
                 // Update checksum
                 checksum.update(&len_bytes);
                 checksum.update(&data);
@@ -289,6 +331,9 @@ fn recover_file(
     writer.flush()?;
     writer.get_ref().sync_all()?;
 
+    index.data_file_size = offset + footer_bytes.len() as u64;
+    write_index(&output, &index)?;
+
     println!();
     println!("\x1b[32m✓ Recovery complete\x1b[0m");
     println!("  Blocks written: {}", blocks_written);
@@ -301,6 +346,49 @@ fn recover_file(
     Ok(())
 }
 
+fn index_files(files: &[PathBuf], force: bool) -> Result<(), Box<dyn std::error::Error>> {
+    for path in files {
+        let file_size = std::fs::metadata(path)?.len();
+        let index_path = BlockIndex::sidecar_path(path);
+
+        if !force {
+            let existing = File::open(&index_path)
+                .ok()
+                .and_then(|f| BlockIndex::read_from(&mut BufReader::new(f)).ok());
+            // Sidecars from before zone maps are rebuilt to gain them
+            if existing.is_some_and(|idx| {
+                idx.data_file_size == file_size && idx.entries.iter().all(|e| e.zone.is_some())
+            }) {
+                println!("  {} (up to date)", index_path.display());
+                continue;
+            }
+        }
+
+        let file = File::open(path)?;
+        let mut data_reader = DataFileReader::new(BufReader::new(file))?;
+        let index = data_reader.build_block_index()?;
+        write_index(path, &index)?;
+
+        let events: u64 = index.entries.iter().map(|e| e.num_events as u64).sum();
+        println!(
+            "  {} ({} blocks, {} events)",
+            index_path.display(),
+            index.len(),
+            events
+        );
+    }
+
+    Ok(())
+}
+
+fn write_index(data_path: &Path, index: &BlockIndex) -> Result<(), Box<dyn std::error::Error>> {
+    let file = File::create(BlockIndex::sidecar_path(data_path))?;
+    let mut writer = BufWriter::new(file);
+    index.write_to(&mut writer)?;
+    writer.flush()?;
+    Ok(())
+}
+
 fn list_files(directory: &Path, recursive: bool) -> Result<(), Box<dyn std::error::Error>> {
     println!("Scanning: {}", directory.display());
     println!();
@@ -405,10 +493,82 @@ fn list_files(directory: &Path, recursive: bool) -> Result<(), Box<dyn std::erro
 /// Flat binary dump magic
 const DUMP_MAGIC: &[u8; 8] = b"DLDUMP01";
 
+/// Columnar dump magic
+const DUMP_MAGIC_V2: &[u8; 8] = b"DLDUMP02";
+
 /// Per-event record size: module(1) + channel(1) + energy(2) + energy_short(2) + flags(8) + timestamp_ns(8) = 22
 const EVENT_RECORD_SIZE: usize = 22;
 
-fn dump_files(files: &[PathBuf], output: &Path) -> Result<(), Box<dyn std::error::Error>> {
+/// Events per DLDUMP02 chunk (the last chunk may hold fewer)
+const DUMP_CHUNK_EVENTS: usize = 65536;
+
+/// DLDUMP02 chunk header: n_events (u32) + reserved (u32)
+const DUMP_CHUNK_HEADER_SIZE: usize = 8;
+
+/// One DLDUMP02 chunk, column by column
+///
+/// Layout (Little-Endian), after the 16-byte file header:
+///   n(u32) reserved(u32)
+///   timestamp_ns f64[n]  flags u64[n]  energy u16[n]  energy_short u16[n]
+///   module u8[n]  channel u8[n]  zero padding to a multiple of 8 bytes
+/// Columns are ordered by width, so every array is naturally aligned when
+/// the file is read into (or mapped at) an 8-byte aligned address.
+#[derive(Default)]
+struct DumpChunk {
+    timestamp_ns: Vec<f64>,
+    flags: Vec<u64>,
+    energy: Vec<u16>,
+    energy_short: Vec<u16>,
+    module: Vec<u8>,
+    channel: Vec<u8>,
+}
+
+impl DumpChunk {
+    fn len(&self) -> usize {
+        self.timestamp_ns.len()
+    }
+
+    fn push(&mut self, ev: &EventData) {
+        self.timestamp_ns.push(ev.timestamp_ns);
+        self.flags.push(ev.flags);
+        self.energy.push(ev.energy);
+        self.energy_short.push(ev.energy_short);
+        self.module.push(ev.module);
+        self.channel.push(ev.channel);
+    }
+
+    /// Bytes of a chunk holding `n` events, padding included
+    fn encoded_size(n: usize) -> usize {
+        (DUMP_CHUNK_HEADER_SIZE + n * EVENT_RECORD_SIZE + 7) & !7
+    }
+
+    /// Append the encoded chunk to `buf` and clear the columns
+    fn encode(&mut self, buf: &mut Vec<u8>) {
+        let start = buf.len();
+        buf.extend_from_slice(&(self.len() as u32).to_le_bytes());
+        buf.extend_from_slice(&0u32.to_le_bytes());
+        buf.extend(self.timestamp_ns.iter().flat_map(|v| v.to_le_bytes()));
+        buf.extend(self.flags.iter().flat_map(|v| v.to_le_bytes()));
+        buf.extend(self.energy.iter().flat_map(|v| v.to_le_bytes()));
+        buf.extend(self.energy_short.iter().flat_map(|v| v.to_le_bytes()));
+        buf.extend_from_slice(&self.module);
+        buf.extend_from_slice(&self.channel);
+        buf.resize(start + Self::encoded_size(self.len()), 0);
+
+        self.timestamp_ns.clear();
+        self.flags.clear();
+        self.energy.clear();
+        self.energy_short.clear();
+        self.module.clear();
+        self.channel.clear();
+    }
+}
+
+fn dump_files(
+    files: &[PathBuf],
+    output: &Path,
+    columnar: bool,
+) -> Result<(), Box<dyn std::error::Error>> {
     // First pass: count total events across all files
     let mut total_events = 0u64;
     for path in files {
@@ -431,10 +591,11 @@ fn dump_files(files: &[PathBuf], output: &Path) -> Result<(), Box<dyn std::error
     }
 
     println!(
-        "Dumping {} events from {} file(s) to {}",
+        "Dumping {} events from {} file(s) to {} ({})",
         total_events,
         files.len(),
-        output.display()
+        output.display(),
+        if columnar { "DLDUMP02" } else { "DLDUMP01" }
     );
 
     // Second pass: write flat binary
@@ -442,10 +603,13 @@ fn dump_files(files: &[PathBuf], output: &Path) -> Result<(), Box<dyn std::error
     let mut writer = BufWriter::with_capacity(64 * 1024, out_file);
 
     // Header: magic (8) + n_events (8) = 16 bytes
-    writer.write_all(DUMP_MAGIC)?;
+    writer.write_all(if columnar { DUMP_MAGIC_V2 } else { DUMP_MAGIC })?;
     writer.write_all(&total_events.to_le_bytes())?;
 
     let mut written = 0u64;
+    let mut chunk = DumpChunk::default();
+    let mut chunk_buf = Vec::new();
+    let mut chunks = 0u64;
     for path in files {
         let file = File::open(path)?;
         let reader = BufReader::new(file);
@@ -454,6 +618,17 @@ fn dump_files(files: &[PathBuf], output: &Path) -> Result<(), Box<dyn std::error
         for batch_result in data_reader.data_blocks() {
             let batch = batch_result?;
             for ev in &batch.events {
+                written += 1;
+                if columnar {
+                    chunk.push(ev);
+                    if chunk.len() == DUMP_CHUNK_EVENTS {
+                        chunk_buf.clear();
+                        chunk.encode(&mut chunk_buf);
+                        writer.write_all(&chunk_buf)?;
+                        chunks += 1;
+                    }
+                    continue;
+                }
                 // Fixed 22-byte record per event (all Little-Endian)
                 writer.write_all(&[ev.module])?;
                 writer.write_all(&[ev.channel])?;
@@ -461,19 +636,44 @@ fn dump_files(files: &[PathBuf], output: &Path) -> Result<(), Box<dyn std::error
                 writer.write_all(&ev.energy_short.to_le_bytes())?;
                 writer.write_all(&ev.flags.to_le_bytes())?;
                 writer.write_all(&ev.timestamp_ns.to_le_bytes())?;
-                written += 1;
             }
         }
     }
+    let mut expected_size = 16 + written * EVENT_RECORD_SIZE as u64;
+    if columnar {
+        let last = chunk.len();
+        if last > 0 {
+            chunk_buf.clear();
+            chunk.encode(&mut chunk_buf);
+            writer.write_all(&chunk_buf)?;
+            chunks += 1;
+        }
+        let full = written / DUMP_CHUNK_EVENTS as u64;
+        expected_size = 16
+            + full * DumpChunk::encoded_size(DUMP_CHUNK_EVENTS) as u64
+            + if last > 0 {
+                DumpChunk::encoded_size(last) as u64
+            } else {
+                0
+            };
+    }
 
     writer.flush()?;
     writer.get_ref().sync_all()?;
 
     let file_size = std::fs::metadata(output)?.len();
-    let expected_size = 16 + written * EVENT_RECORD_SIZE as u64;
     println!("  Events written: {}", written);
+    if columnar {
+        println!("  Chunks written: {}", chunks);
+    }
     println!("  Output size:    {} bytes", file_size);
 
+    if written != total_events {
+        eprintln!(
+            "  Warning: event count mismatch (header {}, written {})",
+            total_events, written
+        );
+    }
     if file_size != expected_size {
         eprintln!(
             "  Warning: size mismatch (expected {}, got {})",
@@ -17,6 +17,10 @@ pub use cli::{
 pub mod command;
 pub use command::{Command, CommandResponse, ComponentState, EmulatorRuntimeConfig, RunConfig};
 
+// Analog probes as bin blobs (EventDataBatch::to_msgpack_with)
+pub mod probe_encoding;
+pub use probe_encoding::MsgpackOptions;
+
 // Shared state and command handling infrastructure
 pub mod state;
 pub use state::{handle_command, handle_command_simple, CommandHandlerExt, ComponentSharedState};
@@ -97,8 +101,10 @@ pub mod flags {
 #[derive(Debug, Clone, Default, Serialize, Deserialize, PartialEq)]
 pub struct Waveform {
     /// Analog probe 1 samples (signed 14-bit values)
+    #[serde(deserialize_with = "probe_encoding::deserialize_i16_probe")]
     pub analog_probe1: Vec<i16>,
     /// Analog probe 2 samples (signed 14-bit values)
+    #[serde(deserialize_with = "probe_encoding::deserialize_i16_probe")]
     pub analog_probe2: Vec<i16>,
     /// Digital probe 1 samples (1-bit per sample, packed)
     pub digital_probe1: Vec<u8>,
@@ -283,7 +289,21 @@ impl EventDataBatch {
         rmp_serde::to_vec(self)
     }
 
-    /// Deserialize from MessagePack bytes
+    /// Serialize to MessagePack bytes with encoding options
+    ///
+    /// Default options give the same bytes as [`Self::to_msgpack`].
+    pub fn to_msgpack_with(
+        &self,
+        options: &MsgpackOptions,
+    ) -> Result<Vec<u8>, rmp_serde::encode::Error> {
+        if options.analog_probes_as_bin {
+            rmp_serde::to_vec(&probe_encoding::BinProbeBatch::new(self))
+        } else {
+            self.to_msgpack()
+        }
+    }
+
+    /// Deserialize from MessagePack bytes (either analog probe encoding)
     pub fn from_msgpack(bytes: &[u8]) -> Result<Self, rmp_serde::decode::Error> {
         rmp_serde::from_slice(bytes)
     }
@@ -0,0 +1,205 @@
+//! Alternative MessagePack encoding of analog probes
+//!
+//! By default rmp_serde writes a `Vec<i16>` as an array with one int per
+//! sample (1 or 3 bytes each, with a type byte per sample). With
+//! [`MsgpackOptions::analog_probes_as_bin`] each analog probe is written as
+//! one `bin` blob of little-endian samples instead, which readers can copy
+//! in one go. Decoding accepts both forms, so files and streams may mix them.
+
+use serde::de::{self, SeqAccess, Visitor};
+use serde::ser::{SerializeSeq, Serializer};
+use serde::{Deserializer, Serialize};
+
+use super::{EventData, EventDataBatch, Waveform};
+
+/// Encoding options for [`EventDataBatch::to_msgpack_with`]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct MsgpackOptions {
+    /// Write analog probes as little-endian `bin` blobs (2 bytes per sample)
+    pub analog_probes_as_bin: bool,
+}
+
+/// Borrowed view of a batch that serializes analog probes as `bin`
+#[derive(Serialize)]
+pub(super) struct BinProbeBatch<'a> {
+    source_id: u32,
+    sequence_number: u64,
+    timestamp: u64,
+    events: BinProbeEvents<'a>,
+}
+
+impl<'a> BinProbeBatch<'a> {
+    pub(super) fn new(batch: &'a EventDataBatch) -> Self {
+        Self {
+            source_id: batch.source_id,
+            sequence_number: batch.sequence_number,
+            timestamp: batch.timestamp,
+            events: BinProbeEvents(&batch.events),
+        }
+    }
+}
+
+struct BinProbeEvents<'a>(&'a [EventData]);
+
+impl Serialize for BinProbeEvents<'_> {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        let mut seq = serializer.serialize_seq(Some(self.0.len()))?;
+        for event in self.0 {
+            seq.serialize_element(&BinProbeEvent::new(event))?;
+        }
+        seq.end()
+    }
+}
+
+/// Same field order and skip rule as [`EventData`]
+#[derive(Serialize)]
+struct BinProbeEvent<'a> {
+    module: u8,
+    channel: u8,
+    energy: u16,
+    energy_short: u16,
+    timestamp_ns: f64,
+    flags: u64,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    waveform: Option<BinProbeWaveform<'a>>,
+}
+
+impl<'a> BinProbeEvent<'a> {
+    fn new(event: &'a EventData) -> Self {
+        Self {
+            module: event.module,
+            channel: event.channel,
+            energy: event.energy,
+            energy_short: event.energy_short,
+            timestamp_ns: event.timestamp_ns,
+            flags: event.flags,
+            waveform: event.waveform.as_ref().map(BinProbeWaveform::new),
+        }
+    }
+}
+
+/// Same field order as [`Waveform`]
+#[derive(Serialize)]
+struct BinProbeWaveform<'a> {
+    #[serde(serialize_with = "serialize_i16_le_bin")]
+    analog_probe1: &'a [i16],
+    #[serde(serialize_with = "serialize_i16_le_bin")]
+    analog_probe2: &'a [i16],
+    digital_probe1: &'a [u8],
+    digital_probe2: &'a [u8],
+    digital_probe3: &'a [u8],
+    digital_probe4: &'a [u8],
+    time_resolution: u8,
+    trigger_threshold: u16,
+}
+
+impl<'a> BinProbeWaveform<'a> {
+    fn new(wf: &'a Waveform) -> Self {
+        Self {
+            analog_probe1: &wf.analog_probe1,
+            analog_probe2: &wf.analog_probe2,
+            digital_probe1: &wf.digital_probe1,
+            digital_probe2: &wf.digital_probe2,
+            digital_probe3: &wf.digital_probe3,
+            digital_probe4: &wf.digital_probe4,
+            time_resolution: wf.time_resolution,
+            trigger_threshold: wf.trigger_threshold,
+        }
+    }
+}
+
+fn serialize_i16_le_bin<S: Serializer>(samples: &&[i16], serializer: S) -> Result<S::Ok, S::Error> {
+    let bytes: Vec<u8> = samples.iter().flat_map(|s| s.to_le_bytes()).collect();
+    serializer.serialize_bytes(&bytes)
+}
+
+/// Deserialize an analog probe written either as an int array or as a
+/// little-endian `bin` blob
+pub(super) fn deserialize_i16_probe<'de, D: Deserializer<'de>>(
+    deserializer: D,
+) -> Result<Vec<i16>, D::Error> {
+    deserializer.deserialize_any(I16ProbeVisitor)
+}
+
+struct I16ProbeVisitor;
+
+impl<'de> Visitor<'de> for I16ProbeVisitor {
+    type Value = Vec<i16>;
+
+    fn expecting(&self, f: &mut std::fmt::Formatter) -> std::fmt::Result {
+        f.write_str("an array of i16 or a bin of little-endian i16")
+    }
+
+    fn visit_seq<A: SeqAccess<'de>>(self, mut seq: A) -> Result<Self::Value, A::Error> {
+        let mut samples = Vec::with_capacity(seq.size_hint().unwrap_or(0));
+        while let Some(s) = seq.next_element()? {
+            samples.push(s);
+        }
+        Ok(samples)
+    }
+
+    fn visit_bytes<E: de::Error>(self, bytes: &[u8]) -> Result<Self::Value, E> {
+        if bytes.len() % 2 != 0 {
+            return Err(E::invalid_length(bytes.len(), &self));
+        }
+        Ok(bytes
+            .chunks_exact(2)
+            .map(|b| i16::from_le_bytes([b[0], b[1]]))
+            .collect())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn waveform_batch() -> EventDataBatch {
+        let wf = Waveform {
+            analog_probe1: (0..1000).map(|i| (i * 37 % 20000 - 10000) as i16).collect(),
+            analog_probe2: vec![-1, 0, 1, i16::MIN, i16::MAX],
+            digital_probe1: vec![0, 1, 1],
+            digital_probe2: vec![],
+            digital_probe3: vec![1],
+            digital_probe4: vec![0, 0],
+            time_resolution: 2,
+            trigger_threshold: 300,
+        };
+        let mut batch = EventDataBatch::new(3, 7);
+        batch.push(EventData::new(0, 1, 100, 80, 1000.0, 0));
+        batch.push(EventData::with_waveform(1, 2, 200, 160, 2000.0, 0, wf));
+        batch
+    }
+
+    #[test]
+    fn bin_probes_roundtrip() {
+        let batch = waveform_batch();
+        let options = MsgpackOptions {
+            analog_probes_as_bin: true,
+        };
+        let bin = batch.to_msgpack_with(&options).unwrap();
+        let plain = batch.to_msgpack().unwrap();
+        assert!(bin.len() < plain.len());
+
+        let decoded = EventDataBatch::from_msgpack(&bin).unwrap();
+        assert_eq!(decoded.source_id, 3);
+        assert_eq!(decoded.sequence_number, 7);
+        assert_eq!(decoded.timestamp, batch.timestamp);
+        assert_eq!(decoded.events, batch.events);
+    }
+
+    #[test]
+    fn default_options_match_to_msgpack() {
+        let batch = waveform_batch();
+        assert_eq!(
+            batch.to_msgpack_with(&MsgpackOptions::default()).unwrap(),
+            batch.to_msgpack().unwrap()
+        );
+    }
+
+    #[test]
+    fn odd_length_bin_rejected() {
+        let buf = [0xc4, 3, 1, 2, 3]; // bin8 of 3 bytes
+        let mut de = rmp_serde::Deserializer::new(&buf[..]);
+        assert!(deserialize_i16_probe(&mut de).is_err());
+    }
+}
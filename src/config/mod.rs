@@ -18,6 +18,7 @@ pub use digitizer::{
     SyncConfig,
 };
 
+use crate::recorder::BlockCompression;
 use serde::Deserialize;
 use std::path::Path;
 use thiserror::Error;
@@ -311,6 +312,18 @@ pub struct RecorderNetworkConfig {
     #[serde(default = "default_max_file_duration_sec")]
     pub max_file_duration_sec: u64,
 
+    /// Write analog probes as little-endian bin blobs (default: false)
+    #[serde(default)]
+    pub analog_probes_as_bin: bool,
+
+    /// Per-block compression: "none", "lz4" or "zstd" (default: none)
+    #[serde(default)]
+    pub compression: BlockCompression,
+
+    /// zstd compression level (default: 3)
+    #[serde(default = "default_compression_level")]
+    pub compression_level: i32,
+
     /// Pipeline order for Start/Stop sequencing (default: 3)
     #[serde(default = "default_sink_pipeline_order")]
     pub pipeline_order: u32,
@@ -328,6 +341,10 @@ fn default_max_file_duration_sec() -> u64 {
     600 // 10 minutes
 }
 
+fn default_compression_level() -> i32 {
+    3
+}
+
 fn default_sink_pipeline_order() -> u32 {
     3 // Sinks (Recorder/Monitor) are downstream
 }
@@ -48,6 +48,178 @@ pub mod waveform_probes {
     pub const ALL: u8 = ALL_ANALOG | ALL_DIGITAL;
 }
 
+/// Generate a simulated waveform of `n` samples with the probes in `probes`
+///
+/// Creates a realistic pulse shape: baseline -> fast rise -> exponential decay
+/// The pulse timing is randomized within the waveform window.
+pub fn generate_waveform<R: Rng + ?Sized>(
+    rng: &mut R,
+    energy: u16,
+    n: usize,
+    probes: u8,
+) -> Waveform {
+    // Pulse parameters
+    let baseline: i16 = rng.gen_range(-50..50); // Small baseline fluctuation
+    let amplitude = (energy as f64 / 65535.0 * 8000.0) as i16; // Scale to ~8000 max
+    let rise_time = 5; // samples
+    let decay_tau = 50.0; // decay time constant in samples
+    let pulse_start = rng.gen_range(n / 4..n / 2); // Random trigger position
+
+    // Generate analog probe 1 (main signal)
+    let analog_probe1 = if probes & waveform_probes::ANALOG_PROBE1 != 0 {
+        (0..n)
+            .map(|i| {
+                if i < pulse_start {
+                    baseline
+                } else if i < pulse_start + rise_time {
+                    // Fast linear rise
+                    let frac = (i - pulse_start) as f64 / rise_time as f64;
+                    baseline + (amplitude as f64 * frac) as i16
+                } else {
+                    // Exponential decay
+                    let t = (i - pulse_start - rise_time) as f64;
+                    baseline + (amplitude as f64 * (-t / decay_tau).exp()) as i16
+                }
+            })
+            .collect()
+    } else {
+        Vec::new()
+    };
+
+    // Generate analog probe 2 (differentiated signal or second integration)
+    let analog_probe2 = if probes & waveform_probes::ANALOG_PROBE2 != 0 {
+        (0..n)
+            .map(|i| {
+                if i < pulse_start || i >= pulse_start + rise_time + 100 {
+                    0i16
+                } else if i < pulse_start + rise_time {
+                    // Positive during rise
+                    amplitude / 4
+                } else {
+                    // Negative during decay
+                    let t = (i - pulse_start - rise_time) as f64;
+                    (-(amplitude as f64 / 4.0) * (-t / decay_tau).exp()) as i16
+                }
+            })
+            .collect()
+    } else {
+        Vec::new()
+    };
+
+    // Digital probes: packed bits (1 bit per sample)
+    let digital_probe1 = if probes & waveform_probes::DIGITAL_PROBE1 != 0 {
+        // Trigger signal: high during pulse
+        let mut bits = vec![0u8; n.div_ceil(8)];
+        for i in pulse_start..(pulse_start + 50).min(n) {
+            bits[i / 8] |= 1 << (i % 8);
+        }
+        bits
+    } else {
+        Vec::new()
+    };
+
+    let digital_probe2 = if probes & waveform_probes::DIGITAL_PROBE2 != 0 {
+        // Gate signal: high during integration window
+        let mut bits = vec![0u8; n.div_ceil(8)];
+        for i in pulse_start..(pulse_start + 100).min(n) {
+            bits[i / 8] |= 1 << (i % 8);
+        }
+        bits
+    } else {
+        Vec::new()
+    };
+
+    let digital_probe3 = if probes & waveform_probes::DIGITAL_PROBE3 != 0 {
+        // Short gate
+        let mut bits = vec![0u8; n.div_ceil(8)];
+        for i in pulse_start..(pulse_start + 30).min(n) {
+            bits[i / 8] |= 1 << (i % 8);
+        }
+        bits
+    } else {
+        Vec::new()
+    };
+
+    let digital_probe4 = if probes & waveform_probes::DIGITAL_PROBE4 != 0 {
+        // Pileup indicator (always low in this simple simulation)
+        vec![0u8; n.div_ceil(8)]
+    } else {
+        Vec::new()
+    };
+
+    Waveform {
+        analog_probe1,
+        analog_probe2,
+        digital_probe1,
+        digital_probe2,
+        digital_probe3,
+        digital_probe4,
+        time_resolution: 0, // 1x resolution
+        trigger_threshold: 100,
+    }
+}
+
+/// Generate one random event of `module` with Gaussian peak + uniform background
+///
+/// Energy distribution:
+/// - 70% Gaussian peak: mean = module * 1000 + channel * 50 + 500, sigma = 50
+/// - 30% Uniform background: 0 to 4095 (simulating random noise/cosmic rays)
+///
+/// `timestamp_ns` is advanced by 10-1000 ns and used as the event time.
+/// `waveform` is (samples, probe mask), or None for scalar-only events.
+pub fn generate_event<R: Rng + ?Sized>(
+    rng: &mut R,
+    module: u8,
+    channels_per_module: u8,
+    timestamp_ns: &mut f64,
+    waveform: Option<(usize, u8)>,
+) -> EventData {
+    // Background ratio: 30% uniform, 70% Gaussian peak
+    const BACKGROUND_RATIO: f64 = 0.3;
+
+    let channel = rng.gen_range(0..channels_per_module);
+
+    let energy: u16 = if rng.gen_bool(BACKGROUND_RATIO) {
+        // Uniform background: 0 to 4095 (12-bit ADC range)
+        rng.gen_range(0..4096)
+    } else {
+        // Gaussian peak: mean = module*1000 + channel*50 + 500, sigma = 50
+        let mean = (module as f64) * 1000.0 + (channel as f64) * 50.0 + 500.0;
+        let sigma = 50.0;
+        let normal = Normal::new(mean, sigma).unwrap();
+        let energy_f64 = normal.sample(&mut *rng);
+        // Clamp to valid u16 range
+        energy_f64.clamp(0.0, 65535.0) as u16
+    };
+
+    // Short gate energy: ~70-80% of long gate with some noise
+    let short_ratio = 0.75 + rng.gen_range(-0.05..0.05);
+    let energy_short: u16 = ((energy as f64) * short_ratio).clamp(0.0, 65535.0) as u16;
+
+    *timestamp_ns += rng.gen_range(10.0..1000.0);
+
+    let flags = if rng.gen_ratio(1, 100) {
+        flags::FLAG_PILEUP
+    } else if rng.gen_ratio(1, 1000) {
+        flags::FLAG_OVER_RANGE
+    } else {
+        0
+    };
+
+    match waveform {
+        Some((samples, probes)) => EventData::with_waveform(
+            module,
+            channel,
+            energy,
+            energy_short,
+            *timestamp_ns,
+            flags,
+            generate_waveform(rng, energy, samples, probes),
+        ),
+        None => EventData::new(module, channel, energy, energy_short, *timestamp_ns, flags),
+    }
+}
+
 /// Emulator configuration
 #[derive(Debug, Clone, serde::Deserialize)]
 #[serde(default)]
@@ -343,117 +515,6 @@ impl Emulator {
         *self.state_rx.borrow()
     }
 
-    /// Generate a simulated waveform
-    ///
-    /// Creates a realistic pulse shape: baseline -> fast rise -> exponential decay
-    /// The pulse timing is randomized within the waveform window.
-    fn generate_waveform(&self, energy: u16) -> Waveform {
-        let mut rng = rand::thread_rng();
-        // Use runtime settings for waveform parameters
-        let n = self.runtime_settings.waveform_samples();
-        let probes = self.runtime_settings.waveform_probes();
-
-        // Pulse parameters
-        let baseline: i16 = rng.gen_range(-50..50); // Small baseline fluctuation
-        let amplitude = (energy as f64 / 65535.0 * 8000.0) as i16; // Scale to ~8000 max
-        let rise_time = 5; // samples
-        let decay_tau = 50.0; // decay time constant in samples
-        let pulse_start = rng.gen_range(n / 4..n / 2); // Random trigger position
-
-        // Generate analog probe 1 (main signal)
-        let analog_probe1 = if probes & waveform_probes::ANALOG_PROBE1 != 0 {
-            (0..n)
-                .map(|i| {
-                    if i < pulse_start {
-                        baseline
-                    } else if i < pulse_start + rise_time {
-                        // Fast linear rise
-                        let frac = (i - pulse_start) as f64 / rise_time as f64;
-                        baseline + (amplitude as f64 * frac) as i16
-                    } else {
-                        // Exponential decay
-                        let t = (i - pulse_start - rise_time) as f64;
-                        baseline + (amplitude as f64 * (-t / decay_tau).exp()) as i16
-                    }
-                })
-                .collect()
-        } else {
-            Vec::new()
-        };
-
-        // Generate analog probe 2 (differentiated signal or second integration)
-        let analog_probe2 = if probes & waveform_probes::ANALOG_PROBE2 != 0 {
-            (0..n)
-                .map(|i| {
-                    if i < pulse_start || i >= pulse_start + rise_time + 100 {
-                        0i16
-                    } else if i < pulse_start + rise_time {
-                        // Positive during rise
-                        amplitude / 4
-                    } else {
-                        // Negative during decay
-                        let t = (i - pulse_start - rise_time) as f64;
-                        (-(amplitude as f64 / 4.0) * (-t / decay_tau).exp()) as i16
-                    }
-                })
-                .collect()
-        } else {
-            Vec::new()
-        };
-
-        // Digital probes: packed bits (1 bit per sample)
-        let digital_probe1 = if probes & waveform_probes::DIGITAL_PROBE1 != 0 {
-            // Trigger signal: high during pulse
-            let mut bits = vec![0u8; n.div_ceil(8)];
-            for i in pulse_start..(pulse_start + 50).min(n) {
-                bits[i / 8] |= 1 << (i % 8);
-            }
-            bits
-        } else {
-            Vec::new()
-        };
-
-        let digital_probe2 = if probes & waveform_probes::DIGITAL_PROBE2 != 0 {
-            // Gate signal: high during integration window
-            let mut bits = vec![0u8; n.div_ceil(8)];
-            for i in pulse_start..(pulse_start + 100).min(n) {
-                bits[i / 8] |= 1 << (i % 8);
-            }
-            bits
-        } else {
-            Vec::new()
-        };
-
-        let digital_probe3 = if probes & waveform_probes::DIGITAL_PROBE3 != 0 {
-            // Short gate
-            let mut bits = vec![0u8; n.div_ceil(8)];
-            for i in pulse_start..(pulse_start + 30).min(n) {
-                bits[i / 8] |= 1 << (i % 8);
-            }
-            bits
-        } else {
-            Vec::new()
-        };
-
-        let digital_probe4 = if probes & waveform_probes::DIGITAL_PROBE4 != 0 {
-            // Pileup indicator (always low in this simple simulation)
-            vec![0u8; n.div_ceil(8)]
-        } else {
-            Vec::new()
-        };
-
-        Waveform {
-            analog_probe1,
-            analog_probe2,
-            digital_probe1,
-            digital_probe2,
-            digital_probe3,
-            digital_probe4,
-            time_resolution: 0, // 1x resolution
-            trigger_threshold: 100,
-        }
-    }
-
     /// Generate a batch of random events with Gaussian peak + uniform background
     ///
     /// Energy distribution:
@@ -477,62 +538,23 @@ impl Emulator {
         // Module number = source_id (each emulator represents one digitizer module)
         let module = self.config.source_id as u8;
 
-        // Background ratio: 30% uniform, 70% Gaussian peak
-        const BACKGROUND_RATIO: f64 = 0.3;
+        let waveform = if enable_waveform {
+            Some((
+                self.runtime_settings.waveform_samples(),
+                self.runtime_settings.waveform_probes(),
+            ))
+        } else {
+            None
+        };
 
         for _ in 0..events_per_batch {
-            let channel = rng.gen_range(0..self.config.channels_per_module);
-
-            let energy: u16 = if rng.gen_bool(BACKGROUND_RATIO) {
-                // Uniform background: 0 to 4095 (12-bit ADC range)
-                rng.gen_range(0..4096)
-            } else {
-                // Gaussian peak: mean = module*1000 + channel*50 + 500, sigma = 50
-                let mean = (module as f64) * 1000.0 + (channel as f64) * 50.0 + 500.0;
-                let sigma = 50.0;
-                let normal = Normal::new(mean, sigma).unwrap();
-                let energy_f64 = normal.sample(&mut rng);
-                // Clamp to valid u16 range
-                energy_f64.clamp(0.0, 65535.0) as u16
-            };
-
-            // Short gate energy: ~70-80% of long gate with some noise
-            let short_ratio = 0.75 + rng.gen_range(-0.05..0.05);
-            let energy_short: u16 = ((energy as f64) * short_ratio).clamp(0.0, 65535.0) as u16;
-
-            self.timestamp_ns += rng.gen_range(10.0..1000.0);
-
-            let flags = if rng.gen_ratio(1, 100) {
-                flags::FLAG_PILEUP
-            } else if rng.gen_ratio(1, 1000) {
-                flags::FLAG_OVER_RANGE
-            } else {
-                0
-            };
-
-            let event = if enable_waveform {
-                let waveform = self.generate_waveform(energy);
-                EventData::with_waveform(
-                    module,
-                    channel,
-                    energy,
-                    energy_short,
-                    self.timestamp_ns,
-                    flags,
-                    waveform,
-                )
-            } else {
-                EventData::new(
-                    module,
-                    channel,
-                    energy,
-                    energy_short,
-                    self.timestamp_ns,
-                    flags,
-                )
-            };
-
-            batch.push(event);
+            batch.push(generate_event(
+                &mut rng,
+                module,
+                self.config.channels_per_module,
+                &mut self.timestamp_ns,
+                waveform,
+            ));
         }
 
         self.sequence_number += 1;
@@ -784,6 +806,24 @@ mod tests {
         assert_eq!(config.events_per_batch, 50);
     }
 
+    #[test]
+    fn generate_event_waveform() {
+        let mut rng = rand::thread_rng();
+        let mut ts = 0.0;
+        let ev = generate_event(&mut rng, 2, 16, &mut ts, None);
+        assert_eq!(ev.module, 2);
+        assert!(ev.channel < 16);
+        assert_eq!(ev.timestamp_ns, ts);
+        assert!(ev.waveform.is_none());
+
+        let ev = generate_event(&mut rng, 0, 16, &mut ts, Some((64, waveform_probes::ALL)));
+        assert!(ev.timestamp_ns > 0.0);
+        let wf = ev.waveform.expect("waveform");
+        assert_eq!(wf.analog_probe1.len(), 64);
+        assert_eq!(wf.analog_probe2.len(), 64);
+        assert_eq!(wf.digital_probe1.len(), 8); // 1 bit per sample
+    }
+
     #[test]
     fn test_config_custom() {
         let config = EmulatorConfig {
@@ -8,7 +8,9 @@
 //! ├─────────────────────────────────────────┤
 //! │  Data Block 1                           │
 //! │  - Length prefix (u32 LE)               │
+//! │  - v3: block header (8 bytes)           │
 //! │  - MsgPack serialized batch             │
+//! │    (v3: optionally LZ4/zstd compressed) │
 //! ├─────────────────────────────────────────┤
 //! │  ...                                    │
 //! ├─────────────────────────────────────────┤
@@ -16,10 +18,37 @@
 //! │  - Magic, checksums, completion flag    │
 //! └─────────────────────────────────────────┘
 //! ```
+//!
+//! Block index sidecar (`<file>.delila.idx`, written when the file is closed):
+//! ```text
+//! ┌─────────────────────────────────────────┐
+//! │  Index header (fixed 32 bytes)          │
+//! │  - Magic, entry size, entry count       │
+//! ├─────────────────────────────────────────┤
+//! │  Entry per block (fixed size, LE)       │
+//! │  - offset, length, source_id, events,   │
+//! │    first/last timestamp_ns              │
+//! └─────────────────────────────────────────┘
+//! ```
+//!
+//! The index lives outside the data file so v2 readers are unaffected; it can
+//! be rebuilt from the data blocks at any time (`delila-recover index`).
+//!
+//! v3 (`DELILA03`, written when block compression is enabled) adds a block
+//! header after each length prefix:
+//! ```text
+//! u8 compression (0 none, 1 LZ4 block, 2 zstd frame), 3 bytes zero,
+//! u32 LE uncompressed MsgPack size
+//! ```
+//! The length prefix counts header + stored payload, so block skipping,
+//! the index and the footer checksum (over the stored bytes) work as in v2.
+//! Uncompressed files are still written as v2.
 
 use serde::{Deserialize, Serialize};
+use std::borrow::Cow;
 use std::collections::HashMap;
 use std::io::{Read, Write};
+use std::path::{Path, PathBuf};
 use xxhash_rust::xxh64::xxh64;
 
 /// Magic bytes for DELILA data files
@@ -28,12 +57,42 @@ pub const FILE_MAGIC: [u8; 8] = *b"DELILA02";
 /// Current file format version
 pub const FORMAT_VERSION: u32 = 2;
 
+/// Magic bytes of v3 files (block headers, per-block compression)
+pub const FILE_MAGIC_V3: [u8; 8] = *b"DELILA03";
+
+/// Format version of files with block headers
+pub const FORMAT_VERSION_V3: u32 = 3;
+
+/// Size of the v3 block header following each length prefix
+pub const BLOCK_HEADER_SIZE: usize = 8;
+
+/// Sanity limit on one block (stored or uncompressed)
+pub const MAX_BLOCK_SIZE: usize = 100_000_000;
+
 /// Footer magic bytes (different from header to detect truncation)
 pub const FOOTER_MAGIC: [u8; 8] = *b"DLEND002";
 
 /// Fixed footer size in bytes
 pub const FOOTER_SIZE: usize = 64;
 
+/// Magic bytes for block index sidecar files
+pub const INDEX_MAGIC: [u8; 8] = *b"DLIDX001";
+
+/// Fixed index header size in bytes
+pub const INDEX_HEADER_SIZE: usize = 32;
+
+/// Size of one index entry in bytes (readers accept larger entries)
+pub const INDEX_ENTRY_SIZE: usize = 176;
+
+/// Entry size of sidecars written before zone maps (still accepted)
+pub const INDEX_ENTRY_MIN_SIZE: usize = 40;
+
+/// Index entry flag: the entry carries a zone map
+pub const INDEX_FLAG_ZONE_MAP: u32 = 0x01;
+
+/// File name suffix of the block index sidecar
+pub const INDEX_SUFFIX: &str = ".idx";
+
 /// File header containing metadata about the run and file
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct FileHeader {
@@ -88,10 +147,24 @@ impl FileHeader {
         }
     }
 
+    /// Magic bytes for this header's format version
+    pub fn magic(&self) -> &'static [u8; 8] {
+        if self.has_block_headers() {
+            &FILE_MAGIC_V3
+        } else {
+            &FILE_MAGIC
+        }
+    }
+
+    /// Whether data blocks carry a v3 block header
+    pub fn has_block_headers(&self) -> bool {
+        self.version >= FORMAT_VERSION_V3
+    }
+
     /// Serialize header to bytes (with magic prefix)
     pub fn to_bytes(&self) -> Result<Vec<u8>, rmp_serde::encode::Error> {
         let mut buf = Vec::with_capacity(256);
-        buf.extend_from_slice(&FILE_MAGIC);
+        buf.extend_from_slice(self.magic());
         let header_bytes = rmp_serde::to_vec(self)?;
         let len = header_bytes.len() as u32;
         buf.extend_from_slice(&len.to_le_bytes());
@@ -106,7 +179,7 @@ impl FileHeader {
         }
 
         // Check magic
-        if data[0..8] != FILE_MAGIC {
+        if !is_file_magic(&data[0..8]) {
             return Err(FileFormatError::InvalidMagic);
         }
 
@@ -132,7 +205,7 @@ impl FileHeader {
         // Read magic
         let mut magic = [0u8; 8];
         reader.read_exact(&mut magic)?;
-        if magic != FILE_MAGIC {
+        if !is_file_magic(&magic) {
             return Err(FileFormatError::InvalidMagic);
         }
 
@@ -149,6 +222,11 @@ impl FileHeader {
     }
 }
 
+/// Whether `magic` starts a v2 or v3 data file
+fn is_file_magic(magic: &[u8]) -> bool {
+    magic == FILE_MAGIC || magic == FILE_MAGIC_V3
+}
+
 /// File footer containing checksums and completion status
 ///
 /// Fixed 64-byte structure for easy seeking to file end.
@@ -368,6 +446,393 @@ impl ChecksumCalculator {
     }
 }
 
+/// Per-block compression of v3 files (block header byte 0)
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default, Serialize, Deserialize)]
+#[serde(rename_all = "lowercase")]
+pub enum BlockCompression {
+    /// Stored as is
+    #[default]
+    None,
+    /// LZ4 block format (fast; ~2x on waveforms)
+    Lz4,
+    /// zstd frame (smaller, slower to write)
+    Zstd,
+}
+
+impl BlockCompression {
+    /// Codec id in the block header
+    pub fn id(self) -> u8 {
+        match self {
+            BlockCompression::None => 0,
+            BlockCompression::Lz4 => 1,
+            BlockCompression::Zstd => 2,
+        }
+    }
+
+    /// Codec for a block header id
+    pub fn from_id(id: u8) -> Option<Self> {
+        match id {
+            0 => Some(BlockCompression::None),
+            1 => Some(BlockCompression::Lz4),
+            2 => Some(BlockCompression::Zstd),
+            _ => None,
+        }
+    }
+}
+
+/// Frame a MessagePack block for a v3 file: block header + payload
+///
+/// `level` is the zstd level (ignored for LZ4). A block that does not shrink
+/// is stored uncompressed, so the result is never much larger than `data`.
+pub fn encode_block(
+    data: &[u8],
+    compression: BlockCompression,
+    level: i32,
+) -> Result<Vec<u8>, FileFormatError> {
+    let compressed = match compression {
+        BlockCompression::None => None,
+        BlockCompression::Lz4 => Some(lz4_flex::block::compress(data)),
+        BlockCompression::Zstd => Some(zstd::bulk::compress(data, level)?),
+    };
+    let (codec, payload) = match compressed {
+        Some(ref c) if c.len() < data.len() => (compression, c.as_slice()),
+        _ => (BlockCompression::None, data),
+    };
+
+    let mut block = Vec::with_capacity(BLOCK_HEADER_SIZE + payload.len());
+    block.push(codec.id());
+    block.extend_from_slice(&[0u8; 3]);
+    block.extend_from_slice(&(data.len() as u32).to_le_bytes());
+    block.extend_from_slice(payload);
+    Ok(block)
+}
+
+/// MessagePack payload of a stored block (the bytes after the length prefix)
+///
+/// v2 blocks are the payload; v3 blocks are decompressed as their block
+/// header says.
+pub fn decode_block(
+    has_block_header: bool,
+    stored: &[u8],
+) -> Result<Cow<'_, [u8]>, FileFormatError> {
+    if !has_block_header {
+        return Ok(Cow::Borrowed(stored));
+    }
+    if stored.len() < BLOCK_HEADER_SIZE {
+        return Err(FileFormatError::InvalidBlock(
+            "shorter than its block header".to_string(),
+        ));
+    }
+    let raw_size = u32::from_le_bytes([stored[4], stored[5], stored[6], stored[7]]) as usize;
+    if raw_size > MAX_BLOCK_SIZE {
+        return Err(FileFormatError::InvalidBlock(format!(
+            "uncompressed size {}",
+            raw_size
+        )));
+    }
+    let payload = &stored[BLOCK_HEADER_SIZE..];
+    let data = match BlockCompression::from_id(stored[0]) {
+        Some(BlockCompression::None) => Cow::Borrowed(payload),
+        Some(BlockCompression::Lz4) => Cow::Owned(
+            lz4_flex::block::decompress(payload, raw_size)
+                .map_err(|e| FileFormatError::InvalidBlock(format!("LZ4: {}", e)))?,
+        ),
+        Some(BlockCompression::Zstd) => Cow::Owned(zstd::bulk::decompress(payload, raw_size)?),
+        None => {
+            return Err(FileFormatError::InvalidBlock(format!(
+                "unknown compression {}",
+                stored[0]
+            )))
+        }
+    };
+    if data.len() != raw_size {
+        return Err(FileFormatError::InvalidBlock(format!(
+            "decompressed to {} bytes, header says {}",
+            data.len(),
+            raw_size
+        )));
+    }
+    Ok(data)
+}
+
+/// Decode a stored block into a batch (see [`decode_block`])
+pub fn decode_batch(
+    has_block_header: bool,
+    stored: &[u8],
+) -> Result<crate::common::EventDataBatch, FileFormatError> {
+    let data = decode_block(has_block_header, stored)?;
+    Ok(crate::common::EventDataBatch::from_msgpack(&data)?)
+}
+
+/// Per-block summary of the events, for skipping blocks a query cannot match
+#[derive(Debug, Clone, Copy, PartialEq, Default)]
+pub struct BlockZoneMap {
+    /// Smallest / largest energy in the block
+    pub min_energy: u16,
+    pub max_energy: u16,
+    /// Events that carry a waveform
+    pub waveform_events: u32,
+    /// (module, channel) pairs present: bit `(module % 16) * 64 + channel % 64`.
+    /// Pairs beyond 16 modules x 64 channels share bits, so a set bit means
+    /// "may be present".
+    pub channels: [u64; 16],
+}
+
+impl BlockZoneMap {
+    /// Bit position of a (module, channel) pair in `channels`
+    pub fn channel_bit(module: u8, channel: u8) -> usize {
+        (module as usize % 16) * 64 + channel as usize % 64
+    }
+
+    /// Whether events of (module, channel) may be in the block
+    pub fn may_contain(&self, module: u8, channel: u8) -> bool {
+        let bit = Self::channel_bit(module, channel);
+        self.channels[bit / 64] & (1u64 << (bit % 64)) != 0
+    }
+}
+
+/// Index entry describing one data block
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct BlockIndexEntry {
+    /// File offset of the block's u32 length prefix
+    pub offset: u64,
+    /// MsgPack payload length (excluding the length prefix)
+    pub length: u32,
+    /// Source that produced the batch
+    pub source_id: u32,
+    /// Number of events in the batch
+    pub num_events: u32,
+    /// Earliest event timestamp (ns) in the block
+    pub first_timestamp_ns: f64,
+    /// Latest event timestamp (ns) in the block
+    pub last_timestamp_ns: f64,
+    /// Energy range, channels and waveform count (None in old sidecars)
+    pub zone: Option<BlockZoneMap>,
+}
+
+impl BlockIndexEntry {
+    /// Build an entry for a batch written at `offset` with payload `length`
+    ///
+    /// Events are only time-ordered per source, so the timestamp range is
+    /// the min/max over the batch rather than the first/last element. Empty
+    /// batches get a zero range.
+    pub fn from_batch(offset: u64, length: u32, batch: &crate::common::EventDataBatch) -> Self {
+        let (first, last) = batch
+            .events
+            .iter()
+            .fold((f64::MAX, f64::MIN), |(lo, hi), ev| {
+                (lo.min(ev.timestamp_ns), hi.max(ev.timestamp_ns))
+            });
+        let (first, last) = if batch.events.is_empty() {
+            (0.0, 0.0)
+        } else {
+            (first, last)
+        };
+
+        let mut zone = BlockZoneMap {
+            min_energy: u16::MAX,
+            ..Default::default()
+        };
+        for ev in &batch.events {
+            zone.min_energy = zone.min_energy.min(ev.energy);
+            zone.max_energy = zone.max_energy.max(ev.energy);
+            if ev.waveform.is_some() {
+                zone.waveform_events += 1;
+            }
+            let bit = BlockZoneMap::channel_bit(ev.module, ev.channel);
+            zone.channels[bit / 64] |= 1u64 << (bit % 64);
+        }
+        if batch.events.is_empty() {
+            zone.min_energy = 0;
+        }
+
+        Self {
+            offset,
+            length,
+            source_id: batch.source_id,
+            num_events: batch.events.len() as u32,
+            first_timestamp_ns: first,
+            last_timestamp_ns: last,
+            zone: Some(zone),
+        }
+    }
+
+    /// Serialize entry to fixed-size array
+    pub fn to_bytes(&self) -> [u8; INDEX_ENTRY_SIZE] {
+        let mut buf = [0u8; INDEX_ENTRY_SIZE];
+        buf[0..8].copy_from_slice(&self.offset.to_le_bytes());
+        buf[8..12].copy_from_slice(&self.length.to_le_bytes());
+        buf[12..16].copy_from_slice(&self.source_id.to_le_bytes());
+        buf[16..20].copy_from_slice(&self.num_events.to_le_bytes());
+        buf[24..32].copy_from_slice(&self.first_timestamp_ns.to_le_bytes());
+        buf[32..40].copy_from_slice(&self.last_timestamp_ns.to_le_bytes());
+        if let Some(zone) = &self.zone {
+            buf[20..24].copy_from_slice(&INDEX_FLAG_ZONE_MAP.to_le_bytes());
+            buf[40..42].copy_from_slice(&zone.min_energy.to_le_bytes());
+            buf[42..44].copy_from_slice(&zone.max_energy.to_le_bytes());
+            buf[44..48].copy_from_slice(&zone.waveform_events.to_le_bytes());
+            for (i, word) in zone.channels.iter().enumerate() {
+                buf[48 + 8 * i..56 + 8 * i].copy_from_slice(&word.to_le_bytes());
+            }
+        }
+        buf
+    }
+
+    /// Deserialize entry (at least INDEX_ENTRY_MIN_SIZE bytes; the zone map
+    /// is read when flagged and the entry is large enough)
+    pub fn from_bytes(data: &[u8]) -> Result<Self, FileFormatError> {
+        if data.len() < INDEX_ENTRY_MIN_SIZE {
+            return Err(FileFormatError::TooShort);
+        }
+        let u32_at =
+            |i: usize| u32::from_le_bytes([data[i], data[i + 1], data[i + 2], data[i + 3]]);
+        let u64_at = |i: usize| {
+            let mut b = [0u8; 8];
+            b.copy_from_slice(&data[i..i + 8]);
+            u64::from_le_bytes(b)
+        };
+
+        let zone = if u32_at(20) & INDEX_FLAG_ZONE_MAP != 0 && data.len() >= INDEX_ENTRY_SIZE {
+            let mut channels = [0u64; 16];
+            for (i, word) in channels.iter_mut().enumerate() {
+                *word = u64_at(48 + 8 * i);
+            }
+            Some(BlockZoneMap {
+                min_energy: u16::from_le_bytes([data[40], data[41]]),
+                max_energy: u16::from_le_bytes([data[42], data[43]]),
+                waveform_events: u32_at(44),
+                channels,
+            })
+        } else {
+            None
+        };
+
+        Ok(Self {
+            offset: u64_at(0),
+            length: u32_at(8),
+            source_id: u32_at(12),
+            num_events: u32_at(16),
+            first_timestamp_ns: f64::from_bits(u64_at(24)),
+            last_timestamp_ns: f64::from_bits(u64_at(32)),
+            zone,
+        })
+    }
+}
+
+/// Block offset index for a data file (stored as a sidecar file)
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct BlockIndex {
+    /// Size of the data file this index describes (used to detect stale indexes)
+    pub data_file_size: u64,
+    /// One entry per data block, in file order
+    pub entries: Vec<BlockIndexEntry>,
+}
+
+impl BlockIndex {
+    /// Create an empty index
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Sidecar path for a data file (`run0001_0000_exp.delila.idx`)
+    pub fn sidecar_path(data_path: &Path) -> PathBuf {
+        let mut name = data_path.as_os_str().to_os_string();
+        name.push(INDEX_SUFFIX);
+        PathBuf::from(name)
+    }
+
+    /// Number of indexed blocks
+    pub fn len(&self) -> usize {
+        self.entries.len()
+    }
+
+    /// Check if index is empty
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    /// Add an entry
+    pub fn push(&mut self, entry: BlockIndexEntry) {
+        self.entries.push(entry);
+    }
+
+    /// Reset for a new file
+    pub fn clear(&mut self) {
+        self.data_file_size = 0;
+        self.entries.clear();
+    }
+
+    /// Serialize index to bytes
+    pub fn to_bytes(&self) -> Vec<u8> {
+        let mut buf = Vec::with_capacity(INDEX_HEADER_SIZE + self.entries.len() * INDEX_ENTRY_SIZE);
+
+        // Header: magic (8) + entry size (4) + reserved (4) + entries (8) + data file size (8)
+        buf.extend_from_slice(&INDEX_MAGIC);
+        buf.extend_from_slice(&(INDEX_ENTRY_SIZE as u32).to_le_bytes());
+        buf.extend_from_slice(&0u32.to_le_bytes());
+        buf.extend_from_slice(&(self.entries.len() as u64).to_le_bytes());
+        buf.extend_from_slice(&self.data_file_size.to_le_bytes());
+
+        for entry in &self.entries {
+            buf.extend_from_slice(&entry.to_bytes());
+        }
+        buf
+    }
+
+    /// Deserialize index from bytes
+    pub fn from_bytes(data: &[u8]) -> Result<Self, FileFormatError> {
+        if data.len() < INDEX_HEADER_SIZE {
+            return Err(FileFormatError::TooShort);
+        }
+        if data[0..8] != INDEX_MAGIC {
+            return Err(FileFormatError::InvalidIndexMagic);
+        }
+
+        let entry_size = u32::from_le_bytes([data[8], data[9], data[10], data[11]]) as usize;
+        let mut n = [0u8; 8];
+        n.copy_from_slice(&data[16..24]);
+        let num_entries = u64::from_le_bytes(n) as usize;
+        n.copy_from_slice(&data[24..32]);
+        let data_file_size = u64::from_le_bytes(n);
+
+        if entry_size < INDEX_ENTRY_MIN_SIZE {
+            return Err(FileFormatError::TooShort);
+        }
+        let needed = num_entries
+            .checked_mul(entry_size)
+            .and_then(|b| b.checked_add(INDEX_HEADER_SIZE))
+            .ok_or(FileFormatError::TooShort)?;
+        if data.len() < needed {
+            return Err(FileFormatError::TooShort);
+        }
+
+        let entries = (0..num_entries)
+            .map(|i| {
+                let start = INDEX_HEADER_SIZE + i * entry_size;
+                BlockIndexEntry::from_bytes(&data[start..start + entry_size])
+            })
+            .collect::<Result<Vec<_>, _>>()?;
+
+        Ok(Self {
+            data_file_size,
+            entries,
+        })
+    }
+
+    /// Write index to a writer
+    pub fn write_to<W: Write>(&self, writer: &mut W) -> Result<(), FileFormatError> {
+        writer.write_all(&self.to_bytes())?;
+        Ok(())
+    }
+
+    /// Read index from a reader
+    pub fn read_from<R: Read>(reader: &mut R) -> Result<Self, FileFormatError> {
+        let mut data = Vec::new();
+        reader.read_to_end(&mut data)?;
+        Self::from_bytes(&data)
+    }
+}
+
 /// File format errors
 #[derive(Debug, thiserror::Error)]
 pub enum FileFormatError {
@@ -380,6 +845,9 @@ pub enum FileFormatError {
     #[error("Invalid footer magic bytes")]
     InvalidFooterMagic,
 
+    #[error("Invalid block index magic bytes")]
+    InvalidIndexMagic,
+
     #[error("Deserialization error: {0}")]
     Deserialization(#[from] rmp_serde::decode::Error),
 
@@ -394,6 +862,9 @@ pub enum FileFormatError {
 
     #[error("Incomplete file (footer indicates crash during write)")]
     IncompleteFile,
+
+    #[error("Invalid data block: {0}")]
+    InvalidBlock(String),
 }
 
 /// Result of file validation
@@ -427,6 +898,8 @@ pub struct DataFileReader<R> {
     footer: Option<FileFooter>,
     header_size: usize,
     file_size: u64,
+    /// v3: blocks carry a block header
+    block_headers: bool,
 }
 
 impl<R: std::io::Read + std::io::Seek> DataFileReader<R> {
@@ -442,6 +915,7 @@ impl<R: std::io::Read + std::io::Seek> DataFileReader<R> {
             footer: None,
             header_size: 0,
             file_size,
+            block_headers: false,
         };
 
         // Try to read header
@@ -458,6 +932,7 @@ impl<R: std::io::Read + std::io::Seek> DataFileReader<R> {
         // Calculate header size (magic + length prefix + msgpack data)
         let pos = self.reader.stream_position()?;
         self.header_size = pos as usize;
+        self.block_headers = header.has_block_headers();
         self.header = Some(header);
         Ok(())
     }
@@ -603,7 +1078,7 @@ impl<R: std::io::Read + std::io::Seek> DataFileReader<R> {
             }
 
             // Try to deserialize to count events
-            match crate::common::EventDataBatch::from_msgpack(&data) {
+            match decode_batch(self.block_headers, &data) {
                 Ok(batch) => {
                     events += batch.events.len() as u64;
                     blocks += 1;
@@ -663,6 +1138,51 @@ impl<R: std::io::Read + std::io::Seek> DataFileReader<R> {
         Ok(computed == footer.data_checksum)
     }
 
+    /// Build a block index by scanning the data region
+    ///
+    /// Stops at the first unreadable block, so for a damaged file the index
+    /// covers the recoverable prefix.
+    pub fn build_block_index(&mut self) -> Result<BlockIndex, FileFormatError> {
+        let mut index = BlockIndex::new();
+        index.data_file_size = self.file_size;
+
+        let data_end = if self.read_footer().is_ok() {
+            self.file_size - FOOTER_SIZE as u64
+        } else {
+            self.file_size
+        };
+        self.reader
+            .seek(std::io::SeekFrom::Start(self.header_size as u64))?;
+
+        loop {
+            let pos = self.reader.stream_position()?;
+            if pos + 4 > data_end {
+                break;
+            }
+
+            let mut len_bytes = [0u8; 4];
+            if self.reader.read_exact(&mut len_bytes).is_err() {
+                break;
+            }
+            let len = u32::from_le_bytes(len_bytes);
+            if len == 0 || len > 100_000_000 || pos + 4 + len as u64 > data_end {
+                break;
+            }
+
+            let mut data = vec![0u8; len as usize];
+            if self.reader.read_exact(&mut data).is_err() {
+                break;
+            }
+
+            match decode_batch(self.block_headers, &data) {
+                Ok(batch) => index.push(BlockIndexEntry::from_batch(pos, len, &batch)),
+                Err(_) => break,
+            }
+        }
+
+        Ok(index)
+    }
+
     /// Iterator over data blocks (for recovery)
     pub fn data_blocks(&mut self) -> DataBlockIterator<'_, R> {
         // Position after header
@@ -679,6 +1199,7 @@ impl<R: std::io::Read + std::io::Seek> DataFileReader<R> {
         DataBlockIterator {
             reader: &mut self.reader,
             data_end,
+            block_headers: self.block_headers,
             done: false,
         }
     }
@@ -688,6 +1209,7 @@ impl<R: std::io::Read + std::io::Seek> DataFileReader<R> {
 pub struct DataBlockIterator<'a, R> {
     reader: &'a mut R,
     data_end: u64,
+    block_headers: bool,
     done: bool,
 }
 
@@ -741,12 +1263,12 @@ impl<'a, R: std::io::Read + std::io::Seek> Iterator for DataBlockIterator<'a, R>
             return Some(Err(FileFormatError::Io(e)));
         }
 
-        // Deserialize
-        match crate::common::EventDataBatch::from_msgpack(&data) {
+        // Decompress (v3) and deserialize
+        match decode_batch(self.block_headers, &data) {
             Ok(batch) => Some(Ok(batch)),
             Err(e) => {
                 self.done = true;
-                Some(Err(FileFormatError::Deserialization(e)))
+                Some(Err(e))
             }
         }
     }
@@ -947,4 +1469,211 @@ mod tests {
         assert_eq!(restored.data_bytes, 11000);
         assert!(restored.is_complete());
     }
+
+    #[test]
+    fn test_block_index_roundtrip() {
+        let mut index = BlockIndex::new();
+        index.data_file_size = 123_456;
+        index.push(BlockIndexEntry {
+            offset: 100,
+            length: 5000,
+            source_id: 2,
+            num_events: 64,
+            first_timestamp_ns: 10.5,
+            last_timestamp_ns: 99.25,
+            zone: None,
+        });
+        index.push(BlockIndexEntry {
+            offset: 5104,
+            length: 800,
+            source_id: 0,
+            num_events: 8,
+            first_timestamp_ns: 5.0,
+            last_timestamp_ns: 120.0,
+            zone: Some(BlockZoneMap {
+                min_energy: 12,
+                max_energy: 4000,
+                waveform_events: 3,
+                channels: [0x8000_0000_0000_0001; 16],
+            }),
+        });
+
+        let bytes = index.to_bytes();
+        assert_eq!(bytes.len(), INDEX_HEADER_SIZE + 2 * INDEX_ENTRY_SIZE);
+        assert_eq!(&bytes[0..8], &INDEX_MAGIC);
+
+        let restored = BlockIndex::from_bytes(&bytes).unwrap();
+        assert_eq!(restored, index);
+    }
+
+    #[test]
+    fn test_block_index_invalid_magic() {
+        let mut bytes = BlockIndex::new().to_bytes();
+        bytes[0..8].copy_from_slice(b"BADMAGIC");
+        assert!(matches!(
+            BlockIndex::from_bytes(&bytes),
+            Err(FileFormatError::InvalidIndexMagic)
+        ));
+    }
+
+    #[test]
+    fn test_block_index_truncated() {
+        let mut index = BlockIndex::new();
+        index.push(BlockIndexEntry::from_batch(
+            0,
+            1,
+            &crate::common::EventDataBatch::new(0, 0),
+        ));
+        let bytes = index.to_bytes();
+        assert!(matches!(
+            BlockIndex::from_bytes(&bytes[..bytes.len() - 1]),
+            Err(FileFormatError::TooShort)
+        ));
+    }
+
+    #[test]
+    fn test_block_index_entry_uses_min_max() {
+        let mut batch = crate::common::EventDataBatch::new(3, 0);
+        for ts in [50.0, 10.0, 70.0, 30.0] {
+            batch.push(crate::common::EventData::new(0, 0, 0, 0, ts, 0));
+        }
+        let entry = BlockIndexEntry::from_batch(42, 1000, &batch);
+        assert_eq!(entry.source_id, 3);
+        assert_eq!(entry.num_events, 4);
+        assert!((entry.first_timestamp_ns - 10.0).abs() < f64::EPSILON);
+        assert!((entry.last_timestamp_ns - 70.0).abs() < f64::EPSILON);
+    }
+
+    #[test]
+    fn test_block_index_entry_zone_map() {
+        let mut batch = crate::common::EventDataBatch::new(0, 0);
+        batch.push(crate::common::EventData::new(1, 3, 500, 0, 1.0, 0));
+        batch.push(crate::common::EventData::new(0, 63, 90, 0, 2.0, 0));
+        let mut with_waveform = crate::common::EventData::new(1, 3, 7000, 0, 3.0, 0);
+        with_waveform.waveform = Some(crate::common::Waveform::default());
+        batch.push(with_waveform);
+
+        let zone = BlockIndexEntry::from_batch(0, 1, &batch).zone.unwrap();
+        assert_eq!(zone.min_energy, 90);
+        assert_eq!(zone.max_energy, 7000);
+        assert_eq!(zone.waveform_events, 1);
+        assert!(zone.may_contain(1, 3));
+        assert!(zone.may_contain(0, 63));
+        assert!(!zone.may_contain(0, 3));
+        assert!(!zone.may_contain(2, 3));
+        assert_eq!(zone.channels.iter().map(|w| w.count_ones()).sum::<u32>(), 2);
+    }
+
+    #[test]
+    fn test_block_index_reads_old_entries() {
+        // Sidecar written before zone maps: 40-byte entries
+        let mut index = BlockIndex::new();
+        index.push(BlockIndexEntry::from_batch(
+            64,
+            100,
+            &crate::common::EventDataBatch::new(1, 0),
+        ));
+        let new = index.to_bytes();
+        let mut old = new[..INDEX_HEADER_SIZE].to_vec();
+        old[8..12].copy_from_slice(&(INDEX_ENTRY_MIN_SIZE as u32).to_le_bytes());
+        old.extend_from_slice(&new[INDEX_HEADER_SIZE..INDEX_HEADER_SIZE + INDEX_ENTRY_MIN_SIZE]);
+        old[INDEX_HEADER_SIZE + 20..INDEX_HEADER_SIZE + 24].fill(0);
+
+        let restored = BlockIndex::from_bytes(&old).unwrap();
+        assert_eq!(restored.entries[0].offset, 64);
+        assert_eq!(restored.entries[0].zone, None);
+    }
+
+    fn waveform_batch() -> crate::common::EventDataBatch {
+        let mut batch = crate::common::EventDataBatch::new(0, 0);
+        for i in 0..20 {
+            let mut ev = crate::common::EventData::new(0, i % 16, 1000 + i as u16, 0, i as f64, 0);
+            ev.waveform = Some(crate::common::Waveform {
+                analog_probe1: (0..512).map(|s| (s % 50) as i16 * 10 - 200).collect(),
+                ..Default::default()
+            });
+            batch.push(ev);
+        }
+        batch
+    }
+
+    #[test]
+    fn test_block_compression_roundtrip() {
+        let data = waveform_batch().to_msgpack().unwrap();
+        for compression in [
+            BlockCompression::None,
+            BlockCompression::Lz4,
+            BlockCompression::Zstd,
+        ] {
+            let block = encode_block(&data, compression, 3).unwrap();
+            assert_eq!(block[0], compression.id());
+            assert_eq!(
+                u32::from_le_bytes([block[4], block[5], block[6], block[7]]) as usize,
+                data.len()
+            );
+            if compression != BlockCompression::None {
+                assert!(
+                    block.len() < data.len() / 2,
+                    "{:?}: {}",
+                    compression,
+                    block.len()
+                );
+            }
+            assert_eq!(
+                decode_block(true, &block).unwrap().as_ref(),
+                data.as_slice()
+            );
+        }
+        // v2 blocks are the payload itself
+        assert_eq!(
+            decode_block(false, &data).unwrap().as_ref(),
+            data.as_slice()
+        );
+    }
+
+    #[test]
+    fn test_incompressible_block_stored() {
+        let data: Vec<u8> = (0..64u32)
+            .map(|i| (i.wrapping_mul(2654435761) >> 13) as u8)
+            .collect();
+        let block = encode_block(&data, BlockCompression::Zstd, 3).unwrap();
+        assert_eq!(block[0], BlockCompression::None.id());
+        assert_eq!(&block[BLOCK_HEADER_SIZE..], data.as_slice());
+    }
+
+    #[test]
+    fn test_damaged_block_header() {
+        let data = waveform_batch().to_msgpack().unwrap();
+        let mut block = encode_block(&data, BlockCompression::Lz4, 0).unwrap();
+        assert!(matches!(
+            decode_block(true, &block[..4]),
+            Err(FileFormatError::InvalidBlock(_))
+        ));
+        block[4..8].copy_from_slice(&(data.len() as u32 + 1).to_le_bytes());
+        assert!(decode_block(true, &block).is_err());
+        block[0] = 9;
+        assert!(matches!(
+            decode_block(true, &block),
+            Err(FileFormatError::InvalidBlock(_))
+        ));
+    }
+
+    #[test]
+    fn test_v3_header_magic() {
+        let mut header = FileHeader::new(1, "test".to_string(), 0);
+        header.version = FORMAT_VERSION_V3;
+        let bytes = header.to_bytes().unwrap();
+        assert_eq!(&bytes[0..8], &FILE_MAGIC_V3);
+        let restored = FileHeader::from_bytes(&bytes).unwrap();
+        assert!(restored.has_block_headers());
+    }
+
+    #[test]
+    fn test_sidecar_path() {
+        let path = BlockIndex::sidecar_path(Path::new("/data/run0042_0000_CRIB2026.delila"));
+        assert_eq!(
+            path.to_str().unwrap(),
+            "/data/run0042_0000_CRIB2026.delila.idx"
+        );
+    }
 }
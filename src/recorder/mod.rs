@@ -17,12 +17,21 @@
 //! - Header: Magic "DELILA02" + length (4 bytes) + MsgPack metadata
 //! - Data blocks: length (4 bytes LE) + MsgPack batch (repeated)
 //! - Footer: Fixed 64 bytes with magic "DLEND002", checksums, completion flag
+//! - Index sidecar: `<file>.idx` with one entry per block: offset, time
+//!   range and a zone map (energy range, channels present, waveform count)
+//!
+//! With `compression` set the file is v3 ("DELILA03"): every block gets an
+//! 8-byte block header and its MsgPack payload is LZ4 or zstd compressed
+//! (see `format.rs`). Index offsets, `data_bytes` and the checksum refer to
+//! the stored (compressed) bytes.
 
 mod format;
 
 pub use format::{
-    ChecksumCalculator, DataBlockIterator, DataFileReader, FileFooter, FileFormatError, FileHeader,
-    FileValidationResult, FOOTER_SIZE, FORMAT_VERSION,
+    decode_batch, decode_block, encode_block, BlockCompression, BlockIndex, BlockIndexEntry,
+    BlockZoneMap, ChecksumCalculator, DataBlockIterator, DataFileReader, FileFooter,
+    FileFormatError, FileHeader, FileValidationResult, BLOCK_HEADER_SIZE, FOOTER_SIZE,
+    FORMAT_VERSION, FORMAT_VERSION_V3, INDEX_MAGIC,
 };
 
 use std::fs::{self, File};
@@ -40,7 +49,7 @@ use tracing::{debug, info, warn};
 
 use crate::common::{
     handle_command, run_command_task, CommandHandlerExt, ComponentSharedState, ComponentState,
-    EventDataBatch, Message, RunConfig,
+    EventDataBatch, Message, MsgpackOptions, RunConfig,
 };
 
 /// Recorder configuration
@@ -56,6 +65,12 @@ pub struct RecorderConfig {
     pub max_file_size: u64,
     /// Maximum file duration in seconds (default: 600 = 10min)
     pub max_file_duration_secs: u64,
+    /// Block encoding (analog probes as bin blobs, default: off)
+    pub msgpack_options: MsgpackOptions,
+    /// Per-block compression (default: none, files stay v2)
+    pub compression: BlockCompression,
+    /// zstd level (1-22, default: 3; unused for LZ4)
+    pub compression_level: i32,
 }
 
 impl Default for RecorderConfig {
@@ -66,6 +81,9 @@ impl Default for RecorderConfig {
             output_dir: PathBuf::from("./data"),
             max_file_size: 1024 * 1024 * 1024, // 1GB
             max_file_duration_secs: 600,       // 10 minutes
+            msgpack_options: MsgpackOptions::default(),
+            compression: BlockCompression::None,
+            compression_level: 3,
         }
     }
 }
@@ -216,6 +234,8 @@ struct FileWriter {
     config: RecorderConfig,
     run_config: Option<RunConfig>,
     writer: Option<BufWriter<File>>,
+    /// Path of the file being written (for the index sidecar)
+    current_path: Option<PathBuf>,
     file_sequence: u32,
     current_file_size: u64,
     current_file_start: Option<Instant>,
@@ -226,6 +246,8 @@ struct FileWriter {
     footer: FileFooter,
     /// Header size for current file (needed for data_bytes calculation)
     header_size: u64,
+    /// Block offsets for current file, written as a sidecar on close
+    block_index: BlockIndex,
     /// Whether we have an active run (file can be opened)
     run_active: bool,
 }
@@ -236,6 +258,7 @@ impl FileWriter {
             config,
             run_config: None,
             writer: None,
+            current_path: None,
             file_sequence: 0,
             current_file_size: 0,
             current_file_start: None,
@@ -243,6 +266,7 @@ impl FileWriter {
             checksum: ChecksumCalculator::new(),
             footer: FileFooter::new(),
             header_size: 0,
+            block_index: BlockIndex::new(),
             run_active: false,
         }
     }
@@ -299,6 +323,7 @@ impl FileWriter {
         // Reset checksum and footer for new file
         self.checksum.reset();
         self.footer = FileFooter::new();
+        self.block_index.clear();
 
         // Create and write header
         let run_config = self.run_config.as_ref().expect("RunConfig not set");
@@ -308,6 +333,9 @@ impl FileWriter {
             self.file_sequence,
         );
         header.comment = run_config.comment.clone();
+        if self.config.compression != BlockCompression::None {
+            header.version = FORMAT_VERSION_V3;
+        }
 
         let header_bytes = header
             .to_bytes()
@@ -319,6 +347,7 @@ impl FileWriter {
         self.current_file_start = Some(Instant::now());
 
         self.writer = Some(writer);
+        self.current_path = Some(path.clone());
 
         info!(
             path = %path.display(),
@@ -343,6 +372,7 @@ impl FileWriter {
             writer.flush()?;
             // Final fsync on close
             writer.get_ref().sync_data()?;
+            self.write_index_sidecar();
             self.stats.files_written.fetch_add(1, Ordering::Relaxed);
             self.file_sequence += 1;
 
@@ -357,6 +387,27 @@ impl FileWriter {
         Ok(())
     }
 
+    /// Write the block index next to the closed data file
+    ///
+    /// Failure is not fatal: the data file is complete and the index can be
+    /// rebuilt with `delila-recover index`.
+    fn write_index_sidecar(&mut self) {
+        let Some(data_path) = self.current_path.take() else {
+            return;
+        };
+        self.block_index.data_file_size = self.current_file_size + FOOTER_SIZE as u64;
+
+        let index_path = BlockIndex::sidecar_path(&data_path);
+        let result = File::create(&index_path).and_then(|file| {
+            let mut writer = BufWriter::new(file);
+            writer.write_all(&self.block_index.to_bytes())?;
+            writer.flush()
+        });
+        if let Err(e) = result {
+            warn!(path = %index_path.display(), error = %e, "Failed to write block index");
+        }
+    }
+
     fn needs_rotation(&self) -> bool {
         // Account for footer size in rotation check
         if self.current_file_size + FOOTER_SIZE as u64 >= self.config.max_file_size {
@@ -400,13 +451,27 @@ impl FileWriter {
         }
 
         let event_count = batch.events.len() as u64;
-        let data = batch.to_msgpack()?;
+        let mut data = batch.to_msgpack_with(&self.config.msgpack_options)?;
+        if self.config.compression != BlockCompression::None {
+            data = encode_block(
+                &data,
+                self.config.compression,
+                self.config.compression_level,
+            )
+            .map_err(|e| RecorderError::Io(std::io::Error::other(e.to_string())))?;
+        }
         let len_bytes = (data.len() as u32).to_le_bytes();
 
         if let Some(ref mut writer) = self.writer {
             writer.write_all(&len_bytes)?;
             writer.write_all(&data)?;
 
+            self.block_index.push(BlockIndexEntry::from_batch(
+                self.current_file_size,
+                data.len() as u32,
+                &batch,
+            ));
+
             // Update checksum with data block (length prefix + data)
             self.checksum.update(&len_bytes);
             self.checksum.update(&data);
@@ -457,6 +522,7 @@ impl FileWriter {
         self.checksum = ChecksumCalculator::new();
         self.footer = FileFooter::new();
         self.header_size = 0;
+        self.block_index.clear();
 
         self.run_active = true;
     }
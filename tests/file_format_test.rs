@@ -6,8 +6,11 @@
 
 use std::io::{Cursor, Write};
 
-use delila_rs::common::{EventData, EventDataBatch};
-use delila_rs::recorder::{ChecksumCalculator, DataFileReader, FileFooter, FileHeader};
+use delila_rs::common::{EventData, EventDataBatch, Waveform};
+use delila_rs::recorder::{
+    decode_batch, encode_block, BlockCompression, BlockIndex, ChecksumCalculator, DataFileReader,
+    FileFooter, FileHeader, FORMAT_VERSION_V3,
+};
 use rand::prelude::*;
 use rand::rngs::StdRng;
 
@@ -57,6 +60,16 @@ fn make_random_event(rng: &mut StdRng) -> EventData {
 
 /// Write a complete .delila file (header + batches + footer) into a Vec<u8>.
 fn write_file(header: &FileHeader, batches: &[EventDataBatch]) -> Vec<u8> {
+    write_file_with(header, batches, BlockCompression::None)
+}
+
+/// As `write_file`; with compression the blocks are framed for v3 (the
+/// header must say so).
+fn write_file_with(
+    header: &FileHeader,
+    batches: &[EventDataBatch],
+    compression: BlockCompression,
+) -> Vec<u8> {
     let mut buf = Vec::new();
 
     // Header
@@ -68,7 +81,10 @@ fn write_file(header: &FileHeader, batches: &[EventDataBatch]) -> Vec<u8> {
     let mut total_events = 0u64;
 
     for batch in batches {
-        let data = batch.to_msgpack().expect("serialize batch");
+        let mut data = batch.to_msgpack().expect("serialize batch");
+        if header.has_block_headers() {
+            data = encode_block(&data, compression, 3).expect("compress block");
+        }
         let len_bytes = (data.len() as u32).to_le_bytes();
 
         buf.write_all(&len_bytes).unwrap();
@@ -263,3 +279,112 @@ fn test_footer_statistics() {
     assert_eq!(result.recoverable_blocks, 1);
     assert_eq!(result.recoverable_events, 5);
 }
+
+// ---------------------------------------------------------------------------
+// Test 5: Block index rebuilt from the data points at every block
+// ---------------------------------------------------------------------------
+
+#[test]
+fn test_block_index_matches_blocks() {
+    let header = FileHeader::new(5, "IndexTest".to_string(), 0);
+    let mut rng = StdRng::seed_from_u64(5);
+
+    let batches: Vec<EventDataBatch> = (0..4)
+        .map(|seq| {
+            let mut b = EventDataBatch::new(seq as u32 % 2, seq);
+            for _ in 0..25 {
+                b.push(make_random_event(&mut rng));
+            }
+            b
+        })
+        .collect();
+
+    let file_bytes = write_file(&header, &batches);
+    let cursor = Cursor::new(file_bytes.clone());
+    let mut reader = DataFileReader::new(cursor).expect("open file");
+    let index = reader.build_block_index().expect("build index");
+
+    assert_eq!(index.len(), 4);
+    assert_eq!(index.data_file_size, file_bytes.len() as u64);
+
+    // Survives serialization
+    let restored = BlockIndex::from_bytes(&index.to_bytes()).expect("parse index");
+    assert_eq!(restored, index);
+
+    for (entry, batch) in index.entries.iter().zip(&batches) {
+        // Offset points at the length prefix, and the block decodes in place
+        let off = entry.offset as usize;
+        let len = u32::from_le_bytes(file_bytes[off..off + 4].try_into().unwrap());
+        assert_eq!(len, entry.length);
+        let decoded =
+            EventDataBatch::from_msgpack(&file_bytes[off + 4..off + 4 + len as usize]).unwrap();
+        assert_eq!(decoded.sequence_number, batch.sequence_number);
+
+        assert_eq!(entry.source_id, batch.source_id);
+        assert_eq!(entry.num_events, 25);
+        let min = batch
+            .events
+            .iter()
+            .map(|e| e.timestamp_ns)
+            .fold(f64::MAX, f64::min);
+        let max = batch
+            .events
+            .iter()
+            .map(|e| e.timestamp_ns)
+            .fold(f64::MIN, f64::max);
+        assert_eq!(entry.first_timestamp_ns, min);
+        assert_eq!(entry.last_timestamp_ns, max);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Test: v3 files with compressed blocks
+// ---------------------------------------------------------------------------
+
+#[test]
+fn test_compressed_v3_roundtrip() {
+    for compression in [BlockCompression::Lz4, BlockCompression::Zstd] {
+        let mut header = FileHeader::new(6, "V3Test".to_string(), 0);
+        header.version = FORMAT_VERSION_V3;
+        let mut rng = StdRng::seed_from_u64(6);
+
+        // Waveforms are what compresses
+        let batches: Vec<EventDataBatch> = (0..3)
+            .map(|seq| {
+                let mut b = EventDataBatch::new(0, seq);
+                for _ in 0..400 {
+                    let mut ev = make_random_event(&mut rng);
+                    ev.waveform = Some(Waveform {
+                        analog_probe1: (0..256).map(|s| 100 - (s as i16 - 64).abs()).collect(),
+                        ..Default::default()
+                    });
+                    b.push(ev);
+                }
+                b
+            })
+            .collect();
+
+        let file_bytes = write_file_with(&header, &batches, compression);
+        let plain_bytes = write_file(&FileHeader::new(6, "V3Test".to_string(), 0), &batches);
+        assert_eq!(&file_bytes[0..8], b"DELILA03");
+        assert!(file_bytes.len() < plain_bytes.len(), "{:?}", compression);
+
+        let mut reader = DataFileReader::new(Cursor::new(file_bytes.clone())).expect("open file");
+        let result = reader.validate();
+        assert!(result.is_valid, "{:?}: {:?}", compression, result.errors);
+        assert_eq!(result.recoverable_events, 1200);
+        assert_eq!(verify_all_checksums(&mut reader), 1200);
+
+        // Index entries point at the stored blocks
+        let index = reader.build_block_index().expect("build index");
+        assert_eq!(index.len(), 3);
+        for (entry, batch) in index.entries.iter().zip(&batches) {
+            let off = entry.offset as usize + 4;
+            let stored = &file_bytes[off..off + entry.length as usize];
+            assert_eq!(stored[0], compression.id());
+            let decoded = decode_batch(true, stored).expect("decode block");
+            assert_eq!(decoded.sequence_number, batch.sequence_number);
+            assert_eq!(entry.num_events, 400);
+        }
+    }
+}